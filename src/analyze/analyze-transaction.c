@@ -0,0 +1,192 @@
+/* SPDX-License-Identifier: LGPL-2.1+ */
+
+#include <stdio.h>
+
+#include "alloc-util.h"
+#include "analyze-transaction.h"
+#include "bus-error.h"
+#include "fd-util.h"
+#include "fileio.h"
+#include "log.h"
+#include "manager.h"
+#include "path-util.h"
+#include "rm-rf.h"
+#include "stdio-util.h"
+#include "string-util.h"
+#include "time-util.h"
+
+#define BENCHMARK_RUNS 5U
+
+/* Number of units conflicting with the generated ones, so that starting them also generates stop jobs */
+#define BENCHMARK_CONFLICTS 16U
+
+static int open_unit(const char *dir, const char *name, FILE **ret) {
+        _cleanup_free_ char *p = NULL;
+        FILE *f;
+
+        p = path_join(NULL, dir, name);
+        if (!p)
+                return -ENOMEM;
+
+        f = fopen(p, "we");
+        if (!f)
+                return -errno;
+
+        *ret = f;
+        return 0;
+}
+
+static int generate_units(const char *dir, unsigned n_units) {
+        char name[STRLEN("bench-conflict-.service") + DECIMAL_STR_MAX(unsigned)];
+        _cleanup_fclose_ FILE *target = NULL;
+        unsigned i;
+        int r;
+
+        /* Generates a target pulling in n_units services. Each service requires its parent in a binary tree and
+         * wants another unit a third of the way down, orders itself after both and conflicts with one of a few
+         * other services. This is not meant to look like any real system, but to give all passes of building a
+         * transaction a dense graph to work on. */
+
+        r = open_unit(dir, "bench.target", &target);
+        if (r < 0)
+                return r;
+
+        fputs("[Unit]\n"
+              "AllowIsolate=yes\n", target);
+
+        for (i = 0; i < n_units; i++) {
+                _cleanup_fclose_ FILE *f = NULL;
+
+                xsprintf(name, "bench-%u.service", i);
+                r = open_unit(dir, name, &f);
+                if (r < 0)
+                        return r;
+
+                fprintf(f,
+                        "[Unit]\n"
+                        "Conflicts=bench-conflict-%u.service\n",
+                        i % BENCHMARK_CONFLICTS);
+                if (i > 0)
+                        fprintf(f,
+                                "Requires=bench-%1$u.service\n"
+                                "After=bench-%1$u.service\n",
+                                (i - 1) / 2);
+                if (i >= 3)
+                        fprintf(f,
+                                "Wants=bench-%1$u.service\n"
+                                "After=bench-%1$u.service\n",
+                                i / 3);
+                fputs("[Service]\n"
+                      "Type=oneshot\n"
+                      "ExecStart=/bin/true\n", f);
+
+                r = fflush_and_check(f);
+                if (r < 0)
+                        return r;
+
+                fprintf(target, "Wants=%s\n", name);
+        }
+
+        for (i = 0; i < BENCHMARK_CONFLICTS; i++) {
+                _cleanup_fclose_ FILE *f = NULL;
+
+                xsprintf(name, "bench-conflict-%u.service", i);
+                r = open_unit(dir, name, &f);
+                if (r < 0)
+                        return r;
+
+                fputs("[Service]\n"
+                      "ExecStart=/bin/true\n", f);
+
+                r = fflush_and_check(f);
+                if (r < 0)
+                        return r;
+        }
+
+        return fflush_and_check(target);
+}
+
+static int benchmark_one(Manager *m, Unit *target, JobType type, JobMode mode) {
+        usec_t min = USEC_INFINITY, sum = 0;
+        char buf[FORMAT_TIMESPAN_MAX];
+        unsigned n_jobs = 0, i;
+        int r;
+
+        for (i = 0; i < BENCHMARK_RUNS; i++) {
+                _cleanup_(sd_bus_error_free) sd_bus_error error = SD_BUS_ERROR_NULL;
+                usec_t ts;
+
+                ts = now(CLOCK_MONOTONIC);
+                r = manager_add_job(m, type, target, mode, NULL, &error, NULL);
+                ts = now(CLOCK_MONOTONIC) - ts;
+                if (r < 0)
+                        return log_error_errno(r, "Failed to enqueue %s job for %s: %s",
+                                               job_type_to_string(type), target->id, bus_error_message(&error, r));
+
+                n_jobs = hashmap_size(m->jobs);
+                manager_clear_jobs(m);
+
+                min = MIN(min, ts);
+                sum += ts;
+        }
+
+        printf("%-6s %-8s %7u jobs  min %10s",
+               job_type_to_string(type), job_mode_to_string(mode), n_jobs,
+               format_timespan(buf, sizeof(buf), min, 1));
+        printf("  avg %10s\n", format_timespan(buf, sizeof(buf), sum / BENCHMARK_RUNS, 1));
+
+        return 0;
+}
+
+int benchmark_transactions(UnitFileScope scope, unsigned n_units) {
+        _cleanup_(rm_rf_physical_and_freep) char *dir = NULL;
+        _cleanup_(manager_freep) Manager *m = NULL;
+        char buf[FORMAT_TIMESPAN_MAX];
+        Unit *target;
+        usec_t ts;
+        int r;
+
+        r = mkdtemp_malloc("/tmp/systemd-analyze-XXXXXX", &dir);
+        if (r < 0)
+                return log_error_errno(r, "Failed to create temporary directory: %m");
+
+        r = generate_units(dir, n_units);
+        if (r < 0)
+                return log_error_errno(r, "Failed to generate units: %m");
+
+        /* Only load the generated units */
+        assert_se(set_unit_path(dir) >= 0);
+
+        r = manager_new(scope, MANAGER_TEST_RUN_MINIMAL, &m);
+        if (r < 0)
+                return log_error_errno(r, "Failed to initialize manager: %m");
+
+        r = manager_startup(m, NULL, NULL);
+        if (r < 0)
+                return log_error_errno(r, "Failed to start manager: %m");
+
+        manager_clear_jobs(m);
+
+        ts = now(CLOCK_MONOTONIC);
+        r = manager_load_startable_unit_or_warn(m, "bench.target", NULL, &target);
+        if (r < 0)
+                return r;
+        ts = now(CLOCK_MONOTONIC) - ts;
+
+        printf("Loaded %u units in %s, best and average of %u runs:\n",
+               hashmap_size(m->units), format_timespan(buf, sizeof(buf), ts, 1), BENCHMARK_RUNS);
+
+        r = benchmark_one(m, target, JOB_START, JOB_REPLACE);
+        if (r < 0)
+                return r;
+
+        r = benchmark_one(m, target, JOB_START, JOB_FAIL);
+        if (r < 0)
+                return r;
+
+        r = benchmark_one(m, target, JOB_START, JOB_ISOLATE);
+        if (r < 0)
+                return r;
+
+        return benchmark_one(m, target, JOB_STOP, JOB_REPLACE);
+}
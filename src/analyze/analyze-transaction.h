@@ -0,0 +1,6 @@
+/* SPDX-License-Identifier: LGPL-2.1+ */
+#pragma once
+
+#include "path-lookup.h"
+
+int benchmark_transactions(UnitFileScope scope, unsigned n_units);
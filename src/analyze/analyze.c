@@ -12,6 +12,7 @@
 
 #include "alloc-util.h"
 #include "analyze-security.h"
+#include "analyze-transaction.h"
 #include "analyze-verify.h"
 #include "bus-error.h"
 #include "bus-unit-util.h"
@@ -1058,6 +1059,52 @@ static int analyze_blame(int argc, char *argv[], void *userdata) {
         return 0;
 }
 
+static int analyze_generators(int argc, char *argv[], void *userdata) {
+        _cleanup_(sd_bus_flush_close_unrefp) sd_bus *bus = NULL;
+        _cleanup_(sd_bus_message_unrefp) sd_bus_message *reply = NULL;
+        _cleanup_(sd_bus_error_free) sd_bus_error error = SD_BUS_ERROR_NULL;
+        const char *path;
+        uint64_t duration;
+        int cached, r;
+
+        r = acquire_bus(&bus, NULL);
+        if (r < 0)
+                return log_error_errno(r, "Failed to create bus connection: %m");
+
+        r = sd_bus_get_property(
+                        bus,
+                        "org.freedesktop.systemd1",
+                        "/org/freedesktop/systemd1",
+                        "org.freedesktop.systemd1.Manager",
+                        "GeneratorTimings",
+                        &error,
+                        &reply,
+                        "a(sbt)");
+        if (r < 0)
+                return log_error_errno(r, "Failed to get generator timings: %s", bus_error_message(&error, -r));
+
+        r = sd_bus_message_enter_container(reply, 'a', "(sbt)");
+        if (r < 0)
+                return bus_log_parse_error(r);
+
+        (void) pager_open(arg_no_pager, false);
+
+        while ((r = sd_bus_message_read(reply, "(sbt)", &path, &cached, &duration)) > 0) {
+                char ts[FORMAT_TIMESPAN_MAX];
+
+                if (cached)
+                        printf("%16s %s\n", "cached", path);
+                else if (duration == USEC_INFINITY)
+                        printf("%16s %s\n", "n/a", path);
+                else
+                        printf("%16s %s\n", format_timespan(ts, sizeof(ts), duration, USEC_PER_MSEC), path);
+        }
+        if (r < 0)
+                return bus_log_parse_error(r);
+
+        return 0;
+}
+
 static int analyze_time(int argc, char *argv[], void *userdata) {
         _cleanup_(sd_bus_flush_close_unrefp) sd_bus *bus = NULL;
         _cleanup_free_ char *buf = NULL;
@@ -1673,6 +1720,19 @@ static int do_security(int argc, char *argv[], void *userdata) {
         return analyze_security(bus, strv_skip(argv, 1), 0);
 }
 
+static int do_transaction_benchmark(int argc, char *argv[], void *userdata) {
+        unsigned n = 1000;
+        int r;
+
+        if (argc > 1) {
+                r = safe_atou(argv[1], &n);
+                if (r < 0)
+                        return log_error_errno(r, "Failed to parse number of units '%s': %m", argv[1]);
+        }
+
+        return benchmark_transactions(arg_scope, n);
+}
+
 static int help(int argc, char *argv[], void *userdata) {
 
         (void) pager_open(arg_no_pager, false);
@@ -1698,6 +1758,7 @@ static int help(int argc, char *argv[], void *userdata) {
                "Commands:\n"
                "  time                     Print time spent in the kernel\n"
                "  blame                    Print list of running units ordered by time to init\n"
+               "  generators               Print time each generator took in the last run\n"
                "  critical-chain [UNIT...] Print a tree of the time critical chain of units\n"
                "  plot                     Output SVG graphic showing service initialization\n"
                "  dot [UNIT...]            Output dependency graph in man:dot(1) format\n"
@@ -1711,6 +1772,8 @@ static int help(int argc, char *argv[], void *userdata) {
                "  calendar SPEC...         Validate repetitive calendar time events\n"
                "  service-watchdogs [BOOL] Get/set service watchdog state\n"
                "  security [UNIT...]       Analyze security of unit\n"
+               "  transaction-benchmark [N]\n"
+               "                           Time building transactions for N generated units\n"
                , program_invocation_short_name);
 
         /* When updating this list, including descriptions, apply
@@ -1882,6 +1945,7 @@ int main(int argc, char *argv[]) {
                 { "help",              VERB_ANY, VERB_ANY, 0,            help                   },
                 { "time",              VERB_ANY, 1,        VERB_DEFAULT, analyze_time           },
                 { "blame",             VERB_ANY, 1,        0,            analyze_blame          },
+                { "generators",        VERB_ANY, 1,        0,            analyze_generators     },
                 { "critical-chain",    VERB_ANY, VERB_ANY, 0,            analyze_critical_chain },
                 { "plot",              VERB_ANY, 1,        0,            analyze_plot           },
                 { "dot",               VERB_ANY, VERB_ANY, 0,            dot                    },
@@ -1900,6 +1964,7 @@ int main(int argc, char *argv[]) {
                 { "calendar",          2,        VERB_ANY, 0,            test_calendar          },
                 { "service-watchdogs", VERB_ANY, 2,        0,            service_watchdogs      },
                 { "security",          VERB_ANY, VERB_ANY, 0,            do_security            },
+                { "transaction-benchmark", VERB_ANY, 2,    0,            do_transaction_benchmark },
                 {}
         };
 
@@ -12,14 +12,15 @@
 #include "macro.h"
 #include "parse-util.h"
 #include "process-util.h"
+#include "string-util.h"
 #include "user-util.h"
 
-int audit_session_from_pid(pid_t pid, uint32_t *id) {
-        _cleanup_free_ char *s = NULL;
-        const char *p;
+static int audit_session_read(int dir_fd, const char *filename, uint32_t *id) {
+        char s[DECIMAL_STR_MAX(uint32_t) + 2];
         uint32_t u;
         int r;
 
+        assert(filename);
         assert(id);
 
         /* We don't convert ENOENT to ESRCH here, since we can't
@@ -27,13 +28,11 @@ int audit_session_from_pid(pid_t pid, uint32_t *id) {
          * kernel" and "the process does not exist", both which will
          * result in ENOENT. */
 
-        p = procfs_file_alloca(pid, "sessionid");
-
-        r = read_one_line_file(p, &s);
+        r = read_virtual_file_at(dir_fd, filename, s, sizeof(s), NULL);
         if (r < 0)
                 return r;
 
-        r = safe_atou32(s, &u);
+        r = safe_atou32(truncate_nl(s), &u);
         if (r < 0)
                 return r;
 
@@ -44,21 +43,29 @@ int audit_session_from_pid(pid_t pid, uint32_t *id) {
         return 0;
 }
 
-int audit_loginuid_from_pid(pid_t pid, uid_t *uid) {
-        _cleanup_free_ char *s = NULL;
-        const char *p;
+int audit_session_from_pid(pid_t pid, uint32_t *id) {
+        return audit_session_read(AT_FDCWD, procfs_file_alloca(pid, "sessionid"), id);
+}
+
+int audit_session_from_proc_fd(int proc_fd, uint32_t *id) {
+        assert(proc_fd >= 0);
+
+        return audit_session_read(proc_fd, "sessionid", id);
+}
+
+static int audit_loginuid_read(int dir_fd, const char *filename, uid_t *uid) {
+        char s[DECIMAL_STR_MAX(uid_t) + 2];
         uid_t u;
         int r;
 
+        assert(filename);
         assert(uid);
 
-        p = procfs_file_alloca(pid, "loginuid");
-
-        r = read_one_line_file(p, &s);
+        r = read_virtual_file_at(dir_fd, filename, s, sizeof(s), NULL);
         if (r < 0)
                 return r;
 
-        r = parse_uid(s, &u);
+        r = parse_uid(truncate_nl(s), &u);
         if (r == -ENXIO) /* the UID was -1 */
                 return -ENODATA;
         if (r < 0)
@@ -68,6 +75,16 @@ int audit_loginuid_from_pid(pid_t pid, uid_t *uid) {
         return 0;
 }
 
+int audit_loginuid_from_pid(pid_t pid, uid_t *uid) {
+        return audit_loginuid_read(AT_FDCWD, procfs_file_alloca(pid, "loginuid"), uid);
+}
+
+int audit_loginuid_from_proc_fd(int proc_fd, uid_t *uid) {
+        assert(proc_fd >= 0);
+
+        return audit_loginuid_read(proc_fd, "loginuid", uid);
+}
+
 bool use_audit(void) {
         static int cached_use = -1;
 
@@ -10,6 +10,9 @@
 int audit_session_from_pid(pid_t pid, uint32_t *id);
 int audit_loginuid_from_pid(pid_t pid, uid_t *uid);
 
+int audit_session_from_proc_fd(int proc_fd, uint32_t *id);
+int audit_loginuid_from_proc_fd(int proc_fd, uid_t *uid);
+
 bool use_audit(void);
 
 static inline bool audit_session_is_valid(uint32_t id) {
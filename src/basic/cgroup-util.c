@@ -994,15 +994,14 @@ int cg_get_xattr(const char *controller, const char *path, const char *name, voi
         return (int) n;
 }
 
-int cg_pid_get_path(const char *controller, pid_t pid, char **path) {
-        _cleanup_fclose_ FILE *f = NULL;
-        char line[LINE_MAX];
-        const char *fs, *controller_str;
+static int cg_pid_get_path_internal(const char *controller, int dir_fd, const char *filename, char **path) {
+        _cleanup_free_ char *allocated = NULL;
+        char buf[4096], *contents, *line, *next;
+        const char *controller_str;
         size_t cs = 0;
-        int unified;
+        int unified, r;
 
         assert(path);
-        assert(pid >= 0);
 
         if (controller) {
                 if (!cg_controller_is_valid(controller))
@@ -1022,17 +1021,25 @@ int cg_pid_get_path(const char *controller, pid_t pid, char **path) {
                 cs = strlen(controller_str);
         }
 
-        fs = procfs_file_alloca(pid, "cgroup");
-        f = fopen(fs, "re");
-        if (!f)
-                return errno == ENOENT ? -ESRCH : -errno;
-
-        (void) __fsetlocking(f, FSETLOCKING_BYCALLER);
+        /* The file is short in the common case, hence try a buffer on the stack first, and only allocate one if
+         * that's not enough, i.e. if there are many hierarchies or very long paths. */
+        r = read_virtual_file_at(dir_fd, filename, buf, sizeof(buf), NULL);
+        if (r == -E2BIG) {
+                r = read_full_virtual_file_at(dir_fd, filename, &allocated, NULL);
+                contents = allocated;
+        } else
+                contents = buf;
+        if (r == -ENOENT)
+                return -ESRCH;
+        if (r < 0)
+                return r;
 
-        FOREACH_LINE(line, f, return -errno) {
+        for (line = contents; line && *line; line = next) {
                 char *e, *p;
 
-                truncate_nl(line);
+                next = strchr(line, '\n');
+                if (next)
+                        *(next++) = 0;
 
                 if (unified) {
                         e = startswith(line, "0:");
@@ -1083,6 +1090,19 @@ int cg_pid_get_path(const char *controller, pid_t pid, char **path) {
         return -ENODATA;
 }
 
+int cg_pid_get_path(const char *controller, pid_t pid, char **path) {
+        assert(pid >= 0);
+
+        return cg_pid_get_path_internal(controller, AT_FDCWD, procfs_file_alloca(pid, "cgroup"), path);
+}
+
+int cg_pid_get_path_at(const char *controller, int proc_fd, char **path) {
+        assert(proc_fd >= 0);
+
+        /* Like cg_pid_get_path(), but takes an fd to the /proc directory of the process, see procfs_pid_open() */
+        return cg_pid_get_path_internal(controller, proc_fd, "cgroup", path);
+}
+
 int cg_install_release_agent(const char *controller, const char *agent) {
         _cleanup_free_ char *fs = NULL, *contents = NULL;
         const char *sc;
@@ -1406,24 +1426,17 @@ int cg_shift_path(const char *cgroup, const char *root, const char **shifted) {
         return 0;
 }
 
-int cg_pid_get_path_shifted(pid_t pid, const char *root, char **cgroup) {
-        _cleanup_free_ char *raw = NULL;
+static int cg_shift_raw_path(char *raw, const char *root, char **cgroup) {
+        _cleanup_free_ char *p = raw;
         const char *c;
         int r;
 
-        assert(pid >= 0);
-        assert(cgroup);
-
-        r = cg_pid_get_path(SYSTEMD_CGROUP_CONTROLLER, pid, &raw);
-        if (r < 0)
-                return r;
-
-        r = cg_shift_path(raw, root, &c);
+        r = cg_shift_path(p, root, &c);
         if (r < 0)
                 return r;
 
-        if (c == raw)
-                *cgroup = TAKE_PTR(raw);
+        if (c == p)
+                *cgroup = TAKE_PTR(p);
         else {
                 char *n;
 
@@ -1437,6 +1450,34 @@ int cg_pid_get_path_shifted(pid_t pid, const char *root, char **cgroup) {
         return 0;
 }
 
+int cg_pid_get_path_shifted(pid_t pid, const char *root, char **cgroup) {
+        char *raw;
+        int r;
+
+        assert(pid >= 0);
+        assert(cgroup);
+
+        r = cg_pid_get_path(SYSTEMD_CGROUP_CONTROLLER, pid, &raw);
+        if (r < 0)
+                return r;
+
+        return cg_shift_raw_path(raw, root, cgroup);
+}
+
+int cg_pid_get_path_shifted_at(int proc_fd, const char *root, char **cgroup) {
+        char *raw;
+        int r;
+
+        assert(proc_fd >= 0);
+        assert(cgroup);
+
+        r = cg_pid_get_path_at(SYSTEMD_CGROUP_CONTROLLER, proc_fd, &raw);
+        if (r < 0)
+                return r;
+
+        return cg_shift_raw_path(raw, root, cgroup);
+}
+
 int cg_path_decode_unit(const char *cgroup, char **unit) {
         char *c, *s;
         size_t n;
@@ -2031,7 +2072,13 @@ int cg_get_attribute(const char *controller, const char *path, const char *attri
         if (r < 0)
                 return r;
 
-        return read_one_line_file(p, ret);
+        r = read_full_virtual_file(p, ret, NULL);
+        if (r < 0)
+                return r;
+
+        /* Only the first line is of interest */
+        (*ret)[strcspn(*ret, NEWLINE)] = 0;
+        return 0;
 }
 
 int cg_get_keyed_attribute_full(
@@ -2059,7 +2106,7 @@ int cg_get_keyed_attribute_full(
         if (r < 0)
                 return r;
 
-        r = read_full_file(filename, &contents, NULL);
+        r = read_full_virtual_file(filename, &contents, NULL);
         if (r < 0)
                 return r;
 
@@ -4,6 +4,7 @@
 #include <errno.h>
 #include <sys/prctl.h>
 #include <sys/types.h>
+#include <sys/wait.h>
 #include <unistd.h>
 #include <stdio.h>
 
@@ -14,6 +15,7 @@
 #include "fd-util.h"
 #include "fileio.h"
 #include "hashmap.h"
+#include "io-util.h"
 #include "macro.h"
 #include "process-util.h"
 #include "set.h"
@@ -27,7 +29,7 @@
 /* Put this test here for a lack of better place */
 assert_cc(EAGAIN == EWOULDBLOCK);
 
-static int do_spawn(const char *path, char *argv[], int stdout_fd, pid_t *pid) {
+static int do_spawn(const char *path, char *argv[], char *envp[], int stdout_fd, pid_t *pid) {
 
         pid_t _pid;
         int r;
@@ -56,7 +58,10 @@ static int do_spawn(const char *path, char *argv[], int stdout_fd, pid_t *pid) {
                 } else
                         argv[0] = (char*) path;
 
-                execv(path, argv);
+                if (envp)
+                        execve(path, argv, envp);
+                else
+                        execv(path, argv);
                 log_error_errno(errno, "Failed to execute %s: %m", path);
                 _exit(EXIT_FAILURE);
         }
@@ -115,7 +120,7 @@ static int do_execute(
                                 return log_error_errno(fd, "Failed to open serialization file: %m");
                 }
 
-                r = do_spawn(t, argv, fd, &pid);
+                r = do_spawn(t, argv, NULL, fd, &pid);
                 if (r <= 0)
                         continue;
 
@@ -214,6 +219,124 @@ int execute_directories(
         return 0;
 }
 
+static int do_execute_binaries(
+                char **paths,
+                char ***argvs,
+                char ***envps,
+                usec_t timeout,
+                int output_fd) {
+
+        _cleanup_hashmap_free_ Hashmap *pids = NULL;
+        _cleanup_free_ usec_t *started = NULL, *durations = NULL;
+        size_t i, n;
+        int r;
+
+        n = strv_length(paths);
+
+        started = new(usec_t, n);
+        durations = new(usec_t, n);
+        pids = hashmap_new(NULL);
+        if (!started || !durations || !pids)
+                return log_oom();
+
+        if (timeout != USEC_INFINITY)
+                alarm(DIV_ROUND_UP(timeout, USEC_PER_SEC));
+
+        for (i = 0; i < n; i++) {
+                pid_t pid;
+
+                durations[i] = USEC_INFINITY;
+
+                r = do_spawn(paths[i], argvs ? argvs[i] : NULL, envps ? envps[i] : NULL, -1, &pid);
+                if (r <= 0)
+                        continue;
+
+                started[i] = now(CLOCK_MONOTONIC);
+
+                /* Index plus one, so that the first one is not mistaken for a missing entry */
+                r = hashmap_put(pids, PID_TO_PTR(pid), SIZE_TO_PTR(i + 1));
+                if (r < 0)
+                        return log_oom();
+        }
+
+        /* Wait for the binaries in the order they finish, so that we know how long each of them took */
+        while (!hashmap_isempty(pids)) {
+                siginfo_t si = {};
+
+                if (waitid(P_ALL, 0, &si, WEXITED|WNOWAIT) < 0) {
+                        if (errno == EINTR)
+                                continue;
+
+                        return log_error_errno(errno, "Failed to wait for children: %m");
+                }
+
+                i = PTR_TO_SIZE(hashmap_remove(pids, PID_TO_PTR(si.si_pid)));
+                if (i == 0) {
+                        (void) wait_for_terminate(si.si_pid, NULL);
+                        continue;
+                }
+                i--;
+
+                durations[i] = now(CLOCK_MONOTONIC) - started[i];
+
+                (void) wait_for_terminate_and_check(paths[i], si.si_pid, WAIT_LOG);
+        }
+
+        return loop_write(output_fd, durations, n * sizeof(usec_t), false);
+}
+
+int execute_binaries(
+                const char *name,
+                char **paths,
+                char ***argvs,
+                char ***envps,
+                usec_t timeout,
+                usec_t *ret_durations) {
+
+        _cleanup_close_ int fd = -1;
+        size_t i, n;
+        ssize_t l;
+        int r;
+
+        assert(name);
+
+        /* Like execute_directories() without callbacks, i.e. runs the binaries in parallel and waits for them to
+         * finish, but for an explicit list of binaries, each with its own arguments and environment. If requested,
+         * returns how long each of them took, or USEC_INFINITY for those that didn't run or didn't finish. */
+
+        n = strv_length(paths);
+        if (ret_durations)
+                for (i = 0; i < n; i++)
+                        ret_durations[i] = USEC_INFINITY;
+
+        if (n == 0)
+                return 0;
+
+        fd = open_serialization_fd(name);
+        if (fd < 0)
+                return log_error_errno(fd, "Failed to open serialization file: %m");
+
+        r = safe_fork("(sd-executor)", FORK_RESET_SIGNALS|FORK_DEATHSIG|FORK_LOG|FORK_WAIT, NULL);
+        if (r < 0)
+                return r;
+        if (r == 0) {
+                r = do_execute_binaries(paths, argvs, envps, timeout, fd);
+                _exit(r < 0 ? EXIT_FAILURE : EXIT_SUCCESS);
+        }
+
+        if (!ret_durations)
+                return 0;
+
+        l = pread(fd, ret_durations, n * sizeof(usec_t), 0);
+        if (l < 0)
+                return log_error_errno(errno, "Failed to read execution times: %m");
+        if ((size_t) l != n * sizeof(usec_t))
+                for (i = 0; i < n; i++)
+                        ret_durations[i] = USEC_INFINITY;
+
+        return 0;
+}
+
 static int gather_environment_generate(int fd, void *arg) {
         char ***env = arg, **x, **y;
         _cleanup_fclose_ FILE *f = NULL;
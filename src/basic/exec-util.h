@@ -20,4 +20,12 @@ int execute_directories(
                 void* const callback_args[_STDOUT_CONSUME_MAX],
                 char *argv[]);
 
+int execute_binaries(
+                const char *name,
+                char **paths,
+                char ***argvs,
+                char ***envps,
+                usec_t timeout,
+                usec_t *ret_durations);
+
 extern const gather_stdout_callback_t gather_environment[_STDOUT_CONSUME_MAX];
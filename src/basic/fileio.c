@@ -276,7 +276,7 @@ int verify_file(const char *fn, const char *blob, bool accept_extra_nl) {
         return 1;
 }
 
-int read_full_virtual_file(const char *filename, char **ret_contents, size_t *ret_size) {
+int read_full_virtual_file_at(int dir_fd, const char *filename, char **ret_contents, size_t *ret_size) {
         _cleanup_free_ char *buf = NULL;
         _cleanup_close_ int fd = -1;
         struct stat st;
@@ -284,6 +284,8 @@ int read_full_virtual_file(const char *filename, char **ret_contents, size_t *re
         int n_retries;
         char *p;
 
+        assert(dir_fd >= 0 || dir_fd == AT_FDCWD);
+        assert(filename);
         assert(ret_contents);
 
         /* Virtual filesystems such as sysfs or procfs use kernfs, and kernfs can work
@@ -295,7 +297,7 @@ int read_full_virtual_file(const char *filename, char **ret_contents, size_t *re
          * why the usage of fread(3) is prohibited in this case as it always performs a
          * second call to read(2) looking for EOF. See issue 13585. */
 
-        fd = open(filename, O_RDONLY|O_CLOEXEC);
+        fd = openat(dir_fd, filename, O_RDONLY|O_CLOEXEC|O_NOCTTY);
         if (fd < 0)
                 return -errno;
 
@@ -383,6 +385,47 @@ int read_full_virtual_file(const char *filename, char **ret_contents, size_t *re
         return 0;
 }
 
+int read_virtual_file_fd(int fd, char *buf, size_t size, size_t *ret_size) {
+        ssize_t n;
+
+        assert(fd >= 0);
+        assert(buf);
+        assert(size > 0);
+
+        /* Like read_full_virtual_file(), but reads into a buffer supplied by the caller, which needs room for the
+         * trailing NUL byte. The file is read with a single pread() at offset 0, hence the same fd may be kept
+         * open and used again for later reads, procfs and sysfs regenerate the contents for each of them. If the
+         * contents don't fit into the buffer we return -E2BIG. */
+
+        n = pread(fd, buf, size, 0);
+        if (n < 0)
+                return -errno;
+        if ((size_t) n >= size)
+                return -E2BIG;
+
+        if (!ret_size) {
+                if (memchr(buf, 0, n))
+                        return -EBADMSG;
+        } else
+                *ret_size = n;
+
+        buf[n] = 0;
+        return 0;
+}
+
+int read_virtual_file_at(int dir_fd, const char *filename, char *buf, size_t size, size_t *ret_size) {
+        _cleanup_close_ int fd = -1;
+
+        assert(dir_fd >= 0 || dir_fd == AT_FDCWD);
+        assert(filename);
+
+        fd = openat(dir_fd, filename, O_RDONLY|O_CLOEXEC|O_NOCTTY);
+        if (fd < 0)
+                return -errno;
+
+        return read_virtual_file_fd(fd, buf, size, ret_size);
+}
+
 int read_full_stream(FILE *f, char **contents, size_t *size) {
         _cleanup_free_ char *buf = NULL;
         struct stat st;
@@ -1082,22 +1125,17 @@ int executable_is_script(const char *path, char **interpreter) {
  * terminator specifies the terminating characters of the field value (not
  * included in the value).
  */
-int get_proc_field(const char *filename, const char *pattern, const char *terminator, char **field) {
-        _cleanup_free_ char *status = NULL;
-        char *t, *f;
+int parse_proc_field(const char *contents, const char *pattern, const char *terminator, char **field) {
+        const char *t;
+        char *f;
         size_t len;
-        int r;
 
-        assert(terminator);
-        assert(filename);
+        assert(contents);
         assert(pattern);
+        assert(terminator);
         assert(field);
 
-        r = read_full_virtual_file(filename, &status, NULL);
-        if (r < 0)
-                return r;
-
-        t = status;
+        t = contents;
 
         do {
                 bool pattern_ok;
@@ -1108,7 +1146,7 @@ int get_proc_field(const char *filename, const char *pattern, const char *termin
                                 return -ENOENT;
 
                         /* Check that pattern occurs in beginning of line. */
-                        pattern_ok = (t == status || t[-1] == '\n');
+                        pattern_ok = (t == contents || t[-1] == '\n');
 
                         t += strlen(pattern);
 
@@ -1147,6 +1185,19 @@ int get_proc_field(const char *filename, const char *pattern, const char *termin
         return 0;
 }
 
+int get_proc_field(const char *filename, const char *pattern, const char *terminator, char **field) {
+        _cleanup_free_ char *status = NULL;
+        int r;
+
+        assert(filename);
+
+        r = read_full_virtual_file(filename, &status, NULL);
+        if (r < 0)
+                return r;
+
+        return parse_proc_field(status, pattern, terminator, field);
+}
+
 DIR *xopendirat(int fd, const char *name, int flags) {
         int nfd;
         DIR *d;
@@ -2,6 +2,7 @@
 #pragma once
 
 #include <dirent.h>
+#include <fcntl.h>
 #include <stdbool.h>
 #include <stddef.h>
 #include <stdio.h>
@@ -38,7 +39,12 @@ int write_string_filef(const char *fn, WriteStringFileFlags flags, const char *f
 int read_one_line_file(const char *fn, char **line);
 int read_full_file(const char *fn, char **contents, size_t *size);
 int read_full_stream(FILE *f, char **contents, size_t *size);
-int read_full_virtual_file(const char *filename, char **ret_contents, size_t *ret_size);
+int read_full_virtual_file_at(int dir_fd, const char *filename, char **ret_contents, size_t *ret_size);
+static inline int read_full_virtual_file(const char *filename, char **ret_contents, size_t *ret_size) {
+        return read_full_virtual_file_at(AT_FDCWD, filename, ret_contents, ret_size);
+}
+int read_virtual_file_fd(int fd, char *buf, size_t size, size_t *ret_size);
+int read_virtual_file_at(int dir_fd, const char *filename, char *buf, size_t size, size_t *ret_size);
 
 int verify_file(const char *fn, const char *blob, bool accept_extra_nl);
 
@@ -53,6 +59,7 @@ int write_env_file(const char *fname, char **l);
 
 int executable_is_script(const char *path, char **interpreter);
 
+int parse_proc_field(const char *contents, const char *pattern, const char *terminator, char **field);
 int get_proc_field(const char *filename, const char *pattern, const char *terminator, char **field);
 
 DIR *xopendirat(int dirfd, const char *name, int flags);
@@ -13,6 +13,10 @@ struct hash_ops {
         compare_func_t compare;
         free_func_t free_key;
         free_func_t free_value;
+
+        /* If true, the keys are never chosen by untrusted parties (pointers, internal ids, …), hence the cheaper
+         * SipHash-1-3 is used for them, instead of SipHash-2-4. */
+        bool trusted_keys;
 };
 
 #define _DEFINE_HASH_OPS(uq, name, type, hash_func, compare_func, free_key_func, free_value_func, scope) \
@@ -82,7 +86,7 @@ int path_compare_func(const char *a, const char *b) _pure_;
 extern const struct hash_ops path_hash_ops;
 
 /* This will compare the passed pointers directly, and will not dereference them. This is hence not useful for strings
- * or suchlike. */
+ * or suchlike. Keys are considered trusted, see above. */
 void trivial_hash_func(const void *p, struct siphash *state);
 int trivial_compare_func(const void *a, const void *b) _const_;
 extern const struct hash_ops trivial_hash_ops;
@@ -250,7 +250,6 @@ assert_cc(sizeof(Hashmap) == sizeof(Set));
 struct hashmap_type_info {
         size_t head_size;
         size_t entry_size;
-        struct mempool *mempool;
         unsigned n_direct_buckets;
 };
 
@@ -258,23 +257,44 @@ static const struct hashmap_type_info hashmap_type_info[_HASHMAP_TYPE_MAX] = {
         [HASHMAP_TYPE_PLAIN] = {
                 .head_size        = sizeof(Hashmap),
                 .entry_size       = sizeof(struct plain_hashmap_entry),
-                .mempool          = &hashmap_pool,
                 .n_direct_buckets = DIRECT_BUCKETS(struct plain_hashmap_entry),
         },
         [HASHMAP_TYPE_ORDERED] = {
                 .head_size        = sizeof(OrderedHashmap),
                 .entry_size       = sizeof(struct ordered_hashmap_entry),
-                .mempool          = &ordered_hashmap_pool,
                 .n_direct_buckets = DIRECT_BUCKETS(struct ordered_hashmap_entry),
         },
         [HASHMAP_TYPE_SET] = {
                 .head_size        = sizeof(Set),
                 .entry_size       = sizeof(struct set_entry),
-                .mempool          = &hashmap_pool,
                 .n_direct_buckets = DIRECT_BUCKETS(struct set_entry),
         },
 };
 
+/* The pools are per-thread, hence these can't be referenced from hashmap_type_info[] */
+static struct mempool *hashmap_mempool(enum HashmapType type) {
+        return type == HASHMAP_TYPE_ORDERED ? &ordered_hashmap_pool : &hashmap_pool;
+}
+
+size_t hashmap_trim_pools(void) {
+        return mempool_trim(&hashmap_pool) + mempool_trim(&ordered_hashmap_pool);
+}
+
+void hashmap_get_pool_stats(struct mempool_stats *ret) {
+        struct mempool_stats plain, ordered;
+
+        assert(ret);
+
+        mempool_get_stats(&hashmap_pool, &plain);
+        mempool_get_stats(&ordered_hashmap_pool, &ordered);
+
+        *ret = (struct mempool_stats) {
+                .n_pools = plain.n_pools + ordered.n_pools,
+                .n_tiles = plain.n_tiles + ordered.n_tiles,
+                .n_free = plain.n_free + ordered.n_free,
+        };
+}
+
 #if VALGRIND
 __attribute__((destructor)) static void cleanup_pools(void) {
         _cleanup_free_ char *t = NULL;
@@ -282,9 +302,8 @@ __attribute__((destructor)) static void cleanup_pools(void) {
 
         /* Be nice to valgrind */
 
-        /* The pool is only allocated by the main thread, but the memory can
-         * be passed to other threads. Let's clean up if we are the main thread
-         * and no other threads are live. */
+        /* The pools of other threads may still be in use by them, and the memory can be passed
+         * between threads. Let's clean up if we are the main thread and no other threads are live. */
         if (!is_main_thread())
                 return;
 
@@ -335,13 +354,18 @@ static unsigned base_bucket_hash(HashmapBase *h, const void *p) {
         struct siphash state;
         uint64_t hash;
 
-        siphash24_init(&state, hash_key(h));
+        if (h->hash_ops->trusted_keys)
+                siphash13_init(&state, hash_key(h));
+        else
+                siphash24_init(&state, hash_key(h));
 
         h->hash_ops->hash(p, &state);
 
         hash = siphash24_finalize(&state);
 
-        return (unsigned) (hash % n_buckets(h));
+        /* Map the upper 32 bits of the hash onto [0, n_buckets) by multiplication instead of a 64bit division,
+         * which is quite a bit slower and shows up in profiles of lookup-heavy code. */
+        return (unsigned) (((hash >> 32) * n_buckets(h)) >> 32);
 }
 #define bucket_hash(h, p) base_bucket_hash(HASHMAP_BASE(h), p)
 
@@ -771,9 +795,9 @@ static struct HashmapBase *hashmap_base_new(const struct hash_ops *hash_ops, enu
         const struct hashmap_type_info *hi = &hashmap_type_info[type];
         bool use_pool;
 
-        use_pool = is_main_thread();
+        use_pool = mempool_enabled();
 
-        h = use_pool ? mempool_alloc0_tile(hi->mempool) : malloc0(hi->head_size);
+        h = use_pool ? mempool_alloc0_tile(hashmap_mempool(type)) : malloc0(hi->head_size);
 
         if (!h)
                 return NULL;
@@ -858,7 +882,7 @@ static void hashmap_free_no_clear(HashmapBase *h) {
 #endif
 
         if (h->from_pool)
-                mempool_free_tile(hashmap_type_info[h->type].mempool, h);
+                mempool_free_tile(hashmap_mempool(h->type), h);
         else
                 free(h);
 }
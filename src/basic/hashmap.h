@@ -393,6 +393,13 @@ static inline char **ordered_hashmap_get_strv(OrderedHashmap *h) {
 #define ORDERED_HASHMAP_FOREACH_KEY(e, k, h, i) \
         for ((i) = ITERATOR_FIRST; ordered_hashmap_iterate((h), &(i), (void**)&(e), (const void**) &(k)); )
 
+/* The hashmap objects themselves are allocated from per-thread pools, where enabled (see mempool_enabled()). These
+ * release pools of the calling thread that are entirely unused (returning the number of bytes freed), and report
+ * their usage. */
+struct mempool_stats;
+size_t hashmap_trim_pools(void);
+void hashmap_get_pool_stats(struct mempool_stats *ret);
+
 DEFINE_TRIVIAL_CLEANUP_FUNC(Hashmap*, hashmap_free);
 DEFINE_TRIVIAL_CLEANUP_FUNC(Hashmap*, hashmap_free_free);
 DEFINE_TRIVIAL_CLEANUP_FUNC(Hashmap*, hashmap_free_free_free);
@@ -1,18 +1,156 @@
 /* SPDX-License-Identifier: LGPL-2.1+ */
 
+#include <pthread.h>
 #include <stdint.h>
 #include <stdlib.h>
 
 #include "macro.h"
 #include "mempool.h"
+#include "process-util.h"
 #include "util.h"
 
 struct pool {
         struct pool *next;
         size_t n_tiles;
         size_t n_used;
+        size_t n_free; /* only valid during mempool_trim() */
 };
 
+static bool thread_pools_enabled = false;
+static pthread_key_t registered_key;
+static pthread_once_t registered_key_once = PTHREAD_ONCE_INIT;
+static bool registered_key_valid = false;
+static thread_local struct mempool *registered_pools = NULL;
+
+static void *pool_tile(struct mempool *mp, struct pool *p, size_t i) {
+        return ((uint8_t*) p) + ALIGN(sizeof(struct pool)) + i*mp->tile_size;
+}
+
+static struct pool *pool_of_tile(struct mempool *mp, void *tile) {
+        struct pool *p;
+
+        for (p = mp->first_pool; p; p = p->next)
+                if ((uint8_t*) tile >= (uint8_t*) pool_tile(mp, p, 0) &&
+                    (uint8_t*) tile < (uint8_t*) pool_tile(mp, p, p->n_tiles))
+                        return p;
+
+        return NULL;
+}
+
+static size_t pool_size(struct mempool *mp, struct pool *p) {
+        return PAGE_ALIGN(ALIGN(sizeof(struct pool)) + p->n_tiles*mp->tile_size);
+}
+
+static void mempool_hand_off(struct mempool *mp) {
+        struct pool *last_pool;
+        void **last_tile;
+
+        /* Moves all pools and free tiles of the calling thread to the depot, so that other threads can
+         * make use of them. Tiles not yet handed out are put on the freelist first, as only the first
+         * pool of a thread is ever allocated from incrementally. */
+
+        if (!mp->depot || (!mp->first_pool && !mp->freelist))
+                return;
+
+        if (mp->first_pool)
+                while (mp->first_pool->n_used < mp->first_pool->n_tiles) {
+                        void *tile = pool_tile(mp, mp->first_pool, mp->first_pool->n_used++);
+
+                        * (void**) tile = mp->freelist;
+                        mp->freelist = tile;
+                }
+
+        assert_se(pthread_mutex_lock(&mp->depot->mutex) == 0);
+
+        if (mp->first_pool) {
+                for (last_pool = mp->first_pool; last_pool->next; last_pool = last_pool->next)
+                        ;
+                last_pool->next = mp->depot->first_pool;
+                mp->depot->first_pool = mp->first_pool;
+        }
+
+        if (mp->freelist) {
+                for (last_tile = mp->freelist; *last_tile; last_tile = *last_tile)
+                        ;
+                *last_tile = mp->depot->freelist;
+                mp->depot->freelist = mp->freelist;
+        }
+
+        assert_se(pthread_mutex_unlock(&mp->depot->mutex) == 0);
+
+        mp->first_pool = NULL;
+        mp->freelist = NULL;
+}
+
+static void registered_pools_hand_off(void *userdata) {
+        struct mempool *mp;
+
+        /* Called on thread exit */
+
+        while ((mp = registered_pools)) {
+                registered_pools = mp->registered_next;
+                mp->registered_next = NULL;
+                mp->registered = false;
+
+                mempool_hand_off(mp);
+        }
+}
+
+static void registered_key_create(void) {
+        registered_key_valid = pthread_key_create(&registered_key, registered_pools_hand_off) == 0;
+}
+
+static void mempool_register(struct mempool *mp) {
+        if (!thread_pools_enabled || mp->registered || !mp->depot)
+                return;
+
+        if (pthread_once(&registered_key_once, registered_key_create) != 0 || !registered_key_valid)
+                return;
+
+        /* Any non-NULL value makes sure registered_pools_hand_off() is called when the thread exits */
+        if (pthread_setspecific(registered_key, mp) != 0)
+                return;
+
+        mp->registered_next = registered_pools;
+        registered_pools = mp;
+        mp->registered = true;
+}
+
+static bool mempool_adopt(struct mempool *mp) {
+        struct pool *last_pool;
+
+        /* Takes over the pools and free tiles left behind by threads that exited. Our freelist is empty
+         * when this is called. */
+
+        assert(!mp->freelist);
+
+        if (!mp->depot)
+                return false;
+
+        assert_se(pthread_mutex_lock(&mp->depot->mutex) == 0);
+
+        if (mp->depot->first_pool) {
+                /* Keep our own first pool first, the adopted ones are fully handed out */
+                for (last_pool = mp->depot->first_pool; last_pool->next; last_pool = last_pool->next)
+                        ;
+
+                if (mp->first_pool) {
+                        last_pool->next = mp->first_pool->next;
+                        mp->first_pool->next = mp->depot->first_pool;
+                } else
+                        mp->first_pool = mp->depot->first_pool;
+        }
+
+        mp->freelist = mp->depot->freelist;
+
+        mp->depot->first_pool = NULL;
+        mp->depot->freelist = NULL;
+
+        assert_se(pthread_mutex_unlock(&mp->depot->mutex) == 0);
+
+        return mp->freelist;
+}
+
 void* mempool_alloc_tile(struct mempool *mp) {
         size_t i;
 
@@ -35,6 +173,11 @@ void* mempool_alloc_tile(struct mempool *mp) {
                 size_t size, n;
                 struct pool *p;
 
+                mempool_register(mp);
+
+                if (mempool_adopt(mp))
+                        return mempool_alloc_tile(mp);
+
                 n = mp->first_pool ? mp->first_pool->n_tiles : 0;
                 n = MAX(mp->at_least, n * 2);
                 size = PAGE_ALIGN(ALIGN(sizeof(struct pool)) + n*mp->tile_size);
@@ -53,7 +196,7 @@ void* mempool_alloc_tile(struct mempool *mp) {
 
         i = mp->first_pool->n_used++;
 
-        return ((uint8_t*) mp->first_pool) + ALIGN(sizeof(struct pool)) + i*mp->tile_size;
+        return pool_tile(mp, mp->first_pool, i);
 }
 
 void* mempool_alloc0_tile(struct mempool *mp) {
@@ -66,14 +209,95 @@ void* mempool_alloc0_tile(struct mempool *mp) {
 }
 
 void mempool_free_tile(struct mempool *mp, void *p) {
+        if (_unlikely_(!mp->registered)) {
+                if (thread_pools_enabled)
+                        /* Make sure the tile isn't lost if this thread exits, even if it never allocated
+                         * from this pool */
+                        mempool_register(mp);
+                else if (mp->depot && !is_main_thread()) {
+                        /* We have no way to learn about this thread exiting, hence return the tile to the
+                         * depot right away, from where the main thread picks it up again. */
+                        assert_se(pthread_mutex_lock(&mp->depot->mutex) == 0);
+                        * (void**) p = mp->depot->freelist;
+                        mp->depot->freelist = p;
+                        assert_se(pthread_mutex_unlock(&mp->depot->mutex) == 0);
+                        return;
+                }
+        }
+
         * (void**) p = mp->freelist;
         mp->freelist = p;
 }
 
+void mempool_enable_thread_pools(void) {
+        thread_pools_enabled = true;
+}
+
+bool mempool_enabled(void) {
+        return thread_pools_enabled || is_main_thread();
+}
+
+size_t mempool_trim(struct mempool *mp) {
+        struct pool *p, **pp;
+        void **tile;
+        size_t freed = 0;
+
+        /* Releases all pools of the calling thread whose tiles are all on its freelist, and returns the
+         * number of bytes freed. Tiles of a pool that live on another thread's freelist keep it around. */
+
+        for (p = mp->first_pool; p; p = p->next)
+                p->n_free = 0;
+
+        for (tile = mp->freelist; tile; tile = *tile) {
+                p = pool_of_tile(mp, tile);
+                if (p)
+                        p->n_free++;
+        }
+
+        /* Drop the tiles of pools we are about to free from the freelist */
+        for (tile = (void**) &mp->freelist; *tile; ) {
+                p = pool_of_tile(mp, *tile);
+                if (p && p->n_free == p->n_used)
+                        *tile = * (void**) *tile;
+                else
+                        tile = *tile;
+        }
+
+        for (pp = &mp->first_pool; *pp; ) {
+                p = *pp;
+
+                if (p->n_free == p->n_used) {
+                        *pp = p->next;
+                        freed += pool_size(mp, p);
+                        free(p);
+                } else
+                        pp = &p->next;
+        }
+
+        return freed;
+}
+
+void mempool_get_stats(struct mempool *mp, struct mempool_stats *ret) {
+        struct mempool_stats stats = {};
+        struct pool *p;
+        void **tile;
+
+        assert(ret);
+
+        for (p = mp->first_pool; p; p = p->next) {
+                stats.n_pools++;
+                stats.n_tiles += p->n_used;
+        }
+
+        for (tile = mp->freelist; tile; tile = *tile)
+                stats.n_free++;
+
+        *ret = stats;
+}
+
 #if VALGRIND
 
-void mempool_drop(struct mempool *mp) {
-        struct pool *p = mp->first_pool;
+static void pools_free(struct pool *p) {
         while (p) {
                 struct pool *n;
                 n = p->next;
@@ -82,4 +306,10 @@ void mempool_drop(struct mempool *mp) {
         }
 }
 
+void mempool_drop(struct mempool *mp) {
+        pools_free(mp->first_pool);
+        if (mp->depot)
+                pools_free(mp->depot->first_pool);
+}
+
 #endif
@@ -2,25 +2,62 @@
 #pragma once
 
 
+#include <pthread.h>
+#include <stdbool.h>
 #include <stddef.h>
 
+#include "macro.h"
+
 struct pool;
 
+/* Pools and free tiles of threads that exited, to be adopted by the next thread that runs out of tiles. Shared
+ * between all threads, hence protected by a mutex. */
+struct mempool_depot {
+        pthread_mutex_t mutex;
+        struct pool *first_pool;
+        void *freelist;
+};
+
+/* Every thread has its own instance of this, hence allocating and freeing tiles requires no locking. Tiles may be
+ * freed by a different thread than the one that allocated them, they'll then be reused by the freeing thread. */
 struct mempool {
         struct pool *first_pool;
         void *freelist;
         size_t tile_size;
         unsigned at_least;
+        struct mempool_depot *depot;
+        struct mempool *registered_next;
+        bool registered;
+};
+
+struct mempool_stats {
+        size_t n_pools;    /* pools owned by the calling thread */
+        size_t n_tiles;    /* tiles handed out from these pools so far */
+        size_t n_free;     /* tiles on the calling thread's freelist */
 };
 
 void* mempool_alloc_tile(struct mempool *mp);
 void* mempool_alloc0_tile(struct mempool *mp);
 void mempool_free_tile(struct mempool *mp, void *p);
 
+/* Pools are only used on the main thread by default. Threads other than that need a TSD destructor to hand their
+ * pools off when they exit, which must not be registered from code that may be unloaded again (such as NSS or PAM
+ * modules, or libsystemd.so when dlopen()ed). Hence executables have to opt in explicitly, before creating any
+ * threads. mempool_enabled() tells callers whether the calling thread may allocate from pools. */
+void mempool_enable_thread_pools(void);
+bool mempool_enabled(void);
+
+size_t mempool_trim(struct mempool *mp);
+void mempool_get_stats(struct mempool *mp, struct mempool_stats *ret);
+
 #define DEFINE_MEMPOOL(pool_name, tile_type, alloc_at_least) \
-static struct mempool pool_name = { \
+static struct mempool_depot pool_name##_depot = { \
+        .mutex = PTHREAD_MUTEX_INITIALIZER, \
+}; \
+static thread_local struct mempool pool_name = { \
         .tile_size = sizeof(tile_type), \
         .at_least = alloc_at_least, \
+        .depot = &pool_name##_depot, \
 }
 
 #if VALGRIND
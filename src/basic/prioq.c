@@ -7,7 +7,7 @@
  * priority. Insertion and removal are Θ(log n). Optionally, the caller can
  * provide a pointer to an index which will be kept up-to-date by the prioq.
  *
- * The underlying algorithm used in this implementation is a Heap.
+ * The underlying algorithm used in this implementation is a 4-ary Heap.
  */
 
 #include <errno.h>
@@ -20,6 +20,7 @@
 struct prioq_item {
         void *data;
         unsigned *idx;
+        uint64_t key;
 };
 
 struct Prioq {
@@ -29,6 +30,10 @@ struct Prioq {
         struct prioq_item *items;
 };
 
+/* The heap is 4-ary rather than binary: it is half as deep, and the four children of an item are adjacent in
+ * memory, which makes up for the additional comparisons on the way down. */
+#define PRIOQ_ARITY 4U
+
 Prioq *prioq_new(compare_func_t compare_func) {
         Prioq *q;
 
@@ -61,112 +66,119 @@ int prioq_ensure_allocated(Prioq **q, compare_func_t compare_func) {
         return 0;
 }
 
-static void swap(Prioq *q, unsigned j, unsigned k) {
-        void *saved_data;
-        unsigned *saved_idx;
-
-        assert(q);
-        assert(j < q->n_items);
-        assert(k < q->n_items);
+static inline int compare(Prioq *q, const struct prioq_item *a, const struct prioq_item *b) {
+        if (q->compare_func)
+                return q->compare_func(a->data, b->data);
 
-        assert(!q->items[j].idx || *(q->items[j].idx) == j);
-        assert(!q->items[k].idx || *(q->items[k].idx) == k);
-
-        saved_data = q->items[j].data;
-        saved_idx = q->items[j].idx;
-        q->items[j].data = q->items[k].data;
-        q->items[j].idx = q->items[k].idx;
-        q->items[k].data = saved_data;
-        q->items[k].idx = saved_idx;
+        return CMP(a->key, b->key);
+}
 
-        if (q->items[j].idx)
-                *q->items[j].idx = j;
+static inline void place(Prioq *q, unsigned idx, const struct prioq_item *i) {
+        q->items[idx] = *i;
 
-        if (q->items[k].idx)
-                *q->items[k].idx = k;
+        if (i->idx)
+                *i->idx = idx;
 }
 
+/* Instead of swapping items pairwise, the item being moved is kept aside while the items it passes are moved
+ * into the hole it leaves, so that each item and its index pointer are written only once. */
+
 static unsigned shuffle_up(Prioq *q, unsigned idx) {
+        struct prioq_item item;
+
         assert(q);
+        assert(idx < q->n_items);
+
+        item = q->items[idx];
 
         while (idx > 0) {
                 unsigned k;
 
-                k = (idx-1)/2;
+                k = (idx-1) / PRIOQ_ARITY;
 
-                if (q->compare_func(q->items[k].data, q->items[idx].data) <= 0)
+                if (compare(q, q->items + k, &item) <= 0)
                         break;
 
-                swap(q, idx, k);
+                place(q, idx, q->items + k);
                 idx = k;
         }
 
+        place(q, idx, &item);
         return idx;
 }
 
 static unsigned shuffle_down(Prioq *q, unsigned idx) {
+        struct prioq_item item;
+
         assert(q);
+        assert(idx < q->n_items);
+
+        item = q->items[idx];
 
         for (;;) {
                 unsigned j, k, s;
 
-                k = (idx+1)*2; /* right child */
-                j = k-1;       /* left child */
-
+                j = idx * PRIOQ_ARITY + 1; /* first child */
                 if (j >= q->n_items)
                         break;
 
-                if (q->compare_func(q->items[j].data, q->items[idx].data) < 0)
-
-                        /* So our left child is smaller than we are, let's
-                         * remember this fact */
-                        s = j;
-                else
-                        s = idx;
-
-                if (k < q->n_items &&
-                    q->compare_func(q->items[k].data, q->items[s].data) < 0)
-
-                        /* So our right child is smaller than we are, let's
-                         * remember this fact */
-                        s = k;
+                /* Find the smallest child */
+                s = j;
+                for (k = j + 1; k < MIN(j + PRIOQ_ARITY, q->n_items); k++)
+                        if (compare(q, q->items + k, q->items + s) < 0)
+                                s = k;
 
-                /* s now points to the smallest of the three items */
-
-                if (s == idx)
-                        /* No swap necessary, we're done */
+                if (compare(q, q->items + s, &item) >= 0)
+                        /* No child is smaller than us, we're done */
                         break;
 
-                swap(q, idx, s);
+                place(q, idx, q->items + s);
                 idx = s;
         }
 
+        place(q, idx, &item);
         return idx;
 }
 
-int prioq_put(Prioq *q, void *data, unsigned *idx) {
-        struct prioq_item *i;
-        unsigned k;
+static int prioq_make_space(Prioq *q, unsigned n) {
+        struct prioq_item *j;
+        unsigned m;
 
         assert(q);
 
-        if (q->n_items >= q->n_allocated) {
-                unsigned n;
-                struct prioq_item *j;
+        if (q->n_items + n <= q->n_allocated)
+                return 0;
 
-                n = MAX((q->n_items+1) * 2, 16u);
-                j = reallocarray(q->items, n, sizeof(struct prioq_item));
-                if (!j)
-                        return -ENOMEM;
+        if (n > UINT_MAX / 2 - q->n_items)
+                return -ENOMEM;
 
-                q->items = j;
-                q->n_allocated = n;
-        }
+        m = MAX((q->n_items + n) * 2, 16u);
+        j = reallocarray(q->items, m, sizeof(struct prioq_item));
+        if (!j)
+                return -ENOMEM;
+
+        q->items = j;
+        q->n_allocated = m;
+
+        return 0;
+}
+
+int prioq_put_with_key(Prioq *q, void *data, unsigned *idx, uint64_t key) {
+        unsigned k;
+        int r;
+
+        assert(q);
+
+        r = prioq_make_space(q, 1);
+        if (r < 0)
+                return r;
 
         k = q->n_items++;
-        i = q->items + k;
-        i->data = data;
-        i->idx = idx;
+        q->items[k] = (struct prioq_item) {
+                .data = data,
+                .idx = idx,
+                .key = key,
+        };
 
         if (idx)
                 *idx = k;
@@ -176,6 +188,60 @@ int prioq_put(Prioq *q, void *data, unsigned *idx) {
         return 0;
 }
 
+int prioq_put(Prioq *q, void *data, unsigned *idx) {
+        return prioq_put_with_key(q, data, idx, 0);
+}
+
+static void heapify(Prioq *q) {
+        unsigned k;
+
+        assert(q);
+
+        /* Builds the heap bottom-up in O(n), starting with the parent of the last item */
+        if (q->n_items <= 1)
+                return;
+
+        k = (q->n_items - 2) / PRIOQ_ARITY + 1;
+        while (k > 0)
+                shuffle_down(q, --k);
+}
+
+int prioq_put_many(Prioq *q, void **data, unsigned **idx, const uint64_t *keys, unsigned n) {
+        unsigned i, k;
+        int r;
+
+        assert(q);
+        assert(data || n == 0);
+
+        r = prioq_make_space(q, n);
+        if (r < 0)
+                return r;
+
+        k = q->n_items;
+        for (i = 0; i < n; i++) {
+                q->items[k + i] = (struct prioq_item) {
+                        .data = data[i],
+                        .idx = idx ? idx[i] : NULL,
+                        .key = keys ? keys[i] : 0,
+                };
+
+                if (q->items[k + i].idx)
+                        *q->items[k + i].idx = k + i;
+        }
+
+        q->n_items += n;
+
+        /* Building the heap from scratch is cheaper than inserting the items one by one, unless only a few
+         * items are added to a large queue. */
+        if (n > k)
+                heapify(q);
+        else
+                for (i = k; i < q->n_items; i++)
+                        shuffle_up(q, i);
+
+        return 0;
+}
+
 static void remove_item(Prioq *q, struct prioq_item *i) {
         struct prioq_item *l;
 
@@ -195,10 +261,7 @@ static void remove_item(Prioq *q, struct prioq_item *i) {
 
                 k = i - q->items;
 
-                i->data = l->data;
-                i->idx = l->idx;
-                if (i->idx)
-                        *i->idx = k;
+                place(q, k, l);
                 q->n_items--;
 
                 k = shuffle_down(q, k);
@@ -213,7 +276,7 @@ _pure_ static struct prioq_item* find_item(Prioq *q, void *data, unsigned *idx)
 
         if (idx) {
                 if (*idx == PRIOQ_IDX_NULL ||
-                    *idx > q->n_items)
+                    *idx >= q->n_items)
                         return NULL;
 
                 i = q->items + *idx;
@@ -259,6 +322,36 @@ int prioq_reshuffle(Prioq *q, void *data, unsigned *idx) {
         return 1;
 }
 
+int prioq_set_key(Prioq *q, void *data, unsigned *idx, uint64_t key) {
+        struct prioq_item *i;
+        unsigned k;
+        bool decrease;
+
+        assert(q);
+
+        i = find_item(q, data, idx);
+        if (!i)
+                return 0;
+
+        decrease = key < i->key;
+        i->key = key;
+
+        /* Only one direction needs to be looked at */
+        k = i - q->items;
+        if (decrease)
+                shuffle_up(q, k);
+        else
+                shuffle_down(q, k);
+        return 1;
+}
+
+void prioq_reshuffle_all(Prioq *q) {
+        if (!q)
+                return;
+
+        heapify(q);
+}
+
 void *prioq_peek_by_index(Prioq *q, unsigned idx) {
         if (!q)
                 return NULL;
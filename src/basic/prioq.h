@@ -2,6 +2,7 @@
 #pragma once
 
 #include <stdbool.h>
+#include <stdint.h>
 
 #include "hashmap.h"
 #include "macro.h"
@@ -10,13 +11,20 @@ typedef struct Prioq Prioq;
 
 #define PRIOQ_IDX_NULL ((unsigned) -1)
 
+/* If compare is NULL, items are ordered by the key passed to prioq_put_with_key() instead. The key is stored
+ * alongside the item, hence the items don't need to be dereferenced while the queue is shuffled. */
 Prioq *prioq_new(compare_func_t compare);
 Prioq *prioq_free(Prioq *q);
+DEFINE_TRIVIAL_CLEANUP_FUNC(Prioq*, prioq_free);
 int prioq_ensure_allocated(Prioq **q, compare_func_t compare_func);
 
 int prioq_put(Prioq *q, void *data, unsigned *idx);
+int prioq_put_with_key(Prioq *q, void *data, unsigned *idx, uint64_t key);
+int prioq_put_many(Prioq *q, void **data, unsigned **idx, const uint64_t *keys, unsigned n);
 int prioq_remove(Prioq *q, void *data, unsigned *idx);
 int prioq_reshuffle(Prioq *q, void *data, unsigned *idx);
+int prioq_set_key(Prioq *q, void *data, unsigned *idx, uint64_t key);
+void prioq_reshuffle_all(Prioq *q);
 
 void *prioq_peek_by_index(Prioq *q, unsigned idx) _pure_;
 static inline void *prioq_peek(Prioq *q) {
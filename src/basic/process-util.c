@@ -70,33 +70,43 @@ int get_process_state(pid_t pid) {
         return (unsigned char) state;
 }
 
-int get_process_comm(pid_t pid, char **ret) {
-        _cleanup_free_ char *escaped = NULL, *comm = NULL;
-        const char *p;
+static int get_process_comm_internal(int dir_fd, const char *filename, char **ret) {
+        _cleanup_free_ char *escaped = NULL;
+        char comm[128];
         int r;
 
+        assert(filename);
         assert(ret);
-        assert(pid >= 0);
 
         escaped = new(char, TASK_COMM_LEN);
         if (!escaped)
                 return -ENOMEM;
 
-        p = procfs_file_alloca(pid, "comm");
-
-        r = read_one_line_file(p, &comm);
+        r = read_virtual_file_at(dir_fd, filename, comm, sizeof(comm), NULL);
         if (r == -ENOENT)
                 return -ESRCH;
         if (r < 0)
                 return r;
 
         /* Escape unprintable characters, just in case, but don't grow the string beyond the underlying size */
-        cellescape(escaped, TASK_COMM_LEN, comm);
+        cellescape(escaped, TASK_COMM_LEN, truncate_nl(comm));
 
         *ret = TAKE_PTR(escaped);
         return 0;
 }
 
+int get_process_comm(pid_t pid, char **ret) {
+        assert(pid >= 0);
+
+        return get_process_comm_internal(AT_FDCWD, procfs_file_alloca(pid, "comm"), ret);
+}
+
+int get_process_comm_at(int proc_fd, char **ret) {
+        assert(proc_fd >= 0);
+
+        return get_process_comm_internal(proc_fd, "comm", ret);
+}
+
 int get_process_cmdline(pid_t pid, size_t max_length, bool comm_fallback, char **line) {
         _cleanup_fclose_ FILE *f = NULL;
         bool space = false;
@@ -446,13 +456,13 @@ int get_process_capeff(pid_t pid, char **capeff) {
         return r;
 }
 
-static int get_process_link_contents(const char *proc_file, char **name) {
+static int get_process_link_contents(int dir_fd, const char *proc_file, char **name) {
         int r;
 
         assert(proc_file);
         assert(name);
 
-        r = readlink_malloc(proc_file, name);
+        r = readlinkat_malloc(dir_fd, proc_file, name);
         if (r == -ENOENT)
                 return -ESRCH;
         if (r < 0)
@@ -461,15 +471,11 @@ static int get_process_link_contents(const char *proc_file, char **name) {
         return 0;
 }
 
-int get_process_exe(pid_t pid, char **name) {
-        const char *p;
+static int get_process_exe_internal(int dir_fd, const char *proc_file, char **name) {
         char *d;
         int r;
 
-        assert(pid >= 0);
-
-        p = procfs_file_alloca(pid, "exe");
-        r = get_process_link_contents(p, name);
+        r = get_process_link_contents(dir_fd, proc_file, name);
         if (r < 0)
                 return r;
 
@@ -480,6 +486,18 @@ int get_process_exe(pid_t pid, char **name) {
         return 0;
 }
 
+int get_process_exe(pid_t pid, char **name) {
+        assert(pid >= 0);
+
+        return get_process_exe_internal(AT_FDCWD, procfs_file_alloca(pid, "exe"), name);
+}
+
+int get_process_exe_at(int proc_fd, char **name) {
+        assert(proc_fd >= 0);
+
+        return get_process_exe_internal(proc_fd, "exe", name);
+}
+
 static int get_process_id(pid_t pid, const char *field, uid_t *uid) {
         _cleanup_fclose_ FILE *f = NULL;
         char line[LINE_MAX];
@@ -547,7 +565,7 @@ int get_process_cwd(pid_t pid, char **cwd) {
 
         p = procfs_file_alloca(pid, "cwd");
 
-        return get_process_link_contents(p, cwd);
+        return get_process_link_contents(AT_FDCWD, p, cwd);
 }
 
 int get_process_root(pid_t pid, char **root) {
@@ -557,7 +575,7 @@ int get_process_root(pid_t pid, char **root) {
 
         p = procfs_file_alloca(pid, "root");
 
-        return get_process_link_contents(p, root);
+        return get_process_link_contents(AT_FDCWD, p, root);
 }
 
 int get_process_environ(pid_t pid, char **env) {
@@ -1,6 +1,7 @@
 /* SPDX-License-Identifier: LGPL-2.1+ */
 
 #include <errno.h>
+#include <fcntl.h>
 
 #include "alloc-util.h"
 #include "def.h"
@@ -12,30 +13,48 @@
 #include "stdio-util.h"
 #include "string-util.h"
 
-int procfs_get_pid_max(uint64_t *ret) {
-        _cleanup_free_ char *value = NULL;
-        int r;
+int procfs_pid_open(pid_t pid) {
+        char path[STRLEN("/proc/") + DECIMAL_STR_MAX(pid_t)];
+        int fd;
 
-        assert(ret);
+        assert(pid >= 0);
 
-        r = read_one_line_file("/proc/sys/kernel/pid_max", &value);
-        if (r < 0)
-                return r;
+        /* Returns an O_PATH fd to the /proc directory of the specified process, for use with
+         * read_virtual_file_at() and friends. This saves the path lookup on every read, and pins the process: once
+         * it is gone reads through the fd fail with ESRCH, even if its PID got reused in the meantime. */
+
+        if (pid == 0)
+                strcpy(path, "/proc/self");
+        else
+                xsprintf(path, "/proc/" PID_FMT, pid);
+
+        fd = open(path, O_PATH|O_DIRECTORY|O_CLOEXEC);
+        if (fd < 0)
+                return errno == ENOENT ? -ESRCH : -errno;
 
-        return safe_atou64(value, ret);
+        return fd;
 }
 
-int procfs_get_threads_max(uint64_t *ret) {
-        _cleanup_free_ char *value = NULL;
+static int procfs_read_u64(const char *path, uint64_t *ret) {
+        char buf[DECIMAL_STR_MAX(uint64_t) + 2];
         int r;
 
+        assert(path);
         assert(ret);
 
-        r = read_one_line_file("/proc/sys/kernel/threads-max", &value);
+        r = read_virtual_file_at(AT_FDCWD, path, buf, sizeof(buf), NULL);
         if (r < 0)
                 return r;
 
-        return safe_atou64(value, ret);
+        return safe_atou64(truncate_nl(buf), ret);
+}
+
+int procfs_get_pid_max(uint64_t *ret) {
+        return procfs_read_u64("/proc/sys/kernel/pid_max", ret);
+}
+
+int procfs_get_threads_max(uint64_t *ret) {
+        return procfs_read_u64("/proc/sys/kernel/threads-max", ret);
 }
 
 int procfs_tasks_set_limit(uint64_t limit) {
@@ -88,14 +107,14 @@ int procfs_tasks_set_limit(uint64_t limit) {
 }
 
 int procfs_tasks_get_current(uint64_t *ret) {
-        _cleanup_free_ char *value = NULL;
+        char value[LINE_MAX];
         const char *p, *nr;
         size_t n;
         int r;
 
         assert(ret);
 
-        r = read_one_line_file("/proc/loadavg", &value);
+        r = read_virtual_file_at(AT_FDCWD, "/proc/loadavg", value, sizeof(value), NULL);
         if (r < 0)
                 return r;
 
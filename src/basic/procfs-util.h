@@ -2,9 +2,12 @@
 #pragma once
 
 #include <inttypes.h>
+#include <sys/types.h>
 
 #include "time-util.h"
 
+int procfs_pid_open(pid_t pid);
+
 int procfs_get_pid_max(uint64_t *ret);
 int procfs_get_threads_max(uint64_t *ret);
 
@@ -68,6 +68,11 @@ void siphash24_init(struct siphash *state, const uint8_t k[16]) {
         };
 }
 
+void siphash13_init(struct siphash *state, const uint8_t k[16]) {
+        siphash24_init(state, k);
+        state->reduced = true;
+}
+
 void siphash24_compress(const void *_in, size_t inlen, struct siphash *state) {
 
         const uint8_t *in = _in;
@@ -100,7 +105,8 @@ void siphash24_compress(const void *_in, size_t inlen, struct siphash *state) {
 
                 state->v3 ^= state->padding;
                 sipround(state);
-                sipround(state);
+                if (!state->reduced)
+                        sipround(state);
                 state->v0 ^= state->padding;
 
                 state->padding = 0;
@@ -119,7 +125,8 @@ void siphash24_compress(const void *_in, size_t inlen, struct siphash *state) {
 #endif
                 state->v3 ^= m;
                 sipround(state);
-                sipround(state);
+                if (!state->reduced)
+                        sipround(state);
                 state->v0 ^= m;
         }
 
@@ -168,7 +175,8 @@ uint64_t siphash24_finalize(struct siphash *state) {
 
         state->v3 ^= b;
         sipround(state);
-        sipround(state);
+        if (!state->reduced)
+                sipround(state);
         state->v0 ^= b;
 
 #ifdef DEBUG
@@ -182,7 +190,8 @@ uint64_t siphash24_finalize(struct siphash *state) {
         sipround(state);
         sipround(state);
         sipround(state);
-        sipround(state);
+        if (!state->reduced)
+                sipround(state);
 
         return state->v0 ^ state->v1 ^ state->v2  ^ state->v3;
 }
@@ -198,3 +207,15 @@ uint64_t siphash24(const void *in, size_t inlen, const uint8_t k[16]) {
 
         return siphash24_finalize(&state);
 }
+
+uint64_t siphash13(const void *in, size_t inlen, const uint8_t k[16]) {
+        struct siphash state;
+
+        assert(in);
+        assert(k);
+
+        siphash13_init(&state, k);
+        siphash24_compress(in, inlen, &state);
+
+        return siphash24_finalize(&state);
+}
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <inttypes.h>
+#include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
 #include <sys/types.h>
@@ -12,12 +13,19 @@ struct siphash {
         uint64_t v3;
         uint64_t padding;
         size_t inlen;
+        bool reduced; /* SipHash-1-3 instead of SipHash-2-4 */
 };
 
 void siphash24_init(struct siphash *state, const uint8_t k[16]);
+
+/* Same as above, but sets up the state for SipHash-1-3, i.e. one compression and three finalization rounds. This is
+ * considerably cheaper for the short keys we usually hash, but should only be used where the hashed data cannot be
+ * chosen by an attacker. siphash24_compress() and siphash24_finalize() work on both kinds of state. */
+void siphash13_init(struct siphash *state, const uint8_t k[16]);
 void siphash24_compress(const void *in, size_t inlen, struct siphash *state);
 #define siphash24_compress_byte(byte, state) siphash24_compress((const uint8_t[]) { (byte) }, 1, (state))
 
 uint64_t siphash24_finalize(struct siphash *state);
 
 uint64_t siphash24(const void *in, size_t inlen, const uint8_t k[16]);
+uint64_t siphash13(const void *in, size_t inlen, const uint8_t k[16]);
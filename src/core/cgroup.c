@@ -10,6 +10,7 @@
 #include "bus-error.h"
 #include "cgroup-util.h"
 #include "cgroup.h"
+#include "extract-word.h"
 #include "fd-util.h"
 #include "fileio.h"
 #include "fs-util.h"
@@ -439,13 +440,111 @@ static int lookup_block_device(const char *p, dev_t *ret) {
         return 0;
 }
 
-static int whitelist_device(const char *path, const char *node, const char *acc) {
+static int unit_write_cgroup_attribute(Unit *u, const char *controller, const char *attribute, const char *value) {
+        assert(u);
+
+        u->manager->n_cgroup_attribute_writes++;
+        return cg_set_attribute(controller, u->cgroup_path, attribute, value);
+}
+
+static void unit_forget_cgroup_attribute(Unit *u, const char *key) {
+        char *k, *v;
+
+        v = hashmap_remove2(u->cgroup_attributes, key, (void**) &k);
+        free(k);
+        free(v);
+}
+
+static void unit_forget_cgroup_attributes(Unit *u, CGroupMask keep) {
+        Iterator i;
+        char *key;
+        void *v;
+
+        assert(u);
+
+        /* Forgets what we wrote for all controllers not in the mask, as their attributes are not there anymore or
+         * will be reset to the defaults once the controller is turned on again */
+
+        HASHMAP_FOREACH_KEY(v, key, u->cgroup_attributes, i) {
+                _cleanup_free_ char *controller = NULL;
+                CGroupController c;
+
+                controller = strndup(key, strcspn(key, "."));
+                c = controller ? cgroup_controller_from_string(controller) : _CGROUP_CONTROLLER_INVALID;
+                if (c >= 0 && FLAGS_SET(keep, CGROUP_CONTROLLER_TO_MASK(c)))
+                        continue;
+
+                unit_forget_cgroup_attribute(u, key);
+        }
+}
+
+static int unit_set_cgroup_attribute(Unit *u, const char *controller, const char *attribute, const char *value, bool keyed) {
+        _cleanup_free_ char *key = NULL, *copy = NULL;
+        char *old;
+        int r;
+
+        assert(u);
+        assert(attribute);
+        assert(value);
+
+        /* Like unit_write_cgroup_attribute(), but doesn't write the value again if we did so last time. Attributes
+         * that take one line per device are "keyed": the first word of the value, i.e. the device, is part of what
+         * we remember the value by. */
+
+        if (keyed) {
+                if (asprintf(&key, "%s %.*s", attribute, (int) strcspn(value, WHITESPACE), value) < 0)
+                        return -ENOMEM;
+        } else {
+                key = strdup(attribute);
+                if (!key)
+                        return -ENOMEM;
+        }
+
+        old = hashmap_get(u->cgroup_attributes, key);
+        if (streq_ptr(old, value)) {
+                u->manager->n_cgroup_attribute_writes_skipped++;
+                return 0;
+        }
+
+        r = unit_write_cgroup_attribute(u, controller, attribute, value);
+        if (r < 0) {
+                /* Who knows what the kernel has now, let's write it next time in any case */
+                unit_forget_cgroup_attribute(u, key);
+                return r;
+        }
+
+        /* Failing to remember the value is not fatal, we'll just write it again next time */
+        copy = strdup(value);
+        if (!copy) {
+                unit_forget_cgroup_attribute(u, key);
+                return 0;
+        }
+
+        if (old) {
+                assert_se(hashmap_update(u->cgroup_attributes, key, copy) >= 0);
+                free(old);
+                TAKE_PTR(copy);
+                return 0;
+        }
+
+        if (hashmap_ensure_allocated(&u->cgroup_attributes, &string_hash_ops) < 0)
+                return 0;
+
+        if (hashmap_put(u->cgroup_attributes, key, copy) < 0)
+                return 0;
+
+        TAKE_PTR(key);
+        TAKE_PTR(copy);
+        return 0;
+}
+
+static int whitelist_device(Unit *u, const char *node, const char *acc) {
         char buf[2+DECIMAL_STR_MAX(dev_t)*2+2+4];
         struct stat st;
         bool ignore_notfound;
         int r;
 
-        assert(path);
+        assert(u);
         assert(acc);
 
         if (node[0] == '-') {
@@ -473,21 +572,21 @@ static int whitelist_device(const char *path, const char *node, const char *acc)
                 major(st.st_rdev), minor(st.st_rdev),
                 acc);
 
-        r = cg_set_attribute("devices", path, "devices.allow", buf);
+        r = unit_write_cgroup_attribute(u, "devices", "devices.allow", buf);
         if (r < 0)
                 log_full_errno(IN_SET(r, -ENOENT, -EROFS, -EINVAL, -EACCES) ? LOG_DEBUG : LOG_WARNING, r,
-                               "Failed to set devices.allow on %s: %m", path);
+                               "Failed to set devices.allow on %s: %m", u->cgroup_path);
 
         return r;
 }
 
-static int whitelist_major(const char *path, const char *name, char type, const char *acc) {
+static int whitelist_major(Unit *u, const char *name, char type, const char *acc) {
         _cleanup_fclose_ FILE *f = NULL;
         char line[LINE_MAX];
         bool good = false;
         int r;
 
-        assert(path);
+        assert(u);
         assert(acc);
         assert(IN_SET(type, 'b', 'c'));
 
@@ -544,10 +643,10 @@ static int whitelist_major(const char *path, const char *name, char type, const
                         maj,
                         acc);
 
-                r = cg_set_attribute("devices", path, "devices.allow", buf);
+                r = unit_write_cgroup_attribute(u, "devices", "devices.allow", buf);
                 if (r < 0)
                         log_full_errno(IN_SET(r, -ENOENT, -EROFS, -EINVAL, -EACCES) ? LOG_DEBUG : LOG_WARNING, r,
-                                       "Failed to set devices.allow on %s: %m", path);
+                                       "Failed to set devices.allow on %s: %m", u->cgroup_path);
         }
 
         return 0;
@@ -625,7 +724,7 @@ static void cgroup_apply_unified_cpu_config(Unit *u, uint64_t weight, uint64_t q
         int r;
 
         xsprintf(buf, "%" PRIu64 "\n", weight);
-        r = cg_set_attribute("cpu", u->cgroup_path, "cpu.weight", buf);
+        r = unit_set_cgroup_attribute(u, "cpu", "cpu.weight", buf, false);
         if (r < 0)
                 log_unit_full(u, IN_SET(r, -ENOENT, -EROFS, -EACCES) ? LOG_DEBUG : LOG_WARNING, r,
                               "Failed to set cpu.weight: %m");
@@ -637,7 +736,7 @@ static void cgroup_apply_unified_cpu_config(Unit *u, uint64_t weight, uint64_t q
         else
                 xsprintf(buf, "max " USEC_FMT "\n", period);
 
-        r = cg_set_attribute("cpu", u->cgroup_path, "cpu.max", buf);
+        r = unit_set_cgroup_attribute(u, "cpu", "cpu.max", buf, false);
 
         if (r < 0)
                 log_unit_full(u, IN_SET(r, -ENOENT, -EROFS, -EACCES) ? LOG_DEBUG : LOG_WARNING, r,
@@ -649,7 +748,7 @@ static void cgroup_apply_legacy_cpu_config(Unit *u, uint64_t shares, uint64_t qu
         int r;
 
         xsprintf(buf, "%" PRIu64 "\n", shares);
-        r = cg_set_attribute("cpu", u->cgroup_path, "cpu.shares", buf);
+        r = unit_set_cgroup_attribute(u, "cpu", "cpu.shares", buf, false);
         if (r < 0)
                 log_unit_full(u, IN_SET(r, -ENOENT, -EROFS, -EACCES) ? LOG_DEBUG : LOG_WARNING, r,
                               "Failed to set cpu.shares: %m");
@@ -657,17 +756,17 @@ static void cgroup_apply_legacy_cpu_config(Unit *u, uint64_t shares, uint64_t qu
         period = cgroup_cpu_adjust_period_and_log(u, period, quota);
 
         xsprintf(buf, USEC_FMT "\n", period);
-        r = cg_set_attribute("cpu", u->cgroup_path, "cpu.cfs_period_us", buf);
+        r = unit_set_cgroup_attribute(u, "cpu", "cpu.cfs_period_us", buf, false);
         if (r < 0)
                 log_unit_full(u, IN_SET(r, -ENOENT, -EROFS, -EACCES) ? LOG_DEBUG : LOG_WARNING, r,
                               "Failed to set cpu.cfs_period_us: %m");
 
         if (quota != USEC_INFINITY) {
                 xsprintf(buf, USEC_FMT "\n", MAX(quota * period / USEC_PER_SEC, USEC_PER_MSEC));
-                r = cg_set_attribute("cpu", u->cgroup_path, "cpu.cfs_quota_us", buf);
+                r = unit_set_cgroup_attribute(u, "cpu", "cpu.cfs_quota_us", buf, false);
         }
         else
-                r = cg_set_attribute("cpu", u->cgroup_path, "cpu.cfs_quota_us", "-1");
+                r = unit_set_cgroup_attribute(u, "cpu", "cpu.cfs_quota_us", "-1", false);
         if (r < 0)
                 log_unit_full(u, IN_SET(r, -ENOENT, -EROFS, -EACCES) ? LOG_DEBUG : LOG_WARNING, r,
                               "Failed to set cpu.cfs_quota_us: %m");
@@ -691,7 +790,7 @@ static void cgroup_apply_unified_cpuset(Unit *u, CPUSet cpus, const char *name)
         if (!buf)
             return;
 
-        r = cg_set_attribute("cpuset", u->cgroup_path, name, buf);
+        r = unit_set_cgroup_attribute(u, "cpuset", name, buf, false);
         if (r < 0)
                 log_unit_full(u, IN_SET(r, -ENOENT, -EROFS, -EACCES) ? LOG_DEBUG : LOG_WARNING, r,
                               "Failed to set %s: %m", name);
@@ -755,7 +854,7 @@ static void cgroup_apply_io_device_weight(Unit *u, const char *dev_path, uint64_
                 return;
 
         xsprintf(buf, "%u:%u %" PRIu64 "\n", major(dev), minor(dev), io_weight);
-        r = cg_set_attribute("io", u->cgroup_path, "io.weight", buf);
+        r = unit_set_cgroup_attribute(u, "io", "io.weight", buf, true);
         if (r < 0)
                 log_unit_full(u, IN_SET(r, -ENOENT, -EROFS, -EACCES) ? LOG_DEBUG : LOG_WARNING, r,
                               "Failed to set io.weight: %m");
@@ -771,7 +870,7 @@ static void cgroup_apply_blkio_device_weight(Unit *u, const char *dev_path, uint
                 return;
 
         xsprintf(buf, "%u:%u %" PRIu64 "\n", major(dev), minor(dev), blkio_weight);
-        r = cg_set_attribute("blkio", u->cgroup_path, "blkio.weight_device", buf);
+        r = unit_set_cgroup_attribute(u, "blkio", "blkio.weight_device", buf, true);
         if (r < 0)
                 log_unit_full(u, IN_SET(r, -ENOENT, -EROFS, -EACCES) ? LOG_DEBUG : LOG_WARNING, r,
                               "Failed to set blkio.weight_device: %m");
@@ -791,7 +890,7 @@ static void cgroup_apply_io_device_latency(Unit *u, const char *dev_path, usec_t
         else
                 xsprintf(buf, "%u:%u target=max\n", major(dev), minor(dev));
 
-        r = cg_set_attribute("io", u->cgroup_path, "io.latency", buf);
+        r = unit_set_cgroup_attribute(u, "io", "io.latency", buf, true);
         if (r < 0)
                 log_unit_full(u, IN_SET(r, -ENOENT, -EROFS, -EACCES) ? LOG_DEBUG : LOG_WARNING, r,
                               "Failed to set io.latency on cgroup %s: %m", u->cgroup_path);
@@ -817,7 +916,7 @@ static void cgroup_apply_io_device_limit(Unit *u, const char *dev_path, uint64_t
         xsprintf(buf, "%u:%u rbps=%s wbps=%s riops=%s wiops=%s\n", major(dev), minor(dev),
                  limit_bufs[CGROUP_IO_RBPS_MAX], limit_bufs[CGROUP_IO_WBPS_MAX],
                  limit_bufs[CGROUP_IO_RIOPS_MAX], limit_bufs[CGROUP_IO_WIOPS_MAX]);
-        r = cg_set_attribute("io", u->cgroup_path, "io.max", buf);
+        r = unit_set_cgroup_attribute(u, "io", "io.max", buf, true);
         if (r < 0)
                 log_unit_full(u, IN_SET(r, -ENOENT, -EROFS, -EACCES) ? LOG_DEBUG : LOG_WARNING, r,
                               "Failed to set io.max: %m");
@@ -833,13 +932,13 @@ static void cgroup_apply_blkio_device_limit(Unit *u, const char *dev_path, uint6
                 return;
 
         sprintf(buf, "%u:%u %" PRIu64 "\n", major(dev), minor(dev), rbps);
-        r = cg_set_attribute("blkio", u->cgroup_path, "blkio.throttle.read_bps_device", buf);
+        r = unit_set_cgroup_attribute(u, "blkio", "blkio.throttle.read_bps_device", buf, true);
         if (r < 0)
                 log_unit_full(u, IN_SET(r, -ENOENT, -EROFS, -EACCES) ? LOG_DEBUG : LOG_WARNING, r,
                               "Failed to set blkio.throttle.read_bps_device: %m");
 
         sprintf(buf, "%u:%u %" PRIu64 "\n", major(dev), minor(dev), wbps);
-        r = cg_set_attribute("blkio", u->cgroup_path, "blkio.throttle.write_bps_device", buf);
+        r = unit_set_cgroup_attribute(u, "blkio", "blkio.throttle.write_bps_device", buf, true);
         if (r < 0)
                 log_unit_full(u, IN_SET(r, -ENOENT, -EROFS, -EACCES) ? LOG_DEBUG : LOG_WARNING, r,
                               "Failed to set blkio.throttle.write_bps_device: %m");
@@ -865,7 +964,7 @@ static void cgroup_apply_unified_memory_limit(Unit *u, const char *file, uint64_
         if (v != CGROUP_LIMIT_MAX)
                 xsprintf(buf, "%" PRIu64 "\n", v);
 
-        r = cg_set_attribute("memory", u->cgroup_path, file, buf);
+        r = unit_set_cgroup_attribute(u, "memory", file, buf, false);
         if (r < 0)
                 log_unit_full(u, IN_SET(r, -ENOENT, -EROFS, -EACCES) ? LOG_DEBUG : LOG_WARNING, r,
                               "Failed to set %s: %m", file);
@@ -979,7 +1078,7 @@ static void cgroup_context_apply(
                                 weight = CGROUP_WEIGHT_DEFAULT;
 
                         xsprintf(buf, "default %" PRIu64 "\n", weight);
-                        r = cg_set_attribute("io", path, "io.weight", buf);
+                        r = unit_set_cgroup_attribute(u, "io", "io.weight", buf, true);
                         if (r < 0)
                                 log_unit_full(u, IN_SET(r, -ENOENT, -EROFS, -EACCES) ? LOG_DEBUG : LOG_WARNING, r,
                                               "Failed to set io.weight: %m");
@@ -987,7 +1086,7 @@ static void cgroup_context_apply(
                         /* FIXME: drop this when distro kernels properly support BFQ through "io.weight"
                          * See also: https://github.com/systemd/systemd/pull/13335 */
                         xsprintf(buf, "%" PRIu64 "\n", weight);
-                        r = cg_set_attribute("io", path, "io.bfq.weight", buf);
+                        r = unit_set_cgroup_attribute(u, "io", "io.bfq.weight", buf, false);
                         if (r < 0)
                                 log_unit_full(u, IN_SET(r, -ENOENT, -EROFS, -EACCES) ? LOG_DEBUG : LOG_WARNING, r,
                                               "Failed to set io.bfq.weight: %m");
@@ -1066,7 +1165,7 @@ static void cgroup_context_apply(
                                 weight = CGROUP_BLKIO_WEIGHT_DEFAULT;
 
                         xsprintf(buf, "%" PRIu64 "\n", weight);
-                        r = cg_set_attribute("blkio", path, "blkio.weight", buf);
+                        r = unit_set_cgroup_attribute(u, "blkio", "blkio.weight", buf, false);
                         if (r < 0)
                                 log_unit_full(u, IN_SET(r, -ENOENT, -EROFS, -EACCES) ? LOG_DEBUG : LOG_WARNING, r,
                                               "Failed to set blkio.weight: %m");
@@ -1074,7 +1173,7 @@ static void cgroup_context_apply(
                         /* FIXME: drop this when distro kernels properly support BFQ through "blkio.weight"
                          * See also: https://github.com/systemd/systemd/pull/13335 */
                         xsprintf(buf, "%" PRIu64 "\n", weight);
-                        r = cg_set_attribute("blkio", path, "blkio.bfq.weight", buf);
+                        r = unit_set_cgroup_attribute(u, "blkio", "blkio.bfq.weight", buf, false);
                         if (r < 0)
                                 log_unit_full(u, IN_SET(r, -ENOENT, -EROFS, -EACCES) ? LOG_DEBUG : LOG_WARNING, r,
                                               "Failed to set blkio.bfq.weight: %m");
@@ -1149,7 +1248,7 @@ static void cgroup_context_apply(
                         else
                                 xsprintf(buf, "%" PRIu64 "\n", val);
 
-                        r = cg_set_attribute("memory", path, "memory.limit_in_bytes", buf);
+                        r = unit_set_cgroup_attribute(u, "memory", "memory.limit_in_bytes", buf, false);
                         if (r < 0)
                                 log_unit_full(u, IN_SET(r, -ENOENT, -EROFS, -EACCES) ? LOG_DEBUG : LOG_WARNING, r,
                                               "Failed to set memory.limit_in_bytes: %m");
@@ -1164,9 +1263,9 @@ static void cgroup_context_apply(
                  * here. */
 
                 if (c->device_allow || c->device_policy != CGROUP_AUTO)
-                        r = cg_set_attribute("devices", path, "devices.deny", "a");
+                        r = unit_write_cgroup_attribute(u, "devices", "devices.deny", "a");
                 else
-                        r = cg_set_attribute("devices", path, "devices.allow", "a");
+                        r = unit_write_cgroup_attribute(u, "devices", "devices.allow", "a");
                 if (r < 0)
                         log_unit_full(u, IN_SET(r, -ENOENT, -EROFS, -EINVAL, -EACCES) ? LOG_DEBUG : LOG_WARNING, r,
                                       "Failed to reset devices.list: %m");
@@ -1188,10 +1287,10 @@ static void cgroup_context_apply(
                         const char *x, *y;
 
                         NULSTR_FOREACH_PAIR(x, y, auto_devices)
-                                whitelist_device(path, x, y);
+                                whitelist_device(u, x, y);
 
                         /* PTS (/dev/pts) devices may not be duplicated, but accessed */
-                        whitelist_major(path, "pts", 'c', "rw");
+                        whitelist_major(u, "pts", 'c', "rw");
                 }
 
                 LIST_FOREACH(device_allow, a, c->device_allow) {
@@ -1211,11 +1310,11 @@ static void cgroup_context_apply(
                         acc[k++] = 0;
 
                         if (path_startswith(a->path, "/dev/"))
-                                whitelist_device(path, a->path, acc);
+                                whitelist_device(u, a->path, acc);
                         else if ((val = startswith(a->path, "block-")))
-                                whitelist_major(path, val, 'b', acc);
+                                whitelist_major(u, val, 'b', acc);
                         else if ((val = startswith(a->path, "char-")))
-                                whitelist_major(path, val, 'c', acc);
+                                whitelist_major(u, val, 'c', acc);
                         else
                                 log_unit_debug(u, "Ignoring device %s while writing cgroup attribute.", a->path);
                 }
@@ -1254,9 +1353,9 @@ static void cgroup_context_apply(
                                 char buf[DECIMAL_STR_MAX(uint64_t) + 2];
 
                                 sprintf(buf, "%" PRIu64 "\n", c->tasks_max);
-                                r = cg_set_attribute("pids", path, "pids.max", buf);
+                                r = unit_set_cgroup_attribute(u, "pids", "pids.max", buf, false);
                         } else
-                                r = cg_set_attribute("pids", path, "pids.max", "max");
+                                r = unit_set_cgroup_attribute(u, "pids", "pids.max", "max", false);
                         if (r < 0)
                                 log_unit_full(u, IN_SET(r, -ENOENT, -EROFS, -EACCES) ? LOG_DEBUG : LOG_WARNING, r,
                                               "Failed to set pids.max: %m");
@@ -1355,7 +1454,7 @@ CGroupMask unit_get_members_mask(Unit *u) {
                 Unit *member;
                 Iterator i;
 
-                HASHMAP_FOREACH_KEY(v, member, u->dependencies[UNIT_BEFORE], i) {
+                UNIT_DEPENDENCY_FOREACH(v, member, u->dependencies[UNIT_BEFORE], i) {
 
                         if (member == u)
                                 continue;
@@ -1676,6 +1775,10 @@ static int unit_create_cgroup(
                 return log_unit_error_errno(u, r, "Failed to create cgroup %s: %m", u->cgroup_path);
         created = !!r;
 
+        /* A new cgroup comes with the default attributes, hence forget what we wrote to the previous one, and
+         * for the controllers we don't need anymore */
+        unit_forget_cgroup_attributes(u, created ? 0 : target_mask);
+
         /* Start watching it */
         (void) unit_watch_cgroup(u);
 
@@ -1987,7 +2090,7 @@ static void unit_add_siblings_to_cgroup_realize_queue(Unit *u) {
                 Unit *m;
                 void *v;
 
-                HASHMAP_FOREACH_KEY(v, m, slice->dependencies[UNIT_BEFORE], i) {
+                UNIT_DEPENDENCY_FOREACH(v, m, slice->dependencies[UNIT_BEFORE], i) {
                         /* Skip units that have a dependency on the slice but aren't actually in it. */
                         if (UNIT_DEREF(m->slice) != slice)
                                 continue;
@@ -2031,6 +2134,10 @@ int unit_realize_cgroup(Unit *u) {
         /* Add all sibling slices to the cgroup queue. */
         unit_add_siblings_to_cgroup_realize_queue(u);
 
+        /* Don't trust what we remember having written for the unit we are explicitly asked to realize, only for
+         * the parents and siblings that get realized along with it */
+        unit_invalidate_cgroup_attributes(u);
+
         /* And realize this one now (and apply the values) */
         return unit_realize_cgroup_now(u, manager_state(u->manager));
 }
@@ -2045,6 +2152,9 @@ void unit_release_cgroup(Unit *u) {
                 u->cgroup_path = mfree(u->cgroup_path);
         }
 
+        u->cgroup_attributes = hashmap_free_free_free(u->cgroup_attributes);
+        u->accounting_snapshot = mfree(u->accounting_snapshot);
+
         if (u->cgroup_inotify_wd >= 0) {
                 if (inotify_rm_watch(u->manager->cgroup_inotify_fd, u->cgroup_inotify_wd) < 0)
                         log_unit_debug_errno(u, errno, "Failed to remove cgroup inotify watch %i for %s, ignoring", u->cgroup_inotify_wd, u->id);
@@ -2252,6 +2362,25 @@ static int on_cgroup_empty_event(sd_event_source *s, void *userdata) {
         return 0;
 }
 
+static void unit_add_to_cgroup_empty_queue_verified(Unit *u) {
+        int r;
+
+        assert(u);
+
+        /* Like unit_add_to_cgroup_empty_queue(), but for callers that just found the cgroup to be empty */
+
+        if (u->in_cgroup_empty_queue)
+                return;
+
+        LIST_PREPEND(cgroup_empty_queue, u->manager->cgroup_empty_queue, u);
+        u->in_cgroup_empty_queue = true;
+
+        /* Trigger the defer event */
+        r = sd_event_source_set_enabled(u->manager->cgroup_empty_event_source, SD_EVENT_ONESHOT);
+        if (r < 0)
+                log_debug_errno(r, "Failed to enable cgroup empty event source: %m");
+}
+
 void unit_add_to_cgroup_empty_queue(Unit *u) {
         int r;
 
@@ -2288,13 +2417,7 @@ void unit_add_to_cgroup_empty_queue(Unit *u) {
         if (r == 0)
                 return;
 
-        LIST_PREPEND(cgroup_empty_queue, u->manager->cgroup_empty_queue, u);
-        u->in_cgroup_empty_queue = true;
-
-        /* Trigger the defer event */
-        r = sd_event_source_set_enabled(u->manager->cgroup_empty_event_source, SD_EVENT_ONESHOT);
-        if (r < 0)
-                log_debug_errno(r, "Failed to enable cgroup empty event source: %m");
+        unit_add_to_cgroup_empty_queue_verified(u);
 }
 
 static void unit_remove_from_cgroup_empty_queue(Unit *u) {
@@ -2325,7 +2448,8 @@ static int unit_check_cgroup_events(Unit *u) {
                 if (streq(values[0], "1"))
                         unit_remove_from_cgroup_empty_queue(u);
                 else
-                        unit_add_to_cgroup_empty_queue(u);
+                        /* This is what unit_add_to_cgroup_empty_queue() would read again to verify */
+                        unit_add_to_cgroup_empty_queue_verified(u);
         }
 
         /* Disregard freezer state changes due to operations not initiated by us */
@@ -2343,12 +2467,19 @@ static int unit_check_cgroup_events(Unit *u) {
 }
 
 static int on_cgroup_inotify_event(sd_event_source *s, int fd, uint32_t revents, void *userdata) {
+        _cleanup_free_ Unit **batch = NULL;
+        size_t n_batch = 0, n_allocated = 0, i;
         Manager *m = userdata;
+        int r = 0;
 
         assert(s);
         assert(fd >= 0);
         assert(m);
 
+        /* A cgroup that runs empty or gets populated usually generates several events at once, and when many scopes
+         * go away together, their events arrive in storms. Hence read all pending events first and only then look at
+         * each unit once, instead of rereading its cgroup.events for every event. */
+
         for (;;) {
                 union inotify_event_buffer buffer;
                 struct inotify_event *e;
@@ -2356,10 +2487,9 @@ static int on_cgroup_inotify_event(sd_event_source *s, int fd, uint32_t revents,
 
                 l = read(fd, &buffer, sizeof(buffer));
                 if (l < 0) {
-                        if (ERRNO_IS_TRANSIENT(errno))
-                                return 0;
-
-                        return log_error_errno(errno, "Failed to read control group inotify events: %m");
+                        if (!ERRNO_IS_TRANSIENT(errno))
+                                r = log_error_errno(errno, "Failed to read control group inotify events: %m");
+                        break;
                 }
 
                 FOREACH_INOTIFY_EVENT(e, buffer, l) {
@@ -2377,10 +2507,26 @@ static int on_cgroup_inotify_event(sd_event_source *s, int fd, uint32_t revents,
                          * because it was queued before the removal. Let's ignore this here safely. */
 
                         u = hashmap_get(m->cgroup_inotify_wd_unit, INT_TO_PTR(e->wd));
-                        if (u)
+                        if (!u || u->in_cgroup_events_batch)
+                                continue;
+
+                        if (!GREEDY_REALLOC(batch, n_allocated, n_batch + 1)) {
+                                /* Can't batch this one, so deal with it right away */
                                 unit_check_cgroup_events(u);
+                                continue;
+                        }
+
+                        batch[n_batch++] = u;
+                        u->in_cgroup_events_batch = true;
                 }
         }
+
+        for (i = 0; i < n_batch; i++) {
+                batch[i]->in_cgroup_events_batch = false;
+                unit_check_cgroup_events(batch[i]);
+        }
+
+        return r;
 }
 
 int manager_setup_cgroup(Manager *m) {
@@ -2831,6 +2977,158 @@ int unit_get_ip_accounting(
         return r;
 }
 
+static int unit_get_io_accounting_raw(Unit *u, uint64_t *ret_read_bytes, uint64_t *ret_write_bytes) {
+        _cleanup_free_ char *path = NULL;
+        _cleanup_fclose_ FILE *f = NULL;
+        uint64_t rbytes = 0, wbytes = 0;
+        int r;
+
+        assert(u);
+        assert(ret_read_bytes);
+        assert(ret_write_bytes);
+
+        if (!UNIT_CGROUP_BOOL(u, io_accounting))
+                return -ENODATA;
+
+        if (!u->cgroup_path)
+                return -ENODATA;
+
+        /* The root cgroup has no io.stat */
+        if (unit_has_root_cgroup(u))
+                return -ENODATA;
+
+        /* The blkio controller reports the numbers in an altogether different format, which we don't bother with */
+        r = cg_all_unified();
+        if (r < 0)
+                return r;
+        if (r == 0)
+                return -ENODATA;
+
+        if ((u->cgroup_realized_mask & CGROUP_MASK_IO) == 0)
+                return -ENODATA;
+
+        r = cg_get_path("io", u->cgroup_path, "io.stat", &path);
+        if (r < 0)
+                return r;
+
+        f = fopen(path, "re");
+        if (!f)
+                return errno == ENOENT ? -ENODATA : -errno;
+
+        /* One line per device, like "8:0 rbytes=4096 wbytes=0 rios=1 wios=0 …" */
+        for (;;) {
+                _cleanup_free_ char *line = NULL;
+                const char *p;
+
+                r = read_line(f, LONG_LINE_MAX, &line);
+                if (r < 0)
+                        return r;
+                if (r == 0)
+                        break;
+
+                p = line;
+                for (;;) {
+                        _cleanup_free_ char *word = NULL;
+                        const char *v;
+                        uint64_t x;
+
+                        r = extract_first_word(&p, &word, NULL, 0);
+                        if (r < 0)
+                                return r;
+                        if (r == 0)
+                                break;
+
+                        if ((v = startswith(word, "rbytes=")) && safe_atou64(v, &x) >= 0)
+                                rbytes += x;
+                        else if ((v = startswith(word, "wbytes=")) && safe_atou64(v, &x) >= 0)
+                                wbytes += x;
+                }
+        }
+
+        *ret_read_bytes = rbytes;
+        *ret_write_bytes = wbytes;
+        return 0;
+}
+
+static void unit_get_ip_accounting_map(
+                Unit *u,
+                int fd,
+                CGroupIPAccountingMetric bytes,
+                CGroupIPAccountingMetric packets,
+                uint64_t *metrics) {
+
+        uint64_t b, p;
+
+        assert(u);
+        assert(metrics);
+
+        /* Like unit_get_ip_accounting(), but gets bytes and packets with a single lookup in the map */
+
+        if (fd < 0 || bpf_firewall_read_accounting(fd, &b, &p) < 0)
+                return;
+
+        metrics[bytes] = b + u->ip_accounting_extra[bytes];
+        metrics[packets] = p + u->ip_accounting_extra[packets];
+}
+
+int unit_get_accounting_snapshot(Unit *u, usec_t max_age, CGroupAccountingSnapshot *ret) {
+        CGroupAccountingSnapshot *s;
+        CGroupIPAccountingMetric metric;
+        usec_t n;
+
+        assert(u);
+        assert(ret);
+
+        /* Reads all accounting counters of the unit at once. If that was done no longer than max_age ago, the
+         * counters read back then are returned instead, so that tools polling many units every few seconds don't
+         * make us reread every cgroup attribute each time. */
+
+        n = now(CLOCK_MONOTONIC);
+
+        s = u->accounting_snapshot;
+        if (s && usec_add(s->timestamp, max_age) > n) {
+                *ret = *s;
+                return 0;
+        }
+
+        if (!s) {
+                s = new(CGroupAccountingSnapshot, 1);
+                if (!s)
+                        return -ENOMEM;
+
+                u->accounting_snapshot = s;
+        }
+
+        *s = (CGroupAccountingSnapshot) {
+                .timestamp = n,
+        };
+
+        if (unit_get_cpu_usage(u, &s->cpu_usage_nsec) < 0)
+                s->cpu_usage_nsec = NSEC_INFINITY;
+
+        if (unit_get_memory_current(u, &s->memory_current) < 0)
+                s->memory_current = UINT64_MAX;
+
+        if (unit_get_tasks_current(u, &s->tasks_current) < 0)
+                s->tasks_current = UINT64_MAX;
+
+        if (unit_get_io_accounting_raw(u, &s->io_read_bytes, &s->io_write_bytes) < 0)
+                s->io_read_bytes = s->io_write_bytes = UINT64_MAX;
+
+        for (metric = 0; metric < _CGROUP_IP_ACCOUNTING_METRIC_MAX; metric++)
+                s->ip[metric] = UINT64_MAX;
+
+        if (UNIT_CGROUP_BOOL(u, ip_accounting)) {
+                unit_get_ip_accounting_map(u, u->ip_accounting_ingress_map_fd,
+                                           CGROUP_IP_INGRESS_BYTES, CGROUP_IP_INGRESS_PACKETS, s->ip);
+                unit_get_ip_accounting_map(u, u->ip_accounting_egress_map_fd,
+                                           CGROUP_IP_EGRESS_BYTES, CGROUP_IP_EGRESS_PACKETS, s->ip);
+        }
+
+        *ret = *s;
+        return 0;
+}
+
 int unit_reset_cpu_accounting(Unit *u) {
         nsec_t ns;
         int r;
@@ -2838,6 +3136,7 @@ int unit_reset_cpu_accounting(Unit *u) {
         assert(u);
 
         u->cpu_usage_last = NSEC_INFINITY;
+        u->accounting_snapshot = mfree(u->accounting_snapshot);
 
         r = unit_get_cpu_usage_raw(u, &ns);
         if (r < 0) {
@@ -2861,6 +3160,7 @@ int unit_reset_ip_accounting(Unit *u) {
                 q = bpf_firewall_reset_accounting(u->ip_accounting_egress_map_fd);
 
         zero(u->ip_accounting_extra);
+        u->accounting_snapshot = mfree(u->accounting_snapshot);
 
         return r < 0 ? r : q;
 }
@@ -2888,6 +3188,15 @@ void unit_invalidate_cgroup(Unit *u, CGroupMask m) {
         unit_add_to_cgroup_realize_queue(u);
 }
 
+void unit_invalidate_cgroup_attributes(Unit *u) {
+        assert(u);
+
+        /* Forgets which attribute values we wrote, so that they are all written again the next time the unit is
+         * realized. Someone else might have changed them behind our back. */
+
+        u->cgroup_attributes = hashmap_free_free_free(u->cgroup_attributes);
+}
+
 void unit_invalidate_cgroup_bpf(Unit *u) {
         assert(u);
 
@@ -2907,7 +3216,7 @@ void unit_invalidate_cgroup_bpf(Unit *u) {
                 Iterator i;
                 void *v;
 
-                HASHMAP_FOREACH_KEY(v, member, u->dependencies[UNIT_BEFORE], i) {
+                UNIT_DEPENDENCY_FOREACH(v, member, u->dependencies[UNIT_BEFORE], i) {
                         if (member == u)
                                 continue;
 
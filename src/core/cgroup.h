@@ -150,6 +150,17 @@ typedef enum CGroupIPAccountingMetric {
         _CGROUP_IP_ACCOUNTING_METRIC_INVALID = -1,
 } CGroupIPAccountingMetric;
 
+/* All accounting counters of a unit, read at the same time. Counters that are not available are UINT64_MAX. */
+typedef struct CGroupAccountingSnapshot {
+        usec_t timestamp;            /* CLOCK_MONOTONIC, when the counters were read */
+        nsec_t cpu_usage_nsec;
+        uint64_t memory_current;
+        uint64_t tasks_current;
+        uint64_t io_read_bytes;
+        uint64_t io_write_bytes;
+        uint64_t ip[_CGROUP_IP_ACCOUNTING_METRIC_MAX];
+} CGroupAccountingSnapshot;
+
 typedef struct Unit Unit;
 typedef struct Manager Manager;
 
@@ -218,6 +229,7 @@ int unit_get_memory_current(Unit *u, uint64_t *ret);
 int unit_get_tasks_current(Unit *u, uint64_t *ret);
 int unit_get_cpu_usage(Unit *u, nsec_t *ret);
 int unit_get_ip_accounting(Unit *u, CGroupIPAccountingMetric metric, uint64_t *ret);
+int unit_get_accounting_snapshot(Unit *u, usec_t max_age, CGroupAccountingSnapshot *ret);
 
 int unit_reset_cpu_accounting(Unit *u);
 int unit_reset_ip_accounting(Unit *u);
@@ -234,6 +246,7 @@ bool unit_has_root_cgroup(Unit *u);
 int manager_notify_cgroup_empty(Manager *m, const char *group);
 
 void unit_invalidate_cgroup(Unit *u, CGroupMask m);
+void unit_invalidate_cgroup_attributes(Unit *u);
 void unit_invalidate_cgroup_bpf(Unit *u);
 
 void manager_invalidate_startup_units(Manager *m);
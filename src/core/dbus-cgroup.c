@@ -629,6 +629,10 @@ int bus_cgroup_set_property(
 
         flags |= UNIT_PRIVATE;
 
+        /* Setting a property applies it again, even if the value is the one we wrote last time */
+        if (!UNIT_WRITE_FLAGS_NOOP(flags))
+                unit_invalidate_cgroup_attributes(u);
+
         if (streq(name, "CPUAccounting"))
                 return bus_cgroup_set_boolean(u, name, &c->cpu_accounting, CGROUP_MASK_CPUACCT|CGROUP_MASK_CPU, message, flags, error);
 
@@ -21,12 +21,15 @@
 #include "fs-util.h"
 #include "install.h"
 #include "log.h"
+#include "ordered-set.h"
 #include "os-util.h"
 #include "parse-util.h"
 #include "path-util.h"
+#include "prioq.h"
 #include "selinux-access.h"
 #include "stat-util.h"
 #include "string-util.h"
+#include "string-table.h"
 #include "strv.h"
 #include "syslog-util.h"
 #include "user-util.h"
@@ -216,6 +219,39 @@ static int property_get_progress(
         return sd_bus_message_append(reply, "d", d);
 }
 
+static int property_get_generator_timings(
+                sd_bus *bus,
+                const char *path,
+                const char *interface,
+                const char *property,
+                sd_bus_message *reply,
+                void *userdata,
+                sd_bus_error *error) {
+
+        Manager *m = userdata;
+        size_t i;
+        int r;
+
+        assert(bus);
+        assert(reply);
+        assert(m);
+
+        r = sd_bus_message_open_container(reply, 'a', "(sbt)");
+        if (r < 0)
+                return r;
+
+        for (i = 0; i < m->n_generator_timings; i++) {
+                r = sd_bus_message_append(reply, "(sbt)",
+                                          m->generator_timings[i].path,
+                                          m->generator_timings[i].cached,
+                                          m->generator_timings[i].duration);
+                if (r < 0)
+                        return r;
+        }
+
+        return sd_bus_message_close_container(reply);
+}
+
 static int property_get_show_status(
                 sd_bus *bus,
                 const char *path,
@@ -1179,6 +1215,391 @@ static int method_list_units_by_patterns(sd_bus_message *message, void *userdata
         return list_units_filtered(message, userdata, error, states, patterns);
 }
 
+/* The fields of the unit info tuple returned by ListUnits() and friends, for ListUnitsPaged() to select from */
+typedef enum UnitInfoField {
+        UNIT_INFO_ID,
+        UNIT_INFO_DESCRIPTION,
+        UNIT_INFO_LOAD_STATE,
+        UNIT_INFO_ACTIVE_STATE,
+        UNIT_INFO_SUB_STATE,
+        UNIT_INFO_FOLLOWING,
+        UNIT_INFO_UNIT_PATH,
+        UNIT_INFO_JOB_ID,
+        UNIT_INFO_JOB_TYPE,
+        UNIT_INFO_JOB_PATH,
+        _UNIT_INFO_FIELD_MAX,
+        _UNIT_INFO_FIELD_INVALID = -1,
+} UnitInfoField;
+
+static const char* const unit_info_field_table[_UNIT_INFO_FIELD_MAX] = {
+        [UNIT_INFO_ID] = "Id",
+        [UNIT_INFO_DESCRIPTION] = "Description",
+        [UNIT_INFO_LOAD_STATE] = "LoadState",
+        [UNIT_INFO_ACTIVE_STATE] = "ActiveState",
+        [UNIT_INFO_SUB_STATE] = "SubState",
+        [UNIT_INFO_FOLLOWING] = "Following",
+        [UNIT_INFO_UNIT_PATH] = "UnitPath",
+        [UNIT_INFO_JOB_ID] = "JobId",
+        [UNIT_INFO_JOB_TYPE] = "JobType",
+        [UNIT_INFO_JOB_PATH] = "JobPath",
+};
+
+DEFINE_PRIVATE_STRING_TABLE_LOOKUP_FROM_STRING(unit_info_field, UnitInfoField);
+
+static int reply_unit_info_field(sd_bus_message *reply, Unit *u, UnitInfoField field) {
+        _cleanup_free_ char *p = NULL;
+        Unit *following;
+
+        switch (field) {
+
+        case UNIT_INFO_ID:
+                return sd_bus_message_append(reply, "v", "s", u->id);
+
+        case UNIT_INFO_DESCRIPTION:
+                return sd_bus_message_append(reply, "v", "s", unit_description(u));
+
+        case UNIT_INFO_LOAD_STATE:
+                return sd_bus_message_append(reply, "v", "s", unit_load_state_to_string(u->load_state));
+
+        case UNIT_INFO_ACTIVE_STATE:
+                return sd_bus_message_append(reply, "v", "s", unit_active_state_to_string(unit_active_state(u)));
+
+        case UNIT_INFO_SUB_STATE:
+                return sd_bus_message_append(reply, "v", "s", unit_sub_state_to_string(u));
+
+        case UNIT_INFO_FOLLOWING:
+                following = unit_following(u);
+                return sd_bus_message_append(reply, "v", "s", following ? following->id : "");
+
+        case UNIT_INFO_UNIT_PATH:
+                p = unit_dbus_path(u);
+                if (!p)
+                        return -ENOMEM;
+
+                return sd_bus_message_append(reply, "v", "o", p);
+
+        case UNIT_INFO_JOB_ID:
+                return sd_bus_message_append(reply, "v", "u", u->job ? u->job->id : 0);
+
+        case UNIT_INFO_JOB_TYPE:
+                return sd_bus_message_append(reply, "v", "s", u->job ? job_type_to_string(u->job->type) : "");
+
+        case UNIT_INFO_JOB_PATH:
+                if (u->job) {
+                        p = job_dbus_path(u->job);
+                        if (!p)
+                                return -ENOMEM;
+                }
+
+                return sd_bus_message_append(reply, "v", "o", p ?: "/");
+
+        default:
+                assert_not_reached("Unknown unit info field");
+        }
+}
+
+static int unit_compare_id(Unit * const *a, Unit * const *b) {
+        return strcmp((*a)->id, (*b)->id);
+}
+
+static int unit_compare_id_reverse(const void *a, const void *b) {
+        return strcmp(((const Unit*) b)->id, ((const Unit*) a)->id);
+}
+
+static int method_list_units_paged(sd_bus_message *message, void *userdata, sd_bus_error *error) {
+        _cleanup_strv_free_ char **states = NULL, **types = NULL, **patterns = NULL, **fields = NULL;
+        _cleanup_(sd_bus_message_unrefp) sd_bus_message *reply = NULL;
+        _cleanup_free_ UnitInfoField *projection = NULL;
+        _cleanup_free_ Unit **units = NULL;
+        _cleanup_(prioq_freep) Prioq *first = NULL;
+        bool type_mask[_UNIT_TYPE_MAX] = {};
+        size_t n_units = 0, n_allocated = 0, n_matching = 0, n_fields, k;
+        Manager *m = userdata;
+        const char *after, *key;
+        uint32_t max_units;
+        Iterator i;
+        char **s;
+        Unit *u;
+        int r;
+
+        assert(message);
+        assert(m);
+
+        /* Anyone can call this method */
+
+        r = mac_selinux_access_check(message, "status", error);
+        if (r < 0)
+                return r;
+
+        r = sd_bus_message_read_strv(message, &states);
+        if (r < 0)
+                return r;
+
+        r = sd_bus_message_read_strv(message, &types);
+        if (r < 0)
+                return r;
+
+        r = sd_bus_message_read_strv(message, &patterns);
+        if (r < 0)
+                return r;
+
+        r = sd_bus_message_read_strv(message, &fields);
+        if (r < 0)
+                return r;
+
+        r = sd_bus_message_read(message, "su", &after, &max_units);
+        if (r < 0)
+                return r;
+
+        STRV_FOREACH(s, types) {
+                UnitType t;
+
+                t = unit_type_from_string(*s);
+                if (t < 0)
+                        return sd_bus_error_setf(error, SD_BUS_ERROR_INVALID_ARGS, "Unknown unit type: %s", *s);
+
+                type_mask[t] = true;
+        }
+
+        n_fields = strv_length(fields);
+        if (n_fields == 0)
+                return sd_bus_error_setf(error, SD_BUS_ERROR_INVALID_ARGS, "No fields requested.");
+
+        projection = new(UnitInfoField, n_fields);
+        if (!projection)
+                return -ENOMEM;
+
+        for (k = 0; k < n_fields; k++) {
+                projection[k] = unit_info_field_from_string(fields[k]);
+                if (projection[k] < 0)
+                        return sd_bus_error_setf(error, SD_BUS_ERROR_INVALID_ARGS, "Unknown field: %s", fields[k]);
+        }
+
+        /* The units are returned ordered by name, so that the name of the last unit returned can serve as the
+         * token to continue with, which stays valid even if units are added or removed between the calls. Each page
+         * still has to look at all units once, but only keeps the first max_units of them after the token, in a
+         * queue with the greatest name on top. Hence fetching all units in pages of a fixed size costs about as much
+         * per page as filtering them, rather than sorting all the remaining ones over and over. */
+
+        if (max_units > 0) {
+                first = prioq_new(unit_compare_id_reverse);
+                if (!first)
+                        return -ENOMEM;
+        }
+
+        HASHMAP_FOREACH_KEY(u, key, m->units, i) {
+                if (key != u->id)
+                        continue;
+
+                if (!isempty(after) && strcmp(u->id, after) <= 0)
+                        continue;
+
+                if (!strv_isempty(types) && !type_mask[u->type])
+                        continue;
+
+                if (!strv_isempty(states) &&
+                    !strv_contains(states, unit_load_state_to_string(u->load_state)) &&
+                    !strv_contains(states, unit_active_state_to_string(unit_active_state(u))) &&
+                    !strv_contains(states, unit_sub_state_to_string(u)))
+                        continue;
+
+                if (!strv_isempty(patterns) &&
+                    !strv_fnmatch_or_empty(patterns, u->id, FNM_NOESCAPE))
+                        continue;
+
+                n_matching++;
+
+                if (first) {
+                        if (prioq_size(first) >= max_units) {
+                                if (strcmp(u->id, ((Unit*) prioq_peek(first))->id) > 0)
+                                        continue;
+
+                                (void) prioq_pop(first);
+                        }
+
+                        r = prioq_put(first, u, NULL);
+                        if (r < 0)
+                                return r;
+
+                        continue;
+                }
+
+                if (!GREEDY_REALLOC(units, n_allocated, n_units + 1))
+                        return -ENOMEM;
+
+                units[n_units++] = u;
+        }
+
+        if (first) {
+                /* The queue hands out the greatest name first, hence fill the array from the back */
+                n_units = prioq_size(first);
+                if (n_units > 0 && !GREEDY_REALLOC(units, n_allocated, n_units))
+                        return -ENOMEM;
+
+                for (k = n_units; k > 0; k--)
+                        units[k - 1] = prioq_pop(first);
+        } else
+                typesafe_qsort(units, n_units, unit_compare_id);
+
+        r = sd_bus_message_new_method_return(message, &reply);
+        if (r < 0)
+                return r;
+
+        r = sd_bus_message_open_container(reply, 'a', "av");
+        if (r < 0)
+                return r;
+
+        for (k = 0; k < n_units; k++) {
+                size_t f;
+
+                r = sd_bus_message_open_container(reply, 'a', "v");
+                if (r < 0)
+                        return r;
+
+                for (f = 0; f < n_fields; f++) {
+                        r = reply_unit_info_field(reply, units[k], projection[f]);
+                        if (r < 0)
+                                return r;
+                }
+
+                r = sd_bus_message_close_container(reply);
+                if (r < 0)
+                        return r;
+        }
+
+        r = sd_bus_message_close_container(reply);
+        if (r < 0)
+                return r;
+
+        /* An empty token means there is nothing more to come */
+        r = sd_bus_message_append(reply, "s", n_matching > n_units ? units[n_units - 1]->id : "");
+        if (r < 0)
+                return r;
+
+        return sd_bus_send(NULL, reply, NULL);
+}
+
+static int accounting_snapshot_add_slice_members(OrderedSet *units, Unit *slice) {
+        Unit *member;
+        Iterator i;
+        void *v;
+        int r;
+
+        assert(units);
+        assert(slice);
+
+        UNIT_DEPENDENCY_FOREACH(v, member, slice->dependencies[UNIT_BEFORE], i) {
+                if (UNIT_DEREF(member->slice) != slice)
+                        continue;
+
+                /* Nothing to account for below units without a cgroup */
+                if (!member->cgroup_path)
+                        continue;
+
+                r = ordered_set_put(units, member);
+                if (r == -EEXIST)
+                        continue;
+                if (r < 0)
+                        return r;
+
+                if (member->type == UNIT_SLICE) {
+                        r = accounting_snapshot_add_slice_members(units, member);
+                        if (r < 0)
+                                return r;
+                }
+        }
+
+        return 0;
+}
+
+static int method_get_accounting_snapshot(sd_bus_message *message, void *userdata, sd_bus_error *error) {
+        _cleanup_(sd_bus_message_unrefp) sd_bus_message *reply = NULL;
+        _cleanup_ordered_set_free_ OrderedSet *units = NULL;
+        _cleanup_strv_free_ char **names = NULL;
+        Manager *m = userdata;
+        uint64_t max_age;
+        int subtree, r;
+        Iterator i;
+        char **name;
+        Unit *u;
+
+        assert(message);
+        assert(m);
+
+        /* Anyone can call this method */
+
+        r = mac_selinux_access_check(message, "status", error);
+        if (r < 0)
+                return r;
+
+        r = sd_bus_message_read_strv(message, &names);
+        if (r < 0)
+                return r;
+
+        r = sd_bus_message_read(message, "bt", &subtree, &max_age);
+        if (r < 0)
+                return r;
+
+        units = ordered_set_new(NULL);
+        if (!units)
+                return -ENOMEM;
+
+        STRV_FOREACH(name, names) {
+                r = bus_get_unit_by_name(m, message, *name, &u, error);
+                if (r < 0)
+                        return r;
+
+                r = ordered_set_put(units, u);
+                if (r == -EEXIST)
+                        continue;
+                if (r < 0)
+                        return r;
+
+                if (subtree && u->type == UNIT_SLICE) {
+                        r = accounting_snapshot_add_slice_members(units, u);
+                        if (r < 0)
+                                return r;
+                }
+        }
+
+        r = sd_bus_message_new_method_return(message, &reply);
+        if (r < 0)
+                return r;
+
+        r = sd_bus_message_open_container(reply, 'a', "(sttttttttt)");
+        if (r < 0)
+                return r;
+
+        ORDERED_SET_FOREACH(u, units, i) {
+                CGroupAccountingSnapshot snapshot;
+
+                r = unit_get_accounting_snapshot(u, max_age, &snapshot);
+                if (r < 0)
+                        return r;
+
+                r = sd_bus_message_append(
+                                reply, "(sttttttttt)",
+                                u->id,
+                                snapshot.cpu_usage_nsec,
+                                snapshot.memory_current,
+                                snapshot.tasks_current,
+                                snapshot.io_read_bytes,
+                                snapshot.io_write_bytes,
+                                snapshot.ip[CGROUP_IP_INGRESS_BYTES],
+                                snapshot.ip[CGROUP_IP_INGRESS_PACKETS],
+                                snapshot.ip[CGROUP_IP_EGRESS_BYTES],
+                                snapshot.ip[CGROUP_IP_EGRESS_PACKETS]);
+                if (r < 0)
+                        return r;
+        }
+
+        r = sd_bus_message_close_container(reply);
+        if (r < 0)
+                return r;
+
+        return sd_bus_send(NULL, reply, NULL);
+}
+
 static int method_list_jobs(sd_bus_message *message, void *userdata, sd_bus_error *error) {
         _cleanup_(sd_bus_message_unrefp) sd_bus_message *reply = NULL;
         Manager *m = userdata;
@@ -1403,6 +1824,10 @@ static int method_reload(sd_bus_message *message, void *userdata, sd_bus_error *
         if (r < 0)
                 return r;
 
+        /* ReloadFull() loads all units anew, even if none of their sources appear to have changed */
+        if (sd_bus_message_is_method_call(message, NULL, "ReloadFull"))
+                m->reload_full = true;
+
         m->exit_code = MANAGER_RELOAD;
 
         return 1;
@@ -2485,6 +2910,7 @@ const sd_bus_vtable bus_manager_vtable[] = {
         BUS_PROPERTY_DUAL_TIMESTAMP("SecurityFinishTimestamp", offsetof(Manager, timestamps[MANAGER_TIMESTAMP_SECURITY_FINISH]), SD_BUS_VTABLE_PROPERTY_CONST),
         BUS_PROPERTY_DUAL_TIMESTAMP("GeneratorsStartTimestamp", offsetof(Manager, timestamps[MANAGER_TIMESTAMP_GENERATORS_START]), SD_BUS_VTABLE_PROPERTY_CONST),
         BUS_PROPERTY_DUAL_TIMESTAMP("GeneratorsFinishTimestamp", offsetof(Manager, timestamps[MANAGER_TIMESTAMP_GENERATORS_FINISH]), SD_BUS_VTABLE_PROPERTY_CONST),
+        SD_BUS_PROPERTY("GeneratorTimings", "a(sbt)", property_get_generator_timings, 0, 0),
         BUS_PROPERTY_DUAL_TIMESTAMP("UnitsLoadStartTimestamp", offsetof(Manager, timestamps[MANAGER_TIMESTAMP_UNITS_LOAD_START]), SD_BUS_VTABLE_PROPERTY_CONST),
         BUS_PROPERTY_DUAL_TIMESTAMP("UnitsLoadFinishTimestamp", offsetof(Manager, timestamps[MANAGER_TIMESTAMP_UNITS_LOAD_FINISH]), SD_BUS_VTABLE_PROPERTY_CONST),
         BUS_PROPERTY_DUAL_TIMESTAMP("UnitsLoadTimestamp", offsetof(Manager, timestamps[MANAGER_TIMESTAMP_UNITS_LOAD]), SD_BUS_VTABLE_PROPERTY_CONST),
@@ -2495,6 +2921,11 @@ const sd_bus_vtable bus_manager_vtable[] = {
         SD_BUS_PROPERTY("NJobs", "u", property_get_hashmap_size, offsetof(Manager, jobs), 0),
         SD_BUS_PROPERTY("NInstalledJobs", "u", bus_property_get_unsigned, offsetof(Manager, n_installed_jobs), 0),
         SD_BUS_PROPERTY("NFailedJobs", "u", bus_property_get_unsigned, offsetof(Manager, n_failed_jobs), 0),
+        SD_BUS_PROPERTY("NDBusSignals", "t", NULL, offsetof(Manager, n_dbus_signals), 0),
+        SD_BUS_PROPERTY("NDBusChangesCoalesced", "t", NULL, offsetof(Manager, n_dbus_changes_coalesced), 0),
+        SD_BUS_PROPERTY("DBusDispatchUSec", "t", bus_property_get_usec, offsetof(Manager, dbus_dispatch_usec), 0),
+        SD_BUS_PROPERTY("NCGroupAttributeWrites", "t", NULL, offsetof(Manager, n_cgroup_attribute_writes), 0),
+        SD_BUS_PROPERTY("NCGroupAttributeWritesSkipped", "t", NULL, offsetof(Manager, n_cgroup_attribute_writes_skipped), 0),
         SD_BUS_PROPERTY("Progress", "d", property_get_progress, 0, 0),
         SD_BUS_PROPERTY("Environment", "as", NULL, offsetof(Manager, environment), 0),
         SD_BUS_PROPERTY("ConfirmSpawn", "b", bus_property_get_bool, offsetof(Manager, confirm_spawn), SD_BUS_VTABLE_PROPERTY_CONST),
@@ -2591,6 +3022,8 @@ const sd_bus_vtable bus_manager_vtable[] = {
         SD_BUS_METHOD("ListUnitsFiltered", "as", "a(ssssssouso)", method_list_units_filtered, SD_BUS_VTABLE_UNPRIVILEGED),
         SD_BUS_METHOD("ListUnitsByPatterns", "asas", "a(ssssssouso)", method_list_units_by_patterns, SD_BUS_VTABLE_UNPRIVILEGED),
         SD_BUS_METHOD("ListUnitsByNames", "as", "a(ssssssouso)", method_list_units_by_names, SD_BUS_VTABLE_UNPRIVILEGED),
+        SD_BUS_METHOD("ListUnitsPaged", "asasasassu", "aavs", method_list_units_paged, SD_BUS_VTABLE_UNPRIVILEGED),
+        SD_BUS_METHOD("GetAccountingSnapshot", "asbt", "a(sttttttttt)", method_get_accounting_snapshot, SD_BUS_VTABLE_UNPRIVILEGED),
         SD_BUS_METHOD("ListJobs", NULL, "a(usssoo)", method_list_jobs, SD_BUS_VTABLE_UNPRIVILEGED),
         SD_BUS_METHOD("Subscribe", NULL, NULL, method_subscribe, SD_BUS_VTABLE_UNPRIVILEGED),
         SD_BUS_METHOD("Unsubscribe", NULL, NULL, method_unsubscribe, SD_BUS_VTABLE_UNPRIVILEGED),
@@ -2599,6 +3032,7 @@ const sd_bus_vtable bus_manager_vtable[] = {
         SD_BUS_METHOD("CreateSnapshot", "sb", "o", method_refuse_snapshot, SD_BUS_VTABLE_UNPRIVILEGED|SD_BUS_VTABLE_HIDDEN),
         SD_BUS_METHOD("RemoveSnapshot", "s", NULL, method_refuse_snapshot, SD_BUS_VTABLE_UNPRIVILEGED|SD_BUS_VTABLE_HIDDEN),
         SD_BUS_METHOD("Reload", NULL, NULL, method_reload, SD_BUS_VTABLE_UNPRIVILEGED),
+        SD_BUS_METHOD("ReloadFull", NULL, NULL, method_reload, SD_BUS_VTABLE_UNPRIVILEGED),
         SD_BUS_METHOD("Reexecute", NULL, NULL, method_reexecute, SD_BUS_VTABLE_UNPRIVILEGED),
         SD_BUS_METHOD("Exit", NULL, NULL, method_exit, 0),
         SD_BUS_METHOD("Reboot", NULL, NULL, method_reboot, SD_BUS_VTABLE_CAPABILITY(CAP_SYS_BOOT)),
@@ -112,7 +112,7 @@ static int property_get_dependencies(
                 void *userdata,
                 sd_bus_error *error) {
 
-        Hashmap **h = userdata;
+        UnitDependencyList **l = userdata;
         Iterator j;
         Unit *u;
         void *v;
@@ -120,13 +120,13 @@ static int property_get_dependencies(
 
         assert(bus);
         assert(reply);
-        assert(h);
+        assert(l);
 
         r = sd_bus_message_open_container(reply, 'a', "s");
         if (r < 0)
                 return r;
 
-        HASHMAP_FOREACH_KEY(v, u, *h, j) {
+        UNIT_DEPENDENCY_FOREACH(v, u, *l, j) {
                 r = sd_bus_message_append(reply, "s", u->id);
                 if (r < 0)
                         return r;
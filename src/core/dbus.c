@@ -677,6 +677,9 @@ static int bus_on_connection(sd_event_source *s, int fd, uint32_t revents, void
                 return 0;
         }
 
+        /* Clients on the private bus are sd-bus peers, let them pass large message bodies as memfds */
+        bus->accept_memfd = true;
+
         r = sd_bus_set_sender(bus, "org.freedesktop.systemd1");
         if (r < 0) {
                 log_warning_errno(r, "Failed to set direct connection sender: %m");
@@ -1195,6 +1198,8 @@ int bus_foreach_bus(
                 r = send_message(b, userdata);
                 if (r < 0)
                         ret = r;
+                else
+                        m->n_dbus_signals++;
         }
 
         /* Send to API bus, but only if somebody is subscribed */
@@ -1204,6 +1209,8 @@ int bus_foreach_bus(
                 r = send_message(m->api_bus, userdata);
                 if (r < 0)
                         ret = r;
+                else
+                        m->n_dbus_signals++;
         }
 
         return ret;
@@ -82,6 +82,7 @@
 #include "signal-util.h"
 #include "smack-util.h"
 #include "socket-util.h"
+#include "spawn-helper.h"
 #include "special.h"
 #include "stat-util.h"
 #include "string-table.h"
@@ -337,8 +338,10 @@ static int connect_logger_as(
                 return -errno;
 
         r = connect_journal_socket(fd, uid, gid);
-        if (r < 0)
+        if (r < 0) {
+                safe_close(fd);
                 return r;
+        }
 
         if (shutdown(fd, SHUT_RD) < 0) {
                 safe_close(fd);
@@ -3687,9 +3690,513 @@ static int exec_child(
         return log_unit_error_errno(unit, r, "Failed to execute command: %m");
 }
 
+static int exec_child_run(
+                Unit *unit,
+                const ExecCommand *command,
+                const ExecContext *context,
+                const ExecParameters *params,
+                ExecRuntime *runtime,
+                DynamicCreds *dcreds,
+                char **argv,
+                int socket_fd,
+                int named_iofds[3],
+                int *fds,
+                size_t n_socket_fds,
+                size_t n_storage_fds,
+                char **files_env,
+                int user_lookup_fd) {
+
+        int exit_status = EXIT_SUCCESS, r;
+
+        /* Runs in the new process, either forked off the manager or cloned off the spawn helper. Only returns
+         * on failure, with the exit status to use. */
+
+        r = exec_child(unit,
+                       command,
+                       context,
+                       params,
+                       runtime,
+                       dcreds,
+                       argv,
+                       socket_fd,
+                       named_iofds,
+                       fds,
+                       n_socket_fds,
+                       n_storage_fds,
+                       files_env,
+                       user_lookup_fd,
+                       &exit_status);
+
+        if (r < 0)
+                log_struct_errno(LOG_ERR, r,
+                                 "MESSAGE_ID=" SD_MESSAGE_SPAWN_FAILED_STR,
+                                 LOG_UNIT_ID(unit),
+                                 LOG_UNIT_INVOCATION_ID(unit),
+                                 LOG_UNIT_MESSAGE(unit, "Failed at step %s spawning %s: %m",
+                                                  exit_status_to_string(exit_status, EXIT_STATUS_SYSTEMD),
+                                                  command->path),
+                                 "EXECUTABLE=%s", command->path);
+
+        return exit_status;
+}
+
 static int exec_context_load_environment(const Unit *unit, const ExecContext *c, char ***l);
 static int exec_context_named_iofds(const ExecContext *c, const ExecParameters *p, int named_iofds[3]);
 
+/* Processes may be spawned through the spawn helper (see spawn-helper.h) if all exec_child() would do for them is
+ * simple enough: no user or group changes, no sandboxing, no namespaces, no terminals. The request carries the
+ * parts of the unit, the command, the context and the parameters that exec_child() looks at in that case, and the
+ * cloned process rebuilds these objects from it and runs exec_child() on them, exactly as a forked process would.
+ * For anything else we fork off the manager as before. */
+
+typedef enum ExecHelperString {
+        EXEC_HELPER_COMMAND_PATH,
+        EXEC_HELPER_WORKING_DIRECTORY,
+        EXEC_HELPER_SYSLOG_IDENTIFIER,
+        EXEC_HELPER_CGROUP_PATH,
+        EXEC_HELPER_UNIT_ID,
+        EXEC_HELPER_UNIT_LOG_FIELD,
+        EXEC_HELPER_UNIT_LOG_FORMAT,
+        EXEC_HELPER_INVOCATION_LOG_FIELD,
+        EXEC_HELPER_INVOCATION_LOG_FORMAT,
+        _EXEC_HELPER_STRING_MAX,
+} ExecHelperString;
+
+typedef enum ExecHelperStrv {
+        EXEC_HELPER_ARGV,
+        EXEC_HELPER_PARAMS_ENVIRONMENT,
+        EXEC_HELPER_ENVIRONMENT,
+        EXEC_HELPER_PASS_ENVIRONMENT,
+        EXEC_HELPER_PASS_ENVIRONMENT_VALUES,  /* PassEnvironment= resolved in the manager */
+        EXEC_HELPER_UNSET_ENVIRONMENT,
+        EXEC_HELPER_FILES_ENVIRONMENT,
+        EXEC_HELPER_FD_NAMES,
+        _EXEC_HELPER_STRV_MAX,
+} ExecHelperStrv;
+
+/* Both ends of the connection run the same binary, hence this needs no care about layout or byte order. The header
+ * is followed by the NUL terminated strings, in the order of ExecHelperString (empty ones are unset), and then the
+ * string lists, in the order of ExecHelperStrv. The passed file descriptors are the ones of the ExecParameters
+ * standard streams that are set, in order, then the socket fd and the exec fd, if any, and then the socket and
+ * storage fds. */
+typedef struct ExecHelperRequest {
+        ExecCommandFlags command_flags;
+
+        ExecInput std_input;
+        ExecOutput std_output, std_error;
+        mode_t umask;
+        int oom_score_adjust;
+        int nice;
+        int ioprio;
+        nsec_t timer_slack_nsec;
+        int syslog_priority;
+        ExecKeyringMode keyring_mode;
+        bool oom_score_adjust_set, nice_set, ioprio_set, same_pgrp, ignore_sigpipe, non_blocking,
+                syslog_level_prefix, working_directory_missing_ok;
+        bool rlimit_set[_RLIMIT_MAX];
+        struct rlimit rlimit[_RLIMIT_MAX];
+
+        ExecFlags flags;
+        CGroupMask cgroup_supported;
+        usec_t watchdog_usec;
+        bool stdio_fd_set[3], socket_fd_set, exec_fd_set;
+        uint32_t n_socket_fds, n_storage_fds;
+
+        sd_id128_t invocation_id;
+
+        uint32_t n_strv[_EXEC_HELPER_STRV_MAX];
+} ExecHelperRequest;
+
+static bool exec_context_may_use_helper(
+                Unit *unit,
+                const ExecCommand *command,
+                const ExecContext *c,
+                const ExecParameters *p,
+                const ExecRuntime *runtime,
+                int socket_fd) {
+
+        ExecDirectoryType dt;
+        ExecInput i;
+
+        assert(c);
+        assert(p);
+
+        if (unit_shall_confirm_spawn(unit) || p->idle_pipe)
+                return false;
+
+        if (c->user || c->group || !strv_isempty(c->supplementary_groups) || c->dynamic_user || c->pam_name)
+                return false;
+
+        /* Terminals, files and named file descriptors */
+        if (is_terminal_input(c->std_input) || is_terminal_output(c->std_output) || is_terminal_output(c->std_error))
+                return false;
+        if (c->tty_path || c->tty_reset || c->tty_vhangup || c->tty_vt_disallocate || c->utmp_id)
+                return false;
+        i = fixup_input(c, socket_fd, p->flags & EXEC_APPLY_TTY_STDIN);
+        if (!IN_SET(i, EXEC_INPUT_NULL, EXEC_INPUT_SOCKET) && p->stdin_fd < 0)
+                return false;
+        if (IN_SET(c->std_output, EXEC_OUTPUT_NAMED_FD, EXEC_OUTPUT_FILE, EXEC_OUTPUT_FILE_APPEND) && p->stdout_fd < 0)
+                return false;
+        if (IN_SET(c->std_error, EXEC_OUTPUT_NAMED_FD, EXEC_OUTPUT_FILE, EXEC_OUTPUT_FILE_APPEND) && p->stderr_fd < 0)
+                return false;
+        if (p->stdin_fd >= 0 && isatty(p->stdin_fd))
+                return false;
+
+        if (c->working_directory_home || c->root_directory || c->root_image)
+                return false;
+        for (dt = 0; dt < _EXEC_DIRECTORY_TYPE_MAX; dt++)
+                if (!strv_isempty(c->directories[dt].paths))
+                        return false;
+
+        if (c->cpu_sched_set || c->cpu_set.set || c->cpu_affinity_from_numa ||
+            mpol_is_valid(numa_policy_get_type(&c->numa_policy)) ||
+            c->personality != PERSONALITY_INVALID)
+                return false;
+
+        if (c->private_network || c->private_users || exec_needs_mount_namespace(c, p, runtime))
+                return false;
+
+        if ((p->flags & EXEC_APPLY_SANDBOXING) && !(command->flags & EXEC_COMMAND_FULLY_PRIVILEGED)) {
+                if (command->flags & EXEC_COMMAND_AMBIENT_MAGIC)
+                        return false;
+
+                if (!cap_test_all(c->capability_bounding_set) || c->capability_ambient_set != 0 || c->secure_bits != 0)
+                        return false;
+
+                if (c->selinux_context || c->apparmor_profile || c->smack_process_label || p->selinux_context_net)
+                        return false;
+#if ENABLE_SMACK
+                if (mac_smack_use())
+                        return false;
+#endif
+
+                /* Covers all the seccomp based settings, too */
+                if (c->no_new_privileges || context_has_address_families(c) || c->memory_deny_write_execute ||
+                    c->restrict_realtime || c->restrict_suid_sgid || exec_context_restrict_namespaces_set(c) ||
+                    c->protect_kernel_tunables || c->protect_kernel_modules || c->private_devices ||
+                    context_has_syscall_filters(c) || !set_isempty(c->syscall_archs) || c->lock_personality)
+                        return false;
+        }
+
+        if (p->n_socket_fds + p->n_storage_fds + 5 > SPAWN_HELPER_FDS_MAX)
+                return false;
+
+        return true;
+}
+
+
+static int exec_helper_append_string(char **buf, size_t *allocated, size_t *size, const char *s) {
+        size_t l;
+
+        l = strlen(strempty(s)) + 1;
+
+        if (*size + l > SPAWN_HELPER_REQUEST_MAX)
+                return -E2BIG;
+
+        if (!GREEDY_REALLOC(*buf, *allocated, *size + l))
+                return -ENOMEM;
+
+        memcpy(*buf + *size, strempty(s), l);
+        *size += l;
+
+        return 0;
+}
+
+static int exec_spawn_via_helper(
+                Unit *unit,
+                const ExecCommand *command,
+                const ExecContext *context,
+                const ExecParameters *params,
+                const ExecRuntime *runtime,
+                char **argv,
+                int socket_fd,
+                int *fds,
+                size_t n_socket_fds,
+                size_t n_storage_fds,
+                char **files_env,
+                pid_t *ret) {
+
+        _cleanup_strv_free_ char **pass_env = NULL;
+        _cleanup_free_ char *buf = NULL;
+        const char *strings[_EXEC_HELPER_STRING_MAX] = {};
+        char **strvs[_EXEC_HELPER_STRV_MAX];
+        int passed_fds[SPAWN_HELPER_FDS_MAX], stdio_fds[3];
+        size_t allocated, size, n_passed = 0, k;
+        ExecHelperRequest *req;
+        int r;
+
+        assert(unit->manager->spawn_helper);
+
+        if (!exec_context_may_use_helper(unit, command, context, params, runtime, socket_fd))
+                return -EOPNOTSUPP;
+
+        /* The helper's environment block is that of the manager when the helper was started, hence resolve
+         * PassEnvironment= here */
+        r = build_pass_environment(context, &pass_env);
+        if (r < 0)
+                return r;
+
+        buf = malloc0(sizeof(ExecHelperRequest));
+        if (!buf)
+                return -ENOMEM;
+        allocated = size = sizeof(ExecHelperRequest);
+        req = (ExecHelperRequest*) buf;
+
+        stdio_fds[STDIN_FILENO] = params->stdin_fd;
+        stdio_fds[STDOUT_FILENO] = params->stdout_fd;
+        stdio_fds[STDERR_FILENO] = params->stderr_fd;
+
+        *req = (ExecHelperRequest) {
+                .command_flags = command->flags,
+
+                .std_input = context->std_input,
+                .std_output = context->std_output,
+                .std_error = context->std_error,
+                .umask = context->umask,
+                .oom_score_adjust = context->oom_score_adjust,
+                .nice = context->nice,
+                .ioprio = context->ioprio,
+                .timer_slack_nsec = context->timer_slack_nsec,
+                .syslog_priority = context->syslog_priority,
+                .keyring_mode = context->keyring_mode,
+                .oom_score_adjust_set = context->oom_score_adjust_set,
+                .nice_set = context->nice_set,
+                .ioprio_set = context->ioprio_set,
+                .same_pgrp = context->same_pgrp,
+                .ignore_sigpipe = context->ignore_sigpipe,
+                .non_blocking = context->non_blocking,
+                .syslog_level_prefix = context->syslog_level_prefix,
+                .working_directory_missing_ok = context->working_directory_missing_ok,
+
+                .flags = params->flags,
+                .cgroup_supported = params->cgroup_supported,
+                .watchdog_usec = params->watchdog_usec,
+                .socket_fd_set = socket_fd >= 0,
+                .exec_fd_set = params->exec_fd >= 0,
+                .n_socket_fds = n_socket_fds,
+                .n_storage_fds = n_storage_fds,
+
+                .invocation_id = unit->invocation_id,
+        };
+
+        for (k = 0; k < 3; k++)
+                req->stdio_fd_set[k] = stdio_fds[k] >= 0;
+
+        for (k = 0; k < _RLIMIT_MAX; k++)
+                if (context->rlimit[k]) {
+                        req->rlimit_set[k] = true;
+                        req->rlimit[k] = *context->rlimit[k];
+                }
+
+        strings[EXEC_HELPER_COMMAND_PATH] = command->path;
+        strings[EXEC_HELPER_WORKING_DIRECTORY] = context->working_directory;
+        strings[EXEC_HELPER_SYSLOG_IDENTIFIER] = context->syslog_identifier;
+        strings[EXEC_HELPER_CGROUP_PATH] = params->cgroup_path;
+        strings[EXEC_HELPER_UNIT_ID] = unit->id;
+        strings[EXEC_HELPER_UNIT_LOG_FIELD] = unit->manager->unit_log_field;
+        strings[EXEC_HELPER_UNIT_LOG_FORMAT] = unit->manager->unit_log_format_string;
+        strings[EXEC_HELPER_INVOCATION_LOG_FIELD] = unit->manager->invocation_log_field;
+        strings[EXEC_HELPER_INVOCATION_LOG_FORMAT] = unit->manager->invocation_log_format_string;
+
+        strvs[EXEC_HELPER_ARGV] = argv;
+        strvs[EXEC_HELPER_PARAMS_ENVIRONMENT] = params->environment;
+        strvs[EXEC_HELPER_ENVIRONMENT] = context->environment;
+        strvs[EXEC_HELPER_PASS_ENVIRONMENT] = context->pass_environment;
+        strvs[EXEC_HELPER_PASS_ENVIRONMENT_VALUES] = pass_env;
+        strvs[EXEC_HELPER_UNSET_ENVIRONMENT] = context->unset_environment;
+        strvs[EXEC_HELPER_FILES_ENVIRONMENT] = files_env;
+        strvs[EXEC_HELPER_FD_NAMES] = params->fd_names;
+
+        for (k = 0; k < _EXEC_HELPER_STRING_MAX; k++) {
+                r = exec_helper_append_string(&buf, &allocated, &size, strings[k]);
+                if (r < 0)
+                        return r;
+        }
+
+        for (k = 0; k < _EXEC_HELPER_STRV_MAX; k++) {
+                char **s;
+
+                STRV_FOREACH(s, strvs[k]) {
+                        r = exec_helper_append_string(&buf, &allocated, &size, *s);
+                        if (r < 0)
+                                return r;
+                }
+
+                /* The buffer might have moved */
+                ((ExecHelperRequest*) buf)->n_strv[k] = strv_length(strvs[k]);
+        }
+
+        for (k = 0; k < 3; k++)
+                if (stdio_fds[k] >= 0)
+                        passed_fds[n_passed++] = stdio_fds[k];
+        if (socket_fd >= 0)
+                passed_fds[n_passed++] = socket_fd;
+        if (params->exec_fd >= 0)
+                passed_fds[n_passed++] = params->exec_fd;
+        for (k = 0; k < n_socket_fds + n_storage_fds; k++)
+                passed_fds[n_passed++] = fds[k];
+
+        return spawn_helper_spawn(unit->manager->spawn_helper, buf, size, passed_fds, n_passed, ret);
+}
+
+static int exec_helper_child(void *data, size_t size, int *fds, size_t n_fds) {
+        _cleanup_strv_free_ char **argv = NULL, **params_env = NULL, **env = NULL, **pass_env = NULL,
+                **pass_env_values = NULL, **unset_env = NULL, **files_env = NULL, **fd_names = NULL;
+        char ***strvs[_EXEC_HELPER_STRV_MAX] = {
+                [EXEC_HELPER_ARGV] = &argv,
+                [EXEC_HELPER_PARAMS_ENVIRONMENT] = &params_env,
+                [EXEC_HELPER_ENVIRONMENT] = &env,
+                [EXEC_HELPER_PASS_ENVIRONMENT] = &pass_env,
+                [EXEC_HELPER_PASS_ENVIRONMENT_VALUES] = &pass_env_values,
+                [EXEC_HELPER_UNSET_ENVIRONMENT] = &unset_env,
+                [EXEC_HELPER_FILES_ENVIRONMENT] = &files_env,
+                [EXEC_HELPER_FD_NAMES] = &fd_names,
+        };
+        int named_iofds[3] = { -1, -1, -1 }, stdio_fds[3] = { -1, -1, -1 }, socket_fd = -1, exec_fd = -1;
+        const ExecHelperRequest *req = data;
+        const char *strings[_EXEC_HELPER_STRING_MAX];
+        ExecContext context = {};
+        size_t k, n_expected = 0;
+        char *p, *e, **i;
+
+        /* Runs in the process cloned off the spawn helper. Rebuilds what exec_child() needs from the request, and then
+         * proceeds exactly like a process forked off the manager. */
+
+        if (size < sizeof(ExecHelperRequest))
+                return EXIT_FAILURE;
+
+        p = (char*) data + sizeof(ExecHelperRequest);
+        e = (char*) data + size;
+
+        for (k = 0; k < _EXEC_HELPER_STRING_MAX; k++) {
+                char *z;
+
+                z = memchr(p, 0, e - p);
+                if (!z)
+                        return EXIT_FAILURE;
+
+                strings[k] = empty_to_null(p);
+                p = z + 1;
+        }
+
+        for (k = 0; k < _EXEC_HELPER_STRV_MAX; k++) {
+                uint32_t j;
+
+                *strvs[k] = new0(char*, req->n_strv[k] + 1);
+                if (!*strvs[k])
+                        return EXIT_MEMORY;
+
+                for (j = 0; j < req->n_strv[k]; j++) {
+                        char *z;
+
+                        z = memchr(p, 0, e - p);
+                        if (!z)
+                                return EXIT_FAILURE;
+
+                        (*strvs[k])[j] = strdup(p);
+                        if (!(*strvs[k])[j])
+                                return EXIT_MEMORY;
+
+                        p = z + 1;
+                }
+        }
+
+        if (!strings[EXEC_HELPER_COMMAND_PATH] || !strings[EXEC_HELPER_UNIT_ID])
+                return EXIT_FAILURE;
+
+        for (k = 0; k < 3; k++)
+                n_expected += req->stdio_fd_set[k];
+        n_expected += req->socket_fd_set + req->exec_fd_set + req->n_socket_fds + req->n_storage_fds;
+        if (n_fds != n_expected)
+                return EXIT_FDS;
+
+        for (k = 0; k < 3; k++)
+                if (req->stdio_fd_set[k])
+                        stdio_fds[k] = *(fds++);
+        if (req->socket_fd_set)
+                socket_fd = *(fds++);
+        if (req->exec_fd_set)
+                exec_fd = *(fds++);
+
+        /* build_pass_environment() looks at our own environment block, make it the manager's */
+        if (clearenv() != 0)
+                return EXIT_MEMORY;
+        STRV_FOREACH(i, pass_env_values)
+                if (putenv(*i) != 0)
+                        return EXIT_MEMORY;
+
+        {
+                Manager manager = {
+                        .unit_log_field = strings[EXEC_HELPER_UNIT_LOG_FIELD],
+                        .unit_log_format_string = strings[EXEC_HELPER_UNIT_LOG_FORMAT],
+                        .invocation_log_field = strings[EXEC_HELPER_INVOCATION_LOG_FIELD],
+                        .invocation_log_format_string = strings[EXEC_HELPER_INVOCATION_LOG_FORMAT],
+                };
+                Unit unit = {
+                        .manager = &manager,
+                        .id = (char*) strings[EXEC_HELPER_UNIT_ID],
+                        .invocation_id = req->invocation_id,
+                };
+                ExecCommand command = {
+                        .path = (char*) strings[EXEC_HELPER_COMMAND_PATH],
+                        .argv = argv,
+                        .flags = req->command_flags,
+                };
+                ExecParameters params = {
+                        .environment = params_env,
+                        .fd_names = fd_names,
+                        .n_socket_fds = req->n_socket_fds,
+                        .n_storage_fds = req->n_storage_fds,
+                        .flags = req->flags,
+                        .cgroup_path = strings[EXEC_HELPER_CGROUP_PATH],
+                        .cgroup_supported = req->cgroup_supported,
+                        .watchdog_usec = req->watchdog_usec,
+                        .stdin_fd = stdio_fds[STDIN_FILENO],
+                        .stdout_fd = stdio_fds[STDOUT_FILENO],
+                        .stderr_fd = stdio_fds[STDERR_FILENO],
+                        .exec_fd = exec_fd,
+                };
+
+                if (!sd_id128_is_null(unit.invocation_id))
+                        sd_id128_to_string(unit.invocation_id, unit.invocation_id_string);
+
+                exec_context_init(&context);
+                context.environment = env;
+                context.pass_environment = pass_env;
+                context.unset_environment = unset_env;
+                context.working_directory = (char*) strings[EXEC_HELPER_WORKING_DIRECTORY];
+                context.working_directory_missing_ok = req->working_directory_missing_ok;
+                context.std_input = req->std_input;
+                context.std_output = req->std_output;
+                context.std_error = req->std_error;
+                context.umask = req->umask;
+                context.oom_score_adjust = req->oom_score_adjust;
+                context.oom_score_adjust_set = req->oom_score_adjust_set;
+                context.nice = req->nice;
+                context.nice_set = req->nice_set;
+                context.ioprio = req->ioprio;
+                context.ioprio_set = req->ioprio_set;
+                context.timer_slack_nsec = req->timer_slack_nsec;
+                context.same_pgrp = req->same_pgrp;
+                context.ignore_sigpipe = req->ignore_sigpipe;
+                context.non_blocking = req->non_blocking;
+                context.syslog_identifier = (char*) strings[EXEC_HELPER_SYSLOG_IDENTIFIER];
+                context.syslog_priority = req->syslog_priority;
+                context.syslog_level_prefix = req->syslog_level_prefix;
+                context.keyring_mode = req->keyring_mode;
+                for (k = 0; k < _RLIMIT_MAX; k++)
+                        if (req->rlimit_set[k])
+                                context.rlimit[k] = (struct rlimit*) &req->rlimit[k];
+
+                return exec_child_run(&unit, &command, &context, &params, NULL, NULL, argv, socket_fd, named_iofds,
+                                      fds, req->n_socket_fds, req->n_storage_fds, files_env, -1);
+        }
+}
+
+int exec_spawn_helper_new(SpawnHelper **ret) {
+        return spawn_helper_new("(sd-spawn)", exec_helper_child, ret);
+}
+
 int exec_spawn(Unit *unit,
                ExecCommand *command,
                const ExecContext *context,
@@ -3767,44 +4274,45 @@ int exec_spawn(Unit *unit,
                 }
         }
 
+        if (unit->manager->spawn_helper_enabled && unit->manager->spawn_helper) {
+                r = exec_spawn_via_helper(unit, command, context, params, runtime, argv, socket_fd,
+                                          fds, n_socket_fds, n_storage_fds, files_env, &pid);
+                if (r >= 0) {
+                        log_unit_debug(unit, "Spawned %s through the spawn helper as "PID_FMT, command->path, pid);
+                        goto spawned;
+                }
+                if (r != -EOPNOTSUPP)
+                        log_unit_debug_errno(unit, r, "Failed to spawn %s through the spawn helper, forking instead: %m", command->path);
+
+                if (!spawn_helper_is_connected(unit->manager->spawn_helper)) {
+                        log_warning("Spawn helper stopped working, forking for all processes from now on.");
+                        unit->manager->spawn_helper = spawn_helper_free(unit->manager->spawn_helper);
+                }
+        }
+
         pid = fork();
         if (pid < 0)
                 return log_unit_error_errno(unit, errno, "Failed to fork: %m");
 
-        if (pid == 0) {
-                int exit_status = EXIT_SUCCESS;
-
-                r = exec_child(unit,
-                               command,
-                               context,
-                               params,
-                               runtime,
-                               dcreds,
-                               argv,
-                               socket_fd,
-                               named_iofds,
-                               fds,
-                               n_socket_fds,
-                               n_storage_fds,
-                               files_env,
-                               unit->manager->user_lookup_fds[1],
-                               &exit_status);
-
-                if (r < 0)
-                        log_struct_errno(LOG_ERR, r,
-                                         "MESSAGE_ID=" SD_MESSAGE_SPAWN_FAILED_STR,
-                                         LOG_UNIT_ID(unit),
-                                         LOG_UNIT_INVOCATION_ID(unit),
-                                         LOG_UNIT_MESSAGE(unit, "Failed at step %s spawning %s: %m",
-                                                          exit_status_to_string(exit_status, EXIT_STATUS_SYSTEMD),
-                                                          command->path),
-                                         "EXECUTABLE=%s", command->path);
-
-                _exit(exit_status);
-        }
+        if (pid == 0)
+                _exit(exec_child_run(unit,
+                                     command,
+                                     context,
+                                     params,
+                                     runtime,
+                                     dcreds,
+                                     argv,
+                                     socket_fd,
+                                     named_iofds,
+                                     fds,
+                                     n_socket_fds,
+                                     n_storage_fds,
+                                     files_env,
+                                     unit->manager->user_lookup_fds[1]));
 
         log_unit_debug(unit, "Forked %s as "PID_FMT, command->path, pid);
 
+spawned:
         /* We add the new process to the cgroup both in the child (so that we can be sure that no user code is ever
          * executed outside of the cgroup) and in the parent (so that we can be sure that when we kill the cgroup the
          * process will be killed too). */
@@ -331,6 +331,7 @@ struct ExecParameters {
 
 #include "unit.h"
 #include "dynamic-user.h"
+#include "spawn-helper.h"
 
 int exec_spawn(Unit *unit,
                ExecCommand *command,
@@ -340,6 +341,8 @@ int exec_spawn(Unit *unit,
                DynamicCreds *dynamic_creds,
                pid_t *ret);
 
+int exec_spawn_helper_new(SpawnHelper **ret);
+
 void exec_command_done_array(ExecCommand *c, size_t n);
 
 ExecCommand* exec_command_free_list(ExecCommand *c);
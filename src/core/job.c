@@ -469,7 +469,7 @@ static bool job_is_runnable(Job *j) {
                  * dependencies, regardless whether they are
                  * starting or stopping something. */
 
-                HASHMAP_FOREACH_KEY(v, other, j->unit->dependencies[UNIT_AFTER], i)
+                UNIT_DEPENDENCY_FOREACH(v, other, j->unit->dependencies[UNIT_AFTER], i)
                         if (other->job)
                                 return false;
         }
@@ -477,7 +477,7 @@ static bool job_is_runnable(Job *j) {
         /* Also, if something else is being stopped and we should
          * change state after it, then let's wait. */
 
-        HASHMAP_FOREACH_KEY(v, other, j->unit->dependencies[UNIT_BEFORE], i)
+        UNIT_DEPENDENCY_FOREACH(v, other, j->unit->dependencies[UNIT_BEFORE], i)
                 if (other->job &&
                     IN_SET(other->job->type, JOB_STOP, JOB_RESTART))
                         return false;
@@ -947,7 +947,7 @@ static void job_fail_dependencies(Unit *u, UnitDependency d) {
 
         assert(u);
 
-        HASHMAP_FOREACH_KEY(v, other, u->dependencies[d], i) {
+        UNIT_DEPENDENCY_FOREACH(v, other, u->dependencies[d], i) {
                 Job *j = other->job;
 
                 if (!j)
@@ -1048,12 +1048,12 @@ int job_finish_and_invalidate(Job *j, JobResult result, bool recursive, bool alr
 
 finish:
         /* Try to start the next jobs that can be started */
-        HASHMAP_FOREACH_KEY(v, other, u->dependencies[UNIT_AFTER], i)
+        UNIT_DEPENDENCY_FOREACH(v, other, u->dependencies[UNIT_AFTER], i)
                 if (other->job) {
                         job_add_to_run_queue(other->job);
                         job_add_to_gc_queue(other->job);
                 }
-        HASHMAP_FOREACH_KEY(v, other, u->dependencies[UNIT_BEFORE], i)
+        UNIT_DEPENDENCY_FOREACH(v, other, u->dependencies[UNIT_BEFORE], i)
                 if (other->job) {
                         job_add_to_run_queue(other->job);
                         job_add_to_gc_queue(other->job);
@@ -1149,8 +1149,10 @@ void job_add_to_dbus_queue(Job *j) {
         assert(j);
         assert(j->installed);
 
-        if (j->in_dbus_queue)
+        if (j->in_dbus_queue) {
+                j->manager->n_dbus_changes_coalesced++;
                 return;
+        }
 
         /* We don't check if anybody is subscribed here, since this
          * job might just have been created and not yet assigned to a
@@ -1194,25 +1196,22 @@ int job_serialize(Job *j, FILE *f) {
         return 0;
 }
 
-int job_deserialize(Job *j, FILE *f) {
+int job_deserialize(Job *j, SerializationReader *reader) {
         int r;
 
         assert(j);
-        assert(f);
+        assert(reader);
 
         for (;;) {
-                _cleanup_free_ char *line = NULL;
                 char *l, *v;
                 size_t k;
 
-                r = read_line(f, LONG_LINE_MAX, &line);
+                r = serialization_read_line(reader, &l);
                 if (r < 0)
                         return log_error_errno(r, "Failed to read serialization line: %m");
                 if (r == 0)
                         return 0;
 
-                l = strstrip(line);
-
                 /* End marker */
                 if (isempty(l))
                         return 0;
@@ -1435,7 +1434,7 @@ bool job_may_gc(Job *j) {
 
         /* If a job is ordered after ours, and is to be started, then it needs to wait for us, regardless if we stop or
          * start, hence let's not GC in that case. */
-        HASHMAP_FOREACH_KEY(v, other, j->unit->dependencies[UNIT_BEFORE], i) {
+        UNIT_DEPENDENCY_FOREACH(v, other, j->unit->dependencies[UNIT_BEFORE], i) {
                 if (!other->job)
                         continue;
 
@@ -1448,7 +1447,7 @@ bool job_may_gc(Job *j) {
 
         /* If we are going down, but something else is ordered After= us, then it needs to wait for us */
         if (IN_SET(j->type, JOB_STOP, JOB_RESTART))
-                HASHMAP_FOREACH_KEY(v, other, j->unit->dependencies[UNIT_AFTER], i) {
+                UNIT_DEPENDENCY_FOREACH(v, other, j->unit->dependencies[UNIT_AFTER], i) {
                         if (!other->job)
                                 continue;
 
@@ -1540,7 +1539,7 @@ int job_get_before(Job *j, Job*** ret) {
 
         if (IN_SET(j->type, JOB_START, JOB_VERIFY_ACTIVE, JOB_RELOAD)) {
 
-                HASHMAP_FOREACH_KEY(v, other, j->unit->dependencies[UNIT_AFTER], i) {
+                UNIT_DEPENDENCY_FOREACH(v, other, j->unit->dependencies[UNIT_AFTER], i) {
                         if (!other->job)
                                 continue;
 
@@ -1550,7 +1549,7 @@ int job_get_before(Job *j, Job*** ret) {
                 }
         }
 
-        HASHMAP_FOREACH_KEY(v, other, j->unit->dependencies[UNIT_BEFORE], i) {
+        UNIT_DEPENDENCY_FOREACH(v, other, j->unit->dependencies[UNIT_BEFORE], i) {
                 if (!other->job)
                         continue;
 
@@ -1581,7 +1580,7 @@ int job_get_after(Job *j, Job*** ret) {
 
         /* Returns a list of all pending jobs that are waiting for this job to finish. */
 
-        HASHMAP_FOREACH_KEY(v, other, j->unit->dependencies[UNIT_BEFORE], i) {
+        UNIT_DEPENDENCY_FOREACH(v, other, j->unit->dependencies[UNIT_BEFORE], i) {
                 if (!other->job)
                         continue;
 
@@ -1598,7 +1597,7 @@ int job_get_after(Job *j, Job*** ret) {
 
         if (IN_SET(j->type, JOB_STOP, JOB_RESTART)) {
 
-                HASHMAP_FOREACH_KEY(v, other, j->unit->dependencies[UNIT_AFTER], i) {
+                UNIT_DEPENDENCY_FOREACH(v, other, j->unit->dependencies[UNIT_AFTER], i) {
                         if (!other->job)
                                 continue;
 
@@ -131,10 +131,7 @@ int unit_load_dropin(Unit *u) {
         }
 
         STRV_FOREACH(f, u->dropin_paths)
-                (void) config_parse(u->id, *f, NULL,
-                                    UNIT_VTABLE(u)->sections,
-                                    config_item_perf_lookup, load_fragment_gperf_lookup,
-                                    0, u);
+                (void) unit_config_parse(u, *f, NULL, 0);
 
         u->dropin_mtime = now(CLOCK_REALTIME);
 
@@ -1558,7 +1558,7 @@ int config_parse_trigger_unit(
         assert(rvalue);
         assert(data);
 
-        if (!hashmap_isempty(u->dependencies[UNIT_TRIGGERS])) {
+        if (!unit_dependency_list_isempty(u->dependencies[UNIT_TRIGGERS])) {
                 log_syntax(unit, LOG_ERR, filename, line, 0, "Multiple units to trigger specified, ignoring: %s", rvalue);
                 return 0;
         }
@@ -4396,6 +4396,31 @@ static int merge_by_names(Unit **u, Set *names, const char *id) {
         return 0;
 }
 
+int unit_config_parse(Unit *u, const char *filename, FILE *f, ConfigParseFlags flags) {
+        ConfigSource *s;
+        int r;
+
+        assert(u);
+        assert(filename);
+
+        /* Parses a unit file or drop-in, reusing what was read ahead by the manager if the file didn't change */
+
+        r = manager_get_config_source(u->manager, filename, f, flags, &s);
+        if (r == -ENOMEM)
+                return r;
+        if (r < 0)
+                /* Leave it to the parser to deal with (and log about) files we can't access */
+                return config_parse(u->id, filename, f,
+                                    UNIT_VTABLE(u)->sections,
+                                    config_item_perf_lookup, load_fragment_gperf_lookup,
+                                    flags, u);
+
+        return config_parse_source(u->id, s,
+                                   UNIT_VTABLE(u)->sections,
+                                   config_item_perf_lookup, load_fragment_gperf_lookup,
+                                   flags, u);
+}
+
 static int load_from_path(Unit *u, const char *path) {
         _cleanup_set_free_free_ Set *symlink_names = NULL;
         _cleanup_fclose_ FILE *f = NULL;
@@ -4491,10 +4516,7 @@ static int load_from_path(Unit *u, const char *path) {
                 u->fragment_mtime = timespec_load(&st.st_mtim);
 
                 /* Now, parse the file contents */
-                r = config_parse(u->id, filename, f,
-                                 UNIT_VTABLE(u)->sections,
-                                 config_item_perf_lookup, load_fragment_gperf_lookup,
-                                 CONFIG_PARSE_ALLOW_INCLUDE, u);
+                r = unit_config_parse(u, filename, f, CONFIG_PARSE_ALLOW_INCLUDE);
                 if (r < 0)
                         return r;
         }
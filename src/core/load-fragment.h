@@ -7,6 +7,7 @@
 /* Read service data from .desktop file style configuration fragments */
 
 int unit_load_fragment(Unit *u);
+int unit_config_parse(Unit *u, const char *filename, FILE *f, ConfigParseFlags flags);
 
 void unit_dump_config_items(FILE *f);
 
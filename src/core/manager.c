@@ -32,6 +32,8 @@
 #include "bus-util.h"
 #include "clean-ipc.h"
 #include "clock-util.h"
+#include "conf-files.h"
+#include "copy.h"
 #include "dbus-job.h"
 #include "dbus-manager.h"
 #include "dbus-unit.h"
@@ -62,7 +64,9 @@
 #include "ratelimit.h"
 #include "rlimit-util.h"
 #include "rm-rf.h"
+#include "serialize.h"
 #include "signal-util.h"
+#include "siphash24.h"
 #include "socket-util.h"
 #include "special.h"
 #include "stat-util.h"
@@ -96,6 +100,9 @@
 /* How many units and jobs to process of the bus queue before returning to the event loop. */
 #define MANAGER_BUS_MESSAGE_BUDGET 100U
 
+/* For how long to keep processing pending events before generating the bus messages for the changes queued so far */
+#define MANAGER_BUS_COALESCE_USEC (50*USEC_PER_MSEC)
+
 static int manager_dispatch_notify_fd(sd_event_source *source, int fd, uint32_t revents, void *userdata);
 static int manager_dispatch_cgroups_agent_fd(sd_event_source *source, int fd, uint32_t revents, void *userdata);
 static int manager_dispatch_signal_fd(sd_event_source *source, int fd, uint32_t revents, void *userdata);
@@ -108,6 +115,7 @@ static int manager_dispatch_sigchld(sd_event_source *source, void *userdata);
 static int manager_dispatch_timezone_change(sd_event_source *source, const struct inotify_event *event, void *userdata);
 static int manager_run_environment_generators(Manager *m);
 static int manager_run_generators(Manager *m);
+static void generator_timings_free(GeneratorTiming *t, size_t n);
 
 static void manager_watch_jobs_in_progress(Manager *m) {
         usec_t next;
@@ -1082,7 +1090,7 @@ static void unit_gc_mark_good(Unit *u, unsigned gc_marker) {
         u->gc_marker = gc_marker + GC_OFFSET_GOOD;
 
         /* Recursively mark referenced units as GOOD as well */
-        HASHMAP_FOREACH_KEY(v, other, u->dependencies[UNIT_REFERENCES], i)
+        UNIT_DEPENDENCY_FOREACH(v, other, u->dependencies[UNIT_REFERENCES], i)
                 if (other->gc_marker == gc_marker + GC_OFFSET_UNSURE)
                         unit_gc_mark_good(other, gc_marker);
 }
@@ -1109,7 +1117,7 @@ static void unit_gc_sweep(Unit *u, unsigned gc_marker) {
 
         is_bad = true;
 
-        HASHMAP_FOREACH_KEY(v, other, u->dependencies[UNIT_REFERENCED_BY], i) {
+        UNIT_DEPENDENCY_FOREACH(v, other, u->dependencies[UNIT_REFERENCED_BY], i) {
                 unit_gc_sweep(other, gc_marker);
 
                 if (other->gc_marker == gc_marker + GC_OFFSET_GOOD)
@@ -1301,6 +1309,8 @@ Manager* manager_free(Manager *m) {
         exec_runtime_vacuum(m);
         hashmap_free(m->exec_runtime_by_id);
 
+        spawn_helper_free(m->spawn_helper);
+
         dynamic_user_vacuum(m, false);
         hashmap_free(m->dynamic_users);
 
@@ -1341,9 +1351,11 @@ Manager* manager_free(Manager *m) {
 
         lookup_paths_free(&m->lookup_paths);
         strv_free(m->environment);
+        generator_timings_free(m->generator_timings, m->n_generator_timings);
 
         hashmap_free(m->cgroup_unit);
         set_free_free(m->unit_path_cache);
+        hashmap_free_with_destructor(m->config_sources, config_source_free);
 
         free(m->switch_root);
         free(m->switch_root_init);
@@ -1491,6 +1503,410 @@ fail:
         m->unit_path_cache = set_free_free(m->unit_path_cache);
 }
 
+static bool manager_path_is_generated(Manager *m, const char *path) {
+        assert(m);
+
+        if (!path)
+                return false;
+
+        return (m->lookup_paths.generator && path_startswith(path, m->lookup_paths.generator)) ||
+                (m->lookup_paths.generator_early && path_startswith(path, m->lookup_paths.generator_early)) ||
+                (m->lookup_paths.generator_late && path_startswith(path, m->lookup_paths.generator_late));
+}
+
+static void hash_stat(const struct stat *st, struct siphash *state) {
+        siphash24_compress(&st->st_dev, sizeof(st->st_dev), state);
+        siphash24_compress(&st->st_ino, sizeof(st->st_ino), state);
+        siphash24_compress(&st->st_mode, sizeof(st->st_mode), state);
+        siphash24_compress(&st->st_size, sizeof(st->st_size), state);
+        siphash24_compress(&st->st_ctim, sizeof(st->st_ctim), state);
+}
+
+static int hash_unit_directory(const char *path, bool by_contents, unsigned level, struct siphash *state) {
+        _cleanup_strv_free_ char **names = NULL;
+        _cleanup_closedir_ DIR *d = NULL;
+        struct dirent *de;
+        char **n;
+        int r;
+
+        assert(path);
+        assert(state);
+
+        siphash24_compress(path, strlen(path) + 1, state);
+
+        d = opendir(path);
+        if (!d) {
+                r = -errno;
+                siphash24_compress(&r, sizeof(r), state);
+                return 0;
+        }
+
+        FOREACH_DIRENT_ALL(de, d, return -errno) {
+                if (dot_or_dot_dot(de->d_name))
+                        continue;
+
+                r = strv_extend(&names, de->d_name);
+                if (r < 0)
+                        return r;
+        }
+
+        /* Directory order is not stable across file systems, hence sort */
+        strv_sort(names);
+
+        STRV_FOREACH(n, names) {
+                struct stat st;
+
+                siphash24_compress(*n, strlen(*n) + 1, state);
+
+                if (fstatat(dirfd(d), *n, &st, AT_SYMLINK_NOFOLLOW) < 0) {
+                        r = -errno;
+                        siphash24_compress(&r, sizeof(r), state);
+                        continue;
+                }
+
+                if (S_ISDIR(st.st_mode)) {
+                        _cleanup_free_ char *p = NULL;
+
+                        /* .d/, .wants/ and .requires/ directories, nothing below them is ever looked at */
+                        if (level > 0)
+                                continue;
+
+                        p = path_join(NULL, path, *n);
+                        if (!p)
+                                return -ENOMEM;
+
+                        r = hash_unit_directory(p, by_contents, level + 1, state);
+                        if (r < 0)
+                                return r;
+
+                } else if (by_contents) {
+                        _cleanup_free_ char *c = NULL;
+                        size_t size = 0;
+
+                        /* Generators write all their files anew on each run, hence their inodes and timestamps change
+                         * every time, and only the contents tell whether anything is different. */
+                        if (S_ISLNK(st.st_mode))
+                                r = readlinkat_malloc(dirfd(d), *n, &c);
+                        else {
+                                _cleanup_free_ char *p = NULL;
+
+                                p = path_join(NULL, path, *n);
+                                if (!p)
+                                        return -ENOMEM;
+
+                                r = read_full_file(p, &c, &size);
+                        }
+                        if (r == -ENOMEM)
+                                return r;
+                        if (r < 0)
+                                siphash24_compress(&r, sizeof(r), state);
+                        else
+                                siphash24_compress(c, S_ISLNK(st.st_mode) ? strlen(c) : size, state);
+
+                } else {
+                        hash_stat(&st, state);
+
+                        /* Linked unit files may live outside of the search path, cover their targets too */
+                        if (S_ISLNK(st.st_mode)) {
+                                if (fstatat(dirfd(d), *n, &st, 0) < 0) {
+                                        r = -errno;
+                                        siphash24_compress(&r, sizeof(r), state);
+                                } else
+                                        hash_stat(&st, state);
+                        }
+                }
+        }
+
+        return 0;
+}
+
+static int manager_units_source_stamp(Manager *m, uint64_t *ret) {
+        static const uint8_t key[16] = {
+                0x3b, 0x9f, 0x72, 0x0e, 0xa4, 0x51, 0x4c, 0xd8,
+                0x86, 0x2f, 0xe1, 0x17, 0x6d, 0xc3, 0x09, 0x5a,
+        };
+        _cleanup_strv_free_ char **conf_files = NULL;
+        struct siphash state;
+        const char *fn;
+        char **i;
+        int r;
+
+        assert(m);
+        assert(ret);
+
+        /* Covers everything loading units depends on: the unit files and drop-ins in the search path, the output of
+         * the generators, the environment and the manager configuration the unit defaults are derived from. If this
+         * doesn't change across a reload, the units loaded now are still current. */
+
+        siphash24_init(&state, key);
+
+        STRV_FOREACH(i, m->lookup_paths.search_path) {
+                r = hash_unit_directory(*i, manager_path_is_generated(m, *i), 0, &state);
+                if (r < 0)
+                        return r;
+        }
+
+        STRV_FOREACH(i, m->environment)
+                siphash24_compress(*i, strlen(*i) + 1, &state);
+
+        fn = MANAGER_IS_SYSTEM(m) ? PKGSYSCONFDIR "/system.conf" : PKGSYSCONFDIR "/user.conf";
+        r = conf_files_list_nulstr(&conf_files, ".conf", NULL, 0,
+                                   MANAGER_IS_SYSTEM(m) ?
+                                   CONF_PATHS_NULSTR("systemd/system.conf.d") :
+                                   CONF_PATHS_NULSTR("systemd/user.conf.d"));
+        if (r < 0)
+                return r;
+
+        r = strv_extend(&conf_files, fn);
+        if (r < 0)
+                return r;
+
+        STRV_FOREACH(i, conf_files) {
+                struct stat st = {};
+
+                siphash24_compress(*i, strlen(*i) + 1, &state);
+                (void) stat(*i, &st);
+                hash_stat(&st, &state);
+        }
+
+        *ret = siphash24_finalize(&state);
+        return 0;
+}
+
+static void manager_update_units_source_stamp(Manager *m) {
+        int r;
+
+        assert(m);
+
+        r = manager_units_source_stamp(m, &m->units_source_stamp);
+        if (r < 0) {
+                log_debug_errno(r, "Failed to determine unit source stamp, next reload will be a full one: %m");
+                m->units_source_stamp = 0;
+        }
+}
+
+static bool manager_has_units_in_error(Manager *m) {
+        Iterator i;
+        Unit *u;
+
+        assert(m);
+
+        /* Loading may have failed for reasons unrelated to the unit files, give those units another chance */
+        HASHMAP_FOREACH(u, m->units, i)
+                if (u->load_state == UNIT_ERROR)
+                        return true;
+
+        return false;
+}
+
+static void manager_refresh_generated_units(Manager *m) {
+        Iterator i;
+        const char *k;
+        Unit *u;
+
+        assert(m);
+
+        /* The generators rewrote their output with the same contents, bring the timestamps of the units loaded from
+         * there up to date, so that they are not reported as needing a reload. */
+
+        HASHMAP_FOREACH_KEY(u, k, m->units, i) {
+                struct stat st;
+                char **p;
+
+                if (u->id != k)
+                        continue;
+
+                if (manager_path_is_generated(m, u->fragment_path)) {
+                        if (stat(u->fragment_path, &st) >= 0)
+                                u->fragment_mtime = timespec_load(&st.st_mtim);
+
+                        if (u->source_path && stat(u->source_path, &st) >= 0)
+                                u->source_mtime = timespec_load(&st.st_mtim);
+                }
+
+                STRV_FOREACH(p, u->dropin_paths)
+                        if (manager_path_is_generated(m, *p)) {
+                                u->dropin_mtime = now(CLOCK_REALTIME);
+                                break;
+                        }
+        }
+}
+
+static int manager_add_config_source(Manager *m, ConfigSource *s) {
+        ConfigSource *old;
+        int r;
+
+        assert(m);
+        assert(s);
+
+        r = hashmap_ensure_allocated(&m->config_sources, &path_hash_ops);
+        if (r < 0)
+                return r;
+
+        old = hashmap_remove(m->config_sources, s->path);
+        if (old != s)
+                config_source_free(old);
+
+        return hashmap_put(m->config_sources, s->path, s);
+}
+
+static void manager_prefetch_config_sources(Manager *m) {
+        _cleanup_strv_free_ char **paths = NULL;
+        _cleanup_free_ ConfigSource **sources = NULL, **old = NULL;
+        size_t i, n;
+        Iterator it;
+        char *p;
+        int r;
+
+        assert(m);
+
+        /* Reads all unit files and drop-ins we know of on a couple of threads, so that loading units later only has
+         * to parse the lines, and doesn't need to wait for the disk one file at a time. Files that didn't change
+         * since they were read last are not read again. */
+
+        if (!m->unit_path_cache)
+                return;
+
+        SET_FOREACH(p, m->unit_path_cache, it) {
+                if (unit_name_is_valid(basename(p), UNIT_NAME_ANY)) {
+                        r = strv_extend(&paths, p);
+                        if (r < 0)
+                                goto fail;
+
+                } else if (endswith(p, ".d")) {
+                        _cleanup_closedir_ DIR *d = NULL;
+                        struct dirent *de;
+
+                        d = opendir(p);
+                        if (!d)
+                                continue;
+
+                        FOREACH_DIRENT(de, d, break) {
+                                char *q;
+
+                                if (!endswith(de->d_name, ".conf"))
+                                        continue;
+
+                                q = path_join(NULL, p, de->d_name);
+                                if (!q) {
+                                        r = -ENOMEM;
+                                        goto fail;
+                                }
+
+                                r = strv_consume(&paths, q);
+                                if (r < 0)
+                                        goto fail;
+                        }
+                }
+        }
+
+        n = strv_length(paths);
+        sources = new(ConfigSource*, n);
+        old = new(ConfigSource*, n);
+        if (!sources || !old) {
+                r = -ENOMEM;
+                goto fail;
+        }
+
+        for (i = 0; i < n; i++)
+                sources[i] = old[i] = hashmap_get(m->config_sources, paths[i]);
+
+        r = config_source_read_many(paths, 0, sources);
+        if (r < 0)
+                goto fail;
+
+        for (i = 0; i < n; i++) {
+                if (sources[i] == old[i])
+                        continue;
+
+                if (!sources[i]) {
+                        config_source_free(hashmap_remove(m->config_sources, paths[i]));
+                        continue;
+                }
+
+                r = manager_add_config_source(m, sources[i]);
+                if (r < 0) {
+                        for (; i < n; i++)
+                                if (sources[i] != old[i])
+                                        config_source_free(sources[i]);
+                        goto fail;
+                }
+        }
+
+        log_debug("Read ahead %zu unit files and drop-ins.", n);
+        return;
+
+fail:
+        log_warning_errno(r, "Failed to read unit files ahead, proceeding without: %m");
+}
+
+static void manager_trim_config_sources(Manager *m) {
+        ConfigSource *s;
+        Iterator i;
+
+        assert(m);
+
+        /* Forget about everything that was read ahead but not used while loading units. What was used is kept, and
+         * is checked for modifications on the next reload. */
+
+        HASHMAP_FOREACH(s, m->config_sources, i) {
+                if (!s->used) {
+                        assert_se(hashmap_remove(m->config_sources, s->path) == s);
+                        config_source_free(s);
+                        continue;
+                }
+
+                s->used = false;
+        }
+}
+
+int manager_get_config_source(Manager *m, const char *path, FILE *f, ConfigParseFlags flags, ConfigSource **ret) {
+        _cleanup_(config_source_freep) ConfigSource *s = NULL;
+        _cleanup_fclose_ FILE *ours = NULL;
+        ConfigSource *cached;
+        struct stat st;
+        int r;
+
+        assert(m);
+        assert(path);
+        assert(ret);
+
+        /* Returns the lines of the specified file, as read ahead, or as read now if the file changed since or we
+         * didn't know about it. */
+
+        if (f)
+                r = fstat(fileno(f), &st);
+        else
+                r = stat(path, &st);
+        if (r < 0)
+                return -errno;
+
+        cached = hashmap_get(m->config_sources, path);
+        if (cached && config_source_is_current(cached, &st, flags)) {
+                cached->used = true;
+                *ret = cached;
+                return 0;
+        }
+
+        if (!f) {
+                f = ours = fopen(path, "re");
+                if (!f)
+                        return -errno;
+        }
+
+        r = config_source_read(path, f, flags, &s);
+        if (r < 0)
+                return r;
+
+        r = manager_add_config_source(m, s);
+        if (r < 0)
+                return r;
+
+        s->used = true;
+        *ret = TAKE_PTR(s);
+        return 0;
+}
+
 static void manager_distribute_fds(Manager *m, FDSet *fds) {
         Iterator i;
         Unit *u;
@@ -1588,6 +2004,13 @@ int manager_startup(Manager *m, FILE *serialization, FDSet *fds) {
 
         assert(m);
 
+        /* Start the spawn helper first, while we are still small, so that it stays small, too */
+        if (m->spawn_helper_enabled && !m->spawn_helper && !m->test_run_flags) {
+                r = exec_spawn_helper_new(&m->spawn_helper);
+                if (r < 0)
+                        log_warning_errno(r, "Failed to start spawn helper, forking off processes directly: %m");
+        }
+
         /* If we are running in test mode, we still want to run the generators,
          * but we should not touch the real generator directories. */
         r = lookup_paths_init(&m->lookup_paths, m->unit_file_scope,
@@ -1609,6 +2032,8 @@ int manager_startup(Manager *m, FILE *serialization, FDSet *fds) {
         manager_preset_all(m);
         lookup_paths_reduce(&m->lookup_paths);
         manager_build_unit_path_cache(m);
+        manager_update_units_source_stamp(m);
+        manager_prefetch_config_sources(m);
 
         /* If we will deserialize make sure that during enumeration
          * this is already known, so we increase the counter here
@@ -1659,6 +2084,9 @@ int manager_startup(Manager *m, FILE *serialization, FDSet *fds) {
         (void) bus_track_coldplug(m, &m->subscribed, false, m->deserialized_subscribed);
         m->deserialized_subscribed = strv_free(m->deserialized_subscribed);
 
+        /* All units are loaded now, drop what was read ahead for nothing */
+        manager_trim_config_sources(m);
+
         /* Third, fire things up! */
         manager_coldplug(m);
 
@@ -1862,7 +2290,7 @@ static int manager_dispatch_target_deps_queue(Manager *m) {
                         Iterator i;
                         void *v;
 
-                        HASHMAP_FOREACH_KEY(v, target, u->dependencies[deps[k]], i) {
+                        UNIT_DEPENDENCY_FOREACH(v, target, u->dependencies[deps[k]], i) {
                                 r = unit_add_default_target_dependency(u, target);
                                 if (r < 0)
                                         return r;
@@ -2059,6 +2487,9 @@ void manager_dump(Manager *m, FILE *f, const char *prefix) {
                                 format_timestamp(buf, sizeof(buf), m->timestamps[q].realtime));
         }
 
+        fprintf(f, "%sCGroup attribute writes: %" PRIu64 " (skipped as unchanged: %" PRIu64 ")\n",
+                strempty(prefix), m->n_cgroup_attribute_writes, m->n_cgroup_attribute_writes_skipped);
+
         manager_dump_units(m, f, prefix);
         manager_dump_jobs(m, f, prefix);
 }
@@ -2146,8 +2577,43 @@ void manager_trigger_run_queue(Manager *m) {
                 log_warning_errno(r, "Failed to enable job run queue event source, ignoring: %m");
 }
 
+static int manager_coalesce_dbus_queue(Manager *m) {
+        usec_t n;
+        int r;
+
+        assert(m);
+
+        /* A unit usually goes through a few states in quick succession, each step triggered by an event of its own
+         * (SIGCHLD, a READY=1 notification, a cgroup becoming empty, …). Before generating bus messages for what is
+         * queued, let's hence first process the events that are already pending, so that a single signal covers
+         * all the changes they cause. Returns > 0 if an event was processed, in which case the caller should look
+         * at the queues again. To not delay the signals for too long while we are busy, we give up after a while. */
+
+        if (!m->dbus_unit_queue && !m->dbus_job_queue) {
+                m->dbus_coalesce_start = 0;
+                return 0;
+        }
+
+        /* Don't delay things while reloading, see manager_dispatch_dbus_queue() */
+        if (MANAGER_IS_RELOADING(m) || m->send_reloading_done || m->pending_reload_message)
+                return 0;
+
+        n = now(CLOCK_MONOTONIC);
+        if (m->dbus_coalesce_start == 0)
+                m->dbus_coalesce_start = n;
+        else if (n - m->dbus_coalesce_start >= MANAGER_BUS_COALESCE_USEC)
+                return 0;
+
+        r = sd_event_run(m->event, 0);
+        if (r < 0)
+                return r;
+
+        return r > 0;
+}
+
 static unsigned manager_dispatch_dbus_queue(Manager *m) {
         unsigned n = 0, budget;
+        usec_t ts;
         Unit *u;
         Job *j;
 
@@ -2186,6 +2652,8 @@ static unsigned manager_dispatch_dbus_queue(Manager *m) {
         }
 
         m->dispatching_dbus_queue = true;
+        m->dbus_coalesce_start = 0;
+        ts = now(CLOCK_MONOTONIC);
 
         while (budget != 0 && (u = m->dbus_unit_queue)) {
 
@@ -2221,6 +2689,8 @@ static unsigned manager_dispatch_dbus_queue(Manager *m) {
                 n++;
         }
 
+        m->dbus_dispatch_usec += now(CLOCK_MONOTONIC) - ts;
+
         return n;
 }
 
@@ -2475,7 +2945,9 @@ static int manager_dispatch_sigchld(sd_event_source *source, void *userdata) {
                 _cleanup_free_ char *name = NULL;
                 Unit *u1, *u2, **array;
 
-                (void) get_process_comm(si.si_pid, &name);
+                /* Reading the comm is only worth it if we are going to log it */
+                if (log_get_max_level() >= LOG_DEBUG)
+                        (void) get_process_comm(si.si_pid, &name);
 
                 log_debug("Child "PID_FMT" (%s) died (code=%s, status=%i/%s)",
                           si.si_pid, strna(name),
@@ -2488,8 +2960,15 @@ static int manager_dispatch_sigchld(sd_event_source *source, void *userdata) {
                 /* Increase the generation counter used for filtering out duplicate unit invocations */
                 m->sigchldgen++;
 
-                /* And now figure out the unit this belongs to, it might be multiple... */
-                u1 = manager_get_unit_by_pid_cgroup(m, si.si_pid);
+                /* And now figure out the unit this belongs to, it might be multiple... On the fully unified
+                 * hierarchy we get reliable notifications when a cgroup runs empty, hence only the units
+                 * that watch the PID explicitly, i.e. for which it is a main or control process, care
+                 * about its death. On legacy and hybrid hierarchies the cgroup of any process that dies is of
+                 * interest, as SIGCHLD is what we use there to find out that a cgroup might be empty now.
+                 * This saves reading /proc/$PID/cgroup for each of the many reparented processes that
+                 * fork-heavy services leave behind for us to reap. */
+                u1 = cg_all_unified() > 0 ? NULL :
+                        manager_get_unit_by_pid_cgroup(m, si.si_pid);
                 u2 = hashmap_get(m->watch_pids, PID_TO_PTR(si.si_pid));
                 array = hashmap_get(m->watch_pids, PID_TO_PTR(-si.si_pid));
                 if (array) {
@@ -2848,6 +3327,7 @@ static int manager_dispatch_jobs_in_progress(sd_event_source *source, usec_t use
 }
 
 int manager_loop(Manager *m) {
+        bool coalescing = false;
         int r;
 
         RATELIMIT_DEFINE(rl, 1*USEC_PER_SEC, 50000);
@@ -2868,15 +3348,21 @@ int manager_loop(Manager *m) {
         while (m->exit_code == MANAGER_OK) {
                 usec_t wait_usec;
 
-                if (m->runtime_watchdog > 0 && m->runtime_watchdog != USEC_INFINITY && MANAGER_IS_SYSTEM(m))
-                        watchdog_ping();
+                /* The events processed while holding back the D-Bus queues belong to the iteration that started
+                 * coalescing, and that one is bounded in time already. Hence don't count them again. */
+                if (!coalescing) {
+                        if (m->runtime_watchdog > 0 && m->runtime_watchdog != USEC_INFINITY && MANAGER_IS_SYSTEM(m))
+                                watchdog_ping();
 
-                if (!ratelimit_below(&rl)) {
-                        /* Yay, something is going seriously wrong, pause a little */
-                        log_warning("Looping too fast. Throttling execution a little.");
-                        sleep(1);
+                        if (!ratelimit_below(&rl)) {
+                                /* Yay, something is going seriously wrong, pause a little */
+                                log_warning("Looping too fast. Throttling execution a little.");
+                                sleep(1);
+                        }
                 }
 
+                coalescing = false;
+
                 if (manager_dispatch_load_queue(m) > 0)
                         continue;
 
@@ -2895,6 +3381,14 @@ int manager_loop(Manager *m) {
                 if (manager_dispatch_stop_when_unneeded_queue(m) > 0)
                         continue;
 
+                r = manager_coalesce_dbus_queue(m);
+                if (r < 0)
+                        return log_error_errno(r, "Failed to run event loop: %m");
+                if (r > 0) {
+                        coalescing = true;
+                        continue;
+                }
+
                 if (manager_dispatch_dbus_queue(m) > 0)
                         continue;
 
@@ -3215,26 +3709,32 @@ int manager_serialize(Manager *m, FILE *f, FDSet *fds, bool switching_root) {
 }
 
 int manager_deserialize(Manager *m, FILE *f, FDSet *fds) {
+        _cleanup_(serialization_reader_freep) SerializationReader *reader = NULL;
         int r = 0;
 
         assert(m);
         assert(f);
 
-        log_debug("Deserializing state...");
+        r = serialization_reader_open(f, &reader);
+        if (r < 0)
+                return log_error_errno(r, "Failed to open serialization: %m");
+
+        log_debug("Deserializing state (%s)...", serialization_format_to_string(serialization_reader_format(reader)));
 
         manager_reloading_start(m);
 
         for (;;) {
-                _cleanup_free_ char *line = NULL;
-                const char *val, *l;
+                const char *val;
+                char *l;
 
-                r = read_line(f, LONG_LINE_MAX, &line);
-                if (r < 0)
-                        return log_error_errno(r, "Failed to read serialization line: %m");
+                r = serialization_read_line(reader, &l);
+                if (r < 0) {
+                        log_error_errno(r, "Failed to read serialization line: %m");
+                        goto finish;
+                }
                 if (r == 0)
                         break;
 
-                l = strstrip(line);
                 if (isempty(l)) /* end marker */
                         break;
 
@@ -3402,31 +3902,30 @@ int manager_deserialize(Manager *m, FILE *f, FDSet *fds) {
         }
 
         for (;;) {
-                _cleanup_free_ char *line = NULL;
-                const char* unit_name;
+                char *unit_name;
                 Unit *u;
 
                 /* Start marker */
-                r = read_line(f, LONG_LINE_MAX, &line);
-                if (r < 0)
-                        return log_error_errno(r, "Failed to read serialization line: %m");
+                r = serialization_read_line(reader, &unit_name);
+                if (r < 0) {
+                        log_error_errno(r, "Failed to read serialization line: %m");
+                        goto finish;
+                }
                 if (r == 0)
                         break;
 
-                unit_name = strstrip(line);
-
                 r = manager_load_unit(m, unit_name, NULL, NULL, &u);
                 if (r < 0) {
                         log_notice_errno(r, "Failed to load unit \"%s\", skipping deserialization: %m", unit_name);
 
-                        r = unit_deserialize_skip(f);
+                        r = unit_deserialize_skip(reader);
                         if (r < 0)
-                                return r;
+                                goto finish;
 
                         continue;
                 }
 
-                r = unit_deserialize(u, f, fds);
+                r = unit_deserialize(u, reader, fds);
                 if (r < 0) {
                         log_notice_errno(r, "Failed to deserialize unit \"%s\": %m", unit_name);
                         if (r == -ENOMEM)
@@ -3444,6 +3943,32 @@ finish:
         return r;
 }
 
+static int manager_serialize_binary(Manager *m, FILE *f, FDSet *fds) {
+        _cleanup_fclose_ FILE *b = NULL;
+        int r;
+
+        assert(m);
+        assert(f);
+
+        /* On reload the state is read back by the very same binary, hence the binary format can always be used.
+         * Reexecution sticks to the text format, as the binary we execute might not know the binary format yet. */
+
+        r = serialization_binary_writer_open(f, &b);
+        if (r < 0)
+                return r;
+
+        r = manager_serialize(m, b, fds, false);
+        if (r < 0)
+                return r;
+
+        r = fclose(b);
+        b = NULL;
+        if (r < 0)
+                return -errno;
+
+        return fflush_and_check(f);
+}
+
 static void manager_flush_finished_jobs(Manager *m) {
         Job *j;
 
@@ -3459,9 +3984,23 @@ int manager_reload(Manager *m) {
         int r, q;
         _cleanup_fclose_ FILE *f = NULL;
         _cleanup_fdset_free_ FDSet *fds = NULL;
+        uint64_t old_stamp;
+        Iterator i;
+        bool full;
+        Unit *u;
 
         assert(m);
 
+        full = m->reload_full;
+        m->reload_full = false;
+
+        /* SpawnHelper= may have been turned off. Turning it on only takes effect on the next re-execution, as the
+         * helper is only small if started before the units are loaded. */
+        if (!m->spawn_helper_enabled && m->spawn_helper) {
+                log_debug("Spawn helper disabled, forking for all processes from now on.");
+                m->spawn_helper = spawn_helper_free(m->spawn_helper);
+        }
+
         r = manager_open_serialization(m, &f);
         if (r < 0)
                 return r;
@@ -3469,16 +4008,54 @@ int manager_reload(Manager *m) {
         manager_reloading_start(m);
         bus_manager_send_reloading(m, true);
 
+        /* Rerun the generators first, so that we know whether anything changed before throwing away all units */
+        lookup_paths_flush_generator(&m->lookup_paths);
+        lookup_paths_free(&m->lookup_paths);
+
+        q = lookup_paths_init(&m->lookup_paths, m->unit_file_scope, 0, NULL);
+        if (q < 0 && r >= 0)
+                r = q;
+
+        q = manager_run_environment_generators(m);
+        if (q < 0 && r >= 0)
+                r = q;
+
+        /* Find new unit paths */
+        q = manager_run_generators(m);
+        if (q < 0 && r >= 0)
+                r = q;
+
+        lookup_paths_reduce(&m->lookup_paths);
+        manager_build_unit_path_cache(m);
+
+        old_stamp = m->units_source_stamp;
+        manager_update_units_source_stamp(m);
+
+        if (!full && r >= 0 && old_stamp != 0 && old_stamp == m->units_source_stamp && !manager_has_units_in_error(m)) {
+                log_debug("No unit files, drop-ins or generator output changed, keeping loaded units.");
+
+                manager_refresh_generated_units(m);
+
+                /* Like units loaded anew, write all cgroup attributes again the next time a unit is realized */
+                HASHMAP_FOREACH(u, m->units, i)
+                        unit_invalidate_cgroup_attributes(u);
+
+                assert(m->n_reloading > 0);
+                m->n_reloading--;
+
+                goto finish;
+        }
+
         fds = fdset_new();
         if (!fds) {
                 m->n_reloading--;
                 return -ENOMEM;
         }
 
-        r = manager_serialize(m, f, fds, false);
-        if (r < 0) {
+        q = manager_serialize_binary(m, f, fds);
+        if (q < 0) {
                 m->n_reloading--;
-                return r;
+                return q;
         }
 
         if (fseeko(f, 0, SEEK_SET) < 0) {
@@ -3488,28 +4065,12 @@ int manager_reload(Manager *m) {
 
         /* From here on there is no way back. */
         manager_clear_jobs_and_units(m);
-        lookup_paths_flush_generator(&m->lookup_paths);
-        lookup_paths_free(&m->lookup_paths);
         exec_runtime_vacuum(m);
         dynamic_user_vacuum(m, false);
         m->uid_refs = hashmap_free(m->uid_refs);
         m->gid_refs = hashmap_free(m->gid_refs);
 
-        q = lookup_paths_init(&m->lookup_paths, m->unit_file_scope, 0, NULL);
-        if (q < 0 && r >= 0)
-                r = q;
-
-        q = manager_run_environment_generators(m);
-        if (q < 0 && r >= 0)
-                r = q;
-
-        /* Find new unit paths */
-        q = manager_run_generators(m);
-        if (q < 0 && r >= 0)
-                r = q;
-
-        lookup_paths_reduce(&m->lookup_paths);
-        manager_build_unit_path_cache(m);
+        manager_prefetch_config_sources(m);
 
         /* First, enumerate what we can from kernel and suchlike */
         manager_enumerate_perpetual(m);
@@ -3539,6 +4100,9 @@ int manager_reload(Manager *m) {
         if (q < 0 && r >= 0)
                 r = q;
 
+        /* All units are loaded now, drop what was read ahead for nothing */
+        manager_trim_config_sources(m);
+
         /* Third, fire things up! */
         manager_coldplug(m);
 
@@ -3551,9 +4115,13 @@ int manager_reload(Manager *m) {
 
         exec_runtime_vacuum(m);
 
+        /* Most hashmaps were freed and allocated anew above, hand back the pools that are now unused */
+        log_debug("Released %zu bytes of unused hashmap pools.", hashmap_trim_pools());
+
         assert(m->n_reloading > 0);
         m->n_reloading--;
 
+finish:
         /* It might be safe to log to the journal now and connect to dbus */
         manager_recheck_journal(m);
         manager_recheck_dbus(m);
@@ -3834,9 +4402,189 @@ static int manager_run_environment_generators(Manager *m) {
         return execute_directories(paths, DEFAULT_TIMEOUT_USEC, gather_environment, args, NULL);
 }
 
+static void generator_timings_free(GeneratorTiming *t, size_t n) {
+        size_t i;
+
+        if (!t)
+                return;
+
+        for (i = 0; i < n; i++)
+                free(t[i].path);
+
+        free(t);
+}
+
+static int generator_read_inputs(const char *dir, char ***ret) {
+        _cleanup_strv_free_ char **inputs = NULL;
+        _cleanup_free_ char *contents = NULL;
+        int r;
+
+        /* Reads the paths the generator declared as its inputs on its last run. Fails with -ENOENT if it didn't
+         * declare any. */
+
+        r = read_full_file(strjoina(dir, "/inputs"), &contents, NULL);
+        if (r < 0)
+                return r;
+
+        inputs = strv_split_newlines(contents);
+        if (!inputs)
+                return -ENOMEM;
+
+        strv_sort(inputs);
+        strv_uniq(inputs);
+
+        *ret = TAKE_PTR(inputs);
+        return 0;
+}
+
+static int generator_inputs_stamp(const char *binary, char **inputs, char **ret) {
+        static const uint8_t key[16] = {
+                0x71, 0x0c, 0xd4, 0x5b, 0x98, 0x2e, 0x43, 0xf6,
+                0xa3, 0x17, 0x6e, 0xc9, 0x04, 0xb8, 0x5d, 0x3f,
+        };
+        struct siphash state;
+        struct stat st;
+        char **i;
+        int r;
+
+        /* Hashes the current state of the inputs, together with the generator binary itself */
+
+        siphash24_init(&state, key);
+
+        if (stat(binary, &st) < 0)
+                return -errno;
+        hash_stat(&st, &state);
+
+        STRV_FOREACH(i, inputs) {
+                if (!path_is_absolute(*i))
+                        continue;
+
+                siphash24_compress(*i, strlen(*i) + 1, &state);
+
+                if (stat(*i, &st) < 0) {
+                        r = -errno;
+                        siphash24_compress(&r, sizeof(r), &state);
+                        continue;
+                }
+
+                /* Virtual files have no meaningful timestamps, compare their contents */
+                if (S_ISREG(st.st_mode) && (path_startswith(*i, "/proc") || path_startswith(*i, "/sys"))) {
+                        _cleanup_free_ char *c = NULL;
+                        size_t size;
+
+                        r = read_full_virtual_file(*i, &c, &size);
+                        if (r < 0)
+                                siphash24_compress(&r, sizeof(r), &state);
+                        else
+                                siphash24_compress(c, size, &state);
+                } else
+                        hash_stat(&st, &state);
+        }
+
+        if (asprintf(ret, "%016" PRIx64, siphash24_finalize(&state)) < 0)
+                return -ENOMEM;
+
+        return 0;
+}
+
+static bool generator_is_current(const char *binary, const char *dir, char ***ret_inputs, char **ret_stamp) {
+        _cleanup_strv_free_ char **inputs = NULL;
+        _cleanup_free_ char *old = NULL, *new = NULL;
+
+        /* Checks whether the inputs the generator declared on its last run are unchanged. If not, returns them
+         * together with their current state, which is recorded once the generator ran again, see
+         * generator_update_stamp(). */
+
+        *ret_inputs = NULL;
+        *ret_stamp = NULL;
+
+        if (generator_read_inputs(dir, &inputs) < 0)
+                return false;
+
+        if (generator_inputs_stamp(binary, inputs, &new) < 0)
+                return false;
+
+        if (read_one_line_file(strjoina(dir, "/stamp"), &old) >= 0 && streq(old, new))
+                return true;
+
+        *ret_inputs = TAKE_PTR(inputs);
+        *ret_stamp = TAKE_PTR(new);
+        return false;
+}
+
+static void generator_update_stamp(const char *binary, const char *dir, char **old_inputs, const char *stamp) {
+        _cleanup_strv_free_ char **inputs = NULL;
+        const char *fn;
+        int r;
+
+        /* The stamp has to describe the inputs as they were before the generator ran, so that changes made while it
+         * was running are noticed the next time. Hence it can only be recorded if the generator declared the same
+         * inputs as on its previous run, whose state was taken before running it. Otherwise the output is cached
+         * only after the next run. */
+
+        fn = strjoina(dir, "/stamp");
+
+        r = generator_read_inputs(dir, &inputs);
+        if (r < 0) {
+                if (r != -ENOENT)
+                        log_debug_errno(r, "Failed to determine inputs of %s, not caching its output: %m", binary);
+
+                (void) unlink(fn);
+                return;
+        }
+
+        if (!stamp || !strv_equal(inputs, old_inputs)) {
+                log_debug("Inputs of %s changed, not caching its output yet.", binary);
+                (void) unlink(fn);
+                return;
+        }
+
+        r = write_string_file(fn, stamp, WRITE_STRING_FILE_CREATE|WRITE_STRING_FILE_ATOMIC);
+        if (r < 0)
+                log_debug_errno(r, "Failed to write %s, not caching output of %s: %m", fn, binary);
+}
+
+static void generator_cache_vacuum(const char *cache, char **binaries) {
+        _cleanup_closedir_ DIR *d = NULL;
+        struct dirent *de;
+        char **b;
+
+        /* Remove the output of generators that are gone */
+
+        d = opendir(cache);
+        if (!d)
+                return;
+
+        FOREACH_DIRENT(de, d, return) {
+                bool found = false;
+
+                STRV_FOREACH(b, binaries)
+                        if (streq(basename(*b), de->d_name)) {
+                                found = true;
+                                break;
+                        }
+
+                if (!found) {
+                        _cleanup_free_ char *p = NULL;
+
+                        p = path_join(NULL, cache, de->d_name);
+                        if (!p)
+                                return;
+
+                        (void) rm_rf(p, REMOVE_ROOT|REMOVE_PHYSICAL);
+                }
+        }
+}
+
 static int manager_run_generators(Manager *m) {
-        _cleanup_strv_free_ char **paths = NULL;
-        const char *argv[5];
+        _cleanup_strv_free_ char **paths = NULL, **binaries = NULL, **run = NULL;
+        _cleanup_free_ char *cache = NULL, *parent = NULL, *inputs_env = NULL;
+        _cleanup_free_ char ***argvs = NULL, ***envps = NULL;
+        _cleanup_free_ usec_t *durations = NULL;
+        _cleanup_free_ size_t *run_index = NULL;
+        _cleanup_free_ char ***old_inputs = NULL, **stamps = NULL;
+        GeneratorTiming *timings = NULL;
+        size_t i, n = 0, n_run = 0;
         int r;
 
         assert(m);
@@ -3855,17 +4603,143 @@ static int manager_run_generators(Manager *m) {
         if (r < 0)
                 goto finish;
 
-        argv[0] = NULL; /* Leave this empty, execute_directory() will fill something in */
-        argv[1] = m->lookup_paths.generator;
-        argv[2] = m->lookup_paths.generator_early;
-        argv[3] = m->lookup_paths.generator_late;
-        argv[4] = NULL;
+        r = conf_files_list_strv(&binaries, NULL, NULL, CONF_FILES_EXECUTABLE|CONF_FILES_REGULAR|CONF_FILES_FILTER_MASKED, (const char* const*) paths);
+        if (r < 0)
+                goto finish;
+
+        /* Each generator writes to its own set of directories next to the generator directories, where its output
+         * is kept for later runs. If a generator declared its inputs, and none of them changed since, it is not run
+         * again, but its earlier output is used. The outputs of all generators are then merged, in order. */
+
+        parent = dirname_malloc(m->lookup_paths.generator);
+        if (!parent) {
+                r = -ENOMEM;
+                goto finish;
+        }
+
+        cache = path_join(NULL, parent, "generator.cache");
+        if (!cache) {
+                r = -ENOMEM;
+                goto finish;
+        }
+
+        n = strv_length(binaries);
+
+        timings = new0(GeneratorTiming, n);
+        argvs = new0(char**, n + 1);
+        envps = new0(char**, n + 1);
+        durations = new(usec_t, n);
+        run_index = new(size_t, n);
+        old_inputs = new0(char**, n);
+        stamps = new0(char*, n);
+        if (!timings || !argvs || !envps || !durations || !run_index || !old_inputs || !stamps) {
+                r = -ENOMEM;
+                goto finish;
+        }
+
+        for (i = 0; i < n; i++) {
+                _cleanup_free_ char *dir = NULL;
+                const char *normal, *early, *late;
+
+                timings[i].path = strdup(binaries[i]);
+                if (!timings[i].path) {
+                        r = -ENOMEM;
+                        goto finish;
+                }
+                timings[i].duration = USEC_INFINITY;
+
+                dir = path_join(NULL, cache, basename(binaries[i]));
+                if (!dir) {
+                        r = -ENOMEM;
+                        goto finish;
+                }
+
+                if (generator_is_current(binaries[i], dir, old_inputs + i, stamps + i)) {
+                        log_debug("Inputs of %s didn't change, reusing its output.", binaries[i]);
+                        timings[i].cached = true;
+                        continue;
+                }
+
+                (void) rm_rf(dir, REMOVE_ROOT|REMOVE_PHYSICAL);
+
+                normal = strjoina(dir, "/normal");
+                early = strjoina(dir, "/early");
+                late = strjoina(dir, "/late");
+
+                r = mkdir_p_label(normal, 0755);
+                if (r >= 0)
+                        r = mkdir_p_label(early, 0755);
+                if (r >= 0)
+                        r = mkdir_p_label(late, 0755);
+                if (r < 0) {
+                        log_warning_errno(r, "Failed to create output directories for %s, skipping: %m", binaries[i]);
+                        continue;
+                }
+
+                inputs_env = strjoin("SYSTEMD_GENERATOR_INPUTS=", dir, "/inputs");
+                if (!inputs_env) {
+                        r = -ENOMEM;
+                        goto finish;
+                }
+
+                /* argv[0] is filled in when the binary is executed */
+                argvs[n_run] = strv_new("", normal, early, late, NULL);
+                envps[n_run] = strv_env_set(environ, inputs_env);
+                inputs_env = mfree(inputs_env);
+                if (!argvs[n_run] || !envps[n_run] || strv_extend(&run, binaries[i]) < 0) {
+                        strv_free(argvs[n_run]);
+                        strv_free(envps[n_run]);
+                        argvs[n_run] = envps[n_run] = NULL;
+                        r = -ENOMEM;
+                        goto finish;
+                }
+
+                run_index[n_run++] = i;
+        }
 
         RUN_WITH_UMASK(0022)
-                execute_directories((const char* const*) paths, DEFAULT_TIMEOUT_USEC,
-                                    NULL, NULL, (char**) argv);
+                (void) execute_binaries("generators", run, argvs, envps, DEFAULT_TIMEOUT_USEC, durations);
+
+        for (i = 0; i < n_run; i++) {
+                size_t k = run_index[i];
+
+                timings[k].duration = durations[i];
+
+                generator_update_stamp(binaries[k], strjoina(cache, "/", basename(binaries[k])), old_inputs[k], stamps[k]);
+        }
+
+        for (i = 0; i < n; i++) {
+                const char *dir;
+                int q;
+
+                dir = strjoina(cache, "/", basename(binaries[i]));
+
+                q = copy_tree(strjoina(dir, "/normal"), m->lookup_paths.generator, UID_INVALID, GID_INVALID, COPY_MERGE);
+                if (q >= 0)
+                        q = copy_tree(strjoina(dir, "/early"), m->lookup_paths.generator_early, UID_INVALID, GID_INVALID, COPY_MERGE);
+                if (q >= 0)
+                        q = copy_tree(strjoina(dir, "/late"), m->lookup_paths.generator_late, UID_INVALID, GID_INVALID, COPY_MERGE);
+                if (q < 0 && q != -ENOENT)
+                        log_warning_errno(q, "Failed to install output of %s, ignoring: %m", binaries[i]);
+        }
+
+        generator_cache_vacuum(cache, binaries);
+
+        generator_timings_free(m->generator_timings, m->n_generator_timings);
+        m->generator_timings = TAKE_PTR(timings);
+        m->n_generator_timings = n;
+        r = 0;
 
 finish:
+        for (i = 0; argvs && argvs[i]; i++) {
+                strv_free(argvs[i]);
+                strv_free(envps[i]);
+        }
+        for (i = 0; old_inputs && i < n; i++) {
+                strv_free(old_inputs[i]);
+                free(stamps[i]);
+        }
+        generator_timings_free(timings, n);
         lookup_paths_trim_generator(&m->lookup_paths);
         return r;
 }
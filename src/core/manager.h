@@ -8,6 +8,7 @@
 #include "sd-event.h"
 
 #include "cgroup-util.h"
+#include "conf-parser.h"
 #include "fdset.h"
 #include "hashmap.h"
 #include "ip-address-access.h"
@@ -74,10 +75,18 @@ typedef enum ManagerTimestamp {
 
 #include "execute.h"
 #include "job.h"
+#include "mount-table.h"
 #include "path-lookup.h"
 #include "show-status.h"
+#include "spawn-helper.h"
 #include "unit-name.h"
 
+typedef struct GeneratorTiming {
+        char *path;
+        usec_t duration;   /* USEC_INFINITY if it didn't finish */
+        bool cached;       /* not run, the output of an earlier run was reused */
+} GeneratorTiming;
+
 enum {
         /* 0 = run normally */
         MANAGER_TEST_RUN_MINIMAL        = 1 << 1,  /* create basic data structures */
@@ -175,12 +184,25 @@ struct Manager {
         int user_lookup_fds[2];
         sd_event_source *user_lookup_event_source;
 
+        /* Clones processes for exec_spawn() off a small process, instead of forking the manager, see spawn-helper.h */
+        SpawnHelper *spawn_helper;
+        bool spawn_helper_enabled;
+
         sd_event_source *sync_bus_names_event_source;
 
         UnitFileScope unit_file_scope;
         LookupPaths lookup_paths;
         Set *unit_path_cache;
 
+        /* Unit files and drop-ins, read ahead of loading units, and kept across reloads while they don't change.
+         * Indexed by path. */
+        Hashmap *config_sources;
+
+        /* Hash over the unit sources that were in place when units were loaded last, see manager_reload() */
+        uint64_t units_source_stamp;
+        /* Whether the next reload shall load all units anew, even if the hash above didn't change */
+        bool reload_full;
+
         char **environment;
 
         usec_t runtime_watchdog;
@@ -188,6 +210,10 @@ struct Manager {
 
         dual_timestamp timestamps[_MANAGER_TIMESTAMP_MAX];
 
+        /* The generators applied during the last run, in order */
+        GeneratorTiming *generator_timings;
+        size_t n_generator_timings;
+
         struct udev* udev;
 
         /* Data specific to the device subsystem */
@@ -198,6 +224,7 @@ struct Manager {
         /* Data specific to the mount subsystem */
         struct libmnt_monitor *mount_monitor;
         sd_event_source *mount_event_source;
+        MountTable *mount_table;
 
         /* Data specific to the swap filesystem */
         FILE *proc_swaps;
@@ -317,6 +344,18 @@ struct Manager {
         unsigned n_installed_jobs;
         unsigned n_failed_jobs;
 
+        /* Statistics about the signals generated for unit and job changes */
+        uint64_t n_dbus_signals;          /* each message counted once per bus it is sent on */
+        uint64_t n_dbus_changes_coalesced; /* changes covered by a signal that was queued already */
+        usec_t dbus_dispatch_usec;        /* time spent in manager_dispatch_dbus_queue() */
+
+        /* When we started to hold back the D-Bus queues to coalesce changes, or 0 */
+        usec_t dbus_coalesce_start;
+
+        /* Statistics about writes to cgroup attributes */
+        uint64_t n_cgroup_attribute_writes;
+        uint64_t n_cgroup_attribute_writes_skipped; /* value unchanged since we last wrote it */
+
         /* Jobs in progress watching */
         unsigned n_running_jobs;
         unsigned n_on_console;
@@ -416,6 +455,8 @@ void manager_unwatch_pid(Manager *m, pid_t pid);
 
 unsigned manager_dispatch_load_queue(Manager *m);
 
+int manager_get_config_source(Manager *m, const char *path, FILE *f, ConfigParseFlags flags, ConfigSource **ret);
+
 int manager_environment_add(Manager *m, char **minus, char **plus);
 int manager_set_default_rlimits(Manager *m, struct rlimit **default_rlimit);
 
@@ -0,0 +1,637 @@
+/* SPDX-License-Identifier: LGPL-2.1+ */
+
+#include <errno.h>
+#include <stdio.h>
+
+#include <libmount.h>
+
+#include "alloc-util.h"
+#include "escape.h"
+#include "extract-word.h"
+#include "fd-util.h"
+#include "fileio.h"
+#include "hashmap.h"
+#include "list.h"
+#include "mount-table.h"
+#include "parse-util.h"
+#include "string-util.h"
+
+#define MOUNTINFO_PATH "/proc/self/mountinfo"
+#define UTAB_PATH "/run/mount/utab"
+
+DEFINE_TRIVIAL_CLEANUP_FUNC(struct libmnt_table*, mnt_free_table);
+DEFINE_TRIVIAL_CLEANUP_FUNC(struct libmnt_iter*, mnt_free_iter);
+
+/* The few fields of a utab line we need. libmount only parses utab as part of reading the whole mount table, hence
+ * we do it ourselves. */
+typedef struct UtabEntry {
+        int id;
+        char *root;
+        char *target;
+        char *options;
+} UtabEntry;
+
+struct MountTable {
+        Hashmap *entries;                 /* mount ID → MountTableEntry */
+
+        Hashmap *by_where;                /* mount point → list of MountTableEntry mounted there */
+        Hashmap *whats;                   /* source → number of entries */
+
+        /* The utab the entries were merged with */
+        char *utab;
+        UtabEntry *utab_entries;
+        size_t n_utab_entries;
+
+        unsigned generation;
+        bool populated;
+};
+
+typedef struct PendingLine {
+        uint64_t id;
+        unsigned position;
+        const char *line;
+        size_t length;
+} PendingLine;
+
+static MountTableEntry* mount_table_entry_free(MountTableEntry *e) {
+        if (!e)
+                return NULL;
+
+        free(e->line);
+        free(e->what);
+        free(e->where);
+        free(e->options);
+        free(e->fstype);
+
+        return mfree(e);
+}
+
+DEFINE_TRIVIAL_CLEANUP_FUNC(MountTableEntry*, mount_table_entry_free);
+
+void mount_table_changes_done(MountTableChanges *c) {
+        assert(c);
+
+        c->wheres = set_free_free(c->wheres);
+        c->found = set_free_free(c->found);
+        c->lost = set_free_free(c->lost);
+}
+
+static void utab_entry_done(UtabEntry *e) {
+        e->root = mfree(e->root);
+        e->target = mfree(e->target);
+        e->options = mfree(e->options);
+}
+
+static void utab_entries_free(UtabEntry *entries, size_t n) {
+        size_t k;
+
+        for (k = 0; k < n; k++)
+                utab_entry_done(entries + k);
+
+        free(entries);
+}
+
+static int utab_parse_line(const char *line, UtabEntry *ret) {
+        _cleanup_(utab_entry_done) UtabEntry e = { .id = -1 };
+        const char *p = line;
+        int r;
+
+        for (;;) {
+                _cleanup_free_ char *word = NULL;
+                char **field;
+                const char *v;
+
+                r = extract_first_word(&p, &word, NULL, 0);
+                if (r < 0)
+                        return r;
+                if (r == 0)
+                        break;
+
+                if ((v = startswith(word, "ID="))) {
+                        (void) safe_atoi(v, &e.id);
+                        continue;
+                } else if ((v = startswith(word, "ROOT=")))
+                        field = &e.root;
+                else if ((v = startswith(word, "TARGET=")))
+                        field = &e.target;
+                else if ((v = startswith(word, "OPTS=")))
+                        field = &e.options;
+                else
+                        continue;
+
+                free(*field);
+                r = cunescape(v, UNESCAPE_RELAX, field);
+                if (r < 0)
+                        return r;
+        }
+
+        /* Entries without userspace options are of no interest */
+        if (!e.options)
+                return 0;
+
+        *ret = e;
+        e = (UtabEntry) {};
+        return 1;
+}
+
+static int utab_parse(const char *utab, UtabEntry **ret, size_t *ret_n) {
+        UtabEntry *entries = NULL;
+        size_t n = 0, n_allocated = 0;
+        const char *p;
+        int r;
+
+        for (p = utab; *p; ) {
+                _cleanup_free_ char *line = NULL;
+                const char *eol;
+
+                eol = strchrnul(p, '\n');
+                line = strndup(p, eol - p);
+                p = *eol ? eol + 1 : eol;
+
+                if (!line || !GREEDY_REALLOC(entries, n_allocated, n + 1)) {
+                        r = -ENOMEM;
+                        goto fail;
+                }
+
+                r = utab_parse_line(line, entries + n);
+                if (r < 0)
+                        goto fail;
+                if (r > 0)
+                        n++;
+        }
+
+        *ret = entries;
+        *ret_n = n;
+        return 0;
+
+fail:
+        utab_entries_free(entries, n);
+        return r;
+}
+
+int mount_table_new(MountTable **ret) {
+        MountTable *t;
+
+        assert(ret);
+
+        t = new0(MountTable, 1);
+        if (!t)
+                return -ENOMEM;
+
+        *ret = t;
+        return 0;
+}
+
+void mount_table_reset(MountTable *t) {
+        assert(t);
+
+        /* Forgets everything, the next update then reports all entries as new */
+
+        t->entries = hashmap_free_with_destructor(t->entries, mount_table_entry_free);
+        t->by_where = hashmap_free(t->by_where);
+        t->whats = hashmap_free_free_key(t->whats);
+
+        t->utab = mfree(t->utab);
+        utab_entries_free(t->utab_entries, t->n_utab_entries);
+        t->utab_entries = NULL;
+        t->n_utab_entries = 0;
+
+        t->populated = false;
+}
+
+MountTable* mount_table_free(MountTable *t) {
+        if (!t)
+                return NULL;
+
+        mount_table_reset(t);
+
+        return mfree(t);
+}
+
+static int changes_add(Set **s, const char *p) {
+        int r;
+
+        if (!p)
+                return 0;
+
+        r = set_ensure_allocated(s, &path_hash_ops);
+        if (r < 0)
+                return r;
+
+        r = set_put_strdup(*s, p);
+        if (r < 0)
+                return r;
+
+        return 0;
+}
+
+static int changes_add_entry(MountTableChanges *c, MountTableEntry *e, bool found) {
+        int r;
+
+        r = changes_add(&c->wheres, e->where);
+        if (r < 0)
+                return r;
+
+        return changes_add(found ? &c->found : &c->lost, e->what);
+}
+
+static int parse_table(const char *data, size_t size, const char *filename, struct libmnt_table **ret) {
+        _cleanup_(mnt_free_tablep) struct libmnt_table *table = NULL;
+        _cleanup_fclose_ FILE *f = NULL;
+        int r;
+
+        table = mnt_new_table();
+        if (!table)
+                return -ENOMEM;
+
+        if (size > 0) {
+                f = fmemopen((void*) data, size, "re");
+                if (!f)
+                        return -errno;
+
+                r = mnt_table_parse_stream(table, f, filename);
+                if (r < 0)
+                        return r;
+        }
+
+        *ret = TAKE_PTR(table);
+        return 0;
+}
+
+static const char* utab_user_options(MountTable *t, struct libmnt_fs *fs) {
+        const char *found = NULL;
+        size_t k;
+
+        /* Like libmount when it reads /proc/self/mountinfo, match utab entries by mount ID, or if they predate
+         * recording that, by root and mount point. The last match wins. */
+
+        for (k = 0; k < t->n_utab_entries; k++) {
+                UtabEntry *u = t->utab_entries + k;
+
+                if (u->id > 0) {
+                        if (u->id == mnt_fs_get_id(fs))
+                                found = u->options;
+                } else if (streq_ptr(u->root, mnt_fs_get_root(fs)) &&
+                           streq_ptr(u->target, mnt_fs_get_target(fs)))
+                        found = u->options;
+        }
+
+        return found;
+}
+
+static int entry_new(MountTable *t, const PendingLine *l, struct libmnt_fs *fs, MountTableEntry **ret) {
+        _cleanup_(mount_table_entry_freep) MountTableEntry *e = NULL;
+        const char *source, *target, *options, *user_options;
+
+        e = new0(MountTableEntry, 1);
+        if (!e)
+                return -ENOMEM;
+
+        e->id = l->id;
+        e->line = strndup(l->line, l->length);
+        if (!e->line)
+                return -ENOMEM;
+
+        source = mnt_fs_get_source(fs);
+        target = mnt_fs_get_target(fs);
+        options = mnt_fs_get_options(fs);
+        user_options = utab_user_options(t, fs);
+
+        if (source && cunescape(source, UNESCAPE_RELAX, &e->what) < 0)
+                return -ENOMEM;
+        if (target && cunescape(target, UNESCAPE_RELAX, &e->where) < 0)
+                return -ENOMEM;
+
+        if (!isempty(user_options))
+                e->options = isempty(options) ? strdup(user_options) : strjoin(options, ",", user_options);
+        else
+                e->options = strdup(strempty(options));
+        e->fstype = strdup(strempty(mnt_fs_get_fstype(fs)));
+        if (!e->options || !e->fstype)
+                return -ENOMEM;
+
+        *ret = TAKE_PTR(e);
+        return 0;
+}
+
+static int mount_table_link(MountTable *t, MountTableEntry *e) {
+        int r;
+
+        if (e->where) {
+                MountTableEntry *head;
+
+                head = hashmap_get(t->by_where, e->where);
+                LIST_PREPEND(same_where, head, e);
+
+                r = hashmap_replace(t->by_where, e->where, head);
+                if (r < 0)
+                        return r;
+        }
+
+        if (e->what) {
+                unsigned n;
+
+                n = PTR_TO_UINT(hashmap_get(t->whats, e->what));
+                if (n == 0) {
+                        _cleanup_free_ char *what = NULL;
+
+                        what = strdup(e->what);
+                        if (!what)
+                                return -ENOMEM;
+
+                        r = hashmap_put(t->whats, what, UINT_TO_PTR(1));
+                        if (r < 0)
+                                return r;
+
+                        TAKE_PTR(what);
+                } else
+                        (void) hashmap_update(t->whats, e->what, UINT_TO_PTR(n + 1));
+        }
+
+        return 0;
+}
+
+static void mount_table_unlink(MountTable *t, MountTableEntry *e) {
+        if (e->where) {
+                MountTableEntry *head;
+
+                /* The list head's mount point doubles as key, hence replace it if that entry goes away */
+                head = hashmap_get(t->by_where, e->where);
+                LIST_REMOVE(same_where, head, e);
+
+                if (head)
+                        (void) hashmap_replace(t->by_where, head->where, head);
+                else
+                        (void) hashmap_remove(t->by_where, e->where);
+        }
+
+        if (e->what) {
+                unsigned n;
+
+                n = PTR_TO_UINT(hashmap_get(t->whats, e->what));
+                if (n <= 1) {
+                        char *what = NULL;
+
+                        (void) hashmap_remove2(t->whats, e->what, (void**) &what);
+                        free(what);
+                } else
+                        (void) hashmap_update(t->whats, e->what, UINT_TO_PTR(n - 1));
+        }
+}
+
+static int mount_table_apply(MountTable *t, const char *mountinfo, bool reparse, MountTableChanges *changes) {
+        _cleanup_(mnt_free_tablep) struct libmnt_table *parsed = NULL;
+        _cleanup_(mnt_free_iterp) struct libmnt_iter *iter = NULL;
+        _cleanup_hashmap_free_ Hashmap *pending_by_id = NULL;
+        _cleanup_free_ PendingLine *pending = NULL;
+        _cleanup_free_ char *buffer = NULL;
+        size_t n_pending = 0, n_allocated = 0, buffer_size = 0, buffer_allocated = 0, k;
+        unsigned position = 0;
+        MountTableEntry *e;
+        const char *p;
+        Iterator i;
+        int r;
+
+        r = hashmap_ensure_allocated(&t->entries, &uint64_hash_ops);
+        if (r < 0)
+                return r;
+
+        r = hashmap_ensure_allocated(&t->by_where, &path_hash_ops);
+        if (r < 0)
+                return r;
+
+        r = hashmap_ensure_allocated(&t->whats, &path_hash_ops);
+        if (r < 0)
+                return r;
+
+        t->generation++;
+
+        /* First pass: pick out the lines that differ from the ones the entries were parsed from */
+        for (p = mountinfo; *p; ) {
+                const char *eol, *space;
+                char id_string[DECIMAL_STR_MAX(uint64_t)];
+                size_t length;
+                uint64_t id;
+
+                eol = strchrnul(p, '\n');
+                length = eol - p;
+
+                space = memchr(p, ' ', length);
+                if (space && (size_t) (space - p) < sizeof(id_string)) {
+                        memcpy(id_string, p, space - p);
+                        id_string[space - p] = 0;
+
+                        if (safe_atou64(id_string, &id) >= 0) {
+                                position++;
+
+                                e = hashmap_get(t->entries, &id);
+                                if (!reparse && e && strneq(e->line, p, length) && e->line[length] == 0) {
+                                        e->generation = t->generation;
+                                        e->position = position;
+                                } else {
+                                        if (!GREEDY_REALLOC(pending, n_allocated, n_pending + 1))
+                                                return -ENOMEM;
+
+                                        pending[n_pending++] = (PendingLine) {
+                                                .id = id,
+                                                .position = position,
+                                                .line = p,
+                                                .length = length,
+                                        };
+
+                                        if (!GREEDY_REALLOC(buffer, buffer_allocated, buffer_size + length + 1))
+                                                return -ENOMEM;
+
+                                        memcpy(buffer + buffer_size, p, length);
+                                        buffer_size += length;
+                                        buffer[buffer_size++] = '\n';
+                                }
+                        }
+                }
+
+                p = *eol ? eol + 1 : eol;
+        }
+
+        /* Second pass: parse only those, in one go */
+        if (n_pending > 0) {
+                struct libmnt_fs *fs;
+
+                pending_by_id = hashmap_new(&uint64_hash_ops);
+                if (!pending_by_id)
+                        return -ENOMEM;
+
+                for (k = 0; k < n_pending; k++) {
+                        r = hashmap_put(pending_by_id, &pending[k].id, pending + k);
+                        if (r < 0 && r != -EEXIST)
+                                return r;
+                }
+
+                r = parse_table(buffer, buffer_size, MOUNTINFO_PATH, &parsed);
+                if (r < 0)
+                        return r;
+
+                iter = mnt_new_iter(MNT_ITER_FORWARD);
+                if (!iter)
+                        return -ENOMEM;
+
+                while (mnt_table_next_fs(parsed, iter, &fs) == 0) {
+                        _cleanup_(mount_table_entry_freep) MountTableEntry *n = NULL;
+                        MountTableEntry *old;
+                        PendingLine *l;
+                        uint64_t id;
+
+                        if (mnt_fs_get_id(fs) < 0)
+                                continue;
+
+                        id = (uint64_t) mnt_fs_get_id(fs);
+                        l = hashmap_get(pending_by_id, &id);
+                        if (!l)
+                                continue;
+
+                        r = entry_new(t, l, fs, &n);
+                        if (r < 0)
+                                return r;
+
+                        n->generation = t->generation;
+                        n->position = l->position;
+
+                        old = hashmap_remove(t->entries, &id);
+                        if (old) {
+                                mount_table_unlink(t, old);
+                                r = changes_add_entry(changes, old, false);
+                                mount_table_entry_free(old);
+                                if (r < 0)
+                                        return r;
+                        }
+
+                        r = changes_add_entry(changes, n, true);
+                        if (r < 0)
+                                return r;
+
+                        r = hashmap_put(t->entries, &n->id, n);
+                        if (r < 0)
+                                return r;
+
+                        r = mount_table_link(t, TAKE_PTR(n));
+                        if (r < 0)
+                                return r;
+                }
+        }
+
+        /* Entries we didn't see are gone, and so are the ones whose new line libmount didn't accept */
+        HASHMAP_FOREACH(e, t->entries, i) {
+                if (e->generation == t->generation)
+                        continue;
+
+                r = changes_add_entry(changes, e, false);
+                if (r < 0)
+                        return r;
+
+                hashmap_remove(t->entries, &e->id);
+                mount_table_unlink(t, e);
+                mount_table_entry_free(e);
+        }
+
+        return 0;
+}
+
+int mount_table_update_from_string(MountTable *t, const char *mountinfo, const char *utab, MountTableChanges *ret) {
+        MountTableChanges changes = {};
+        bool reparse, was_populated;
+        int r;
+
+        assert(t);
+        assert(mountinfo);
+        assert(ret);
+
+        /* Returns 1 if the changes were determined against the previous state, or 0 if there was no previous state
+         * and all entries are reported as added. On failure the table is reset. */
+
+        was_populated = t->populated;
+
+        /* A changed utab may add userspace options to any entry. It only changes when mount(8) and friends are
+         * invoked, i.e. rarely compared to the kernel's mount table, so just parse everything again then. */
+        reparse = !streq_ptr(t->utab, utab);
+        if (reparse) {
+                UtabEntry *entries = NULL;
+                size_t n = 0;
+
+                if (utab) {
+                        r = utab_parse(utab, &entries, &n);
+                        if (r < 0)
+                                goto fail;
+                }
+
+                utab_entries_free(t->utab_entries, t->n_utab_entries);
+                t->utab_entries = entries;
+                t->n_utab_entries = n;
+
+                r = free_and_strdup(&t->utab, utab);
+                if (r < 0)
+                        goto fail;
+        }
+
+        r = mount_table_apply(t, mountinfo, reparse, &changes);
+        if (r < 0)
+                goto fail;
+
+        t->populated = true;
+
+        *ret = changes;
+        return was_populated;
+
+fail:
+        mount_table_changes_done(&changes);
+        mount_table_reset(t);
+        return r;
+}
+
+int mount_table_update(MountTable *t, MountTableChanges *ret) {
+        _cleanup_free_ char *mountinfo = NULL, *utab = NULL;
+        int r;
+
+        assert(t);
+        assert(ret);
+
+        /* This is a seq_file, i.e. may be read in several goes */
+        r = read_full_file(MOUNTINFO_PATH, &mountinfo, NULL);
+        if (r < 0) {
+                mount_table_reset(t);
+                return r;
+        }
+
+        r = read_full_file(UTAB_PATH, &utab, NULL);
+        if (r < 0 && r != -ENOENT) {
+                mount_table_reset(t);
+                return r;
+        }
+
+        return mount_table_update_from_string(t, mountinfo, utab, ret);
+}
+
+MountTableEntry* mount_table_get(MountTable *t, const char *where) {
+        MountTableEntry *e, *top = NULL;
+
+        assert(t);
+        assert(where);
+
+        /* If several file systems are mounted on the same point, the one mounted last is visible */
+        LIST_FOREACH(same_where, e, hashmap_get(t->by_where, where))
+                if (!top || e->position > top->position)
+                        top = e;
+
+        return top;
+}
+
+bool mount_table_has_what(MountTable *t, const char *what) {
+        assert(t);
+        assert(what);
+
+        return hashmap_contains(t->whats, what);
+}
+
+unsigned mount_table_size(MountTable *t) {
+        assert(t);
+
+        return hashmap_size(t->entries);
+}
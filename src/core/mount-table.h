@@ -0,0 +1,52 @@
+/* SPDX-License-Identifier: LGPL-2.1+ */
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "list.h"
+#include "macro.h"
+#include "set.h"
+
+/* A cache of /proc/self/mountinfo, keyed by mount ID. The kernel only ever hands out the whole table, but on each
+ * change usually only a few lines differ from the last read. Lines that didn't change are matched up with their
+ * entries by a plain string comparison, and only the others are parsed. The changes are reported by mount point and
+ * by source, so that only the units and devices involved need to be looked at. */
+
+typedef struct MountTableEntry {
+        uint64_t id;
+        unsigned generation;  /* the last update this entry was seen in */
+        unsigned position;    /* the line number in that update, later lines are mounted on top of earlier ones */
+        char *line;
+
+        /* Unescaped, NULL if libmount couldn't tell */
+        char *what;
+        char *where;
+        char *options;        /* including the userspace options from utab */
+        char *fstype;
+
+        LIST_FIELDS(struct MountTableEntry, same_where);
+} MountTableEntry;
+
+typedef struct MountTable MountTable;
+
+typedef struct MountTableChanges {
+        Set *wheres;          /* mount points with entries added, changed or removed */
+        Set *found;           /* sources of entries added or changed */
+        Set *lost;            /* sources of entries changed or removed */
+} MountTableChanges;
+
+void mount_table_changes_done(MountTableChanges *c);
+
+int mount_table_new(MountTable **ret);
+MountTable* mount_table_free(MountTable *t);
+DEFINE_TRIVIAL_CLEANUP_FUNC(MountTable*, mount_table_free);
+
+void mount_table_reset(MountTable *t);
+
+int mount_table_update_from_string(MountTable *t, const char *mountinfo, const char *utab, MountTableChanges *ret);
+int mount_table_update(MountTable *t, MountTableChanges *ret);
+
+MountTableEntry* mount_table_get(MountTable *t, const char *where);
+bool mount_table_has_what(MountTable *t, const char *what);
+unsigned mount_table_size(MountTable *t);
@@ -20,6 +20,7 @@
 #include "manager.h"
 #include "mkdir.h"
 #include "mount-setup.h"
+#include "mount-table.h"
 #include "mount-util.h"
 #include "mount.h"
 #include "parse-util.h"
@@ -34,9 +35,6 @@
 
 #define RETRY_UMOUNT_MAX 32
 
-DEFINE_TRIVIAL_CLEANUP_FUNC(struct libmnt_table*, mnt_free_table);
-DEFINE_TRIVIAL_CLEANUP_FUNC(struct libmnt_iter*, mnt_free_iter);
-
 static const UnitActiveState state_translation_table[_MOUNT_STATE_MAX] = {
         [MOUNT_DEAD] = UNIT_INACTIVE,
         [MOUNT_MOUNTING] = UNIT_ACTIVATING,
@@ -1620,53 +1618,48 @@ fail:
         return r;
 }
 
-static int mount_load_proc_self_mountinfo(Manager *m, bool set_flags) {
-        _cleanup_(mnt_free_tablep) struct libmnt_table *table = NULL;
-        _cleanup_(mnt_free_iterp) struct libmnt_iter *iter = NULL;
+static int mount_load_proc_self_mountinfo(Manager *m, bool set_flags, MountTableChanges *ret_changes) {
+        _cleanup_(mount_table_changes_done) MountTableChanges changes = {};
+        const char *what, *where;
+        bool incremental;
+        Iterator i;
         int r;
 
         assert(m);
 
-        table = mnt_new_table();
-        iter = mnt_new_iter(MNT_ITER_FORWARD);
-        if (!table || !iter)
-                return log_oom();
+        if (!m->mount_table) {
+                r = mount_table_new(&m->mount_table);
+                if (r < 0)
+                        return log_oom();
+        }
 
-        r = mnt_table_parse_mtab(table, NULL);
+        /* Only the entries that were added or changed since the last time are looked at. If the table had to be
+         * read from scratch, all entries count as added, but we cannot tell which ones went away. */
+        r = mount_table_update(m->mount_table, &changes);
         if (r < 0)
                 return log_error_errno(r, "Failed to parse /proc/self/mountinfo: %m");
+        incremental = r > 0;
 
-        for (;;) {
-                struct libmnt_fs *fs;
-                const char *device, *path, *options, *fstype;
-                _cleanup_free_ char *d = NULL, *p = NULL;
+        SET_FOREACH(what, changes.found, i)
+                device_found_node(m, what, DEVICE_FOUND_MOUNT, DEVICE_FOUND_MOUNT);
 
-                r = mnt_table_next_fs(table, iter, &fs);
-                if (r == 1)
-                        break;
-                if (r < 0)
-                        return log_error_errno(r, "Failed to get next entry from /proc/self/mountinfo: %m");
+        SET_FOREACH(where, changes.wheres, i) {
+                MountTableEntry *e;
 
-                device = mnt_fs_get_source(fs);
-                path = mnt_fs_get_target(fs);
-                options = mnt_fs_get_options(fs);
-                fstype = mnt_fs_get_fstype(fs);
-
-                if (!device || !path)
+                /* If several file systems are mounted on top of each other, the unit follows the topmost */
+                e = mount_table_get(m->mount_table, where);
+                if (!e || !e->what)
                         continue;
 
-                if (cunescape(device, UNESCAPE_RELAX, &d) < 0)
-                        return log_oom();
-
-                if (cunescape(path, UNESCAPE_RELAX, &p) < 0)
-                        return log_oom();
-
-                device_found_node(m, d, DEVICE_FOUND_MOUNT, DEVICE_FOUND_MOUNT);
+                (void) mount_setup_unit(m, e->what, e->where, e->options, e->fstype, set_flags);
+        }
 
-                (void) mount_setup_unit(m, d, p, options, fstype, set_flags);
+        if (ret_changes) {
+                *ret_changes = changes;
+                changes = (MountTableChanges) {};
         }
 
-        return 0;
+        return incremental;
 }
 
 static void mount_shutdown(Manager *m) {
@@ -1676,6 +1669,8 @@ static void mount_shutdown(Manager *m) {
 
         mnt_unref_monitor(m->mount_monitor);
         m->mount_monitor = NULL;
+
+        m->mount_table = mount_table_free(m->mount_table);
 }
 
 static int mount_get_timeout(Unit *u, usec_t *timeout) {
@@ -1811,7 +1806,11 @@ static void mount_enumerate(Manager *m) {
                 (void) sd_event_source_set_description(m->mount_event_source, "mount-monitor-dispatch");
         }
 
-        r = mount_load_proc_self_mountinfo(m, false);
+        /* Units are created anew, hence report all mounts to them */
+        if (m->mount_table)
+                mount_table_reset(m->mount_table);
+
+        r = mount_load_proc_self_mountinfo(m, false, NULL);
         if (r < 0)
                 goto fail;
 
@@ -1844,9 +1843,78 @@ static int drain_libmount(Manager *m) {
         return rescan;
 }
 
+static void mount_process_mountinfo_change(Mount *mount, Set **gone) {
+        assert(mount);
+        assert(gone);
+
+        if (!mount_is_mounted(mount)) {
+
+                /* A mount point is not around right now. It
+                 * might be gone, or might never have
+                 * existed. */
+
+                if (mount->from_proc_self_mountinfo &&
+                    mount->parameters_proc_self_mountinfo.what) {
+
+                        /* Remember that this device might just have disappeared */
+                        if (set_ensure_allocated(gone, &path_hash_ops) < 0 ||
+                            set_put_strdup(*gone, mount->parameters_proc_self_mountinfo.what) < 0)
+                                log_oom(); /* we don't care too much about OOM here... */
+                }
+
+                mount->from_proc_self_mountinfo = false;
+
+                switch (mount->state) {
+
+                case MOUNT_MOUNTED:
+                        /* This has just been unmounted by
+                         * somebody else, follow the state
+                         * change. */
+                        mount->result = MOUNT_SUCCESS; /* make sure we forget any earlier umount failures */
+                        mount_enter_dead(mount, MOUNT_SUCCESS);
+                        break;
+
+                default:
+                        break;
+                }
+
+        } else if (mount->just_mounted || mount->just_changed) {
+
+                /* A mount point was added or changed */
+
+                switch (mount->state) {
+
+                case MOUNT_DEAD:
+                case MOUNT_FAILED:
+
+                        /* This has just been mounted by somebody else, follow the state change, but let's
+                         * generate a new invocation ID for this implicitly and automatically. */
+                        (void) unit_acquire_invocation_id(UNIT(mount));
+                        mount_enter_mounted(mount, MOUNT_SUCCESS);
+                        break;
+
+                case MOUNT_MOUNTING:
+                        mount_set_state(mount, MOUNT_MOUNTING_DONE);
+                        break;
+
+                default:
+                        /* Nothing really changed, but let's
+                         * issue an notification call
+                         * nonetheless, in case somebody is
+                         * waiting for this. (e.g. file system
+                         * ro/rw remounts.) */
+                        mount_set_state(mount, mount->state);
+                        break;
+                }
+        }
+
+        /* Reset the flags for later calls */
+        mount->is_mounted = mount->just_mounted = mount->just_changed = false;
+}
+
 static int mount_process_proc_self_mountinfo(Manager *m) {
-        _cleanup_set_free_ Set *around = NULL, *gone = NULL;
-        const char *what;
+        _cleanup_(mount_table_changes_done) MountTableChanges changes = {};
+        const char *what, *where;
         Iterator i;
         Unit *u;
         int r;
@@ -1857,7 +1925,7 @@ static int mount_process_proc_self_mountinfo(Manager *m) {
         if (r <= 0)
                 return r;
 
-        r = mount_load_proc_self_mountinfo(m, true);
+        r = mount_load_proc_self_mountinfo(m, true, &changes);
         if (r < 0) {
                 /* Reset flags, just in case, for later calls */
                 LIST_FOREACH(units_by_type, u, m->units_by_type[UNIT_MOUNT]) {
@@ -1871,85 +1939,25 @@ static int mount_process_proc_self_mountinfo(Manager *m) {
 
         manager_dispatch_load_queue(m);
 
-        LIST_FOREACH(units_by_type, u, m->units_by_type[UNIT_MOUNT]) {
-                Mount *mount = MOUNT(u);
-
-                if (!mount_is_mounted(mount)) {
-
-                        /* A mount point is not around right now. It
-                         * might be gone, or might never have
-                         * existed. */
-
-                        if (mount->from_proc_self_mountinfo &&
-                            mount->parameters_proc_self_mountinfo.what) {
-
-                                /* Remember that this device might just have disappeared */
-                                if (set_ensure_allocated(&gone, &path_hash_ops) < 0 ||
-                                    set_put(gone, mount->parameters_proc_self_mountinfo.what) < 0)
-                                        log_oom(); /* we don't care too much about OOM here... */
-                        }
-
-                        mount->from_proc_self_mountinfo = false;
-
-                        switch (mount->state) {
+        if (r > 0)
+                /* Only the units of mount points that changed need to follow */
+                SET_FOREACH(where, changes.wheres, i) {
+                        _cleanup_free_ char *name = NULL;
 
-                        case MOUNT_MOUNTED:
-                                /* This has just been unmounted by
-                                 * somebody else, follow the state
-                                 * change. */
-                                mount->result = MOUNT_SUCCESS; /* make sure we forget any earlier umount failures */
-                                mount_enter_dead(mount, MOUNT_SUCCESS);
-                                break;
+                        if (unit_name_from_path(where, ".mount", &name) < 0)
+                                continue;
 
-                        default:
-                                break;
-                        }
-
-                } else if (mount->just_mounted || mount->just_changed) {
-
-                        /* A mount point was added or changed */
-
-                        switch (mount->state) {
-
-                        case MOUNT_DEAD:
-                        case MOUNT_FAILED:
-
-                                /* This has just been mounted by somebody else, follow the state change, but let's
-                                 * generate a new invocation ID for this implicitly and automatically. */
-                                (void) unit_acquire_invocation_id(UNIT(mount));
-                                mount_enter_mounted(mount, MOUNT_SUCCESS);
-                                break;
-
-                        case MOUNT_MOUNTING:
-                                mount_set_state(mount, MOUNT_MOUNTING_DONE);
-                                break;
-
-                        default:
-                                /* Nothing really changed, but let's
-                                 * issue an notification call
-                                 * nonetheless, in case somebody is
-                                 * waiting for this. (e.g. file system
-                                 * ro/rw remounts.) */
-                                mount_set_state(mount, mount->state);
-                                break;
-                        }
-                }
-
-                if (mount_is_mounted(mount) &&
-                    mount->from_proc_self_mountinfo &&
-                    mount->parameters_proc_self_mountinfo.what) {
-
-                        if (set_ensure_allocated(&around, &path_hash_ops) < 0 ||
-                            set_put(around, mount->parameters_proc_self_mountinfo.what) < 0)
-                                log_oom();
+                        u = manager_get_unit(m, name);
+                        if (u)
+                                mount_process_mountinfo_change(MOUNT(u), &changes.lost);
                 }
+        else
+                /* The table was read from scratch, hence any unit might have lost its mount point */
+                LIST_FOREACH(units_by_type, u, m->units_by_type[UNIT_MOUNT])
+                        mount_process_mountinfo_change(MOUNT(u), &changes.lost);
 
-                /* Reset the flags for later calls */
-                mount->is_mounted = mount->just_mounted = mount->just_changed = false;
-        }
-
-        SET_FOREACH(what, gone, i) {
-                if (set_contains(around, what))
+        SET_FOREACH(what, changes.lost, i) {
+                if (mount_table_has_what(m->mount_table, what))
                         continue;
 
                 /* Let the device units know that the device is no longer mounted */
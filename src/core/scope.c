@@ -393,6 +393,13 @@ static int scope_enter_running(Scope *s) {
 
         s->result = SCOPE_SUCCESS;
 
+        /* The PIDs were only recorded so that we know what to move into the cgroup. On the fully unified
+         * hierarchy cgroup.events tells us when the scope runs empty, hence there's no point in keeping them
+         * around: the processes are not our children, so we'd never get SIGCHLD for them anyway. On legacy and
+         * hybrid hierarchies we keep watching them, as before. */
+        if (cg_all_unified() > 0)
+                unit_unwatch_all_pids(u);
+
         scope_set_state(s, SCOPE_RUNNING);
 
         /* Start watching the PIDs currently in the scope */
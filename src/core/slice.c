@@ -351,7 +351,7 @@ static bool slice_freezer_action_supported_by_children(Unit *s) {
 
         assert(s);
 
-        HASHMAP_FOREACH_KEY(v, member, s->dependencies[UNIT_BEFORE], i) {
+        UNIT_DEPENDENCY_FOREACH(v, member, s->dependencies[UNIT_BEFORE], i) {
                 int r;
 
                 if (UNIT_DEREF(member->slice) != s)
@@ -382,7 +382,7 @@ static int slice_freezer_action(Unit *s, FreezerAction action) {
         if (!slice_freezer_action_supported_by_children(s))
                 return log_unit_warning(s, "Requested freezer operation is not supported by all children of the slice");
 
-        HASHMAP_FOREACH_KEY(v, member, s->dependencies[UNIT_BEFORE], i) {
+        UNIT_DEPENDENCY_FOREACH(v, member, s->dependencies[UNIT_BEFORE], i) {
                 if (UNIT_DEREF(member->slice) != s)
                         continue;
 
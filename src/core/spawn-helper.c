@@ -0,0 +1,255 @@
+/* SPDX-License-Identifier: LGPL-2.1+ */
+
+#include <errno.h>
+#include <poll.h>
+#include <sched.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "alloc-util.h"
+#include "fd-util.h"
+#include "io-util.h"
+#include "log.h"
+#include "process-util.h"
+#include "raw-clone.h"
+#include "socket-util.h"
+#include "spawn-helper.h"
+#include "time-util.h"
+
+/* How long to wait for the helper to answer a request. Cloning a small process should take no time at all, hence if
+ * this elapses the helper is wedged, and we stop using it. */
+#define SPAWN_HELPER_TIMEOUT_USEC (5 * USEC_PER_SEC)
+
+struct SpawnHelper {
+        pid_t pid;
+        int fd;
+};
+
+static void close_many_and_zero(int *fds, size_t *n_fds) {
+        close_many(fds, *n_fds);
+        *n_fds = 0;
+}
+
+static int receive_request(int fd, void *buf, size_t *size, int *fds, size_t *n_fds) {
+        union {
+                struct cmsghdr cmsghdr;
+                uint8_t buf[CMSG_SPACE(sizeof(int) * SPAWN_HELPER_FDS_MAX)];
+        } control = {};
+        struct iovec iov = IOVEC_INIT(buf, SPAWN_HELPER_REQUEST_MAX);
+        struct msghdr mh = {
+                .msg_iov = &iov,
+                .msg_iovlen = 1,
+                .msg_control = &control,
+                .msg_controllen = sizeof(control),
+        };
+        struct cmsghdr *cmsg;
+        ssize_t n;
+
+        *n_fds = 0;
+
+        n = recvmsg(fd, &mh, MSG_CMSG_CLOEXEC);
+        if (n < 0)
+                return -errno;
+        if (n == 0)
+                return 0;
+
+        CMSG_FOREACH(cmsg, &mh)
+                if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS) {
+                        size_t k;
+
+                        k = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+                        memcpy(fds + *n_fds, CMSG_DATA(cmsg), k * sizeof(int));
+                        *n_fds += k;
+                }
+
+        if (mh.msg_flags & (MSG_TRUNC|MSG_CTRUNC))
+                return -EMSGSIZE;
+
+        *size = n;
+        return 1;
+}
+
+_noreturn_ static void spawn_helper_run(int fd, spawn_helper_child_t child) {
+        _cleanup_free_ void *buf = NULL;
+        int fds[SPAWN_HELPER_FDS_MAX];
+
+        buf = malloc(SPAWN_HELPER_REQUEST_MAX);
+        if (!buf) {
+                log_oom();
+                _exit(EXIT_FAILURE);
+        }
+
+        for (;;) {
+                size_t size = 0, n_fds = 0;
+                int64_t reply;
+                pid_t pid;
+                int r;
+
+                r = receive_request(fd, buf, &size, fds, &n_fds);
+                if (r == 0) /* The manager went away */
+                        _exit(EXIT_SUCCESS);
+                if (r == -EINTR) {
+                        close_many_and_zero(fds, &n_fds);
+                        continue;
+                }
+                if (r < 0 && r != -EMSGSIZE) {
+                        log_error_errno(r, "Failed to receive spawn request: %m");
+                        _exit(EXIT_FAILURE);
+                }
+
+                if (r < 0)
+                        reply = r;
+                else {
+                        /* The new process becomes a sibling of ours, i.e. the manager gets SIGCHLD for it and reaps it */
+                        pid = raw_clone(SIGCHLD|CLONE_PARENT);
+                        if (pid < 0)
+                                reply = -errno;
+                        else if (pid == 0) {
+                                /* raw_clone() bypasses the pid cache */
+                                reset_cached_pid();
+
+                                fd = safe_close(fd);
+                                _exit(child(buf, size, fds, n_fds));
+                        } else
+                                reply = pid;
+                }
+
+                close_many_and_zero(fds, &n_fds);
+
+                if (send(fd, &reply, sizeof(reply), MSG_NOSIGNAL) < 0) {
+                        if (errno == EPIPE)
+                                _exit(EXIT_SUCCESS);
+
+                        log_error_errno(errno, "Failed to send spawn reply: %m");
+                        _exit(EXIT_FAILURE);
+                }
+        }
+}
+
+int spawn_helper_new(const char *name, spawn_helper_child_t child, SpawnHelper **ret) {
+        _cleanup_close_pair_ int pair[2] = { -1, -1 };
+        SpawnHelper *h;
+        pid_t pid;
+        int r;
+
+        assert(name);
+        assert(child);
+        assert(ret);
+
+        if (socketpair(AF_UNIX, SOCK_SEQPACKET|SOCK_CLOEXEC, 0, pair) < 0)
+                return -errno;
+
+        (void) fd_inc_sndbuf(pair[0], SPAWN_HELPER_REQUEST_MAX * 2);
+        (void) fd_inc_rcvbuf(pair[1], SPAWN_HELPER_REQUEST_MAX * 2);
+
+        r = safe_fork_full(name, &pair[1], 1, FORK_RESET_SIGNALS|FORK_CLOSE_ALL_FDS|FORK_DEATHSIG|FORK_REOPEN_LOG|FORK_LOG, &pid);
+        if (r < 0)
+                return r;
+        if (r == 0)
+                spawn_helper_run(pair[1], child);
+
+        h = new(SpawnHelper, 1);
+        if (!h) {
+                (void) kill(pid, SIGKILL);
+                return -ENOMEM;
+        }
+
+        *h = (SpawnHelper) {
+                .pid = pid,
+                .fd = TAKE_FD(pair[0]),
+        };
+
+        *ret = h;
+        return 0;
+}
+
+SpawnHelper* spawn_helper_free(SpawnHelper *h) {
+        if (!h)
+                return NULL;
+
+        /* The helper exits as soon as it sees the connection closed. We don't wait for that here, the manager reaps
+         * it like any other process it doesn't know about. */
+        safe_close(h->fd);
+
+        return mfree(h);
+}
+
+bool spawn_helper_is_connected(SpawnHelper *h) {
+        assert(h);
+
+        return h->fd >= 0;
+}
+
+static int spawn_helper_broken(SpawnHelper *h, int error) {
+        /* After a failure on the connection we cannot tell which reply belongs to which request anymore, hence stop
+         * using the helper altogether */
+        h->fd = safe_close(h->fd);
+        (void) kill(h->pid, SIGKILL);
+
+        return error;
+}
+
+int spawn_helper_spawn(SpawnHelper *h, const void *data, size_t size, const int *fds, size_t n_fds, pid_t *ret) {
+        union {
+                struct cmsghdr cmsghdr;
+                uint8_t buf[CMSG_SPACE(sizeof(int) * SPAWN_HELPER_FDS_MAX)];
+        } control = {};
+        struct iovec iov = IOVEC_INIT((void*) data, size);
+        struct msghdr mh = {
+                .msg_iov = &iov,
+                .msg_iovlen = 1,
+        };
+        int64_t reply;
+        ssize_t n;
+        int r;
+
+        assert(h);
+        assert(data);
+        assert(fds || n_fds == 0);
+        assert(ret);
+
+        if (h->fd < 0)
+                return -ENOTCONN;
+
+        if (size == 0 || size > SPAWN_HELPER_REQUEST_MAX)
+                return -EMSGSIZE;
+        if (n_fds > SPAWN_HELPER_FDS_MAX)
+                return -E2BIG;
+
+        if (n_fds > 0) {
+                struct cmsghdr *cmsg;
+
+                mh.msg_control = &control;
+                mh.msg_controllen = CMSG_SPACE(sizeof(int) * n_fds);
+
+                cmsg = CMSG_FIRSTHDR(&mh);
+                cmsg->cmsg_level = SOL_SOCKET;
+                cmsg->cmsg_type = SCM_RIGHTS;
+                cmsg->cmsg_len = CMSG_LEN(sizeof(int) * n_fds);
+                memcpy(CMSG_DATA(cmsg), fds, sizeof(int) * n_fds);
+        }
+
+        if (sendmsg(h->fd, &mh, MSG_NOSIGNAL) < 0)
+                return spawn_helper_broken(h, -errno);
+
+        r = fd_wait_for_event(h->fd, POLLIN, SPAWN_HELPER_TIMEOUT_USEC);
+        if (r < 0)
+                return spawn_helper_broken(h, r);
+        if (r == 0)
+                return spawn_helper_broken(h, -ETIMEDOUT);
+
+        n = recv(h->fd, &reply, sizeof(reply), 0);
+        if (n < 0)
+                return spawn_helper_broken(h, -errno);
+        if (n != sizeof(reply))
+                return spawn_helper_broken(h, -ECONNRESET);
+
+        if (reply < 0)
+                return (int) reply;
+        if (reply == 0 || reply > INT32_MAX)
+                return spawn_helper_broken(h, -EBADMSG);
+
+        *ret = (pid_t) reply;
+        return 0;
+}
@@ -0,0 +1,30 @@
+/* SPDX-License-Identifier: LGPL-2.1+ */
+#pragma once
+
+#include <stdbool.h>
+#include <sys/types.h>
+
+#include "macro.h"
+
+/* Forking the manager copies its page tables, which gets expensive as the number of units grows. The spawn helper is
+ * forked off early, while the manager is still small, and then clones the processes for the manager on request.
+ * These processes are made children of the manager (CLONE_PARENT), hence are indistinguishable from ones forked off
+ * the manager directly. The helper only transports requests, what the cloned process does with a request is up to
+ * the function passed when creating the helper. */
+
+#define SPAWN_HELPER_REQUEST_MAX (64U*1024U)
+#define SPAWN_HELPER_FDS_MAX 250U
+
+typedef struct SpawnHelper SpawnHelper;
+
+/* Called in the cloned process, with the request data and the passed file descriptors. Should not return, if it does
+ * the process exits with the returned exit status. */
+typedef int (*spawn_helper_child_t)(void *data, size_t size, int *fds, size_t n_fds);
+
+int spawn_helper_new(const char *name, spawn_helper_child_t child, SpawnHelper **ret);
+SpawnHelper* spawn_helper_free(SpawnHelper *h);
+DEFINE_TRIVIAL_CLEANUP_FUNC(SpawnHelper*, spawn_helper_free);
+
+bool spawn_helper_is_connected(SpawnHelper *h);
+
+int spawn_helper_spawn(SpawnHelper *h, const void *data, size_t size, const int *fds, size_t n_fds, pid_t *ret);
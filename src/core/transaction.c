@@ -284,26 +284,29 @@ static void transaction_drop_redundant(Transaction *tr) {
 
         /* Goes through the transaction and removes all jobs of the units
          * whose jobs are all noops. If not all of a unit's jobs are
-         * redundant, they are kept. */
+         * redundant, they are kept. Whether a job is redundant doesn't
+         * depend on the other jobs in the transaction, and dropping one
+         * doesn't drop any others, hence one pass suffices. */
 
         assert(tr);
 
-rescan:
         HASHMAP_FOREACH(j, tr->jobs, i) {
+                Unit *u = j->unit;
                 Job *k;
 
-                LIST_FOREACH(transaction, k, j) {
-
+                LIST_FOREACH(transaction, k, j)
                         if (tr->anchor_job == k ||
                             !job_type_is_redundant(k->type, unit_active_state(k->unit)) ||
                             (k->unit->job && job_type_is_conflicting(k->type, k->unit->job->type)))
-                                goto next_unit;
-                }
+                                break;
+                if (k)
+                        continue;
 
                 /* log_debug("Found redundant job %s/%s, dropping.", j->unit->id, job_type_to_string(j->type)); */
-                transaction_delete_job(tr, j, false);
-                goto rescan;
-        next_unit:;
+
+                /* This only replaces or removes the current entry, which is fine while iterating */
+                while ((k = hashmap_get(tr->jobs, u)))
+                        transaction_delete_job(tr, k, false);
         }
 }
 
@@ -435,7 +438,7 @@ static int transaction_verify_order_one(Transaction *tr, Job *j, Job *from, unsi
 
         /* We assume that the dependencies are bidirectional, and
          * hence can ignore UNIT_AFTER */
-        HASHMAP_FOREACH_KEY(v, u, j->unit->dependencies[UNIT_BEFORE], i) {
+        UNIT_DEPENDENCY_FOREACH(v, u, j->unit->dependencies[UNIT_BEFORE], i) {
                 Job *o;
 
                 /* Is there a job for this unit? */
@@ -484,25 +487,65 @@ static int transaction_verify_order(Transaction *tr, unsigned *generation, sd_bu
         return 0;
 }
 
+static bool unit_queue_push(Unit ***queue, size_t *n, size_t *allocated, Unit *u) {
+        if (!GREEDY_REALLOC(*queue, *allocated, *n + 1))
+                return false;
+
+        (*queue)[(*n)++] = u;
+        return true;
+}
+
+static bool job_is_garbage(Transaction *tr, Job *j) {
+        return tr->anchor_job != j && !j->object_list;
+}
+
 static void transaction_collect_garbage(Transaction *tr) {
+        _cleanup_free_ Unit **queue = NULL;
+        size_t n_queue = 0, n_allocated = 0;
         Iterator i;
         Job *j;
 
         assert(tr);
 
-        /* Drop jobs that are not required by any other job */
+        /* Drop jobs that are not required by any other job. Dropping one
+         * may leave the jobs it required unrequired in turn. Instead of
+         * rescanning the whole transaction after each job dropped, the
+         * units of those jobs are queued up and looked at again. Like
+         * before, only the first job of each unit is looked at. */
+
+        HASHMAP_FOREACH(j, tr->jobs, i)
+                if (job_is_garbage(tr, j) && !unit_queue_push(&queue, &n_queue, &n_allocated, j->unit))
+                        goto rescan;
+
+        while (n_queue > 0) {
+                Unit *u = queue[--n_queue];
+
+                while ((j = hashmap_get(tr->jobs, u)) && job_is_garbage(tr, j)) {
+
+                        while (j->subject_list) {
+                                Job *o = j->subject_list->object;
+
+                                job_dependency_free(j->subject_list);
+
+                                if (!o->object_list && !unit_queue_push(&queue, &n_queue, &n_allocated, o->unit)) {
+                                        transaction_delete_job(tr, j, true);
+                                        goto rescan;
+                                }
+                        }
+
+                        /* log_debug("Garbage collecting job %s/%s", j->unit->id, job_type_to_string(j->type)); */
+                        transaction_delete_job(tr, j, true);
+                }
+        }
+
+        return;
 
 rescan:
+        /* Out of memory for the queue, fall back to looking at everything again */
         HASHMAP_FOREACH(j, tr->jobs, i) {
-                if (tr->anchor_job == j || j->object_list) {
-                        /* log_debug("Keeping job %s/%s because of %s/%s", */
-                        /*           j->unit->id, job_type_to_string(j->type), */
-                        /*           j->object_list->subject ? j->object_list->subject->unit->id : "root", */
-                        /*           j->object_list->subject ? job_type_to_string(j->object_list->subject->type) : "root"); */
+                if (!job_is_garbage(tr, j))
                         continue;
-                }
 
-                /* log_debug("Garbage collecting job %s/%s", j->unit->id, job_type_to_string(j->type)); */
                 transaction_delete_job(tr, j, true);
                 goto rescan;
         }
@@ -534,56 +577,80 @@ static int transaction_is_destructive(Transaction *tr, JobMode mode, sd_bus_erro
         return 0;
 }
 
-static void transaction_minimize_impact(Transaction *tr) {
+static Job* job_first_impacting(Job *first) {
         Job *j;
-        Iterator i;
 
-        assert(tr);
+        /* Returns the first job of the list that would stop a running
+         * service or change an existing job, unless it matters. */
 
-        /* Drops all unnecessary jobs that reverse already active jobs
-         * or that stop a running service. */
+        LIST_FOREACH(transaction, j, first) {
+                if (j->matters_to_anchor)
+                        continue;
 
-rescan:
-        HASHMAP_FOREACH(j, tr->jobs, i) {
-                LIST_FOREACH(transaction, j, j) {
-                        bool stops_running_service, changes_existing_job;
+                if (j->type == JOB_STOP && UNIT_IS_ACTIVE_OR_ACTIVATING(unit_active_state(j->unit)))
+                        return j;
 
-                        /* If it matters, we shouldn't drop it */
-                        if (j->matters_to_anchor)
-                                continue;
+                if (j->unit->job && job_type_is_conflicting(j->type, j->unit->job->type))
+                        return j;
+        }
 
-                        /* Would this stop a running service?
-                         * Would this change an existing job?
-                         * If so, let's drop this entry */
+        return NULL;
+}
 
-                        stops_running_service =
-                                j->type == JOB_STOP && UNIT_IS_ACTIVE_OR_ACTIVATING(unit_active_state(j->unit));
+static void transaction_delete_impacting_job(Transaction *tr, Job *j) {
+        if (j->type == JOB_STOP && UNIT_IS_ACTIVE_OR_ACTIVATING(unit_active_state(j->unit)))
+                log_unit_debug(j->unit,
+                               "%s/%s would stop a running service.",
+                               j->unit->id, job_type_to_string(j->type));
 
-                        changes_existing_job =
-                                j->unit->job &&
-                                job_type_is_conflicting(j->type, j->unit->job->type);
+        if (j->unit->job && job_type_is_conflicting(j->type, j->unit->job->type))
+                log_unit_debug(j->unit,
+                               "%s/%s would change existing job.",
+                               j->unit->id, job_type_to_string(j->type));
 
-                        if (!stops_running_service && !changes_existing_job)
-                                continue;
+        /* Ok, let's get rid of this */
+        log_unit_debug(j->unit,
+                       "Deleting %s/%s to minimize impact.",
+                       j->unit->id, job_type_to_string(j->type));
 
-                        if (stops_running_service)
-                                log_unit_debug(j->unit,
-                                               "%s/%s would stop a running service.",
-                                               j->unit->id, job_type_to_string(j->type));
+        transaction_delete_job(tr, j, true);
+}
 
-                        if (changes_existing_job)
-                                log_unit_debug(j->unit,
-                                               "%s/%s would change existing job.",
-                                               j->unit->id, job_type_to_string(j->type));
+static void transaction_minimize_impact(Transaction *tr) {
+        _cleanup_free_ Unit **queue = NULL;
+        size_t n_queue = 0, n_allocated = 0, k;
+        Iterator i;
+        Job *j;
 
-                        /* Ok, let's get rid of this */
-                        log_unit_debug(j->unit,
-                                       "Deleting %s/%s to minimize impact.",
-                                       j->unit->id, job_type_to_string(j->type));
+        assert(tr);
 
-                        transaction_delete_job(tr, j, true);
+        /* Drops all unnecessary jobs that reverse already active jobs
+         * or that stop a running service. Whether a job qualifies
+         * doesn't change by dropping others, hence the units of all
+         * such jobs are collected first. Dropping a job also drops the
+         * jobs requiring it, so look the jobs up again afterwards. */
+
+        HASHMAP_FOREACH(j, tr->jobs, i)
+                if (job_first_impacting(j) && !unit_queue_push(&queue, &n_queue, &n_allocated, j->unit))
                         goto rescan;
-                }
+
+        for (k = 0; k < n_queue; k++)
+                while ((j = job_first_impacting(hashmap_get(tr->jobs, queue[k]))))
+                        transaction_delete_impacting_job(tr, j);
+
+        return;
+
+rescan:
+        /* Out of memory for the queue, fall back to looking at everything again */
+        HASHMAP_FOREACH(j, tr->jobs, i) {
+                Job *d;
+
+                d = job_first_impacting(j);
+                if (!d)
+                        continue;
+
+                transaction_delete_impacting_job(tr, d);
+                goto rescan;
         }
 }
 
@@ -863,7 +930,7 @@ void transaction_add_propagate_reload_jobs(Transaction *tr, Unit *unit, Job *by,
         assert(tr);
         assert(unit);
 
-        HASHMAP_FOREACH_KEY(v, dep, unit->dependencies[UNIT_PROPAGATES_RELOAD_TO], i) {
+        UNIT_DEPENDENCY_FOREACH(v, dep, unit->dependencies[UNIT_PROPAGATES_RELOAD_TO], i) {
                 nt = job_type_collapse(JOB_TRY_RELOAD, dep);
                 if (nt == JOB_NOP)
                         continue;
@@ -968,7 +1035,7 @@ int transaction_add_job_and_dependencies(
 
                 /* Finally, recursively add in all dependencies. */
                 if (IN_SET(type, JOB_START, JOB_RESTART)) {
-                        HASHMAP_FOREACH_KEY(v, dep, ret->unit->dependencies[UNIT_REQUIRES], i) {
+                        UNIT_DEPENDENCY_FOREACH(v, dep, ret->unit->dependencies[UNIT_REQUIRES], i) {
                                 r = transaction_add_job_and_dependencies(tr, JOB_START, dep, ret, true, false, false, ignore_order, e);
                                 if (r < 0) {
                                         if (r != -EBADR) /* job type not applicable */
@@ -978,7 +1045,7 @@ int transaction_add_job_and_dependencies(
                                 }
                         }
 
-                        HASHMAP_FOREACH_KEY(v, dep, ret->unit->dependencies[UNIT_BINDS_TO], i) {
+                        UNIT_DEPENDENCY_FOREACH(v, dep, ret->unit->dependencies[UNIT_BINDS_TO], i) {
                                 r = transaction_add_job_and_dependencies(tr, JOB_START, dep, ret, true, false, false, ignore_order, e);
                                 if (r < 0) {
                                         if (r != -EBADR) /* job type not applicable */
@@ -988,7 +1055,7 @@ int transaction_add_job_and_dependencies(
                                 }
                         }
 
-                        HASHMAP_FOREACH_KEY(v, dep, ret->unit->dependencies[UNIT_WANTS], i) {
+                        UNIT_DEPENDENCY_FOREACH(v, dep, ret->unit->dependencies[UNIT_WANTS], i) {
                                 r = transaction_add_job_and_dependencies(tr, JOB_START, dep, ret, false, false, false, ignore_order, e);
                                 if (r < 0) {
                                         /* unit masked, job type not applicable and unit not found are not considered as errors. */
@@ -1000,7 +1067,7 @@ int transaction_add_job_and_dependencies(
                                 }
                         }
 
-                        HASHMAP_FOREACH_KEY(v, dep, ret->unit->dependencies[UNIT_REQUISITE], i) {
+                        UNIT_DEPENDENCY_FOREACH(v, dep, ret->unit->dependencies[UNIT_REQUISITE], i) {
                                 r = transaction_add_job_and_dependencies(tr, JOB_VERIFY_ACTIVE, dep, ret, true, false, false, ignore_order, e);
                                 if (r < 0) {
                                         if (r != -EBADR) /* job type not applicable */
@@ -1010,7 +1077,7 @@ int transaction_add_job_and_dependencies(
                                 }
                         }
 
-                        HASHMAP_FOREACH_KEY(v, dep, ret->unit->dependencies[UNIT_CONFLICTS], i) {
+                        UNIT_DEPENDENCY_FOREACH(v, dep, ret->unit->dependencies[UNIT_CONFLICTS], i) {
                                 r = transaction_add_job_and_dependencies(tr, JOB_STOP, dep, ret, true, true, false, ignore_order, e);
                                 if (r < 0) {
                                         if (r != -EBADR) /* job type not applicable */
@@ -1020,7 +1087,7 @@ int transaction_add_job_and_dependencies(
                                 }
                         }
 
-                        HASHMAP_FOREACH_KEY(v, dep, ret->unit->dependencies[UNIT_CONFLICTED_BY], i) {
+                        UNIT_DEPENDENCY_FOREACH(v, dep, ret->unit->dependencies[UNIT_CONFLICTED_BY], i) {
                                 r = transaction_add_job_and_dependencies(tr, JOB_STOP, dep, ret, false, false, false, ignore_order, e);
                                 if (r < 0) {
                                         log_unit_warning(dep,
@@ -1049,7 +1116,7 @@ int transaction_add_job_and_dependencies(
                         ptype = type == JOB_RESTART ? JOB_TRY_RESTART : type;
 
                         for (j = 0; j < ELEMENTSOF(propagate_deps); j++)
-                                HASHMAP_FOREACH_KEY(v, dep, ret->unit->dependencies[propagate_deps[j]], i) {
+                                UNIT_DEPENDENCY_FOREACH(v, dep, ret->unit->dependencies[propagate_deps[j]], i) {
                                         JobType nt;
 
                                         nt = job_type_collapse(ptype, dep);
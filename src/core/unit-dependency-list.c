@@ -0,0 +1,278 @@
+/* SPDX-License-Identifier: LGPL-2.1+ */
+
+#include <errno.h>
+#include <stdlib.h>
+
+#include "alloc-util.h"
+#include "unit-dependency-list.h"
+
+static Hashmap** unit_dependency_list_index(const UnitDependencyList *l) {
+        if (!l || l->n_allocated <= UNIT_DEPENDENCY_LIST_INDEX_MIN)
+                return NULL;
+
+        return (Hashmap**) (l->entries + l->n_allocated);
+}
+
+static Hashmap* unit_dependency_list_get_index(const UnitDependencyList *l) {
+        Hashmap **index;
+
+        index = unit_dependency_list_index(l);
+        return index ? *index : NULL;
+}
+
+UnitDependencyList* unit_dependency_list_free(UnitDependencyList *l) {
+        if (!l)
+                return NULL;
+
+        hashmap_free(unit_dependency_list_get_index(l));
+        return mfree(l);
+}
+
+static unsigned unit_dependency_list_find(const UnitDependencyList *l, const Unit *u) {
+        Hashmap *index;
+        unsigned i;
+
+        /* Returns the position of the entry of the unit, or UINT_MAX if there is none */
+
+        if (!l)
+                return UINT_MAX;
+
+        index = unit_dependency_list_get_index(l);
+        if (index)
+                return PTR_TO_UINT(hashmap_get(index, u)) - 1;
+
+        for (i = 0; i < l->n_entries; i++)
+                if (l->entries[i].unit == u)
+                        return i;
+
+        return UINT_MAX;
+}
+
+void* unit_dependency_list_get(const UnitDependencyList *l, const Unit *u) {
+        unsigned i;
+
+        i = unit_dependency_list_find(l, u);
+        if (i == UINT_MAX)
+                return NULL;
+
+        return l->entries[i].data;
+}
+
+Unit* unit_dependency_list_first(const UnitDependencyList *l) {
+        if (unit_dependency_list_isempty(l))
+                return NULL;
+
+        return l->entries[0].unit;
+}
+
+static int unit_dependency_list_build_index(UnitDependencyList *l, unsigned n_entries) {
+        _cleanup_(hashmap_freep) Hashmap *index = NULL;
+        unsigned i;
+        int r;
+
+        assert(l);
+        assert(unit_dependency_list_index(l));
+        assert(!*unit_dependency_list_index(l));
+
+        index = hashmap_new(NULL);
+        if (!index)
+                return -ENOMEM;
+
+        r = hashmap_reserve(index, n_entries);
+        if (r < 0)
+                return r;
+
+        for (i = 0; i < l->n_entries; i++) {
+                r = hashmap_put(index, l->entries[i].unit, UINT_TO_PTR(i + 1));
+                if (r < 0)
+                        return r;
+        }
+
+        *unit_dependency_list_index(l) = TAKE_PTR(index);
+        return 0;
+}
+
+static size_t unit_dependency_list_alloc_size(unsigned n_allocated) {
+        return offsetof(UnitDependencyList, entries) +
+                (size_t) n_allocated * sizeof(UnitDependencyEntry) +
+                (n_allocated > UNIT_DEPENDENCY_LIST_INDEX_MIN ? sizeof(Hashmap*) : 0);
+}
+
+int unit_dependency_list_reserve(UnitDependencyList **l, unsigned n_entries_add) {
+        UnitDependencyList *n;
+        Hashmap *index;
+        unsigned size, allocated;
+
+        assert(l);
+
+        /* Makes sure that the next n_entries_add additions can't fail */
+
+        size = unit_dependency_list_size(*l);
+        if (n_entries_add > UINT_MAX / 2 - size)
+                return -ENOMEM;
+
+        allocated = *l ? (*l)->n_allocated : 0;
+        if (size + n_entries_add > allocated) {
+                index = unit_dependency_list_get_index(*l);
+                allocated = MAX(size + n_entries_add, 2 * allocated);
+
+                n = realloc(*l, unit_dependency_list_alloc_size(allocated));
+                if (!n)
+                        return -ENOMEM;
+
+                if (!*l)
+                        *n = (UnitDependencyList) {};
+
+                /* The index pointer moves to the new end */
+                n->n_allocated = allocated;
+                if (unit_dependency_list_index(n))
+                        *unit_dependency_list_index(n) = index;
+
+                *l = n;
+        }
+
+        if (size + n_entries_add <= UNIT_DEPENDENCY_LIST_INDEX_MIN)
+                return 0;
+
+        index = unit_dependency_list_get_index(*l);
+        if (!index)
+                return unit_dependency_list_build_index(*l, size + n_entries_add);
+
+        return hashmap_reserve(index, n_entries_add);
+}
+
+int unit_dependency_list_replace(UnitDependencyList **l, Unit *u, void *data) {
+        Hashmap *index;
+        unsigned i;
+        int r;
+
+        assert(l);
+        assert(u);
+
+        /* Adds an entry for the unit, or updates the data of the existing one */
+
+        i = unit_dependency_list_find(*l, u);
+        if (i != UINT_MAX) {
+                (*l)->entries[i].data = data;
+                return 0;
+        }
+
+        r = unit_dependency_list_reserve(l, 1);
+        if (r < 0)
+                return r;
+
+        i = (*l)->n_entries;
+        index = unit_dependency_list_get_index(*l);
+        if (index)
+                assert_se(hashmap_put(index, u, UINT_TO_PTR(i + 1)) > 0);
+
+        (*l)->entries[i] = (UnitDependencyEntry) {
+                .unit = u,
+                .data = data,
+        };
+        (*l)->n_entries++;
+
+        return 1;
+}
+
+static void unit_dependency_list_remove_at(UnitDependencyList *l, unsigned i) {
+        Hashmap *index;
+        unsigned last;
+
+        assert(l);
+        assert(i < l->n_entries);
+
+        /* Fills the gap with the last entry */
+
+        last = l->n_entries - 1;
+
+        index = unit_dependency_list_get_index(l);
+        if (index) {
+                assert_se(hashmap_remove(index, l->entries[i].unit));
+                if (i != last)
+                        assert_se(hashmap_update(index, l->entries[last].unit, UINT_TO_PTR(i + 1)) >= 0);
+        }
+
+        l->entries[i] = l->entries[last];
+        l->n_entries--;
+}
+
+void* unit_dependency_list_remove(UnitDependencyList *l, const Unit *u) {
+        unsigned i;
+        void *data;
+
+        i = unit_dependency_list_find(l, u);
+        if (i == UINT_MAX)
+                return NULL;
+
+        data = l->entries[i].data;
+        unit_dependency_list_remove_at(l, i);
+
+        return data;
+}
+
+int unit_dependency_list_remove_and_replace(UnitDependencyList *l, const Unit *old_unit, Unit *new_unit, void *data) {
+        Hashmap *index;
+        unsigned i, j;
+
+        assert(old_unit);
+        assert(new_unit);
+
+        /* Replaces the entry of old_unit by one for new_unit, merging with an existing entry of new_unit. As no new
+         * entry is added, this never needs to allocate anything. */
+
+        i = unit_dependency_list_find(l, old_unit);
+        if (i == UINT_MAX)
+                return -ENOENT;
+
+        j = unit_dependency_list_find(l, new_unit);
+        if (j != UINT_MAX) {
+                l->entries[j].data = data;
+                unit_dependency_list_remove_at(l, i);
+                return 0;
+        }
+
+        index = unit_dependency_list_get_index(l);
+        if (index)
+                assert_se(hashmap_remove_and_replace(index, old_unit, new_unit, UINT_TO_PTR(i + 1)) >= 0);
+
+        l->entries[i] = (UnitDependencyEntry) {
+                .unit = new_unit,
+                .data = data,
+        };
+
+        return 0;
+}
+
+int unit_dependency_list_move(UnitDependencyList **l, UnitDependencyList **other) {
+        unsigned i;
+        int r;
+
+        assert(l);
+        assert(other);
+
+        /* Moves all entries of other that l doesn't have yet to l, and frees other. If other's entries were reserved
+         * in l beforehand, this cannot fail. */
+
+        if (!*other)
+                return 0;
+
+        if (!*l) {
+                *l = TAKE_PTR(*other);
+                return 0;
+        }
+
+        for (i = 0; i < (*other)->n_entries; i++) {
+                UnitDependencyEntry *e = (*other)->entries + i;
+
+                if (unit_dependency_list_find(*l, e->unit) != UINT_MAX)
+                        continue;
+
+                r = unit_dependency_list_replace(l, e->unit, e->data);
+                if (r < 0)
+                        return r;
+        }
+
+        *other = unit_dependency_list_free(*other);
+        return 0;
+}
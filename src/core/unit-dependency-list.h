@@ -0,0 +1,80 @@
+/* SPDX-License-Identifier: LGPL-2.1+ */
+#pragma once
+
+#include <stdbool.h>
+
+#include "hashmap.h"
+#include "macro.h"
+
+typedef struct Unit Unit;
+
+/* The dependencies of one type of a unit. Almost all units have only a handful of dependencies of each type, hence
+ * these are kept in a flat array, which is cheap to store and fast to iterate through. Only once a list grows long an
+ * index from unit to position is added, so that lookups and removals stay cheap for targets and slices that might
+ * have thousands of entries. The pointer to it is stored after the entries, and only allocated for lists with room
+ * for that many entries, so that short lists don't pay for it. The entries are in no particular order. */
+
+/* Up to this many entries a linear search is at least as fast as a hash table lookup */
+#define UNIT_DEPENDENCY_LIST_INDEX_MIN 16U
+
+typedef struct UnitDependencyEntry {
+        Unit *unit;
+        void *data;           /* a UnitDependencyInfo */
+} UnitDependencyEntry;
+
+typedef struct UnitDependencyList {
+        unsigned n_entries;
+        unsigned n_allocated;
+        UnitDependencyEntry entries[];
+        /* Hashmap *index;       Unit* → position + 1, if n_allocated > UNIT_DEPENDENCY_LIST_INDEX_MIN */
+} UnitDependencyList;
+
+UnitDependencyList* unit_dependency_list_free(UnitDependencyList *l);
+
+static inline unsigned unit_dependency_list_size(const UnitDependencyList *l) {
+        return l ? l->n_entries : 0;
+}
+
+static inline bool unit_dependency_list_isempty(const UnitDependencyList *l) {
+        return unit_dependency_list_size(l) == 0;
+}
+
+void* unit_dependency_list_get(const UnitDependencyList *l, const Unit *u);
+static inline bool unit_dependency_list_contains(const UnitDependencyList *l, const Unit *u) {
+        return unit_dependency_list_get(l, u);
+}
+
+Unit* unit_dependency_list_first(const UnitDependencyList *l);
+
+int unit_dependency_list_reserve(UnitDependencyList **l, unsigned n_entries_add);
+int unit_dependency_list_replace(UnitDependencyList **l, Unit *u, void *data);
+void* unit_dependency_list_remove(UnitDependencyList *l, const Unit *u);
+int unit_dependency_list_remove_and_replace(UnitDependencyList *l, const Unit *old_unit, Unit *new_unit, void *data);
+int unit_dependency_list_move(UnitDependencyList **l, UnitDependencyList **other);
+
+/* Iterates from the back, so that removing the current entry is safe: its place is taken by the last entry, which
+ * was already visited. Adding entries while iterating is not. */
+static inline bool unit_dependency_list_iterate(const UnitDependencyList *l, Iterator *i, void **ret_data, Unit **ret_unit) {
+        const UnitDependencyEntry *e;
+
+        assert(i);
+
+        i->idx = MIN(i->idx, unit_dependency_list_size(l));
+        if (i->idx == 0) {
+                if (ret_data)
+                        *ret_data = NULL;
+                if (ret_unit)
+                        *ret_unit = NULL;
+                return false;
+        }
+
+        e = l->entries + --i->idx;
+        if (ret_data)
+                *ret_data = e->data;
+        if (ret_unit)
+                *ret_unit = e->unit;
+        return true;
+}
+
+#define UNIT_DEPENDENCY_FOREACH(e, k, l, i) \
+        for ((i) = ITERATOR_FIRST; unit_dependency_list_iterate((l), &(i), (void**)&(e), &(k)); )
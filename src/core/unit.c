@@ -423,8 +423,13 @@ void unit_add_to_dbus_queue(Unit *u) {
         assert(u);
         assert(u->type != _UNIT_TYPE_INVALID);
 
-        if (u->load_state == UNIT_STUB || u->in_dbus_queue)
+        if (u->load_state == UNIT_STUB)
+                return;
+
+        if (u->in_dbus_queue) {
+                u->manager->n_dbus_changes_coalesced++;
                 return;
+        }
 
         /* Shortcut things if nobody cares */
         if (sd_bus_track_count(u->manager->subscribed) <= 0 &&
@@ -454,25 +459,25 @@ void unit_add_to_stop_when_unneeded_queue(Unit *u) {
         u->in_stop_when_unneeded_queue = true;
 }
 
-static void bidi_set_free(Unit *u, Hashmap *h) {
+static void bidi_set_free(Unit *u, UnitDependencyList *l) {
         Unit *other;
         Iterator i;
         void *v;
 
         assert(u);
 
-        /* Frees the hashmap and makes sure we are dropped from the inverse pointers */
+        /* Frees the list and makes sure we are dropped from the inverse pointers */
 
-        HASHMAP_FOREACH_KEY(v, other, h, i) {
+        UNIT_DEPENDENCY_FOREACH(v, other, l, i) {
                 UnitDependency d;
 
                 for (d = 0; d < _UNIT_DEPENDENCY_MAX; d++)
-                        hashmap_remove(other->dependencies[d], u);
+                        unit_dependency_list_remove(other->dependencies[d], u);
 
                 unit_add_to_gc_queue(other);
         }
 
-        hashmap_free(h);
+        unit_dependency_list_free(l);
 }
 
 static void unit_remove_transient(Unit *u) {
@@ -752,21 +757,6 @@ static int set_complete_move(Set **s, Set **other) {
         return 0;
 }
 
-static int hashmap_complete_move(Hashmap **s, Hashmap **other) {
-        assert(s);
-        assert(other);
-
-        if (!*other)
-                return 0;
-
-        if (*s)
-                return hashmap_move(*s, *other);
-        else
-                *s = TAKE_PTR(*other);
-
-        return 0;
-}
-
 static int merge_names(Unit *u, Unit *other) {
         char *t;
         Iterator i;
@@ -797,24 +787,23 @@ static int reserve_dependencies(Unit *u, Unit *other, UnitDependency d) {
         assert(d < _UNIT_DEPENDENCY_MAX);
 
         /*
-         * If u does not have this dependency set allocated, there is no need
-         * to reserve anything. In that case other's set will be transferred
-         * as a whole to u by complete_move().
+         * If u does not have this dependency list allocated, there is no need
+         * to reserve anything. In that case other's list will be transferred
+         * as a whole to u by unit_dependency_list_move().
          */
         if (!u->dependencies[d])
                 return 0;
 
         /* merge_dependencies() will skip a u-on-u dependency */
-        n_reserve = hashmap_size(other->dependencies[d]) - !!hashmap_get(other->dependencies[d], u);
+        n_reserve = unit_dependency_list_size(other->dependencies[d]) - !!unit_dependency_list_get(other->dependencies[d], u);
 
-        return hashmap_reserve(u->dependencies[d], n_reserve);
+        return unit_dependency_list_reserve(&u->dependencies[d], n_reserve);
 }
 
 static void merge_dependencies(Unit *u, Unit *other, const char *other_id, UnitDependency d) {
         Iterator i;
         Unit *back;
         void *v;
-        int r;
 
         /* Merges all dependencies of type 'd' of the unit 'other' into the deps of the unit 'u' */
 
@@ -823,7 +812,7 @@ static void merge_dependencies(Unit *u, Unit *other, const char *other_id, UnitD
         assert(d < _UNIT_DEPENDENCY_MAX);
 
         /* Fix backwards pointers. Let's iterate through all dependendent units of the other unit. */
-        HASHMAP_FOREACH_KEY(v, back, other->dependencies[d], i) {
+        UNIT_DEPENDENCY_FOREACH(v, back, other->dependencies[d], i) {
                 UnitDependency k;
 
                 /* Let's now iterate through the dependencies of that dependencies of the other units, looking for
@@ -832,7 +821,7 @@ static void merge_dependencies(Unit *u, Unit *other, const char *other_id, UnitD
                 for (k = 0; k < _UNIT_DEPENDENCY_MAX; k++) {
                         if (back == u) {
                                 /* Do not add dependencies between u and itself. */
-                                if (hashmap_remove(back->dependencies[k], other))
+                                if (unit_dependency_list_remove(back->dependencies[k], other))
                                         maybe_warn_about_dependency(u, other_id, k);
                         } else {
                                 UnitDependencyInfo di_u, di_other, di_merged;
@@ -841,37 +830,33 @@ static void merge_dependencies(Unit *u, Unit *other, const char *other_id, UnitD
                                  * "back" and "u" instead. Let's merge the bit masks of the dependency we are moving,
                                  * and any such dependency which might already exist */
 
-                                di_other.data = hashmap_get(back->dependencies[k], other);
+                                di_other.data = unit_dependency_list_get(back->dependencies[k], other);
                                 if (!di_other.data)
                                         continue; /* dependency isn't set, let's try the next one */
 
-                                di_u.data = hashmap_get(back->dependencies[k], u);
+                                di_u.data = unit_dependency_list_get(back->dependencies[k], u);
 
                                 di_merged = (UnitDependencyInfo) {
                                         .origin_mask = di_u.origin_mask | di_other.origin_mask,
                                         .destination_mask = di_u.destination_mask | di_other.destination_mask,
                                 };
 
-                                r = hashmap_remove_and_replace(back->dependencies[k], other, u, di_merged.data);
-                                if (r < 0)
-                                        log_warning_errno(r, "Failed to remove/replace: back=%s other=%s u=%s: %m", back->id, other_id, u->id);
-                                assert(r >= 0);
-
-                                /* assert_se(hashmap_remove_and_replace(back->dependencies[k], other, u, di_merged.data) >= 0); */
+                                /* This reuses the entry of "other", hence cannot fail */
+                                assert_se(unit_dependency_list_remove_and_replace(back->dependencies[k], other, u, di_merged.data) >= 0);
                         }
                 }
 
         }
 
         /* Also do not move dependencies on u to itself */
-        back = hashmap_remove(other->dependencies[d], u);
+        back = unit_dependency_list_remove(other->dependencies[d], u);
         if (back)
                 maybe_warn_about_dependency(u, other_id, d);
 
         /* The move cannot fail. The caller must have performed a reservation. */
-        assert_se(hashmap_complete_move(&u->dependencies[d], &other->dependencies[d]) == 0);
+        assert_se(unit_dependency_list_move(&u->dependencies[d], &other->dependencies[d]) == 0);
 
-        other->dependencies[d] = hashmap_free(other->dependencies[d]);
+        other->dependencies[d] = unit_dependency_list_free(other->dependencies[d]);
 }
 
 int unit_merge(Unit *u, Unit *other) {
@@ -1269,7 +1254,7 @@ void unit_dump(Unit *u, FILE *f, const char *prefix) {
                 UnitDependencyInfo di;
                 Unit *other;
 
-                HASHMAP_FOREACH_KEY(di.data, other, u->dependencies[d], i) {
+                UNIT_DEPENDENCY_FOREACH(di.data, other, u->dependencies[d], i) {
                         bool space = false;
 
                         fprintf(f, "%s\t%s: %s (", prefix, unit_dependency_to_string(d), other->id);
@@ -1407,7 +1392,7 @@ int unit_add_default_target_dependency(Unit *u, Unit *target) {
                 return 0;
 
         /* Don't create loops */
-        if (hashmap_get(target->dependencies[UNIT_BEFORE], u))
+        if (unit_dependency_list_get(target->dependencies[UNIT_BEFORE], u))
                 return 0;
 
         return unit_add_dependency(target, UNIT_AFTER, u, true, UNIT_DEPENDENCY_DEFAULT);
@@ -1555,7 +1540,7 @@ int unit_load(Unit *u) {
                 if (r < 0)
                         goto fail;
 
-                if (u->on_failure_job_mode == JOB_ISOLATE && hashmap_size(u->dependencies[UNIT_ON_FAILURE]) > 1) {
+                if (u->on_failure_job_mode == JOB_ISOLATE && unit_dependency_list_size(u->dependencies[UNIT_ON_FAILURE]) > 1) {
                         log_unit_error(u, "More than one OnFailure= dependencies specified but OnFailureJobMode=isolate set. Refusing.");
                         r = -ENOEXEC;
                         goto fail;
@@ -1697,9 +1682,9 @@ static bool unit_verify_deps(Unit *u) {
          * processing, but do not have any effect afterwards. We don't check BindsTo= dependencies that are not used in
          * conjunction with After= as for them any such check would make things entirely racy. */
 
-        HASHMAP_FOREACH_KEY(v, other, u->dependencies[UNIT_BINDS_TO], j) {
+        UNIT_DEPENDENCY_FOREACH(v, other, u->dependencies[UNIT_BINDS_TO], j) {
 
-                if (!hashmap_contains(u->dependencies[UNIT_AFTER], other))
+                if (!unit_dependency_list_contains(u->dependencies[UNIT_AFTER], other))
                         continue;
 
                 if (!UNIT_IS_ACTIVE_OR_RELOADING(unit_active_state(other))) {
@@ -1926,7 +1911,7 @@ bool unit_can_reload(Unit *u) {
         if (UNIT_VTABLE(u)->can_reload)
                 return UNIT_VTABLE(u)->can_reload(u);
 
-        if (!hashmap_isempty(u->dependencies[UNIT_PROPAGATES_RELOAD_TO]))
+        if (!unit_dependency_list_isempty(u->dependencies[UNIT_PROPAGATES_RELOAD_TO]))
                 return true;
 
         return UNIT_VTABLE(u)->reload;
@@ -1960,7 +1945,7 @@ bool unit_is_unneeded(Unit *u) {
                 /* If a dependending unit has a job queued, or is active (or in transitioning), or is marked for
                  * restart, then don't clean this one up. */
 
-                HASHMAP_FOREACH_KEY(v, other, u->dependencies[deps[j]], i) {
+                UNIT_DEPENDENCY_FOREACH(v, other, u->dependencies[deps[j]], i) {
                         if (other->job)
                                 return false;
 
@@ -1994,7 +1979,7 @@ static void check_unneeded_dependencies(Unit *u) {
                 Iterator i;
                 void *v;
 
-                HASHMAP_FOREACH_KEY(v, other, u->dependencies[deps[j]], i)
+                UNIT_DEPENDENCY_FOREACH(v, other, u->dependencies[deps[j]], i)
                         unit_add_to_stop_when_unneeded_queue(other);
         }
 }
@@ -2015,7 +2000,7 @@ static void unit_check_binds_to(Unit *u) {
         if (unit_active_state(u) != UNIT_ACTIVE)
                 return;
 
-        HASHMAP_FOREACH_KEY(v, other, u->dependencies[UNIT_BINDS_TO], i) {
+        UNIT_DEPENDENCY_FOREACH(v, other, u->dependencies[UNIT_BINDS_TO], i) {
                 if (other->job)
                         continue;
 
@@ -2058,26 +2043,26 @@ static void retroactively_start_dependencies(Unit *u) {
         assert(u);
         assert(UNIT_IS_ACTIVE_OR_ACTIVATING(unit_active_state(u)));
 
-        HASHMAP_FOREACH_KEY(v, other, u->dependencies[UNIT_REQUIRES], i)
-                if (!hashmap_get(u->dependencies[UNIT_AFTER], other) &&
+        UNIT_DEPENDENCY_FOREACH(v, other, u->dependencies[UNIT_REQUIRES], i)
+                if (!unit_dependency_list_get(u->dependencies[UNIT_AFTER], other) &&
                     !UNIT_IS_ACTIVE_OR_ACTIVATING(unit_active_state(other)))
                         manager_add_job(u->manager, JOB_START, other, JOB_REPLACE, NULL, NULL, NULL);
 
-        HASHMAP_FOREACH_KEY(v, other, u->dependencies[UNIT_BINDS_TO], i)
-                if (!hashmap_get(u->dependencies[UNIT_AFTER], other) &&
+        UNIT_DEPENDENCY_FOREACH(v, other, u->dependencies[UNIT_BINDS_TO], i)
+                if (!unit_dependency_list_get(u->dependencies[UNIT_AFTER], other) &&
                     !UNIT_IS_ACTIVE_OR_ACTIVATING(unit_active_state(other)))
                         manager_add_job(u->manager, JOB_START, other, JOB_REPLACE, NULL, NULL, NULL);
 
-        HASHMAP_FOREACH_KEY(v, other, u->dependencies[UNIT_WANTS], i)
-                if (!hashmap_get(u->dependencies[UNIT_AFTER], other) &&
+        UNIT_DEPENDENCY_FOREACH(v, other, u->dependencies[UNIT_WANTS], i)
+                if (!unit_dependency_list_get(u->dependencies[UNIT_AFTER], other) &&
                     !UNIT_IS_ACTIVE_OR_ACTIVATING(unit_active_state(other)))
                         manager_add_job(u->manager, JOB_START, other, JOB_FAIL, NULL, NULL, NULL);
 
-        HASHMAP_FOREACH_KEY(v, other, u->dependencies[UNIT_CONFLICTS], i)
+        UNIT_DEPENDENCY_FOREACH(v, other, u->dependencies[UNIT_CONFLICTS], i)
                 if (!UNIT_IS_INACTIVE_OR_DEACTIVATING(unit_active_state(other)))
                         manager_add_job(u->manager, JOB_STOP, other, JOB_REPLACE, NULL, NULL, NULL);
 
-        HASHMAP_FOREACH_KEY(v, other, u->dependencies[UNIT_CONFLICTED_BY], i)
+        UNIT_DEPENDENCY_FOREACH(v, other, u->dependencies[UNIT_CONFLICTED_BY], i)
                 if (!UNIT_IS_INACTIVE_OR_DEACTIVATING(unit_active_state(other)))
                         manager_add_job(u->manager, JOB_STOP, other, JOB_REPLACE, NULL, NULL, NULL);
 }
@@ -2091,7 +2076,7 @@ static void retroactively_stop_dependencies(Unit *u) {
         assert(UNIT_IS_INACTIVE_OR_DEACTIVATING(unit_active_state(u)));
 
         /* Pull down units which are bound to us recursively if enabled */
-        HASHMAP_FOREACH_KEY(v, other, u->dependencies[UNIT_BOUND_BY], i)
+        UNIT_DEPENDENCY_FOREACH(v, other, u->dependencies[UNIT_BOUND_BY], i)
                 if (!UNIT_IS_INACTIVE_OR_DEACTIVATING(unit_active_state(other)))
                         manager_add_job(u->manager, JOB_STOP, other, JOB_REPLACE, NULL, NULL, NULL);
 }
@@ -2104,12 +2089,12 @@ void unit_start_on_failure(Unit *u) {
 
         assert(u);
 
-        if (hashmap_size(u->dependencies[UNIT_ON_FAILURE]) <= 0)
+        if (unit_dependency_list_size(u->dependencies[UNIT_ON_FAILURE]) <= 0)
                 return;
 
         log_unit_info(u, "Triggering OnFailure= dependencies.");
 
-        HASHMAP_FOREACH_KEY(v, other, u->dependencies[UNIT_ON_FAILURE], i) {
+        UNIT_DEPENDENCY_FOREACH(v, other, u->dependencies[UNIT_ON_FAILURE], i) {
                 _cleanup_(sd_bus_error_free) sd_bus_error error = SD_BUS_ERROR_NULL;
 
                 r = manager_add_job(u->manager, JOB_START, other, u->on_failure_job_mode, NULL, &error, NULL);
@@ -2125,7 +2110,7 @@ void unit_trigger_notify(Unit *u) {
 
         assert(u);
 
-        HASHMAP_FOREACH_KEY(v, other, u->dependencies[UNIT_TRIGGERED_BY], i)
+        UNIT_DEPENDENCY_FOREACH(v, other, u->dependencies[UNIT_TRIGGERED_BY], i)
                 if (UNIT_VTABLE(other)->trigger_notify)
                         UNIT_VTABLE(other)->trigger_notify(other, u);
 }
@@ -2743,8 +2728,8 @@ static void maybe_warn_about_dependency(Unit *u, const char *other, UnitDependen
                 log_unit_warning(u, "Dependency %s=%s dropped, merged into %s", unit_dependency_to_string(dependency), strna(other), u->id);
 }
 
-static int unit_add_dependency_hashmap(
-                Hashmap **h,
+static int unit_add_dependency_list(
+                UnitDependencyList **l,
                 Unit *other,
                 UnitDependencyMask origin_mask,
                 UnitDependencyMask destination_mask) {
@@ -2752,19 +2737,15 @@ static int unit_add_dependency_hashmap(
         UnitDependencyInfo info;
         int r;
 
-        assert(h);
+        assert(l);
         assert(other);
         assert(origin_mask < _UNIT_DEPENDENCY_MASK_FULL);
         assert(destination_mask < _UNIT_DEPENDENCY_MASK_FULL);
         assert(origin_mask > 0 || destination_mask > 0);
 
-        r = hashmap_ensure_allocated(h, NULL);
-        if (r < 0)
-                return r;
-
         assert_cc(sizeof(void*) == sizeof(info));
 
-        info.data = hashmap_get(*h, other);
+        info.data = unit_dependency_list_get(*l, other);
         if (info.data) {
                 /* Entry already exists. Add in our mask. */
 
@@ -2774,16 +2755,13 @@ static int unit_add_dependency_hashmap(
 
                 info.origin_mask |= origin_mask;
                 info.destination_mask |= destination_mask;
-
-                r = hashmap_update(*h, other, info.data);
-        } else {
+        } else
                 info = (UnitDependencyInfo) {
                         .origin_mask = origin_mask,
                         .destination_mask = destination_mask,
                 };
 
-                r = hashmap_put(*h, other, info.data);
-        }
+        r = unit_dependency_list_replace(l, other, info.data);
         if (r < 0)
                 return r;
 
@@ -2848,14 +2826,14 @@ int unit_add_dependency(
                 return 0;
         }
 
-        r = unit_add_dependency_hashmap(u->dependencies + d, other, mask, 0);
+        r = unit_add_dependency_list(u->dependencies + d, other, mask, 0);
         if (r < 0)
                 return r;
         else if (r > 0)
                 noop = false;
 
         if (inverse_table[d] != _UNIT_DEPENDENCY_INVALID && inverse_table[d] != d) {
-                r = unit_add_dependency_hashmap(other->dependencies + inverse_table[d], u, 0, mask);
+                r = unit_add_dependency_list(other->dependencies + inverse_table[d], u, 0, mask);
                 if (r < 0)
                         return r;
                 else if (r > 0)
@@ -2863,13 +2841,13 @@ int unit_add_dependency(
         }
 
         if (add_reference) {
-                r = unit_add_dependency_hashmap(u->dependencies + UNIT_REFERENCES, other, mask, 0);
+                r = unit_add_dependency_list(u->dependencies + UNIT_REFERENCES, other, mask, 0);
                 if (r < 0)
                         return r;
                 else if (r > 0)
                         noop = false;
 
-                r = unit_add_dependency_hashmap(other->dependencies + UNIT_REFERENCED_BY, u, 0, mask);
+                r = unit_add_dependency_list(other->dependencies + UNIT_REFERENCED_BY, u, 0, mask);
                 if (r < 0)
                         return r;
                 else if (r > 0)
@@ -3375,26 +3353,24 @@ void unit_serialize_item_format(Unit *u, FILE *f, const char *key, const char *f
         fputc('\n', f);
 }
 
-int unit_deserialize(Unit *u, FILE *f, FDSet *fds) {
+int unit_deserialize(Unit *u, SerializationReader *reader, FDSet *fds) {
         int r;
 
         assert(u);
-        assert(f);
+        assert(reader);
         assert(fds);
 
         for (;;) {
-                _cleanup_free_ char *line = NULL;
                 CGroupIPAccountingMetric m;
                 char *l, *v;
                 size_t k;
 
-                r = read_line(f, LONG_LINE_MAX, &line);
+                r = serialization_read_line(reader, &l);
                 if (r < 0)
                         return log_error_errno(r, "Failed to read serialization line: %m");
                 if (r == 0) /* eof */
                         break;
 
-                l = strstrip(line);
                 if (isempty(l)) /* End marker */
                         break;
 
@@ -3415,7 +3391,7 @@ int unit_deserialize(Unit *u, FILE *f, FDSet *fds) {
                                 if (!j)
                                         return log_oom();
 
-                                r = job_deserialize(j, f);
+                                r = job_deserialize(j, reader);
                                 if (r < 0) {
                                         job_free(j);
                                         return r;
@@ -3700,24 +3676,21 @@ int unit_deserialize(Unit *u, FILE *f, FDSet *fds) {
         return 0;
 }
 
-int unit_deserialize_skip(FILE *f) {
+int unit_deserialize_skip(SerializationReader *reader) {
         int r;
-        assert(f);
+        assert(reader);
 
         /* Skip serialized data for this unit. We don't know what it is. */
 
         for (;;) {
-                _cleanup_free_ char *line = NULL;
                 char *l;
 
-                r = read_line(f, LONG_LINE_MAX, &line);
+                r = serialization_read_line(reader, &l);
                 if (r < 0)
                         return log_error_errno(r, "Failed to read serialization line: %m");
                 if (r == 0)
                         return 0;
 
-                l = strstrip(line);
-
                 /* End marker */
                 if (isempty(l))
                         return 1;
@@ -4748,7 +4721,7 @@ int unit_setup_exec_runtime(Unit *u) {
                 return 0;
 
         /* Try to get it from somebody else */
-        HASHMAP_FOREACH_KEY(v, other, u->dependencies[UNIT_JOINS_NAMESPACE_OF], i) {
+        UNIT_DEPENDENCY_FOREACH(v, other, u->dependencies[UNIT_JOINS_NAMESPACE_OF], i) {
                 r = exec_runtime_acquire(u->manager, NULL, other->id, false, rt);
                 if (r == 1)
                         return 1;
@@ -5126,11 +5099,11 @@ static void unit_update_dependency_mask(Unit *u, UnitDependency d, Unit *other,
 
         if (di.origin_mask == 0 && di.destination_mask == 0) {
                 /* No bit set anymore, let's drop the whole entry */
-                assert_se(hashmap_remove(u->dependencies[d], other));
+                assert_se(unit_dependency_list_remove(u->dependencies[d], other));
                 log_unit_debug(u, "%s lost dependency %s=%s", u->id, unit_dependency_to_string(d), other->id);
         } else
                 /* Mask was reduced, let's update the entry */
-                assert_se(hashmap_update(u->dependencies[d], other, di.data) == 0);
+                assert_se(unit_dependency_list_replace(&u->dependencies[d], other, di.data) == 0);
 }
 
 void unit_remove_dependencies(Unit *u, UnitDependencyMask mask) {
@@ -5153,7 +5126,7 @@ void unit_remove_dependencies(Unit *u, UnitDependencyMask mask) {
 
                         done = true;
 
-                        HASHMAP_FOREACH_KEY(di.data, other, u->dependencies[d], i) {
+                        UNIT_DEPENDENCY_FOREACH(di.data, other, u->dependencies[d], i) {
                                 UnitDependency q;
 
                                 if ((di.origin_mask & ~mask) == di.origin_mask)
@@ -5169,7 +5142,7 @@ void unit_remove_dependencies(Unit *u, UnitDependencyMask mask) {
                                 for (q = 0; q < _UNIT_DEPENDENCY_MAX; q++) {
                                         UnitDependencyInfo dj;
 
-                                        dj.data = hashmap_get(other->dependencies[q], u);
+                                        dj.data = unit_dependency_list_get(other->dependencies[q], u);
                                         if ((dj.destination_mask & ~mask) == dj.destination_mask)
                                                 continue;
                                         dj.destination_mask &= ~mask;
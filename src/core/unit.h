@@ -10,6 +10,7 @@
 #include "emergency-action.h"
 #include "install.h"
 #include "list.h"
+#include "unit-dependency-list.h"
 #include "unit-name.h"
 #include "cgroup.h"
 
@@ -87,8 +88,8 @@ typedef enum UnitDependencyMask {
         _UNIT_DEPENDENCY_MASK_FULL         = (1 << 8) - 1,
 } UnitDependencyMask;
 
-/* The Unit's dependencies[] hashmaps use this structure as value. It has the same size as a void pointer, and thus can
- * be stored directly as hashmap value, without any indirection. Note that this stores two masks, as both the origin
+/* The Unit's dependencies[] lists and the requires_mounts_for hashmap use this structure as value. It has the same size
+ * as a void pointer, and thus can be stored directly as value, without any indirection. Note that this stores two masks, as both the origin
  * and the destination of a dependency might have created it. */
 typedef union UnitDependencyInfo {
         void *data;
@@ -130,9 +131,9 @@ typedef struct Unit {
 
         Set *names;
 
-        /* For each dependency type we maintain a Hashmap whose key is the Unit* object, and the value encodes why the
+        /* For each dependency type we maintain a list of the Unit* objects, each with a value that encodes why the
          * dependency exists, using the UnitDependencyInfo type */
-        Hashmap *dependencies[_UNIT_DEPENDENCY_MAX];
+        UnitDependencyList *dependencies[_UNIT_DEPENDENCY_MAX];
 
         /* Similar, for RequiresMountsFor= path dependencies. The key is the path, the value the UnitDependencyInfo type */
         Hashmap *requires_mounts_for;
@@ -269,6 +270,9 @@ typedef struct Unit {
         CGroupMask cgroup_members_mask;
         int cgroup_inotify_wd;
 
+        /* The cgroup attributes we wrote last, attribute → value, so that unchanged values aren't written again */
+        Hashmap *cgroup_attributes;
+
         /* IP BPF Firewalling/accounting */
         int ip_accounting_ingress_map_fd;
         int ip_accounting_egress_map_fd;
@@ -283,6 +287,9 @@ typedef struct Unit {
 
         uint64_t ip_accounting_extra[_CGROUP_IP_ACCOUNTING_METRIC_MAX];
 
+        /* The counters last read by unit_get_accounting_snapshot(), to serve frequent polls from */
+        CGroupAccountingSnapshot *accounting_snapshot;
+
         /* Low-priority event source which is used to remove watched PIDs that have gone away, and subscribe to any new
          * ones which might have appeared. */
         sd_event_source *rewatch_pids_event_source;
@@ -331,6 +338,7 @@ typedef struct Unit {
         bool in_gc_queue:1;
         bool in_cgroup_realize_queue:1;
         bool in_cgroup_empty_queue:1;
+        bool in_cgroup_events_batch:1;
         bool in_target_deps_queue:1;
         bool in_stop_when_unneeded_queue:1;
 
@@ -616,7 +624,7 @@ extern const UnitVTable * const unit_vtable[_UNIT_TYPE_MAX];
 #define UNIT_HAS_CGROUP_CONTEXT(u) (UNIT_VTABLE(u)->cgroup_context_offset > 0)
 #define UNIT_HAS_KILL_CONTEXT(u) (UNIT_VTABLE(u)->kill_context_offset > 0)
 
-#define UNIT_TRIGGER(u) ((Unit*) hashmap_first_key((u)->dependencies[UNIT_TRIGGERS]))
+#define UNIT_TRIGGER(u) unit_dependency_list_first((u)->dependencies[UNIT_TRIGGERS])
 
 Unit *unit_new(Manager *m, size_t size);
 void unit_free(Unit *u);
@@ -712,8 +720,8 @@ int unit_load_related_unit(Unit *u, const char *type, Unit **_found);
 bool unit_can_serialize(Unit *u) _pure_;
 
 int unit_serialize(Unit *u, FILE *f, FDSet *fds, bool serialize_jobs);
-int unit_deserialize(Unit *u, FILE *f, FDSet *fds);
-int unit_deserialize_skip(FILE *f);
+int unit_deserialize(Unit *u, SerializationReader *reader, FDSet *fds);
+int unit_deserialize_skip(SerializationReader *reader);
 
 int unit_serialize_item(Unit *u, FILE *f, const char *key, const char *value);
 int unit_serialize_item_escaped(Unit *u, FILE *f, const char *key, const char *value);
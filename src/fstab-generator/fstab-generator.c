@@ -883,6 +883,14 @@ int main(int argc, char *argv[]) {
 
         umask(0022);
 
+        /* The kernel command line, the fstab files and whether swap is supported at all (see add_swap()) are all we
+         * look at, see generator_add_input() */
+        (void) generator_add_input("/proc/cmdline");
+        (void) generator_add_input("/proc/swaps");
+        (void) generator_add_input(fstab_path());
+        if (in_initrd())
+                (void) generator_add_input(sysroot_fstab_path());
+
         r = proc_cmdline_parse(parse_proc_cmdline_item, NULL, 0);
         if (r < 0)
                 log_warning_errno(r, "Failed to parse kernel command line, ignoring: %m");
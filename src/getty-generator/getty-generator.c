@@ -8,6 +8,7 @@
 #include "alloc-util.h"
 #include "fd-util.h"
 #include "fileio.h"
+#include "generator.h"
 #include "log.h"
 #include "mkdir.h"
 #include "path-util.h"
@@ -127,6 +128,12 @@ int main(int argc, char *argv[]) {
 
         umask(0022);
 
+        /* Everything we look at, see generator_add_input(). Whether we run in a container doesn't change. */
+        (void) generator_add_input("/proc/1/environ");
+        (void) generator_add_input("/sys/class/tty/console/active");
+        NULSTR_FOREACH(j, virtualization_consoles)
+                (void) generator_add_input(strjoina("/sys/class/tty/", j));
+
         if (detect_container() > 0) {
                 _cleanup_free_ char *container_ttys = NULL;
 
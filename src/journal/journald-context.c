@@ -130,6 +130,7 @@ static int client_context_new(Server *s, pid_t pid, ClientContext **ret) {
                 return -ENOMEM;
 
         c->pid = pid;
+        c->proc_fd = -1;
 
         c->uid = UID_INVALID;
         c->gid = GID_INVALID;
@@ -207,42 +208,121 @@ static ClientContext* client_context_free(Server *s, ClientContext *c) {
 
         client_context_reset(s, c);
 
+        safe_close(c->proc_fd);
+
         return mfree(c);
 }
 
 static void client_context_read_uid_gid(ClientContext *c, const struct ucred *ucred) {
         assert(c);
-        assert(pid_is_valid(c->pid));
 
-        /* The ucred data passed in is always the most current and accurate, if we have any. Use it. */
+        /* The ucred data passed in is always the most current and accurate, if we have any. Use it. Whatever is
+         * missing is read from /proc by client_context_read_status() below. */
         if (ucred && uid_is_valid(ucred->uid))
                 c->uid = ucred->uid;
-        else
-                (void) get_process_uid(c->pid, &c->uid);
 
         if (ucred && gid_is_valid(ucred->gid))
                 c->gid = ucred->gid;
-        else
-                (void) get_process_gid(c->pid, &c->gid);
+}
+
+static int client_context_read_status(ClientContext *c, const struct ucred *ucred) {
+        _cleanup_free_ char *allocated = NULL;
+        char buf[4096], *status = buf, *t;
+        int r;
+
+        assert(c);
+        assert(c->proc_fd >= 0);
+
+        /* Several fields come from the same file, hence read it only once */
+        r = read_virtual_file_at(c->proc_fd, "status", buf, sizeof(buf), NULL);
+        if (r == -E2BIG) {
+                r = read_full_virtual_file_at(c->proc_fd, "status", &allocated, NULL);
+                status = allocated;
+        }
+        if (r < 0)
+                return r;
+
+        if (!(ucred && uid_is_valid(ucred->uid)) &&
+            parse_proc_field(status, "Uid", WHITESPACE, &t) >= 0) {
+                (void) parse_uid(t, &c->uid);
+                free(t);
+        }
+
+        if (!(ucred && gid_is_valid(ucred->gid)) &&
+            parse_proc_field(status, "Gid", WHITESPACE, &t) >= 0) {
+                (void) parse_gid(t, &c->gid);
+                free(t);
+        }
+
+        if (parse_proc_field(status, "CapEff", WHITESPACE, &t) >= 0)
+                free_and_replace(c->capeff, t);
+
+        return 0;
 }
 
 static void client_context_read_basic(ClientContext *c) {
         char *t;
 
         assert(c);
-        assert(pid_is_valid(c->pid));
+        assert(c->proc_fd >= 0);
 
-        if (get_process_comm(c->pid, &t) >= 0)
+        if (get_process_comm_at(c->proc_fd, &t) >= 0)
                 free_and_replace(c->comm, t);
 
-        if (get_process_exe(c->pid, &t) >= 0)
+        if (get_process_exe_at(c->proc_fd, &t) >= 0)
                 free_and_replace(c->exe, t);
 
         if (get_process_cmdline(c->pid, 0, false, &t) >= 0)
                 free_and_replace(c->cmdline, t);
+}
 
-        if (get_process_capeff(c->pid, &t) >= 0)
-                free_and_replace(c->capeff, t);
+static int client_context_open_proc(ClientContext *c) {
+        int fd;
+
+        assert(c);
+        assert(pid_is_valid(c->pid));
+
+        /* All reads from /proc go through an fd to the directory of the process there. It is kept open for as long
+         * as the entry is pinned, i.e. as long as a stream client is connected, so that the refreshes for these
+         * don't have to look it up each time. */
+
+        if (c->proc_fd >= 0)
+                return 0;
+
+        fd = procfs_pid_open(c->pid);
+        if (fd < 0)
+                return fd;
+
+        c->proc_fd = fd;
+        return 1;
+}
+
+static void client_context_read_proc(ClientContext *c, const struct ucred *ucred) {
+        int opened, r;
+
+        assert(c);
+
+        opened = client_context_open_proc(c);
+        if (opened < 0)
+                return;
+
+        r = client_context_read_status(c, ucred);
+        if (IN_SET(r, -ENOENT, -ESRCH) && opened == 0) {
+                /* The process we kept the fd of is gone, but its PID might have been reused by now, let's look it
+                 * up again. */
+                c->proc_fd = safe_close(c->proc_fd);
+
+                r = client_context_open_proc(c);
+                if (r < 0)
+                        return;
+
+                (void) client_context_read_status(c, ucred);
+        }
+
+        client_context_read_basic(c);
+
+        (void) audit_session_from_proc_fd(c->proc_fd, &c->auditid);
+        (void) audit_loginuid_from_proc_fd(c->proc_fd, &c->loginuid);
 }
 
 static int client_context_read_label(
@@ -288,7 +368,10 @@ static int client_context_read_cgroup(Server *s, ClientContext *c, const char *u
         assert(c);
 
         /* Try to acquire the current cgroup path */
-        r = cg_pid_get_path_shifted(c->pid, s->cgroup_root, &t);
+        if (c->proc_fd >= 0)
+                r = cg_pid_get_path_shifted_at(c->proc_fd, s->cgroup_root, &t);
+        else
+                r = -ESRCH;
         if (r < 0 || empty_or_root(t)) {
                 /* We use the unit ID passed in as fallback if we have nothing cached yet and cg_pid_get_path_shifted()
                  * failed or process is running in a root cgroup. Zombie processes are automatically migrated to root cgroup
@@ -519,12 +602,9 @@ static void client_context_really_refresh(
                 timestamp = now(CLOCK_MONOTONIC);
 
         client_context_read_uid_gid(c, ucred);
-        client_context_read_basic(c);
+        client_context_read_proc(c, ucred);
         (void) client_context_read_label(c, label, label_size);
 
-        (void) audit_session_from_pid(c->pid, &c->auditid);
-        (void) audit_loginuid_from_pid(c->pid, &c->loginuid);
-
         (void) client_context_read_cgroup(s, c, unit_id);
         (void) client_context_read_invocation_id(s, c);
         (void) client_context_read_log_level_max(s, c);
@@ -532,6 +612,10 @@ static void client_context_really_refresh(
         (void) client_context_read_log_rate_limit_interval(c);
         (void) client_context_read_log_rate_limit_burst(c);
 
+        /* Unpinned entries are plenty, don't keep an fd open for each of them */
+        if (c->n_ref == 0)
+                c->proc_fd = safe_close(c->proc_fd);
+
         c->timestamp = timestamp;
 
         if (c->in_lru) {
@@ -746,6 +830,8 @@ ClientContext *client_context_release(Server *s, ClientContext *c) {
         if (c->n_ref > 0)
                 return NULL;
 
+        c->proc_fd = safe_close(c->proc_fd);
+
         /* The entry is not pinned anymore, let's add it to the LRU prioq if we can. If we can't we'll drop it
          * right-away */
 
@@ -17,6 +17,7 @@ struct ClientContext {
         bool in_lru;
 
         pid_t pid;
+        int proc_fd;
         uid_t uid;
         gid_t gid;
 
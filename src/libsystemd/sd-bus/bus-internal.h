@@ -95,6 +95,13 @@ struct node_vtable {
         const sd_bus_vtable *vtable;
         sd_bus_object_find_t find;
 
+        /* Pre-marshalled GetAll() replies, by object path, if SD_BUS_VTABLE_CACHE_PROPERTIES is set */
+        Hashmap *properties_cache;
+
+        /* The introspection data for the vtable, generated on first use */
+        char *introspection;
+        bool introspection_trusted;
+
         unsigned last_iteration;
 
         LIST_FIELDS(struct node_vtable, vtables);
@@ -212,6 +219,8 @@ struct sd_bus {
         bool watch_bind:1;
         bool is_monitor:1;
         bool accept_fd:1;
+        bool accept_memfd:1;
+        bool can_memfd:1;
         bool attach_timestamp:1;
         bool connected_signal:1;
 
@@ -258,7 +267,7 @@ struct sd_bus {
 
         enum bus_auth auth;
         size_t auth_rbegin;
-        struct iovec auth_iovec[3];
+        struct iovec auth_iovec[4];
         unsigned auth_index;
         char *auth_buffer;
         usec_t auth_timeout;
@@ -163,6 +163,40 @@ int introspect_write_interface(struct introspect *i, const sd_bus_vtable *v) {
         return 0;
 }
 
+int introspect_interface_to_string(const sd_bus_vtable *v, bool trusted, char **ret) {
+        struct introspect intro = {
+                .trusted = trusted,
+        };
+        int r;
+
+        assert(v);
+        assert(ret);
+
+        /* Generates just the contents of the <interface> element for the specified vtable, so that it may
+         * be cached and reused for every object implementing it. */
+
+        intro.f = open_memstream(&intro.introspection, &intro.size);
+        if (!intro.f)
+                return -ENOMEM;
+
+        (void) __fsetlocking(intro.f, FSETLOCKING_BYCALLER);
+
+        r = introspect_write_interface(&intro, v);
+        if (r < 0)
+                goto finish;
+
+        r = fflush_and_check(intro.f);
+        if (r < 0)
+                goto finish;
+
+        intro.f = safe_fclose(intro.f);
+        *ret = TAKE_PTR(intro.introspection);
+
+finish:
+        introspect_free(&intro);
+        return r;
+}
+
 int introspect_finish(struct introspect *i, sd_bus *bus, sd_bus_message *m, sd_bus_message **reply) {
         sd_bus_message *q;
         int r;
@@ -49,16 +49,23 @@
  *  ` BUS_MATCH_SENDER
  *    ` BUS_MATCH_VALUE: value == miau
  *      ` BUS_MATCH_LEAF: E
+ *
+ * The values below every compare node are hashed, hence dispatching a message costs one lookup per compare node
+ * on the way down, regardless of the number of matches. The keys are deliberately not combined across components
+ * (say interface and member in one key): a match may leave out any component, so combined keys would need a table
+ * for every subset of components that occurs, and sender= and the prefix matches need several lookups per
+ * message anyway. That would only save a few lookups per level of the tree.
  */
 
 static inline bool BUS_MATCH_IS_COMPARE(enum bus_match_node_type t) {
         return t >= BUS_MATCH_SENDER && t <= BUS_MATCH_ARG_HAS_LAST;
 }
 
-static inline bool BUS_MATCH_CAN_HASH(enum bus_match_node_type t) {
-        return (t >= BUS_MATCH_MESSAGE_TYPE && t <= BUS_MATCH_PATH) ||
-                (t >= BUS_MATCH_ARG && t <= BUS_MATCH_ARG_LAST) ||
-                (t >= BUS_MATCH_ARG_HAS && t <= BUS_MATCH_ARG_HAS_LAST);
+static inline bool BUS_MATCH_IS_PREFIX(enum bus_match_node_type t) {
+        /* Prefix matches are hashed by their pattern too, and are looked up by enumerating all prefixes of
+         * the tested string that might match */
+        return t == BUS_MATCH_PATH_NAMESPACE ||
+                (t >= BUS_MATCH_ARG_PATH && t <= BUS_MATCH_ARG_NAMESPACE_LAST);
 }
 
 static void bus_match_node_free(struct bus_match_node *node) {
@@ -89,7 +96,7 @@ static void bus_match_node_free(struct bus_match_node *node) {
 
                 if (node->parent->type == BUS_MATCH_MESSAGE_TYPE)
                         hashmap_remove(node->parent->compare.children, UINT_TO_PTR(node->value.u8));
-                else if (BUS_MATCH_CAN_HASH(node->parent->type) && node->value.str)
+                else if (BUS_MATCH_IS_COMPARE(node->parent->type) && node->value.str)
                         hashmap_remove(node->parent->compare.children, node->value.str);
 
                 free(node->value.str);
@@ -119,127 +126,166 @@ static bool bus_match_node_maybe_free(struct bus_match_node *node) {
         return true;
 }
 
-static bool value_node_test(
+static int bus_match_run_key(
+                sd_bus *bus,
                 struct bus_match_node *node,
-                enum bus_match_node_type parent_type,
-                uint8_t value_u8,
-                const char *value_str,
-                char **value_strv,
+                const char *key,
                 sd_bus_message *m) {
 
-        assert(node);
-        assert(node->type == BUS_MATCH_VALUE);
+        struct bus_match_node *found;
 
-        /* Tests parameters against this value node, doing prefix
-         * magic and stuff. */
+        found = hashmap_get(node->compare.children, key);
+        if (!found)
+                return 0;
 
-        switch (parent_type) {
+        return bus_match_run(bus, found, m);
+}
 
-        case BUS_MATCH_MESSAGE_TYPE:
-                return node->value.u8 == value_u8;
+static int bus_match_run_prefixes(
+                sd_bus *bus,
+                struct bus_match_node *node,
+                const char *test_str,
+                sd_bus_message *m) {
 
-        case BUS_MATCH_SENDER:
-                if (streq_ptr(node->value.str, value_str))
-                        return true;
+        _cleanup_free_ char *buf = NULL;
+        bool complex;
+        size_t i, n;
+        char c;
+        int r;
 
-                if (m->creds.mask & SD_BUS_CREDS_WELL_KNOWN_NAMES) {
-                        char **i;
+        assert(node);
+        assert(BUS_MATCH_IS_PREFIX(node->type));
+        assert(test_str);
+
+        /* Instead of testing every pattern against the string, look up all strings a matching pattern could
+         * consist of in the hash table. For simple patterns (path_namespace=, argNnamespace=) these are
+         * the string itself, and each prefix followed by a separator in the string, with or without that
+         * separator. For complex patterns (argNpath=) these are the string itself and each prefix up to and
+         * including a separator, plus every pattern that starts with the string if it ends in a separator
+         * itself. */
 
-                        /* on kdbus we have the well known names list
-                         * in the credentials, let's make use of that
-                         * for an accurate match */
+        complex = node->type >= BUS_MATCH_ARG_PATH && node->type <= BUS_MATCH_ARG_PATH_LAST;
+        c = node->type >= BUS_MATCH_ARG_NAMESPACE && node->type <= BUS_MATCH_ARG_NAMESPACE_LAST ? '.' : '/';
 
-                        STRV_FOREACH(i, m->creds.well_known_names)
-                                if (streq_ptr(node->value.str, *i))
-                                        return true;
+        r = bus_match_run_key(bus, node, test_str, m);
+        if (r != 0)
+                return r;
+        if (bus && bus->match_callbacks_modified)
+                return 0;
 
-                } else {
+        n = strlen(test_str);
 
-                        /* If we don't have kdbus, we don't know the
-                         * well-known names of the senders. In that,
-                         * let's just hope that dbus-daemon doesn't
-                         * send us stuff we didn't want. */
+        buf = new(char, n + 1);
+        if (!buf)
+                return -ENOMEM;
 
-                        if (node->value.str[0] != ':' && value_str && value_str[0] == ':')
-                                return true;
-                }
+        for (i = 0; i < n; i++) {
+                if (test_str[i] != c)
+                        continue;
 
-                return false;
+                if (!complex) {
+                        memcpy(buf, test_str, i);
+                        buf[i] = 0;
 
-        case BUS_MATCH_DESTINATION:
-        case BUS_MATCH_INTERFACE:
-        case BUS_MATCH_MEMBER:
-        case BUS_MATCH_PATH:
-        case BUS_MATCH_ARG ... BUS_MATCH_ARG_LAST:
+                        r = bus_match_run_key(bus, node, buf, m);
+                        if (r != 0)
+                                return r;
+                        if (bus && bus->match_callbacks_modified)
+                                return 0;
+                }
 
-                if (value_str)
-                        return streq_ptr(node->value.str, value_str);
+                /* The full string has been looked up already */
+                if (i + 1 >= n)
+                        break;
 
-                return false;
+                memcpy(buf, test_str, i + 1);
+                buf[i + 1] = 0;
 
-        case BUS_MATCH_ARG_HAS ... BUS_MATCH_ARG_HAS_LAST: {
-                char **i;
+                r = bus_match_run_key(bus, node, buf, m);
+                if (r != 0)
+                        return r;
+                if (bus && bus->match_callbacks_modified)
+                        return 0;
+        }
 
-                STRV_FOREACH(i, value_strv)
-                        if (streq_ptr(node->value.str, *i))
-                                return true;
+        if (complex && n > 0 && test_str[n - 1] == c) {
+                struct bus_match_node *found;
+                Iterator j;
 
-                return false;
+                HASHMAP_FOREACH(found, node->compare.children, j) {
+                        if (!startswith(found->value.str, test_str) || streq(found->value.str, test_str))
+                                continue;
+
+                        r = bus_match_run(bus, found, m);
+                        if (r != 0)
+                                return r;
+                        if (bus && bus->match_callbacks_modified)
+                                return 0;
+                }
         }
 
-        case BUS_MATCH_ARG_NAMESPACE ... BUS_MATCH_ARG_NAMESPACE_LAST:
-                if (value_str)
-                        return namespace_simple_pattern(node->value.str, value_str);
+        return 0;
+}
 
-                return false;
+static int bus_match_run_senders(
+                sd_bus *bus,
+                struct bus_match_node *node,
+                const char *test_str,
+                sd_bus_message *m) {
 
-        case BUS_MATCH_PATH_NAMESPACE:
-                return path_simple_pattern(node->value.str, value_str);
+        struct bus_match_node *found;
+        Iterator i;
+        int r;
 
-        case BUS_MATCH_ARG_PATH ... BUS_MATCH_ARG_PATH_LAST:
-                if (value_str)
-                        return path_complex_pattern(node->value.str, value_str);
+        assert(node);
+        assert(node->type == BUS_MATCH_SENDER);
 
-                return false;
+        /* The exact sender name is a plain hash lookup. On top of that, a well-known name in a sender= match
+         * has to match messages from the unique name currently owning it. If the message carries the
+         * owned well-known names, look those up. Otherwise we cannot resolve ownership here, hence let all
+         * well-known name matches through whenever the sender is a unique name, the way the bus driver
+         * would have filtered for us already. */
 
-        default:
-                assert_not_reached("Invalid node type");
+        if (test_str) {
+                r = bus_match_run_key(bus, node, test_str, m);
+                if (r != 0)
+                        return r;
+                if (bus && bus->match_callbacks_modified)
+                        return 0;
         }
-}
 
-static bool value_node_same(
-                struct bus_match_node *node,
-                enum bus_match_node_type parent_type,
-                uint8_t value_u8,
-                const char *value_str) {
+        if (m->creds.mask & SD_BUS_CREDS_WELL_KNOWN_NAMES) {
+                char **name;
 
-        /* Tests parameters against this value node, not doing prefix
-         * magic and stuff, i.e. this one actually compares the match
-         * itself. */
+                STRV_FOREACH(name, m->creds.well_known_names) {
+                        if (streq_ptr(*name, test_str))
+                                continue;
 
-        assert(node);
-        assert(node->type == BUS_MATCH_VALUE);
+                        r = bus_match_run_key(bus, node, *name, m);
+                        if (r != 0)
+                                return r;
+                        if (bus && bus->match_callbacks_modified)
+                                return 0;
+                }
 
-        switch (parent_type) {
+                return 0;
+        }
 
-        case BUS_MATCH_MESSAGE_TYPE:
-                return node->value.u8 == value_u8;
+        if (!test_str || test_str[0] != ':')
+                return 0;
 
-        case BUS_MATCH_SENDER:
-        case BUS_MATCH_DESTINATION:
-        case BUS_MATCH_INTERFACE:
-        case BUS_MATCH_MEMBER:
-        case BUS_MATCH_PATH:
-        case BUS_MATCH_ARG ... BUS_MATCH_ARG_LAST:
-        case BUS_MATCH_ARG_HAS ... BUS_MATCH_ARG_HAS_LAST:
-        case BUS_MATCH_ARG_NAMESPACE ... BUS_MATCH_ARG_NAMESPACE_LAST:
-        case BUS_MATCH_PATH_NAMESPACE:
-        case BUS_MATCH_ARG_PATH ... BUS_MATCH_ARG_PATH_LAST:
-                return streq(node->value.str, value_str);
+        HASHMAP_FOREACH(found, node->compare.children, i) {
+                if (found->value.str[0] == ':')
+                        continue;
 
-        default:
-                assert_not_reached("Invalid node type");
+                r = bus_match_run(bus, found, m);
+                if (r != 0)
+                        return r;
+                if (bus && bus->match_callbacks_modified)
+                        return 0;
         }
+
+        return 0;
 }
 
 int bus_match_run(
@@ -248,6 +294,7 @@ int bus_match_run(
                 sd_bus_message *m) {
 
         _cleanup_strv_free_ char **test_strv = NULL;
+        struct bus_match_node *found;
         const char *test_str = NULL;
         uint8_t test_u8 = 0;
         int r;
@@ -374,52 +421,46 @@ int bus_match_run(
                 assert_not_reached("Unknown match type.");
         }
 
-        if (BUS_MATCH_CAN_HASH(node->type)) {
-                struct bus_match_node *found;
-
-                /* Lookup via hash table, nice! So let's jump directly. */
-
-                if (test_str)
-                        found = hashmap_get(node->compare.children, test_str);
-                else if (test_strv) {
-                        char **i;
-
-                        STRV_FOREACH(i, test_strv) {
-                                found = hashmap_get(node->compare.children, *i);
-                                if (found) {
-                                        r = bus_match_run(bus, found, m);
-                                        if (r != 0)
-                                                return r;
-                                }
-                        }
-
-                        found = NULL;
-                } else if (node->type == BUS_MATCH_MESSAGE_TYPE)
-                        found = hashmap_get(node->compare.children, UINT_TO_PTR(test_u8));
-                else
-                        found = NULL;
+        /* Lookup via hash table, nice! So let's jump directly. */
 
-                if (found) {
-                        r = bus_match_run(bus, found, m);
+        if (BUS_MATCH_IS_PREFIX(node->type)) {
+                if (test_str) {
+                        r = bus_match_run_prefixes(bus, node, test_str, m);
                         if (r != 0)
                                 return r;
                 }
-        } else {
-                struct bus_match_node *c;
 
-                /* No hash table, so let's iterate manually... */
-
-                for (c = node->child; c; c = c->next) {
-                        if (!value_node_test(c, node->type, test_u8, test_str, test_strv, m))
-                                continue;
+                found = NULL;
+        } else if (node->type == BUS_MATCH_SENDER) {
+                r = bus_match_run_senders(bus, node, test_str, m);
+                if (r != 0)
+                        return r;
 
-                        r = bus_match_run(bus, c, m);
-                        if (r != 0)
-                                return r;
+                found = NULL;
+        } else if (test_str)
+                found = hashmap_get(node->compare.children, test_str);
+        else if (test_strv) {
+                char **i;
 
-                        if (bus && bus->match_callbacks_modified)
-                                return 0;
+                STRV_FOREACH(i, test_strv) {
+                        found = hashmap_get(node->compare.children, *i);
+                        if (found) {
+                                r = bus_match_run(bus, found, m);
+                                if (r != 0)
+                                        return r;
+                        }
                 }
+
+                found = NULL;
+        } else if (node->type == BUS_MATCH_MESSAGE_TYPE)
+                found = hashmap_get(node->compare.children, UINT_TO_PTR(test_u8));
+        else
+                found = NULL;
+
+        if (found) {
+                r = bus_match_run(bus, found, m);
+                if (r != 0)
+                        return r;
         }
 
         if (bus && bus->match_callbacks_modified)
@@ -453,12 +494,8 @@ static int bus_match_add_compare_value(
 
                 if (t == BUS_MATCH_MESSAGE_TYPE)
                         n = hashmap_get(c->compare.children, UINT_TO_PTR(value_u8));
-                else if (BUS_MATCH_CAN_HASH(t))
+                else
                         n = hashmap_get(c->compare.children, value_str);
-                else {
-                        for (n = c->child; n && !value_node_same(n, t, value_u8, value_str); n = n->next)
-                                ;
-                }
 
                 if (n) {
                         *ret = n;
@@ -481,18 +518,10 @@ static int bus_match_add_compare_value(
                         c->next->prev = c;
                 where->child = c;
 
-                if (t == BUS_MATCH_MESSAGE_TYPE) {
-                        c->compare.children = hashmap_new(NULL);
-                        if (!c->compare.children) {
-                                r = -ENOMEM;
-                                goto fail;
-                        }
-                } else if (BUS_MATCH_CAN_HASH(t)) {
-                        c->compare.children = hashmap_new(&string_hash_ops);
-                        if (!c->compare.children) {
-                                r = -ENOMEM;
-                                goto fail;
-                        }
+                c->compare.children = hashmap_new(t == BUS_MATCH_MESSAGE_TYPE ? NULL : &string_hash_ops);
+                if (!c->compare.children) {
+                        r = -ENOMEM;
+                        goto fail;
                 }
         }
 
@@ -513,21 +542,13 @@ static int bus_match_add_compare_value(
         }
 
         n->parent = c;
-        if (c->compare.children) {
-
-                if (t == BUS_MATCH_MESSAGE_TYPE)
-                        r = hashmap_put(c->compare.children, UINT_TO_PTR(value_u8), n);
-                else
-                        r = hashmap_put(c->compare.children, n->value.str, n);
 
-                if (r < 0)
-                        goto fail;
-        } else {
-                n->next = c->child;
-                if (n->next)
-                        n->next->prev = n;
-                c->child = n;
-        }
+        if (t == BUS_MATCH_MESSAGE_TYPE)
+                r = hashmap_put(c->compare.children, UINT_TO_PTR(value_u8), n);
+        else
+                r = hashmap_put(c->compare.children, n->value.str, n);
+        if (r < 0)
+                goto fail;
 
         *ret = n;
         return 1;
@@ -566,12 +587,8 @@ static int bus_match_find_compare_value(
 
         if (t == BUS_MATCH_MESSAGE_TYPE)
                 n = hashmap_get(c->compare.children, UINT_TO_PTR(value_u8));
-        else if (BUS_MATCH_CAN_HASH(t))
+        else
                 n = hashmap_get(c->compare.children, value_str);
-        else {
-                for (n = c->child; n && !value_node_same(n, t, value_u8, value_str); n = n->next)
-                        ;
-        }
 
         if (n) {
                 *ret = n;
@@ -1066,7 +1083,7 @@ void bus_match_free(struct bus_match_node *node) {
         if (!node)
                 return;
 
-        if (BUS_MATCH_CAN_HASH(node->type)) {
+        if (BUS_MATCH_IS_COMPARE(node->type)) {
                 Iterator i;
 
                 HASHMAP_FOREACH(c, node->compare.children, i)
@@ -1159,7 +1176,7 @@ void bus_match_dump(struct bus_match_node *node, unsigned level) {
         else
                 putchar('\n');
 
-        if (BUS_MATCH_CAN_HASH(node->type)) {
+        if (BUS_MATCH_IS_COMPARE(node->type)) {
                 Iterator i;
 
                 HASHMAP_FOREACH(c, node->compare.children, i)
@@ -18,6 +18,7 @@
 #include "fd-util.h"
 #include "io-util.h"
 #include "memfd-util.h"
+#include "mempool.h"
 #include "string-util.h"
 #include "strv.h"
 #include "time-util.h"
@@ -26,6 +27,20 @@
 
 static int message_append_basic(sd_bus_message *m, char type, const void *p, const void **stored);
 
+/* Locally constructed messages are allocated together with some space for the header fields and the first
+ * body part, which is enough for most method calls, replies and signals. On the main thread the allocations
+ * are recycled through a memory pool, so that building a small message usually needs no malloc() at all. */
+#define MESSAGE_INLINE_HEADER_SIZE 256
+#define MESSAGE_INLINE_BODY_SIZE 512
+
+struct message_tile {
+        sd_bus_message message;
+        uint64_t header[MESSAGE_INLINE_HEADER_SIZE / sizeof(uint64_t)];
+        uint64_t body[MESSAGE_INLINE_BODY_SIZE / sizeof(uint64_t)];
+};
+
+DEFINE_MEMPOOL(message_pool, struct message_tile, 16);
+
 static void *adjust_pointer(const void *p, void *old_base, size_t sz, void *new_base) {
 
         if (p == NULL)
@@ -107,7 +122,9 @@ static void message_reset_containers(sd_bus_message *m) {
         while (m->n_containers > 0)
                 message_free_last_container(m);
 
-        m->containers = mfree(m->containers);
+        if (m->containers != m->containers_fixed)
+                free(m->containers);
+        m->containers = NULL;
         m->containers_allocated = 0;
         m->root_container.index = 0;
 }
@@ -131,12 +148,51 @@ static sd_bus_message* message_free(sd_bus_message *m) {
         if (m->iovec != m->iovec_fixed)
                 free(m->iovec);
 
+        free(m->wire_header);
+        safe_close(m->wire_body_memfd);
+
         message_reset_containers(m);
         assert(m->n_containers == 0);
         message_free_last_container(m);
 
         bus_creds_done(&m->creds);
-        return mfree(m);
+
+        if (m->from_pool)
+                mempool_free_tile(&message_pool, m);
+        else
+                free(m);
+
+        return NULL;
+}
+
+static int message_grow_containers(sd_bus_message *m) {
+        struct bus_container *n;
+
+        assert(m);
+
+        /* Makes sure we have space for one more container. The first few are kept in the message object
+         * itself. */
+
+        if (!m->containers) {
+                m->containers = m->containers_fixed;
+                m->containers_allocated = ELEMENTSOF(m->containers_fixed);
+        }
+
+        if (m->n_containers < m->containers_allocated)
+                return 0;
+
+        if (m->containers != m->containers_fixed)
+                return GREEDY_REALLOC(m->containers, m->containers_allocated, m->n_containers + 1) ? 0 : -ENOMEM;
+
+        n = new(struct bus_container, m->containers_allocated * 2);
+        if (!n)
+                return -ENOMEM;
+
+        memcpy(n, m->containers_fixed, sizeof(m->containers_fixed));
+        m->containers = n;
+        m->containers_allocated *= 2;
+
+        return 0;
 }
 
 static void *message_extend_fields(sd_bus_message *m, size_t align, size_t sz, bool add_offset) {
@@ -163,16 +219,20 @@ static void *message_extend_fields(sd_bus_message *m, size_t align, size_t sz, b
                 np = realloc(m->header, ALIGN8(new_size));
                 if (!np)
                         goto poison;
-        } else {
+        } else if (ALIGN8(new_size) <= m->header_allocated)
                 /* Initially, the header is allocated as part of
-                 * the sd_bus_message itself, let's replace it by
-                 * dynamic data */
+                 * the sd_bus_message itself, and as long as the
+                 * fields fit in there we stay there */
+                np = m->header;
+        else {
+                /* Let's replace it by dynamic data */
 
                 np = malloc(ALIGN8(new_size));
                 if (!np)
                         goto poison;
 
-                memcpy(np, m->header, sizeof(struct bus_header));
+                memcpy(np, m->header, old_size);
+                m->free_header = true;
         }
 
         /* Zero out padding */
@@ -191,8 +251,6 @@ static void *message_extend_fields(sd_bus_message *m, size_t align, size_t sz, b
         m->sender = adjust_pointer(m->sender, op, old_size, m->header);
         m->error.name = adjust_pointer(m->error.name, op, old_size, m->header);
 
-        m->free_header = true;
-
         if (add_offset) {
                 if (m->n_header_offsets >= ELEMENTSOF(m->header_offsets))
                         goto poison;
@@ -463,6 +521,7 @@ int bus_message_from_header(
         m->sealed = true;
         m->header = header;
         m->header_accessible = header_accessible;
+        m->wire_body_memfd = -1;
         m->footer = footer;
         m->footer_accessible = footer_accessible;
 
@@ -576,25 +635,39 @@ _public_ int sd_bus_message_new(
                 sd_bus_message **m,
                 uint8_t type) {
 
+        struct message_tile *tile;
         sd_bus_message *t;
+        bool use_pool;
 
         assert_return(bus, -ENOTCONN);
         assert_return(bus->state != BUS_UNSET, -ENOTCONN);
         assert_return(m, -EINVAL);
         assert_return(type < _SD_BUS_MESSAGE_TYPE_MAX, -EINVAL);
 
-        t = malloc0(ALIGN(sizeof(sd_bus_message)) + sizeof(struct bus_header));
-        if (!t)
+        /* Padding in the inline header and body is zeroed as it is appended, hence only the message object
+         * and the fixed header need to be initialized here. */
+        use_pool = mempool_enabled();
+        tile = use_pool ? mempool_alloc_tile(&message_pool) : new(struct message_tile, 1);
+        if (!tile)
                 return -ENOMEM;
 
+        t = &tile->message;
+        memzero(t, sizeof(sd_bus_message));
+        memzero(tile->header, sizeof(struct bus_header));
+
         t->n_ref = 1;
         t->bus = sd_bus_ref(bus);
-        t->header = (struct bus_header*) ((uint8_t*) t + ALIGN(sizeof(struct sd_bus_message)));
+        t->from_pool = use_pool;
+        t->header = (struct bus_header*) tile->header;
+        t->header_allocated = sizeof(tile->header);
+        t->inline_body = tile->body;
+        t->inline_body_allocated = sizeof(tile->body);
         t->header->endian = BUS_NATIVE_ENDIAN;
         t->header->type = type;
         t->header->version = bus->message_version;
         t->allow_fds = bus->can_fds || !IN_SET(bus->state, BUS_HELLO, BUS_RUNNING);
         t->root_container.need_offsets = BUS_MESSAGE_IS_GVARIANT(t);
+        t->wire_body_memfd = -1;
 
         if (bus->allow_interactive_authorization)
                 t->header->flags |= BUS_MESSAGE_ALLOW_INTERACTIVE_AUTHORIZATION;
@@ -1238,11 +1311,23 @@ static int part_make_space(
         if (m->poisoned)
                 return -ENOMEM;
 
-        if (part->allocated == 0 || sz > part->allocated) {
+        if (part->allocated == 0 && m->inline_body && sz <= m->inline_body_allocated) {
+                /* The first part that fits gets the inline space of the message */
+                part->data = TAKE_PTR(m->inline_body);
+                part->allocated = m->inline_body_allocated;
+
+        } else if (part->allocated == 0 || sz > part->allocated) {
                 size_t new_allocated;
 
                 new_allocated = sz > 0 ? 2 * sz : 64;
-                n = realloc(part->data, new_allocated);
+
+                if (part->allocated > 0 && !part->free_this) {
+                        /* Outgrew the inline space, move to dynamic data */
+                        n = malloc(new_allocated);
+                        if (n)
+                                memcpy(n, part->data, part->size);
+                } else
+                        n = realloc(part->data, new_allocated);
                 if (!n) {
                         m->poisoned = true;
                         return -ENOMEM;
@@ -2018,9 +2103,10 @@ _public_ int sd_bus_message_open_container(
         assert_return(!m->poisoned, -ESTALE);
 
         /* Make sure we have space for one more container */
-        if (!GREEDY_REALLOC(m->containers, m->containers_allocated, m->n_containers + 1)) {
+        r = message_grow_containers(m);
+        if (r < 0) {
                 m->poisoned = true;
-                return -ENOMEM;
+                return r;
         }
 
         c = message_get_last_container(m);
@@ -4093,8 +4179,9 @@ _public_ int sd_bus_message_enter_container(sd_bus_message *m,
         if (m->n_containers >= BUS_CONTAINER_DEPTH)
                 return -EBADMSG;
 
-        if (!GREEDY_REALLOC(m->containers, m->containers_allocated, m->n_containers + 1))
-                return -ENOMEM;
+        r = message_grow_containers(m);
+        if (r < 0)
+                return r;
 
         if (message_end_of_signature(m))
                 return -ENXIO;
@@ -5124,11 +5211,57 @@ static int message_skip_fields(
         }
 }
 
+static int message_take_body_memfd(sd_bus_message *m, uint32_t size) {
+        uint64_t real_size;
+        int fd, r;
+
+        assert(m);
+
+        /* The body was passed out-of-band, as sealed memfd appended to the fds of the message. Use it as the
+         * one and only body part, it is mapped lazily when the body is read. */
+
+        if (m->body_size > 0 || m->n_fds <= 0)
+                return -EBADMSG;
+
+        if (size <= 0 ||
+            BUS_MESSAGE_BODY_BEGIN(m) + (size_t) size > BUS_MESSAGE_SIZE_MAX)
+                return -EBADMSG;
+
+        fd = m->fds[m->n_fds - 1];
+
+        r = memfd_get_sealed(fd);
+        if (r < 0)
+                return r;
+        if (r == 0)
+                return -EBADMSG;
+
+        r = memfd_get_size(fd, &real_size);
+        if (r < 0)
+                return r;
+        if (real_size != size)
+                return -EBADMSG;
+
+        m->n_fds--;
+
+        m->body = (struct bus_body_part) {
+                .memfd = fd,
+                .size = size,
+                .sealed = true,
+        };
+        m->n_body_parts = 1;
+
+        m->body_size = m->user_body_size = size;
+
+        return 0;
+}
+
 int bus_message_parse_fields(sd_bus_message *m) {
         size_t ri;
         int r;
         uint32_t unix_fds = 0;
         bool unix_fds_set = false;
+        uint32_t body_memfd_size = 0;
+        bool body_memfd_set = false;
         void *offsets = NULL;
         unsigned n_offsets = 0;
         size_t sz = 0;
@@ -5424,6 +5557,23 @@ int bus_message_parse_fields(sd_bus_message *m) {
                         unix_fds_set = true;
                         break;
 
+                case BUS_MESSAGE_HEADER_SYSTEMD_BODY_MEMFD:
+                        if (BUS_MESSAGE_IS_GVARIANT(m) || !m->bus->can_memfd)
+                                return -EBADMSG;
+
+                        if (body_memfd_set)
+                                return -EBADMSG;
+
+                        if (!streq(signature, "u"))
+                                return -EBADMSG;
+
+                        r = message_peek_field_uint32(m, &ri, item_size, &body_memfd_size);
+                        if (r < 0)
+                                return -EBADMSG;
+
+                        body_memfd_set = true;
+                        break;
+
                 default:
                         if (!BUS_MESSAGE_IS_GVARIANT(m))
                                 r = message_skip_fields(m, &ri, (uint32_t) -1, (const char **) &signature);
@@ -5435,6 +5585,12 @@ int bus_message_parse_fields(sd_bus_message *m) {
                 i++;
         }
 
+        if (body_memfd_set) {
+                r = message_take_body_memfd(m, body_memfd_size);
+                if (r < 0)
+                        return r;
+        }
+
         if (m->n_fds != unix_fds)
                 return -EBADMSG;
 
@@ -5549,6 +5705,74 @@ int bus_message_get_blob(sd_bus_message *m, void **buffer, size_t *sz) {
         return 0;
 }
 
+int bus_message_copy_body(sd_bus_message *m, size_t begin, size_t end, void **ret) {
+        struct bus_body_part *part;
+        size_t i, offset = 0;
+        uint8_t *p;
+        int r;
+
+        assert(m);
+        assert(begin <= end);
+        assert(end <= m->body_size);
+        assert(ret);
+
+        /* Copies out a range of the (possibly still unsealed) body of a message, for example to replay it
+         * later with bus_message_append_body(). */
+
+        p = malloc(MAX(end - begin, 1U));
+        if (!p)
+                return -ENOMEM;
+
+        MESSAGE_FOREACH_PART(part, i, m) {
+                size_t a, b;
+
+                a = MAX(offset, begin);
+                b = MIN(offset + part->size, end);
+
+                if (a < b) {
+                        r = bus_body_part_map(part);
+                        if (r < 0) {
+                                free(p);
+                                return r;
+                        }
+
+                        memcpy(p + a - begin, (uint8_t*) part->data + a - offset, b - a);
+                }
+
+                offset += part->size;
+                if (offset >= end)
+                        break;
+        }
+
+        *ret = p;
+        return 0;
+}
+
+int bus_message_append_body(sd_bus_message *m, size_t align, const void *p, size_t sz) {
+        void *a;
+
+        assert(m);
+        assert(p || sz == 0);
+
+        /* Appends pre-marshalled data to the body of the message, at the current position in the open
+         * containers. The caller has to make sure the data is valid in the current context, and that it
+         * doesn't reference any file descriptors. */
+
+        if (m->sealed)
+                return -EPERM;
+        if (m->poisoned)
+                return -ESTALE;
+        if (sz == 0)
+                return 0;
+
+        a = message_extend_body(m, align, sz, false, false);
+        if (!a)
+                return -ENOMEM;
+
+        memcpy(a, p, sz);
+        return 0;
+}
+
 int bus_message_read_strv_extend(sd_bus_message *m, char ***l) {
         const char *s;
         int r;
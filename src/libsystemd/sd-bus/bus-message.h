@@ -88,6 +88,7 @@ struct sd_bus_message {
         bool free_header:1;
         bool free_fds:1;
         bool poisoned:1;
+        bool from_pool:1;
 
         /* The first and last bytes of the message */
         struct bus_header *header;
@@ -115,11 +116,24 @@ struct sd_bus_message {
         struct bus_container root_container, *containers;
         size_t n_containers;
         size_t containers_allocated;
+        struct bus_container containers_fixed[4];
+
+        /* Space allocated along with the message object, for the header fields and the first body part,
+         * so that small messages may be built without further allocations */
+        size_t header_allocated;
+        void *inline_body;
+        size_t inline_body_allocated;
 
         struct iovec *iovec;
         struct iovec iovec_fixed[2];
         unsigned n_iovec;
 
+        /* If the body is passed to the peer as sealed memfd, the header as written to the socket and the
+         * memfd carrying the body */
+        void *wire_header;
+        size_t wire_header_size;
+        int wire_body_memfd;
+
         char *peeked_signature;
 
         /* If set replies to this message must carry the signature
@@ -180,6 +194,9 @@ static inline bool BUS_MESSAGE_IS_GVARIANT(sd_bus_message *m) {
 int bus_message_get_blob(sd_bus_message *m, void **buffer, size_t *sz);
 int bus_message_read_strv_extend(sd_bus_message *m, char ***l);
 
+int bus_message_copy_body(sd_bus_message *m, size_t begin, size_t end, void **ret);
+int bus_message_append_body(sd_bus_message *m, size_t align, const void *p, size_t sz);
+
 int bus_message_from_header(
                 sd_bus *bus,
                 void *header,
@@ -718,7 +718,80 @@ static int vtable_append_one_property(
         return 0;
 }
 
-static int vtable_append_all_properties(
+/* The entries are keyed by the object path, in a table of the vtable they were generated for. Whoever puts a
+ * different object at a path has to say so, by emitting InterfacesAdded/InterfacesRemoved or by calling
+ * sd_bus_invalidate_properties_cache(). The userdata returned by find() is not compared, as a new object may well
+ * be allocated at the address of the one it replaces. */
+struct properties_cache_entry {
+        char *path;
+        void *data;
+        size_t size;
+};
+
+static struct properties_cache_entry* properties_cache_entry_free(struct properties_cache_entry *e) {
+        if (!e)
+                return NULL;
+
+        free(e->path);
+        free(e->data);
+        return mfree(e);
+}
+
+DEFINE_TRIVIAL_CLEANUP_FUNC(struct properties_cache_entry*, properties_cache_entry_free);
+
+DEFINE_PRIVATE_HASH_OPS_WITH_VALUE_DESTRUCTOR(properties_cache_hash_ops, char, string_hash_func, string_compare_func,
+                                              struct properties_cache_entry, properties_cache_entry_free);
+
+static void node_vtable_invalidate_properties(struct node_vtable *c, const char *path) {
+        assert(c);
+        assert(path);
+
+        properties_cache_entry_free(hashmap_remove(c->properties_cache, path));
+}
+
+static int node_vtable_cache_properties(
+                struct node_vtable *c,
+                const char *path,
+                sd_bus_message *reply,
+                size_t begin,
+                size_t end) {
+
+        _cleanup_(properties_cache_entry_freep) struct properties_cache_entry *e = NULL;
+        int r;
+
+        assert(c);
+        assert(path);
+        assert(reply);
+
+        r = hashmap_ensure_allocated(&c->properties_cache, &properties_cache_hash_ops);
+        if (r < 0)
+                return r;
+
+        e = new0(struct properties_cache_entry, 1);
+        if (!e)
+                return -ENOMEM;
+
+        e->path = strdup(path);
+        if (!e->path)
+                return -ENOMEM;
+
+        r = bus_message_copy_body(reply, begin, end, &e->data);
+        if (r < 0)
+                return r;
+
+        e->size = end - begin;
+
+        node_vtable_invalidate_properties(c, path);
+
+        r = hashmap_put(c->properties_cache, e->path, e);
+        if (r < 0)
+                return r;
+
+        TAKE_PTR(e);
+        return 0;
+}
+
+static int vtable_append_all_properties_uncached(
                 sd_bus *bus,
                 sd_bus_message *reply,
                 const char *path,
@@ -729,14 +802,6 @@ static int vtable_append_all_properties(
         const sd_bus_vtable *v;
         int r;
 
-        assert(bus);
-        assert(reply);
-        assert(path);
-        assert(c);
-
-        if (c->vtable[0].flags & SD_BUS_VTABLE_HIDDEN)
-                return 1;
-
         for (v = c->vtable+1; v->type != _SD_BUS_VTABLE_END; v++) {
                 if (!IN_SET(v->type, _SD_BUS_VTABLE_PROPERTY, _SD_BUS_VTABLE_WRITABLE_PROPERTY))
                         continue;
@@ -757,6 +822,59 @@ static int vtable_append_all_properties(
         return 1;
 }
 
+static int vtable_append_all_properties(
+                sd_bus *bus,
+                sd_bus_message *reply,
+                const char *path,
+                struct node_vtable *c,
+                void *userdata,
+                sd_bus_error *error) {
+
+        struct properties_cache_entry *e;
+        size_t begin, end;
+        int r;
+
+        assert(bus);
+        assert(reply);
+        assert(path);
+        assert(c);
+
+        if (c->vtable[0].flags & SD_BUS_VTABLE_HIDDEN)
+                return 1;
+
+        /* The gvariant marshalling keeps offset tables around which we cannot replay, hence cache only
+         * for dbus1 messages. */
+        if (!(c->vtable[0].flags & SD_BUS_VTABLE_CACHE_PROPERTIES) || BUS_MESSAGE_IS_GVARIANT(reply))
+                return vtable_append_all_properties_uncached(bus, reply, path, c, userdata, error);
+
+        e = hashmap_get(c->properties_cache, path);
+        if (e) {
+                r = bus_message_append_body(reply, 8, e->data, e->size);
+                if (r < 0)
+                        return r;
+
+                return 1;
+        }
+
+        /* Dict entries are always 8-byte aligned, and all alignment within them is relative to that, hence
+         * the marshalled entries may be replayed at any other 8-byte boundary later on. */
+        begin = ALIGN8(reply->body_size);
+
+        r = vtable_append_all_properties_uncached(bus, reply, path, c, userdata, error);
+        if (r <= 0)
+                return r;
+
+        end = reply->body_size;
+        if (end < begin) /* nothing appended */
+                begin = end;
+
+        r = node_vtable_cache_properties(c, path, reply, begin, end);
+        if (r < 0)
+                return r;
+
+        return 1;
+}
+
 static int property_get_all_callbacks_run(
                 sd_bus *bus,
                 sd_bus_message *m,
@@ -883,6 +1001,30 @@ static int bus_node_exists(
         return 0;
 }
 
+static int node_vtable_get_introspection(sd_bus *bus, struct node_vtable *c, const char **ret) {
+        int r;
+
+        assert(bus);
+        assert(c);
+        assert(ret);
+
+        /* The introspection data of a vtable only depends on whether the connection is trusted, hence
+         * generate it once and reuse it for all objects it is registered for. */
+
+        if (!c->introspection || c->introspection_trusted != bus->trusted) {
+                c->introspection = mfree(c->introspection);
+
+                r = introspect_interface_to_string(c->vtable, bus->trusted, &c->introspection);
+                if (r < 0)
+                        return r;
+
+                c->introspection_trusted = bus->trusted;
+        }
+
+        *ret = c->introspection;
+        return 0;
+}
+
 static int process_introspect(
                 sd_bus *bus,
                 sd_bus_message *m,
@@ -893,7 +1035,7 @@ static int process_introspect(
         _cleanup_(sd_bus_error_free) sd_bus_error error = SD_BUS_ERROR_NULL;
         _cleanup_(sd_bus_message_unrefp) sd_bus_message *reply = NULL;
         _cleanup_set_free_free_ Set *s = NULL;
-        const char *previous_interface = NULL;
+        const char *previous_interface = NULL, *x;
         struct introspect intro;
         struct node_vtable *c;
         bool empty;
@@ -949,10 +1091,12 @@ static int process_introspect(
                         fprintf(intro.f, " <interface name=\"%s\">\n", c->interface);
                 }
 
-                r = introspect_write_interface(&intro, c->vtable);
+                r = node_vtable_get_introspection(bus, c, &x);
                 if (r < 0)
                         goto finish;
 
+                fputs(x, intro.f);
+
                 previous_interface = c->interface;
         }
 
@@ -1771,6 +1915,16 @@ static int add_object_vtable_internal(
                                 goto fail;
                         }
 
+                        /* Cached properties must either never change, or tell us when they do, and may
+                         * not carry file descriptors, which cannot be replayed. */
+                        if ((vtable[0].flags & SD_BUS_VTABLE_CACHE_PROPERTIES) &&
+                            !(v->flags & (SD_BUS_VTABLE_HIDDEN|SD_BUS_VTABLE_PROPERTY_EXPLICIT)) &&
+                            (!(v->flags & (SD_BUS_VTABLE_PROPERTY_CONST|SD_BUS_VTABLE_PROPERTY_EMITS_CHANGE|SD_BUS_VTABLE_PROPERTY_EMITS_INVALIDATION)) ||
+                             strchr(v->x.property.signature, SD_BUS_TYPE_UNIX_FD))) {
+                                r = -EINVAL;
+                                goto fail;
+                        }
+
                         m = new0(struct vtable_member, 1);
                         if (!m) {
                                 r = -ENOMEM;
@@ -1944,6 +2098,8 @@ static int emit_properties_changed_on_interface(
                 if (!streq(c->interface, interface))
                         continue;
 
+                node_vtable_invalidate_properties(c, path);
+
                 r = node_vtable_get_userdata(bus, path, c, &u, &error);
                 if (r < 0)
                         return r;
@@ -2182,6 +2338,64 @@ _public_ int sd_bus_emit_properties_changed(
         return sd_bus_emit_properties_changed_strv(bus, path, interface, names);
 }
 
+static void invalidate_properties_cache_on_node(
+                sd_bus *bus,
+                const char *prefix,
+                const char *path,
+                const char *interface,
+                bool require_fallback) {
+
+        struct node_vtable *c;
+        struct node *n;
+
+        assert(bus);
+        assert(prefix);
+        assert(path);
+
+        n = hashmap_get(bus->nodes, prefix);
+        if (!n)
+                return;
+
+        LIST_FOREACH(vtables, c, n->vtables) {
+                if (require_fallback && !c->is_fallback)
+                        continue;
+
+                if (interface && !streq(c->interface, interface))
+                        continue;
+
+                node_vtable_invalidate_properties(c, path);
+        }
+}
+
+_public_ int sd_bus_invalidate_properties_cache(sd_bus *bus, const char *path, const char *interface) {
+        _cleanup_free_ char *prefix = NULL;
+        size_t pl;
+
+        assert_return(bus, -EINVAL);
+        assert_return(bus = bus_resolve(bus), -ENOPKG);
+        assert_return(object_path_is_valid(path), -EINVAL);
+        assert_return(!interface || interface_name_is_valid(interface), -EINVAL);
+        assert_return(!bus_pid_changed(bus), -ECHILD);
+
+        /* Drops the GetAll() replies cached for vtables registered with SD_BUS_VTABLE_CACHE_PROPERTIES on
+         * the specified object, for a specific interface or all of them. sd_bus_emit_properties_changed()
+         * does this implicitly, use this for changes that shall not be signalled, and when replacing the object
+         * at a path without announcing it. */
+
+        pl = strlen(path);
+        assert(pl <= BUS_PATH_SIZE_MAX);
+        prefix = new(char, pl + 1);
+        if (!prefix)
+                return -ENOMEM;
+
+        invalidate_properties_cache_on_node(bus, path, path, interface, false);
+
+        OBJECT_PATH_FOREACH_PREFIX(prefix, path)
+                invalidate_properties_cache_on_node(bus, prefix, path, interface, true);
+
+        return 0;
+}
+
 static int object_added_append_all_prefix(
                 sd_bus *bus,
                 sd_bus_message *m,
@@ -2368,6 +2582,9 @@ _public_ int sd_bus_emit_object_added(sd_bus *bus, const char *path) {
         if (r == 0)
                 return -ESRCH;
 
+        /* This might be a new object at the path of an old one */
+        (void) sd_bus_invalidate_properties_cache(bus, path, NULL);
+
         BUS_DONT_DESTROY(bus);
 
         do {
@@ -2545,6 +2762,8 @@ _public_ int sd_bus_emit_object_removed(sd_bus *bus, const char *path) {
         if (r == 0)
                 return -ESRCH;
 
+        (void) sd_bus_invalidate_properties_cache(bus, path, NULL);
+
         BUS_DONT_DESTROY(bus);
 
         do {
@@ -2708,6 +2927,9 @@ _public_ int sd_bus_emit_interfaces_added_strv(sd_bus *bus, const char *path, ch
         if (r == 0)
                 return -ESRCH;
 
+        STRV_FOREACH(i, interfaces)
+                (void) sd_bus_invalidate_properties_cache(bus, path, *i);
+
         BUS_DONT_DESTROY(bus);
 
         do {
@@ -2776,6 +2998,7 @@ _public_ int sd_bus_emit_interfaces_added(sd_bus *bus, const char *path, const c
 _public_ int sd_bus_emit_interfaces_removed_strv(sd_bus *bus, const char *path, char **interfaces) {
         _cleanup_(sd_bus_message_unrefp) sd_bus_message *m = NULL;
         struct node *object_manager;
+        char **i;
         int r;
 
         assert_return(bus, -EINVAL);
@@ -2795,6 +3018,9 @@ _public_ int sd_bus_emit_interfaces_removed_strv(sd_bus *bus, const char *path,
         if (r == 0)
                 return -ESRCH;
 
+        STRV_FOREACH(i, interfaces)
+                (void) sd_bus_invalidate_properties_cache(bus, path, *i);
+
         r = sd_bus_message_new_signal(bus, &m, object_manager->path, "org.freedesktop.DBus.ObjectManager", "InterfacesRemoved");
         if (r < 0)
                 return r;
@@ -78,6 +78,11 @@ enum {
         _BUS_MESSAGE_HEADER_MAX
 };
 
+/* Private header field, only sent to peers that agreed to it with NEGOTIATE_SYSTEMD_MEMFD during
+ * authentication. Its "u" value is the size of the message body, which is not sent inline, but passed as
+ * sealed memfd appended to the file descriptors of the message (and not counted in the UNIX_FDS field). */
+#define BUS_MESSAGE_HEADER_SYSTEMD_BODY_MEMFD 0x80
+
 /* RequestName parameters */
 
 enum  {
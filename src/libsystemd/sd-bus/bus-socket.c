@@ -12,6 +12,7 @@
 
 #include "alloc-util.h"
 #include "bus-internal.h"
+#include "bus-kernel.h"
 #include "bus-message.h"
 #include "bus-socket.h"
 #include "fd-util.h"
@@ -20,6 +21,7 @@
 #include "hexdecoct.h"
 #include "io-util.h"
 #include "macro.h"
+#include "memfd-util.h"
 #include "missing.h"
 #include "path-util.h"
 #include "process-util.h"
@@ -33,6 +35,9 @@
 
 #define SNDBUF_SIZE (8*1024*1024)
 
+/* How many iovecs to pass to a single sendmsg() at most, when writing out queued messages in one go */
+#define BUS_WRITE_IOVEC_MAX 64
+
 static void iovec_advance(struct iovec iov[], unsigned *idx, size_t size) {
 
         while (size > 0) {
@@ -65,6 +70,74 @@ static int append_iovec(sd_bus_message *m, const void *p, size_t sz) {
         return 0;
 }
 
+static bool bus_message_use_body_memfd(sd_bus_message *m) {
+        assert(m);
+
+        /* Large bodies are passed as sealed memfd to peers that agreed to that, so that the receiver can
+         * simply map them instead of copying them through the socket buffers. */
+
+        return m->bus->can_memfd &&
+                !BUS_MESSAGE_IS_GVARIANT(m) &&
+                m->body_size >= MEMFD_MIN_SIZE &&
+                m->n_fds < BUS_FDS_MAX;
+}
+
+static int bus_message_setup_body_memfd(sd_bus_message *m) {
+        _cleanup_close_ int fd = -1;
+        _cleanup_free_ uint8_t *h = NULL;
+        struct bus_body_part *part;
+        struct bus_header *header;
+        size_t begin;
+        unsigned i;
+        int r;
+
+        assert(m);
+        assert(m->wire_body_memfd < 0);
+
+        fd = memfd_new("sd-bus-body");
+        if (fd < 0)
+                return fd;
+
+        MESSAGE_FOREACH_PART(part, i, m) {
+                r = bus_body_part_map(part);
+                if (r < 0)
+                        return r;
+
+                r = loop_write(fd, part->data, part->size, false);
+                if (r < 0)
+                        return r;
+        }
+
+        r = memfd_set_sealed(fd);
+        if (r < 0)
+                return r;
+
+        /* Write a copy of the header without body, but with our private field appended that carries the
+         * body size. Fields are always 8 byte aligned, and ours is exactly 8 bytes long, hence no padding
+         * is necessary at the end. */
+        begin = BUS_MESSAGE_BODY_BEGIN(m);
+        h = malloc(begin + 8);
+        if (!h)
+                return -ENOMEM;
+
+        memcpy(h, m->header, begin);
+        h[begin] = BUS_MESSAGE_HEADER_SYSTEMD_BODY_MEMFD;
+        h[begin + 1] = 1;
+        h[begin + 2] = SD_BUS_TYPE_UINT32;
+        h[begin + 3] = 0;
+        *(uint32_t*) (h + begin + 4) = BUS_MESSAGE_BSWAP32(m, (uint32_t) m->body_size);
+
+        header = (struct bus_header*) h;
+        header->dbus1.fields_size = BUS_MESSAGE_BSWAP32(m, (uint32_t) (ALIGN8(m->fields_size) + 8));
+        header->dbus1.body_size = 0;
+
+        m->wire_header = TAKE_PTR(h);
+        m->wire_header_size = begin + 8;
+        m->wire_body_memfd = TAKE_FD(fd);
+
+        return 0;
+}
+
 static int bus_message_setup_iovec(sd_bus_message *m) {
         struct bus_body_part *part;
         unsigned n, i;
@@ -78,6 +151,16 @@ static int bus_message_setup_iovec(sd_bus_message *m) {
 
         assert(!m->iovec);
 
+        if (bus_message_use_body_memfd(m)) {
+                r = bus_message_setup_body_memfd(m);
+                if (r >= 0) {
+                        m->iovec = m->iovec_fixed;
+                        return append_iovec(m, m->wire_header, m->wire_header_size);
+                }
+
+                log_debug_errno(r, "Failed to pass message body as memfd, sending it inline: %m");
+        }
+
         n = 1 + m->n_body_parts;
         if (n < ELEMENTSOF(m->iovec_fixed))
                 m->iovec = m->iovec_fixed;
@@ -162,7 +245,7 @@ static int bus_socket_write_auth(sd_bus *b) {
 }
 
 static int bus_socket_auth_verify_client(sd_bus *b) {
-        char *d, *e, *f, *start;
+        char *d, *e, *f, *g, *start;
         sd_id128_t peer;
         unsigned i;
         int r;
@@ -174,6 +257,9 @@ static int bus_socket_auth_verify_client(sd_bus *b) {
          *   "DATA\r\n"
          *   "OK <server-id>\r\n"
          *   "AGREE_UNIX_FD\r\n"        (optional)
+         *
+         * And a fourth one, if we asked for memfd body passing:
+         *   "AGREE_SYSTEMD_MEMFD\r\n"  (optional)
          */
 
         d = memmem_safe(b->rbuffer, b->rbuffer_size, "\r\n", 2);
@@ -189,9 +275,18 @@ static int bus_socket_auth_verify_client(sd_bus *b) {
                 if (!f)
                         return 0;
 
-                start = f + 2;
+                if (b->accept_memfd) {
+                        g = memmem(f + 2, b->rbuffer_size - (f - (char*) b->rbuffer) - 2, "\r\n", 2);
+                        if (!g)
+                                return 0;
+
+                        start = g + 2;
+                } else {
+                        g = NULL;
+                        start = f + 2;
+                }
         } else {
-                f = NULL;
+                f = g = NULL;
                 start = e + 2;
         }
 
@@ -249,6 +344,13 @@ static int bus_socket_auth_verify_client(sd_bus *b) {
                         memcmp(e + 2, "AGREE_UNIX_FD",
                                STRLEN("AGREE_UNIX_FD")) == 0;
 
+        if (g)
+                b->can_memfd =
+                        b->can_fds &&
+                        (g - f == STRLEN("\r\nAGREE_SYSTEMD_MEMFD")) &&
+                        memcmp(f + 2, "AGREE_SYSTEMD_MEMFD",
+                               STRLEN("AGREE_SYSTEMD_MEMFD")) == 0;
+
         b->rbuffer_size -= (start - (char*) b->rbuffer);
         memmove(b->rbuffer, start, b->rbuffer_size);
 
@@ -498,6 +600,13 @@ static int bus_socket_auth_verify_server(sd_bus *b) {
                                 b->can_fds = true;
                                 r = bus_socket_auth_write(b, "AGREE_UNIX_FD\r\n");
                         }
+                } else if (line_equals(line, l, "NEGOTIATE_SYSTEMD_MEMFD")) {
+                        if (b->auth == _BUS_AUTH_INVALID || !b->can_fds || !b->accept_memfd)
+                                r = bus_socket_auth_write(b, "ERROR\r\n");
+                        else {
+                                b->can_memfd = true;
+                                r = bus_socket_auth_write(b, "AGREE_SYSTEMD_MEMFD\r\n");
+                        }
                 } else
                         r = bus_socket_auth_write(b, "ERROR\r\n");
 
@@ -658,6 +767,9 @@ static int bus_socket_start_auth_client(sd_bus *b) {
         static const char sasl_negotiate_unix_fd[] = {
                 "NEGOTIATE_UNIX_FD\r\n"
         };
+        static const char sasl_negotiate_memfd[] = {
+                "NEGOTIATE_SYSTEMD_MEMFD\r\n"
+        };
         static const char sasl_begin[] = {
                 "BEGIN\r\n"
         };
@@ -670,9 +782,13 @@ static int bus_socket_start_auth_client(sd_bus *b) {
         else
                 b->auth_iovec[i++] = IOVEC_MAKE((char*) sasl_auth_external, sizeof(sasl_auth_external) - 1);
 
-        if (b->accept_fd)
+        if (b->accept_fd) {
                 b->auth_iovec[i++] = IOVEC_MAKE_STRING(sasl_negotiate_unix_fd);
 
+                if (b->accept_memfd)
+                        b->auth_iovec[i++] = IOVEC_MAKE_STRING(sasl_negotiate_memfd);
+        }
+
         b->auth_iovec[i++] = IOVEC_MAKE_STRING(sasl_begin);
 
         return bus_socket_write_auth(b);
@@ -999,61 +1115,147 @@ int bus_socket_take_fd(sd_bus *b) {
         return bus_socket_start_auth(b);
 }
 
-int bus_socket_write_message(sd_bus *bus, sd_bus_message *m, size_t *idx) {
+static size_t bus_message_wire_size(sd_bus_message *m) {
+        assert(m);
+
+        /* If the body is passed as memfd, only the header goes over the socket */
+        return m->wire_body_memfd >= 0 ? m->wire_header_size : BUS_MESSAGE_SIZE(m);
+}
+
+int bus_socket_write_messages(sd_bus *bus, sd_bus_message **messages, size_t n_messages, size_t *idx, size_t *ret_n_written) {
         struct iovec *iov;
+        sd_bus_message *m;
+        size_t n_iov = 0, n_batch, i, done;
+        unsigned j = 0, n_fds;
         ssize_t k;
-        size_t n;
-        unsigned j;
         int r;
 
         assert(bus);
-        assert(m);
+        assert(messages);
+        assert(n_messages > 0);
         assert(idx);
         assert(IN_SET(bus->state, BUS_RUNNING, BUS_HELLO));
 
-        if (*idx >= BUS_MESSAGE_SIZE(m))
-                return 0;
+        /* Writes the first message from the specified array, starting at offset *idx, plus as many of the
+         * following messages as fit into a single sendmsg() call. File descriptors are always attached to
+         * the first byte of a message, hence a message that carries any always starts a new batch. Returns
+         * the number of completely written messages in *ret_n_written, and the offset into the next one
+         * in *idx. */
 
-        r = bus_message_setup_iovec(m);
-        if (r < 0)
-                return r;
+        iov = newa(struct iovec, BUS_WRITE_IOVEC_MAX);
+
+        for (n_batch = 0; n_batch < n_messages; n_batch++) {
+                m = messages[n_batch];
 
-        n = m->n_iovec * sizeof(struct iovec);
-        iov = alloca(n);
-        memcpy_safe(iov, m->iovec, n);
+                r = bus_message_setup_iovec(m);
+                if (r < 0) {
+                        /* Send what we collected so far, the error will be seen again on the next
+                         * iteration then. */
+                        if (n_batch > 0)
+                                break;
 
-        j = 0;
-        iovec_advance(iov, &j, *idx);
+                        return r;
+                }
+
+                if (n_batch > 0 &&
+                    (m->n_fds > 0 || m->wire_body_memfd >= 0 || n_iov + m->n_iovec > BUS_WRITE_IOVEC_MAX))
+                        break;
+
+                if (m->n_iovec > BUS_WRITE_IOVEC_MAX) {
+                        /* Messages with a lot of body parts don't fit into our array, let's write them
+                         * on their own with their own iovec. */
+                        iov = m->iovec;
+                        n_iov = m->n_iovec;
+                        n_batch++;
+                        break;
+                }
+
+                memcpy_safe(iov + n_iov, m->iovec, m->n_iovec * sizeof(struct iovec));
+                n_iov += m->n_iovec;
+        }
+
+        if (*idx > 0) {
+                if (iov == messages[0]->iovec) {
+                        iov = newa(struct iovec, n_iov);
+                        memcpy(iov, messages[0]->iovec, n_iov * sizeof(struct iovec));
+                }
+
+                iovec_advance(iov, &j, *idx);
+        }
+
+        m = messages[0];
 
         if (bus->prefer_writev)
-                k = writev(bus->output_fd, iov, m->n_iovec);
+                k = writev(bus->output_fd, iov + j, n_iov - j);
         else {
                 struct msghdr mh = {
-                        .msg_iov = iov,
-                        .msg_iovlen = m->n_iovec,
+                        .msg_iov = iov + j,
+                        .msg_iovlen = n_iov - j,
                 };
 
-                if (m->n_fds > 0 && *idx == 0) {
+                /* The memfd carrying the body, if there is one, is passed after all fds of the message */
+                n_fds = m->n_fds + (m->wire_body_memfd >= 0);
+
+                if (n_fds > 0 && *idx == 0) {
                         struct cmsghdr *control;
 
-                        mh.msg_control = control = alloca(CMSG_SPACE(sizeof(int) * m->n_fds));
-                        mh.msg_controllen = control->cmsg_len = CMSG_LEN(sizeof(int) * m->n_fds);
+                        mh.msg_control = control = alloca(CMSG_SPACE(sizeof(int) * n_fds));
+                        mh.msg_controllen = control->cmsg_len = CMSG_LEN(sizeof(int) * n_fds);
                         control->cmsg_level = SOL_SOCKET;
                         control->cmsg_type = SCM_RIGHTS;
-                        memcpy(CMSG_DATA(control), m->fds, sizeof(int) * m->n_fds);
+                        memcpy_safe(CMSG_DATA(control), m->fds, sizeof(int) * m->n_fds);
+                        if (m->wire_body_memfd >= 0)
+                                ((int*) CMSG_DATA(control))[m->n_fds] = m->wire_body_memfd;
                 }
 
                 k = sendmsg(bus->output_fd, &mh, MSG_DONTWAIT|MSG_NOSIGNAL);
                 if (k < 0 && errno == ENOTSOCK) {
                         bus->prefer_writev = true;
-                        k = writev(bus->output_fd, iov, m->n_iovec);
+                        k = writev(bus->output_fd, iov + j, n_iov - j);
                 }
         }
 
         if (k < 0)
                 return ERRNO_IS_TRANSIENT(errno) ? 0 : -errno;
 
-        *idx += (size_t) k;
+        /* Figure out how many messages made it out completely */
+        for (done = 0, i = 0; i < n_batch; i++) {
+                size_t left;
+
+                left = bus_message_wire_size(messages[i]) - *idx;
+                if ((size_t) k < left) {
+                        *idx += (size_t) k;
+                        break;
+                }
+
+                k -= left;
+                *idx = 0;
+                done++;
+        }
+
+        if (ret_n_written)
+                *ret_n_written = done;
+
+        return 1;
+}
+
+int bus_socket_write_message(sd_bus *bus, sd_bus_message *m, size_t *idx) {
+        size_t n;
+        int r;
+
+        assert(m);
+        assert(idx);
+
+        if (*idx >= BUS_MESSAGE_SIZE(m))
+                return 0;
+
+        r = bus_socket_write_messages(bus, &m, 1, idx, &n);
+        if (r <= 0)
+                return r;
+
+        if (n > 0)
+                *idx = BUS_MESSAGE_SIZE(m);
+
         return 1;
 }
 
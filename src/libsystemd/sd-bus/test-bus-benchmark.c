@@ -49,6 +49,38 @@ static void server(sd_bus *b, size_t *result) {
 
                         r = sd_bus_reply_method_return(m, NULL);
                         assert_se(r >= 0);
+                } else if (sd_bus_message_is_method_call(m, "benchmark.server", "Burst")) {
+                        _cleanup_(sd_bus_message_unrefp) sd_bus_message *done = NULL;
+                        const char *sender;
+                        uint32_t i, n;
+                        usec_t t;
+
+                        assert_se(sd_bus_message_read(m, "u", &n) > 0);
+                        assert_se(sd_bus_reply_method_return(m, NULL) >= 0);
+
+                        sender = sd_bus_message_get_sender(m);
+
+                        /* Queue up the signals faster than the client reads them, so that most of them
+                         * are written out of the write queue, and report how long that took */
+                        t = now(CLOCK_MONOTONIC);
+                        for (i = 0; i < n; i++) {
+                                _cleanup_(sd_bus_message_unrefp) sd_bus_message *signal = NULL;
+
+                                assert_se(sd_bus_message_new_signal(b, &signal, "/", "benchmark.server", "Tick") >= 0);
+                                if (sender)
+                                        assert_se(sd_bus_message_set_destination(signal, sender) >= 0);
+                                assert_se(sd_bus_message_append(signal, "us", i, "org.freedesktop.systemd1.Unit") >= 0);
+                                assert_se(sd_bus_send(b, signal, NULL) >= 0);
+                        }
+
+                        assert_se(sd_bus_flush(b) >= 0);
+                        t = now(CLOCK_MONOTONIC) - t;
+
+                        assert_se(sd_bus_message_new_signal(b, &done, "/", "benchmark.server", "Done") >= 0);
+                        if (sender)
+                                assert_se(sd_bus_message_set_destination(done, sender) >= 0);
+                        assert_se(sd_bus_message_append(done, "t", t) >= 0);
+                        assert_se(sd_bus_send(b, done, NULL) >= 0);
                 } else if (sd_bus_message_is_method_call(m, "benchmark.server", "Exit")) {
                         uint64_t res;
                         assert_se(sd_bus_message_read(m, "t", &res) > 0);
@@ -206,10 +238,79 @@ static void client_chart(Type type, const char *address, const char *server_name
         sd_bus_unref(b);
 }
 
+static void client_signals(Type type, const char *address, const char *server_name, int fd) {
+        _cleanup_(sd_bus_message_unrefp) sd_bus_message *x = NULL;
+        uint32_t n;
+        sd_bus *b;
+        int r;
+
+        r = sd_bus_new(&b);
+        assert_se(r >= 0);
+
+        if (type == TYPE_DIRECT) {
+                r = sd_bus_set_fd(b, fd, fd);
+                assert_se(r >= 0);
+        } else {
+                r = sd_bus_set_address(b, address);
+                assert_se(r >= 0);
+
+                r = sd_bus_set_bus_client(b, true);
+                assert_se(r >= 0);
+        }
+
+        r = sd_bus_start(b);
+        assert_se(r >= 0);
+
+        r = sd_bus_call_method(b, server_name, "/", "benchmark.server", "Ping", NULL, NULL, NULL);
+        assert_se(r >= 0);
+
+        printf("SIGNALS\tSENDER\tTOTAL\n");
+
+        for (n = 16; n <= 256*1024; n *= 4) {
+                uint64_t t_sender = 0;
+                bool done = false;
+                usec_t t;
+
+                t = now(CLOCK_MONOTONIC);
+
+                r = sd_bus_call_method(b, server_name, "/", "benchmark.server", "Burst", NULL, NULL, "u", n);
+                assert_se(r >= 0);
+
+                while (!done) {
+                        _cleanup_(sd_bus_message_unrefp) sd_bus_message *m = NULL;
+
+                        r = sd_bus_process(b, &m);
+                        assert_se(r >= 0);
+
+                        if (r == 0)
+                                assert_se(sd_bus_wait(b, USEC_INFINITY) >= 0);
+
+                        if (m && sd_bus_message_is_signal(m, "benchmark.server", "Done")) {
+                                assert_se(sd_bus_message_read(m, "t", &t_sender) > 0);
+                                done = true;
+                        }
+                }
+
+                t = now(CLOCK_MONOTONIC) - t;
+
+                /* Messages per second, as seen by the sender and the receiver */
+                printf("%" PRIu32 "\t%" PRIu64 "\t%" PRIu64 "\n", n,
+                       (uint64_t) n * USEC_PER_SEC / MAX(t_sender, (uint64_t) 1),
+                       (uint64_t) n * USEC_PER_SEC / MAX(t, (usec_t) 1));
+        }
+
+        assert_se(sd_bus_message_new_method_call(b, &x, server_name, "/", "benchmark.server", "Exit") >= 0);
+        assert_se(sd_bus_message_append(x, "t", (uint64_t) 0) >= 0);
+        assert_se(sd_bus_send(b, x, NULL) >= 0);
+
+        sd_bus_unref(b);
+}
+
 int main(int argc, char *argv[]) {
         enum {
                 MODE_BISECT,
                 MODE_CHART,
+                MODE_SIGNALS,
         } mode = MODE_BISECT;
         Type type = TYPE_LEGACY;
         int i, pair[2] = { -1, -1 };
@@ -226,6 +327,9 @@ int main(int argc, char *argv[]) {
                 if (streq(argv[i], "chart")) {
                         mode = MODE_CHART;
                         continue;
+                } else if (streq(argv[i], "signals")) {
+                        mode = MODE_SIGNALS;
+                        continue;
                 } else if (streq(argv[i], "legacy")) {
                         type = TYPE_LEGACY;
                         continue;
@@ -301,8 +405,13 @@ int main(int argc, char *argv[]) {
                 case MODE_CHART:
                         client_chart(type, address, server_name, pair[1]);
                         break;
+
+                case MODE_SIGNALS:
+                        client_signals(type, address, server_name, pair[1]);
+                        break;
                 }
 
+                fflush(stdout);
                 _exit(EXIT_SUCCESS);
         }
 
@@ -2,8 +2,10 @@
 /***
 ***/
 
+#include "alloc-util.h"
 #include "bus-introspect.h"
 #include "log.h"
+#include "string-util.h"
 
 static int prop_get(sd_bus *bus, const char *path, const char *interface, const char *property, sd_bus_message *reply, void *userdata, sd_bus_error *error) {
         return -EINVAL;
@@ -29,6 +31,7 @@ static const sd_bus_vtable vtable[] = {
 };
 
 int main(int argc, char *argv[]) {
+        _cleanup_free_ char *fragment = NULL;
         struct introspect intro;
 
         log_set_max_level(LOG_DEBUG);
@@ -42,6 +45,15 @@ int main(int argc, char *argv[]) {
         fflush(intro.f);
         fputs(intro.introspection, stdout);
 
+        /* The cached per-vtable fragment must match what is generated inline */
+        assert_se(introspect_interface_to_string(vtable, false, &fragment) >= 0);
+        assert_se(strstr(intro.introspection, fragment));
+        assert_se(strstr(fragment, "org.freedesktop.systemd1.Privileged"));
+
+        fragment = mfree(fragment);
+        assert_se(introspect_interface_to_string(vtable, true, &fragment) >= 0);
+        assert_se(!strstr(fragment, "org.freedesktop.systemd1.Privileged"));
+
         introspect_free(&intro);
 
         return 0;
@@ -23,6 +23,7 @@
 #include "escape.h"
 #include "fd-util.h"
 #include "log.h"
+#include "time-util.h"
 #include "util.h"
 
 static void test_bus_path_encode_unique(void) {
@@ -105,6 +106,51 @@ static void test_bus_label_escape(void) {
         test_bus_label_escape_one(":1", "_3a1");
 }
 
+static void test_marshal_benchmark(void) {
+        _cleanup_(sd_bus_unrefp) sd_bus *bus = NULL;
+        _cleanup_close_pair_ int pair[2] = { -1, -1 };
+        unsigned n;
+        usec_t t;
+
+        /* Measures a typical method call round trip through the marshaller: build, seal, serialize, parse
+         * again and read */
+
+        assert_se(socketpair(AF_UNIX, SOCK_STREAM|SOCK_CLOEXEC, 0, pair) >= 0);
+        assert_se(sd_bus_new(&bus) >= 0);
+        assert_se(sd_bus_set_fd(bus, pair[0], pair[0]) >= 0);
+        pair[0] = -1;
+        assert_se(sd_bus_start(bus) >= 0);
+
+        t = now(CLOCK_MONOTONIC);
+        for (n = 0; now(CLOCK_MONOTONIC) < t + 100 * USEC_PER_MSEC; n++) {
+                _cleanup_(sd_bus_message_unrefp) sd_bus_message *m = NULL, *parsed = NULL;
+                const char *s, *k, *v;
+                uint32_t u;
+                void *blob;
+                size_t sz;
+
+                assert_se(sd_bus_message_new_method_call(bus, &m, "org.freedesktop.systemd1", "/org/freedesktop/systemd1/unit/foo_2eservice",
+                                                         "org.freedesktop.DBus.Properties", "GetAll") >= 0);
+                assert_se(sd_bus_message_append(m, "sa{sv}", "org.freedesktop.systemd1.Unit", 3,
+                                                "Id", "s", "foo.service",
+                                                "ActiveState", "s", "active",
+                                                "NRestarts", "u", 7) >= 0);
+                assert_se(sd_bus_message_seal(m, n + 1, 0) >= 0);
+
+                assert_se(bus_message_get_blob(m, &blob, &sz) >= 0);
+                assert_se(bus_message_from_malloc(bus, blob, sz, NULL, 0, NULL, &parsed) >= 0);
+
+                assert_se(sd_bus_message_read(parsed, "s", &s) > 0);
+                assert_se(sd_bus_message_read(parsed, "a{sv}", 3,
+                                              &k, "s", &v,
+                                              &k, "s", &v,
+                                              &k, "u", &u) > 0);
+                assert_se(u == 7);
+        }
+
+        log_info("Marshalled and parsed %u messages in 100ms, %u msg/s", n, n * 10);
+}
+
 int main(int argc, char *argv[]) {
         _cleanup_(sd_bus_message_unrefp) sd_bus_message *m = NULL, *copy = NULL;
         int r, boolean;
@@ -122,6 +168,8 @@ int main(int argc, char *argv[]) {
         double dbl;
         uint64_t u64;
 
+        test_marshal_benchmark();
+
         r = sd_bus_default_user(&bus);
         if (r < 0)
                 return EXIT_TEST_SKIP;
@@ -2,12 +2,16 @@
 /***
 ***/
 
+#include "alloc-util.h"
 #include "bus-match.h"
 #include "bus-message.h"
 #include "bus-slot.h"
 #include "bus-util.h"
 #include "log.h"
 #include "macro.h"
+#include "stdio-util.h"
+#include "string-util.h"
+#include "time-util.h"
 
 static bool mask[32];
 
@@ -68,6 +72,144 @@ static void test_match_scope(const char *match, enum bus_match_scope scope) {
         bus_match_parse_free(components, n_components);
 }
 
+static void test_match_sender(sd_bus *bus) {
+        struct bus_match_node root = {
+                .type = BUS_MATCH_ROOT,
+        };
+        _cleanup_(sd_bus_message_unrefp) sd_bus_message *m = NULL;
+        sd_bus_slot slots[5];
+
+        /* Messages from the bus always carry the unique name of the sender, hence sender= matches on
+         * well-known names have to fire for unique senders too. Matches on other unique names must not. */
+
+        assert_se(match_add(slots, &root, "sender='org.freedesktop.foo'", 1) >= 0);
+        assert_se(match_add(slots, &root, "sender='org.freedesktop.foo',member='waldo'", 2) >= 0);
+        assert_se(match_add(slots, &root, "sender=':1.42'", 3) >= 0);
+        assert_se(match_add(slots, &root, "sender=':1.43'", 4) >= 0);
+
+        assert_se(sd_bus_message_new_signal(bus, &m, "/foo/bar", "bar.x", "waldo") >= 0);
+        assert_se(sd_bus_message_set_sender(m, ":1.42") >= 0);
+        assert_se(sd_bus_message_seal(m, 1, 0) >= 0);
+
+        zero(mask);
+        assert_se(bus_match_run(NULL, &root, m) == 0);
+        assert_se(mask_contains((unsigned[]) { 1, 2, 3 }, 3));
+
+        m = sd_bus_message_unref(m);
+
+        assert_se(sd_bus_message_new_signal(bus, &m, "/foo/bar", "bar.x", "waldo") >= 0);
+        assert_se(sd_bus_message_set_sender(m, "org.freedesktop.bar") >= 0);
+        assert_se(sd_bus_message_seal(m, 1, 0) >= 0);
+
+        zero(mask);
+        assert_se(bus_match_run(NULL, &root, m) == 0);
+        assert_se(mask_contains(NULL, 0));
+
+        bus_match_free(&root);
+}
+
+#define N_BENCHMARK_MATCHES 10000U
+#define N_BENCHMARK_MESSAGES 1000U
+#define N_BENCHMARK_ROUNDS 100U
+
+static unsigned n_benchmark_calls = 0;
+
+static int benchmark_filter(sd_bus_message *m, void *userdata, sd_bus_error *ret_error) {
+        n_benchmark_calls++;
+        return 0;
+}
+
+static void test_match_benchmark(sd_bus *bus) {
+        struct bus_match_node root = {
+                .type = BUS_MATCH_ROOT,
+        };
+        _cleanup_free_ sd_bus_message **messages = NULL;
+        _cleanup_free_ sd_bus_slot *slots = NULL;
+        char ts[FORMAT_TIMESPAN_MAX];
+        unsigned i, j;
+        usec_t t;
+
+        /* Install a lot of matches of the kinds clients typically use to follow units: exact paths, path
+         * namespaces, argument namespaces and argument paths. Then run a storm of signals against them,
+         * each of which matches exactly one of them. */
+
+        slots = new0(sd_bus_slot, N_BENCHMARK_MATCHES);
+        assert_se(slots);
+
+        for (i = 0; i < N_BENCHMARK_MATCHES; i++) {
+                struct bus_match_component *components = NULL;
+                unsigned n_components = 0;
+                char match[256];
+
+                switch (i % 4) {
+
+                case 0:
+                        xsprintf(match, "type='signal',path='/org/freedesktop/systemd1/unit/u%u',"
+                                 "interface='org.freedesktop.DBus.Properties',member='PropertiesChanged'", i);
+                        break;
+
+                case 1:
+                        xsprintf(match, "type='signal',path_namespace='/org/freedesktop/systemd1/unit/u%u'", i);
+                        break;
+
+                case 2:
+                        xsprintf(match, "type='signal',arg0namespace='org.freedesktop.systemd1.U%u'", i);
+                        break;
+
+                case 3:
+                        xsprintf(match, "type='signal',arg1path='/org/freedesktop/systemd1/unit/u%u/'", i);
+                        break;
+                }
+
+                assert_se(bus_match_parse(match, &components, &n_components) >= 0);
+
+                slots[i].match_callback.callback = benchmark_filter;
+                assert_se(bus_match_add(&root, components, n_components, &slots[i].match_callback) >= 0);
+
+                bus_match_parse_free(components, n_components);
+        }
+
+        messages = new0(sd_bus_message*, N_BENCHMARK_MESSAGES);
+        assert_se(messages);
+
+        for (i = 0; i < N_BENCHMARK_MESSAGES; i++) {
+                char path[STRLEN("/org/freedesktop/systemd1/unit/u") + DECIMAL_STR_MAX(unsigned)],
+                        arg0[STRLEN("org.freedesktop.systemd1.U") + DECIMAL_STR_MAX(unsigned)],
+                        arg1[STRLEN("/org/freedesktop/systemd1/unit/u/job") + DECIMAL_STR_MAX(unsigned)];
+                unsigned k;
+
+                k = (i * 7) % N_BENCHMARK_MATCHES;
+
+                xsprintf(path, "/org/freedesktop/systemd1/unit/u%u", k);
+                xsprintf(arg0, "org.freedesktop.systemd1.U%u", k);
+                xsprintf(arg1, "/org/freedesktop/systemd1/unit/u%u/job", k);
+
+                assert_se(sd_bus_message_new_signal(bus, messages + i, path, "org.freedesktop.DBus.Properties", "PropertiesChanged") >= 0);
+                assert_se(sd_bus_message_append(messages[i], "ss", arg0, arg1) >= 0);
+                assert_se(sd_bus_message_seal(messages[i], 1, 0) >= 0);
+        }
+
+        t = now(CLOCK_MONOTONIC);
+
+        for (j = 0; j < N_BENCHMARK_ROUNDS; j++)
+                for (i = 0; i < N_BENCHMARK_MESSAGES; i++)
+                        assert_se(bus_match_run(NULL, &root, messages[i]) == 0);
+
+        t = now(CLOCK_MONOTONIC) - t;
+
+        assert_se(n_benchmark_calls == N_BENCHMARK_ROUNDS * N_BENCHMARK_MESSAGES);
+
+        log_info("Dispatched %u signals against %u matches in %s (%.0f signals/s)",
+                 N_BENCHMARK_ROUNDS * N_BENCHMARK_MESSAGES, N_BENCHMARK_MATCHES,
+                 format_timespan(ts, sizeof(ts), t, 1),
+                 (double) (N_BENCHMARK_ROUNDS * N_BENCHMARK_MESSAGES) * USEC_PER_SEC / MAX(t, (usec_t) 1));
+
+        for (i = 0; i < N_BENCHMARK_MESSAGES; i++)
+                sd_bus_message_unref(messages[i]);
+
+        bus_match_free(&root);
+}
+
 int main(int argc, char *argv[]) {
         struct bus_match_node root = {
                 .type = BUS_MATCH_ROOT,
@@ -140,5 +282,8 @@ int main(int argc, char *argv[]) {
         test_match_scope("member='gurke',path='/org/freedesktop/DBus/Local'", BUS_MATCH_LOCAL);
         test_match_scope("arg2='piep',sender='org.freedesktop.DBus',member='waldo'", BUS_MATCH_DRIVER);
 
+        test_match_sender(bus);
+        test_match_benchmark(bus);
+
         return 0;
 }
@@ -23,6 +23,7 @@ struct context {
         char *something;
         char *automatic_string_property;
         uint32_t automatic_integer_property;
+        uint32_t generation;
 };
 
 static int something_handler(sd_bus_message *m, void *userdata, sd_bus_error *error) {
@@ -206,6 +207,54 @@ static const sd_bus_vtable vtable2[] = {
         SD_BUS_VTABLE_END
 };
 
+static int generation_handler(sd_bus *bus, const char *path, const char *interface, const char *property, sd_bus_message *reply, void *userdata, sd_bus_error *error) {
+        struct context *c = userdata;
+
+        /* Counts how often the getter is actually called, so that the client can tell cached replies apart */
+        return sd_bus_message_append(reply, "u", ++c->generation);
+}
+
+static int strings_handler(sd_bus *bus, const char *path, const char *interface, const char *property, sd_bus_message *reply, void *userdata, sd_bus_error *error) {
+        return sd_bus_message_append(reply, "as", 3, "a", "bb", "ccc");
+}
+
+static int bump_generation(sd_bus_message *m, void *userdata, sd_bus_error *error) {
+        assert_se(sd_bus_emit_properties_changed(sd_bus_message_get_bus(m), m->path, "org.freedesktop.systemd.CacheTest", "Generation", NULL) >= 0);
+
+        return sd_bus_reply_method_return(m, NULL);
+}
+
+static int invalidate_generation(sd_bus_message *m, void *userdata, sd_bus_error *error) {
+        assert_se(sd_bus_invalidate_properties_cache(sd_bus_message_get_bus(m), m->path, "org.freedesktop.systemd.CacheTest") >= 0);
+
+        return sd_bus_reply_method_return(m, NULL);
+}
+
+static int replace_object(sd_bus_message *m, void *userdata, sd_bus_error *error) {
+        /* Announces a new object at the same path, at the same address */
+        assert_se(sd_bus_emit_interfaces_added(sd_bus_message_get_bus(m), m->path, "org.freedesktop.systemd.CacheTest", NULL) >= 0);
+
+        return sd_bus_reply_method_return(m, NULL);
+}
+
+static const sd_bus_vtable vtable_cached[] = {
+        SD_BUS_VTABLE_START(SD_BUS_VTABLE_CACHE_PROPERTIES),
+        SD_BUS_METHOD("Replace", NULL, NULL, replace_object, 0),
+        SD_BUS_METHOD("Bump", NULL, NULL, bump_generation, 0),
+        SD_BUS_METHOD("Invalidate", NULL, NULL, invalidate_generation, 0),
+        SD_BUS_PROPERTY("Name", "s", NULL, offsetof(struct context, automatic_string_property), SD_BUS_VTABLE_PROPERTY_CONST),
+        SD_BUS_PROPERTY("Generation", "u", generation_handler, 0, SD_BUS_VTABLE_PROPERTY_EMITS_CHANGE),
+        SD_BUS_PROPERTY("Strings", "as", strings_handler, 0, SD_BUS_VTABLE_PROPERTY_CONST),
+        SD_BUS_PROPERTY("Something", "s", get_handler, 0, SD_BUS_VTABLE_PROPERTY_EXPLICIT),
+        SD_BUS_VTABLE_END
+};
+
+static const sd_bus_vtable vtable_cached_invalid[] = {
+        SD_BUS_VTABLE_START(SD_BUS_VTABLE_CACHE_PROPERTIES),
+        SD_BUS_PROPERTY("Value4", "s", value_handler, 10, 0),
+        SD_BUS_VTABLE_END
+};
+
 static int enumerator_callback(sd_bus *bus, const char *path, void *userdata, char ***nodes, sd_bus_error *error) {
 
         if (object_path_startswith("/value", path))
@@ -243,6 +292,9 @@ static void *server(void *p) {
         assert_se(sd_bus_add_node_enumerator(bus, NULL, "/value/a", enumerator2_callback, NULL) >= 0);
         assert_se(sd_bus_add_object_manager(bus, NULL, "/value") >= 0);
         assert_se(sd_bus_add_object_manager(bus, NULL, "/value/a") >= 0);
+        assert_se(sd_bus_add_object_vtable(bus, NULL, "/cached", "org.freedesktop.systemd.CacheTest", vtable_cached, c) >= 0);
+        assert_se(sd_bus_add_object_vtable(bus, NULL, "/cached", "org.freedesktop.systemd.CacheTest2", vtable_cached_invalid, c) == -EINVAL);
+        assert_se(sd_bus_add_object_manager(bus, NULL, "/cached") >= 0);
 
         assert_se(sd_bus_start(bus) >= 0);
 
@@ -279,6 +331,42 @@ fail:
         return INT_TO_PTR(r);
 }
 
+static uint32_t get_all_cached(sd_bus *bus) {
+        _cleanup_(sd_bus_message_unrefp) sd_bus_message *reply = NULL;
+        _cleanup_(sd_bus_error_free) sd_bus_error error = SD_BUS_ERROR_NULL;
+        _cleanup_strv_free_ char **strings = NULL;
+        const char *name, *s;
+        uint32_t generation = 0;
+        unsigned n = 0;
+
+        assert_se(sd_bus_call_method(bus, "org.freedesktop.systemd.test", "/cached", "org.freedesktop.DBus.Properties", "GetAll", &error, &reply, "s", "org.freedesktop.systemd.CacheTest") >= 0);
+
+        assert_se(sd_bus_message_enter_container(reply, 'a', "{sv}") > 0);
+        while (sd_bus_message_enter_container(reply, 'e', "sv") > 0) {
+                assert_se(sd_bus_message_read(reply, "s", &name) > 0);
+
+                if (streq(name, "Name")) {
+                        assert_se(sd_bus_message_read(reply, "v", "s", &s) > 0);
+                        assert_se(streq(s, "Du Dödel, Du!"));
+                } else if (streq(name, "Generation"))
+                        assert_se(sd_bus_message_read(reply, "v", "u", &generation) > 0);
+                else if (streq(name, "Strings")) {
+                        assert_se(sd_bus_message_enter_container(reply, 'v', "as") > 0);
+                        assert_se(sd_bus_message_read_strv(reply, &strings) > 0);
+                        assert_se(strv_equal(strings, STRV_MAKE("a", "bb", "ccc")));
+                        assert_se(sd_bus_message_exit_container(reply) > 0);
+                } else
+                        assert_not_reached("Unexpected property");
+
+                assert_se(sd_bus_message_exit_container(reply) > 0);
+                n++;
+        }
+        assert_se(sd_bus_message_exit_container(reply) > 0);
+        assert_se(n == 3);
+
+        return generation;
+}
+
 static int client(struct context *c) {
         _cleanup_(sd_bus_message_unrefp) sd_bus_message *reply = NULL;
         _cleanup_(sd_bus_unrefp) sd_bus *bus = NULL;
@@ -496,6 +584,46 @@ static int client(struct context *c) {
         sd_bus_message_unref(reply);
         reply = NULL;
 
+        /* The first GetAll() calls the getters, the second one is answered from the cache */
+        assert_se(get_all_cached(bus) == 1);
+        assert_se(get_all_cached(bus) == 1);
+
+        /* Emitting PropertiesChanged calls the getter once more, and drops the cached reply */
+        r = sd_bus_call_method(bus, "org.freedesktop.systemd.test", "/cached", "org.freedesktop.systemd.CacheTest", "Bump", &error, NULL, "");
+        assert_se(r >= 0);
+
+        r = sd_bus_process(bus, &reply);
+        assert_se(r > 0);
+
+        assert_se(sd_bus_message_is_signal(reply, "org.freedesktop.DBus.Properties", "PropertiesChanged"));
+
+        sd_bus_message_unref(reply);
+        reply = NULL;
+
+        assert_se(get_all_cached(bus) == 3);
+        assert_se(get_all_cached(bus) == 3);
+
+        r = sd_bus_call_method(bus, "org.freedesktop.systemd.test", "/cached", "org.freedesktop.systemd.CacheTest", "Invalidate", &error, NULL, "");
+        assert_se(r >= 0);
+
+        assert_se(get_all_cached(bus) == 4);
+        assert_se(get_all_cached(bus) == 4);
+
+        /* The properties sent along with InterfacesAdded are not taken from the cache, and replace it */
+        r = sd_bus_call_method(bus, "org.freedesktop.systemd.test", "/cached", "org.freedesktop.systemd.CacheTest", "Replace", &error, NULL, "");
+        assert_se(r >= 0);
+
+        r = sd_bus_process(bus, &reply);
+        assert_se(r > 0);
+
+        assert_se(sd_bus_message_is_signal(reply, "org.freedesktop.DBus.ObjectManager", "InterfacesAdded"));
+
+        sd_bus_message_unref(reply);
+        reply = NULL;
+
+        assert_se(get_all_cached(bus) == 5);
+        assert_se(get_all_cached(bus) == 5);
+
         r = sd_bus_call_method(bus, "org.freedesktop.systemd.test", "/foo", "org.freedesktop.systemd.test", "Exit", &error, NULL, "");
         assert_se(r >= 0);
 
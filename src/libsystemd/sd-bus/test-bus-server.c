@@ -7,7 +7,9 @@
 
 #include "sd-bus.h"
 
+#include "alloc-util.h"
 #include "bus-internal.h"
+#include "bus-message.h"
 #include "bus-util.h"
 #include "log.h"
 #include "macro.h"
@@ -21,8 +23,26 @@ struct context {
 
         bool client_anonymous_auth;
         bool server_anonymous_auth;
+
+        bool client_negotiate_memfd;
+        bool server_negotiate_memfd;
 };
 
+#define BLOB_SIZE (1024U*1024U)
+
+static bool blob_is_valid(const uint8_t *p, size_t sz) {
+        size_t i;
+
+        if (sz != BLOB_SIZE)
+                return false;
+
+        for (i = 0; i < sz; i++)
+                if (p[i] != (uint8_t) i)
+                        return false;
+
+        return true;
+}
+
 static void *server(void *p) {
         struct context *c = p;
         sd_bus *bus = NULL;
@@ -37,6 +57,7 @@ static void *server(void *p) {
         assert_se(sd_bus_set_server(bus, 1, id) >= 0);
         assert_se(sd_bus_set_anonymous(bus, c->server_anonymous_auth) >= 0);
         assert_se(sd_bus_negotiate_fds(bus, c->server_negotiate_unix_fds) >= 0);
+        bus->accept_memfd = c->server_negotiate_memfd;
         assert_se(sd_bus_start(bus) >= 0);
 
         while (!quit) {
@@ -76,6 +97,28 @@ static void *server(void *p) {
 
                         quit = true;
 
+                } else if (sd_bus_message_is_method_call(m, "org.freedesktop.systemd.test", "Blob")) {
+                        const void *data;
+                        size_t sz;
+
+                        /* If negotiated, the body must have been passed as memfd */
+                        assert_se((m->body.memfd >= 0) == bus->can_memfd);
+
+                        assert_se(sd_bus_message_read_array(m, 'y', &data, &sz) >= 0);
+                        assert_se(blob_is_valid(data, sz));
+
+                        r = sd_bus_message_new_method_return(m, &reply);
+                        if (r < 0) {
+                                log_error_errno(r, "Failed to allocate return: %m");
+                                goto fail;
+                        }
+
+                        r = sd_bus_message_append_array(reply, 'y', data, sz);
+                        if (r < 0) {
+                                log_error_errno(r, "Failed to append array: %m");
+                                goto fail;
+                        }
+
                 } else if (sd_bus_message_is_method_call(m, NULL, NULL)) {
                         r = sd_bus_message_new_method_error(
                                         m,
@@ -107,6 +150,44 @@ fail:
         return INT_TO_PTR(r);
 }
 
+static int client_blob(sd_bus *bus) {
+        _cleanup_(sd_bus_message_unrefp) sd_bus_message *m = NULL, *reply = NULL;
+        _cleanup_free_ uint8_t *blob = NULL;
+        sd_bus_error error = SD_BUS_ERROR_NULL;
+        const void *p;
+        size_t i, sz;
+        int r;
+
+        blob = new(uint8_t, BLOB_SIZE);
+        assert_se(blob);
+
+        for (i = 0; i < BLOB_SIZE; i++)
+                blob[i] = (uint8_t) i;
+
+        r = sd_bus_message_new_method_call(
+                        bus,
+                        &m,
+                        "org.freedesktop.systemd.test",
+                        "/",
+                        "org.freedesktop.systemd.test",
+                        "Blob");
+        if (r < 0)
+                return log_error_errno(r, "Failed to allocate method call: %m");
+
+        r = sd_bus_message_append_array(m, 'y', blob, BLOB_SIZE);
+        if (r < 0)
+                return log_error_errno(r, "Failed to append array: %m");
+
+        r = sd_bus_call(bus, m, 0, &error, &reply);
+        if (r < 0)
+                return log_error_errno(r, "Failed to issue method call: %s", bus_error_message(&error, -r));
+
+        assert_se(sd_bus_message_read_array(reply, 'y', &p, &sz) >= 0);
+        assert_se(blob_is_valid(p, sz));
+
+        return 0;
+}
+
 static int client(struct context *c) {
         _cleanup_(sd_bus_message_unrefp) sd_bus_message *m = NULL, *reply = NULL;
         _cleanup_(sd_bus_unrefp) sd_bus *bus = NULL;
@@ -117,8 +198,17 @@ static int client(struct context *c) {
         assert_se(sd_bus_set_fd(bus, c->fds[1], c->fds[1]) >= 0);
         assert_se(sd_bus_negotiate_fds(bus, c->client_negotiate_unix_fds) >= 0);
         assert_se(sd_bus_set_anonymous(bus, c->client_anonymous_auth) >= 0);
+        bus->accept_memfd = c->client_negotiate_memfd;
         assert_se(sd_bus_start(bus) >= 0);
 
+        r = client_blob(bus);
+        if (r < 0)
+                return r;
+
+        assert_se(bus->can_memfd ==
+                  (c->client_negotiate_unix_fds && c->server_negotiate_unix_fds &&
+                   c->client_negotiate_memfd && c->server_negotiate_memfd));
+
         r = sd_bus_message_new_method_call(
                         bus,
                         &m,
@@ -137,7 +227,8 @@ static int client(struct context *c) {
 }
 
 static int test_one(bool client_negotiate_unix_fds, bool server_negotiate_unix_fds,
-                    bool client_anonymous_auth, bool server_anonymous_auth) {
+                    bool client_anonymous_auth, bool server_anonymous_auth,
+                    bool client_negotiate_memfd, bool server_negotiate_memfd) {
 
         struct context c;
         pthread_t s;
@@ -152,6 +243,8 @@ static int test_one(bool client_negotiate_unix_fds, bool server_negotiate_unix_f
         c.server_negotiate_unix_fds = server_negotiate_unix_fds;
         c.client_anonymous_auth = client_anonymous_auth;
         c.server_anonymous_auth = server_anonymous_auth;
+        c.client_negotiate_memfd = client_negotiate_memfd;
+        c.server_negotiate_memfd = server_negotiate_memfd;
 
         r = pthread_create(&s, NULL, server, &c);
         if (r != 0)
@@ -175,26 +268,38 @@ static int test_one(bool client_negotiate_unix_fds, bool server_negotiate_unix_f
 int main(int argc, char *argv[]) {
         int r;
 
-        r = test_one(true, true, false, false);
+        r = test_one(true, true, false, false, false, false);
         assert_se(r >= 0);
 
-        r = test_one(true, false, false, false);
+        r = test_one(true, false, false, false, false, false);
         assert_se(r >= 0);
 
-        r = test_one(false, true, false, false);
+        r = test_one(false, true, false, false, false, false);
         assert_se(r >= 0);
 
-        r = test_one(false, false, false, false);
+        r = test_one(false, false, false, false, false, false);
         assert_se(r >= 0);
 
-        r = test_one(true, true, true, true);
+        r = test_one(true, true, true, true, false, false);
         assert_se(r >= 0);
 
-        r = test_one(true, true, false, true);
+        r = test_one(true, true, false, true, false, false);
         assert_se(r >= 0);
 
-        r = test_one(true, true, true, false);
+        r = test_one(true, true, true, false, false, false);
         assert_se(r == -EPERM);
 
+        r = test_one(true, true, false, false, true, true);
+        assert_se(r >= 0);
+
+        r = test_one(true, true, false, false, true, false);
+        assert_se(r >= 0);
+
+        r = test_one(true, true, false, false, false, true);
+        assert_se(r >= 0);
+
+        r = test_one(false, true, false, false, true, true);
+        assert_se(r >= 0);
+
         return EXIT_SUCCESS;
 }
@@ -225,22 +225,13 @@ void dns_cache_prune(DnsCache *c) {
         }
 }
 
-static int dns_cache_item_prioq_compare_func(const void *a, const void *b) {
-        const DnsCacheItem *x = a, *y = b;
-
-        if (x->until < y->until)
-                return -1;
-        if (x->until > y->until)
-                return 1;
-        return 0;
-}
-
 static int dns_cache_init(DnsCache *c) {
         int r;
 
         assert(c);
 
-        r = prioq_ensure_allocated(&c->by_expiry, dns_cache_item_prioq_compare_func);
+        /* Ordered by the expiry time, which is passed along as key */
+        r = prioq_ensure_allocated(&c->by_expiry, NULL);
         if (r < 0)
                 return r;
 
@@ -258,7 +249,7 @@ static int dns_cache_link_item(DnsCache *c, DnsCacheItem *i) {
         assert(c);
         assert(i);
 
-        r = prioq_put(c->by_expiry, i, &i->prioq_idx);
+        r = prioq_put_with_key(c->by_expiry, i, &i->prioq_idx, i->until);
         if (r < 0)
                 return r;
 
@@ -379,7 +370,7 @@ static void dns_cache_item_update_positive(
         i->owner_family = owner_family;
         i->owner_address = *owner_address;
 
-        prioq_reshuffle(c->by_expiry, i, &i->prioq_idx);
+        prioq_set_key(c->by_expiry, i, &i->prioq_idx, i->until);
 }
 
 static int dns_cache_put_positive(
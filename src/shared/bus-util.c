@@ -604,6 +604,9 @@ int bus_connect_system_systemd(sd_bus **_bus) {
         if (r < 0)
                 return r;
 
+        /* PID 1 is an sd-bus peer, hence large message bodies may be passed as memfds */
+        bus->accept_memfd = true;
+
         r = sd_bus_start(bus);
         if (r < 0)
                 return sd_bus_default_system(_bus);
@@ -641,6 +644,8 @@ int bus_connect_user_systemd(sd_bus **_bus) {
         if (!bus->address)
                 return -ENOMEM;
 
+        bus->accept_memfd = true;
+
         r = sd_bus_start(bus);
         if (r < 0)
                 return sd_bus_default_user(_bus);
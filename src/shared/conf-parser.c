@@ -2,11 +2,16 @@
 
 #include <errno.h>
 #include <limits.h>
+#include <pthread.h>
+#include <signal.h>
 #include <stdint.h>
 #include <stdio.h>
+#include <stdio_ext.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/stat.h>
 #include <sys/types.h>
+#include <unistd.h>
 
 #include "alloc-util.h"
 #include "conf-files.h"
@@ -273,38 +278,41 @@ static int parse_line(
                                userdata);
 }
 
-/* Go through the file and parse each line */
-int config_parse(const char *unit,
-                 const char *filename,
-                 FILE *f,
-                 const char *sections,
-                 ConfigItemLookup lookup,
-                 const void *table,
-                 ConfigParseFlags flags,
-                 void *userdata) {
+ConfigSource* config_source_free(ConfigSource *s) {
+        if (!s)
+                return NULL;
 
-        _cleanup_free_ char *section = NULL, *continuation = NULL;
-        _cleanup_fclose_ FILE *ours = NULL;
-        unsigned line = 0, section_line = 0;
-        bool section_ignored = false;
+        free(s->path);
+        strv_free(s->lines);
+
+        return mfree(s);
+}
+
+/* Split the file into logical lines, without interpreting them yet. This doesn't log and doesn't touch any global
+ * state, hence may be called from any thread. */
+int config_source_read(const char *filename, FILE *f, ConfigParseFlags flags, ConfigSource **ret) {
+        _cleanup_(config_source_freep) ConfigSource *s = NULL;
+        _cleanup_free_ char *continuation = NULL;
+        size_t n_allocated = 0;
         int r;
 
         assert(filename);
-        assert(lookup);
+        assert(f);
+        assert(ret);
 
-        if (!f) {
-                f = ours = fopen(filename, "re");
-                if (!f) {
-                        /* Only log on request, except for ENOENT,
-                         * since we return 0 to the caller. */
-                        if ((flags & CONFIG_PARSE_WARN) || errno == ENOENT)
-                                log_full_errno(errno == ENOENT ? LOG_DEBUG : LOG_ERR, errno,
-                                               "Failed to open configuration file '%s': %m", filename);
-                        return errno == ENOENT ? 0 : -errno;
-                }
-        }
+        s = new0(ConfigSource, 1);
+        if (!s)
+                return -ENOMEM;
+
+        s->path = strdup(filename);
+        if (!s->path)
+                return -ENOMEM;
+
+        /* Streams without a file descriptor can't be checked for changes later on, hence are never considered
+         * current. The same goes for files we fail to stat() for some reason. */
+        s->st_valid = fileno(f) >= 0 && fstat(fileno(f), &s->st) >= 0;
 
-        fd_warn_permissions(filename, fileno(f));
+        s->flags = flags & CONFIG_PARSE_REFUSE_BOM;
 
         for (;;) {
                 _cleanup_free_ char *buf = NULL;
@@ -314,17 +322,10 @@ int config_parse(const char *unit,
                 r = read_line(f, LONG_LINE_MAX, &buf);
                 if (r == 0)
                         break;
-                if (r == -ENOBUFS) {
-                        if (flags & CONFIG_PARSE_WARN)
-                                log_error_errno(r, "%s:%u: Line too long", filename, line);
-
-                        return r;
-                }
                 if (r < 0) {
-                        if (CONFIG_PARSE_WARN)
-                                log_error_errno(r, "%s:%u: Error while reading configuration file: %m", filename, line);
-
-                        return r;
+                        /* Remember the error, it's reported once the lines before it were parsed */
+                        s->error = r;
+                        goto finish;
                 }
 
                 l = buf;
@@ -333,23 +334,20 @@ int config_parse(const char *unit,
 
                         q = startswith(buf, UTF8_BYTE_ORDER_MARK);
                         if (q) {
-                                l = q;
+                                memmove(buf, q, strlen(q) + 1);
                                 flags |= CONFIG_PARSE_REFUSE_BOM;
                         }
                 }
 
                 if (continuation) {
                         if (strlen(continuation) + strlen(l) > LONG_LINE_MAX) {
-                                if (flags & CONFIG_PARSE_WARN)
-                                        log_error("%s:%u: Continuation line too long", filename, line);
-                                return -ENOBUFS;
+                                s->error = -ENOBUFS;
+                                s->error_continuation = true;
+                                goto finish;
                         }
 
-                        if (!strextend(&continuation, l, NULL)) {
-                                if (flags & CONFIG_PARSE_WARN)
-                                        log_oom();
+                        if (!strextend(&continuation, l, NULL))
                                 return -ENOMEM;
-                        }
 
                         p = continuation;
                 } else
@@ -367,40 +365,172 @@ int config_parse(const char *unit,
 
                         if (!continuation) {
                                 continuation = strdup(l);
-                                if (!continuation) {
-                                        if (flags & CONFIG_PARSE_WARN)
-                                                log_oom();
+                                if (!continuation)
                                         return -ENOMEM;
-                                }
                         }
 
                         continue;
                 }
 
-                r = parse_line(unit,
-                               filename,
-                               ++line,
-                               sections,
-                               lookup,
-                               table,
-                               flags,
-                               &section,
-                               &section_line,
-                               &section_ignored,
-                               p,
-                               userdata);
-                if (r < 0) {
-                        if (flags & CONFIG_PARSE_WARN)
-                                log_warning_errno(r, "%s:%u: Failed to parse file: %m", filename, line);
-                        return r;
-                }
+                if (!GREEDY_REALLOC(s->lines, n_allocated, s->n_lines + 2))
+                        return -ENOMEM;
 
-                continuation = mfree(continuation);
+                s->lines[s->n_lines++] = continuation ? TAKE_PTR(continuation) : TAKE_PTR(buf);
+                s->lines[s->n_lines] = NULL;
         }
 
         if (continuation) {
+                if (!GREEDY_REALLOC(s->lines, n_allocated, s->n_lines + 2))
+                        return -ENOMEM;
+
+                s->lines[s->n_lines++] = TAKE_PTR(continuation);
+                s->lines[s->n_lines] = NULL;
+        }
+
+finish:
+        *ret = TAKE_PTR(s);
+        return 0;
+}
+
+bool config_source_is_current(const ConfigSource *s, const struct stat *st, ConfigParseFlags flags) {
+        assert(s);
+        assert(st);
+
+        return s->st_valid &&
+                s->st.st_dev == st->st_dev &&
+                s->st.st_ino == st->st_ino &&
+                s->st.st_size == st->st_size &&
+                timespec_load_nsec(&s->st.st_mtim) == timespec_load_nsec(&st->st_mtim) &&
+                s->flags == (flags & CONFIG_PARSE_REFUSE_BOM);
+}
+
+typedef struct ReadManyContext {
+        char **paths;
+        ConfigSource **sources;
+        size_t n;
+        ConfigParseFlags flags;
+        size_t next;
+} ReadManyContext;
+
+static void* config_source_read_thread(void *p) {
+        ReadManyContext *c = p;
+
+        for (;;) {
+                _cleanup_fclose_ FILE *f = NULL;
+                struct stat st;
+                size_t i;
+
+                i = __sync_fetch_and_add(&c->next, 1);
+                if (i >= c->n)
+                        break;
+
+                if (stat(c->paths[i], &st) < 0 || !S_ISREG(st.st_mode)) {
+                        c->sources[i] = NULL;
+                        continue;
+                }
+
+                if (c->sources[i] && config_source_is_current(c->sources[i], &st, c->flags))
+                        continue;
+
+                c->sources[i] = NULL;
+
+                f = fopen(c->paths[i], "re");
+                if (!f)
+                        continue;
+
+                (void) __fsetlocking(f, FSETLOCKING_BYCALLER);
+
+                (void) config_source_read(c->paths[i], f, c->flags, c->sources + i);
+        }
+
+        return NULL;
+}
+
+/* Reads the specified files on a couple of threads. On input sources[i] may point to what is known about paths[i]
+ * already, it is left as is if the file didn't change, and replaced by a new object otherwise, or NULL if the file
+ * can't be read. Neither kind of object is freed here, that's up to the caller. */
+int config_source_read_many(char **paths, ConfigParseFlags flags, ConfigSource **sources) {
+        ReadManyContext c = {
+                .paths = paths,
+                .sources = sources,
+                .n = strv_length(paths),
+                .flags = flags,
+        };
+        pthread_t threads[CONFIG_SOURCE_READ_THREADS_MAX];
+        sigset_t ss, saved_ss;
+        unsigned i, n_threads = 0, n_wanted;
+        long ncpus;
+        int r;
+
+        assert(sources || c.n == 0);
+
+        ncpus = sysconf(_SC_NPROCESSORS_ONLN);
+        n_wanted = CLAMP(ncpus, 1, (long) ELEMENTSOF(threads));
+        /* Starting a thread is not worth it for a handful of files */
+        n_wanted = MIN(n_wanted, (unsigned) (c.n / 16));
+
+        if (n_wanted > 1) {
+                /* Start the threads with all signals blocked, so that they don't affect signal handling */
+                assert_se(sigfillset(&ss) >= 0);
+
+                r = pthread_sigmask(SIG_BLOCK, &ss, &saved_ss);
+                if (r > 0)
+                        return -r;
+
+                for (i = 1; i < n_wanted; i++) {
+                        if (pthread_create(threads + n_threads, NULL, config_source_read_thread, &c) != 0)
+                                break; /* Proceed with the threads we got */
+
+                        n_threads++;
+                }
+
+                assert_se(pthread_sigmask(SIG_SETMASK, &saved_ss, NULL) == 0);
+        }
+
+        /* The calling thread helps out too, so that this makes progress even if no thread could be started */
+        (void) config_source_read_thread(&c);
+
+        for (i = 0; i < n_threads; i++)
+                assert_se(pthread_join(threads[i], NULL) == 0);
+
+        return 0;
+}
+
+/* Go through the logical lines of a file and parse each */
+int config_parse_source(
+                const char *unit,
+                const ConfigSource *s,
+                const char *sections,
+                ConfigItemLookup lookup,
+                const void *table,
+                ConfigParseFlags flags,
+                void *userdata) {
+
+        _cleanup_free_ char *section = NULL;
+        unsigned line = 0, section_line = 0;
+        bool section_ignored = false;
+        char **l;
+        int r;
+
+        assert(s);
+        assert(lookup);
+
+        if (s->st_valid)
+                stat_warn_permissions(s->path, &s->st);
+
+        STRV_FOREACH(l, s->lines) {
+                _cleanup_free_ char *p = NULL;
+
+                /* parse_line() works in place, but the source might be parsed again later */
+                p = strdup(*l);
+                if (!p) {
+                        if (flags & CONFIG_PARSE_WARN)
+                                log_oom();
+                        return -ENOMEM;
+                }
+
                 r = parse_line(unit,
-                               filename,
+                               s->path,
                                ++line,
                                sections,
                                lookup,
@@ -409,18 +539,70 @@ int config_parse(const char *unit,
                                &section,
                                &section_line,
                                &section_ignored,
-                               continuation,
+                               p,
                                userdata);
                 if (r < 0) {
                         if (flags & CONFIG_PARSE_WARN)
-                                log_warning_errno(r, "%s:%u: Failed to parse file: %m", filename, line);
+                                log_warning_errno(r, "%s:%u: Failed to parse file: %m", s->path, line);
                         return r;
                 }
         }
 
+        if (s->error == -ENOBUFS) {
+                if (flags & CONFIG_PARSE_WARN) {
+                        if (s->error_continuation)
+                                log_error("%s:%u: Continuation line too long", s->path, line);
+                        else
+                                log_error_errno(s->error, "%s:%u: Line too long", s->path, line);
+                }
+
+                return s->error;
+        }
+        if (s->error < 0)
+                return log_error_errno(s->error, "%s:%u: Error while reading configuration file: %m", s->path, line);
+
         return 0;
 }
 
+/* Go through the file and parse each line */
+int config_parse(const char *unit,
+                 const char *filename,
+                 FILE *f,
+                 const char *sections,
+                 ConfigItemLookup lookup,
+                 const void *table,
+                 ConfigParseFlags flags,
+                 void *userdata) {
+
+        _cleanup_(config_source_freep) ConfigSource *s = NULL;
+        _cleanup_fclose_ FILE *ours = NULL;
+        int r;
+
+        assert(filename);
+        assert(lookup);
+
+        if (!f) {
+                f = ours = fopen(filename, "re");
+                if (!f) {
+                        /* Only log on request, except for ENOENT,
+                         * since we return 0 to the caller. */
+                        if ((flags & CONFIG_PARSE_WARN) || errno == ENOENT)
+                                log_full_errno(errno == ENOENT ? LOG_DEBUG : LOG_ERR, errno,
+                                               "Failed to open configuration file '%s': %m", filename);
+                        return errno == ENOENT ? 0 : -errno;
+                }
+        }
+
+        r = config_source_read(filename, f, flags, &s);
+        if (r < 0) {
+                if (flags & CONFIG_PARSE_WARN)
+                        log_error_errno(r, "Failed to read configuration file '%s': %m", filename);
+                return r;
+        }
+
+        return config_parse_source(unit, s, sections, lookup, table, flags, userdata);
+}
+
 static int config_parse_many_files(
                 const char *conf_file,
                 char **files,
@@ -5,6 +5,7 @@
 #include <stdbool.h>
 #include <stddef.h>
 #include <stdio.h>
+#include <sys/stat.h>
 #include <syslog.h>
 
 #include "alloc-util.h"
@@ -81,6 +82,38 @@ int config_item_table_lookup(const void *table, const char *section, const char
  * ConfigPerfItem tables */
 int config_item_perf_lookup(const void *table, const char *section, const char *lvalue, ConfigParserCallback *func, int *ltype, void **data, void *userdata);
 
+/* A configuration file split into logical lines, i.e. with comments still in place but continuation lines joined.
+ * Reading files into this form may happen ahead of time, and on other threads, and the result may be kept around
+ * and parsed again, for as long as the file didn't change. */
+typedef struct ConfigSource {
+        char *path;
+        struct stat st;          /* of the file the lines were read from */
+        bool st_valid;           /* false if the file couldn't be stat()ed, e.g. for fmemopen() streams */
+        ConfigParseFlags flags;  /* the flags that affect splitting, i.e. CONFIG_PARSE_REFUSE_BOM */
+        char **lines;
+        size_t n_lines;
+        int error;               /* if non-zero, reading stopped early with this error */
+        bool error_continuation; /* whether error is about a continuation line that got too long */
+        bool used;               /* for use by caches */
+} ConfigSource;
+
+#define CONFIG_SOURCE_READ_THREADS_MAX 8U
+
+int config_source_read(const char *filename, FILE *f, ConfigParseFlags flags, ConfigSource **ret);
+int config_source_read_many(char **paths, ConfigParseFlags flags, ConfigSource **sources);
+bool config_source_is_current(const ConfigSource *s, const struct stat *st, ConfigParseFlags flags);
+ConfigSource* config_source_free(ConfigSource *s);
+DEFINE_TRIVIAL_CLEANUP_FUNC(ConfigSource*, config_source_free);
+
+int config_parse_source(
+                const char *unit,
+                const ConfigSource *s,
+                const char *sections,  /* nulstr */
+                ConfigItemLookup lookup,
+                const void *table,
+                ConfigParseFlags flags,
+                void *userdata);
+
 int config_parse(
                 const char *unit,
                 const char *filename,
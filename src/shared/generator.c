@@ -7,6 +7,7 @@
 #include "alloc-util.h"
 #include "dropin.h"
 #include "escape.h"
+#include "extract-word.h"
 #include "fd-util.h"
 #include "fileio.h"
 #include "fstab-util.h"
@@ -55,6 +56,47 @@ int generator_open_unit_file(
         return 0;
 }
 
+int generator_add_input(const char *path) {
+        _cleanup_fclose_ FILE *f = NULL;
+        const char *fn;
+
+        assert(path);
+
+        /* Declares a file or directory the output of the generator is derived from. The service manager may skip
+         * running a generator again as long as none of the inputs it declared changed, and reuse the output of the
+         * previous run instead. Hence a generator that declares any input needs to declare all of them: files it
+         * reads, directories it enumerates, and paths whose existence it checks. */
+
+        fn = getenv("SYSTEMD_GENERATOR_INPUTS");
+        if (!fn)
+                return 0;
+
+        f = fopen(fn, "ae");
+        if (!f)
+                return log_debug_errno(errno, "Failed to open %s: %m", fn);
+
+        fputs(path, f);
+        fputc('\n', f);
+
+        return fflush_and_check(f);
+}
+
+static void add_binary_search_path_inputs(void) {
+        const char *p;
+
+        /* Whether a helper binary exists depends on all directories it is looked for in */
+
+        p = getenv("PATH") ?: DEFAULT_PATH;
+        for (;;) {
+                _cleanup_free_ char *dir = NULL;
+
+                if (extract_first_word(&p, &dir, ":", EXTRACT_DONT_COALESCE_SEPARATORS) <= 0)
+                        break;
+
+                (void) generator_add_input(dir);
+        }
+}
+
 int generator_add_symlink(const char *root, const char *dst, const char *dep_type, const char *src) {
         /* Adds a symlink from <dst>.<dep_type>.d/ to ../<src> */
 
@@ -143,6 +185,8 @@ int generator_write_fsck_deps(
         }
 
         if (!isempty(fstype) && !streq(fstype, "auto")) {
+                add_binary_search_path_inputs();
+
                 r = fsck_exists(fstype);
                 if (r < 0)
                         log_warning_errno(r, "Checking was requested for %s, but couldn't detect if fsck.%s may be used, proceeding: %m", what, fstype);
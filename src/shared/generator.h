@@ -9,6 +9,8 @@ int generator_open_unit_file(
         const char *name,
         FILE **file);
 
+int generator_add_input(const char *path);
+
 int generator_add_symlink(const char *root, const char *dst, const char *dep_type, const char *src);
 
 int generator_write_fsck_deps(
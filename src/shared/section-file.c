@@ -0,0 +1,195 @@
+/* SPDX-License-Identifier: LGPL-2.1+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "alloc-util.h"
+#include "fd-util.h"
+#include "fileio.h"
+#include "fs-util.h"
+#include "io-util.h"
+#include "section-file.h"
+
+static int write_padding(FILE *f, uint64_t *offset, uint64_t alignment) {
+        static const uint8_t zeroes[SECTION_FILE_ALIGN] = {};
+        uint64_t n;
+
+        n = ALIGN_TO(*offset, alignment) - *offset;
+        if (n == 0)
+                return 0;
+
+        if (fwrite(zeroes, n, 1, f) != 1)
+                return -EIO;
+
+        *offset += n;
+        return 0;
+}
+
+int section_file_write(
+                const char *path,
+                const char signature[static SECTION_FILE_SIGNATURE_SIZE],
+                uint64_t version,
+                uint64_t stamp,
+                const struct iovec *sections,
+                size_t n_sections,
+                mode_t mode) {
+
+        _cleanup_(unlink_and_freep) char *temp_path = NULL;
+        _cleanup_fclose_ FILE *f = NULL;
+        _cleanup_free_ struct section_file_header *h = NULL;
+        uint64_t header_size, offset;
+        size_t i;
+        int r;
+
+        assert(path);
+        assert(signature);
+        assert(sections || n_sections == 0);
+
+        if (n_sections > SECTION_FILE_SECTIONS_MAX)
+                return -E2BIG;
+
+        header_size = offsetof(struct section_file_header, sections) + n_sections * sizeof(struct section_file_entry);
+
+        h = malloc0(header_size);
+        if (!h)
+                return -ENOMEM;
+
+        memcpy(h->signature, signature, SECTION_FILE_SIGNATURE_SIZE);
+        h->version = htole64(version);
+        h->stamp = htole64(stamp);
+        h->header_size = htole64(header_size);
+        h->n_sections = htole64(n_sections);
+
+        offset = header_size;
+        for (i = 0; i < n_sections; i++) {
+                offset = ALIGN_TO(offset, SECTION_FILE_ALIGN);
+                h->sections[i].offset = htole64(offset);
+                h->sections[i].size = htole64(sections[i].iov_len);
+                offset += sections[i].iov_len;
+        }
+        h->file_size = htole64(offset);
+
+        r = fopen_temporary(path, &f, &temp_path);
+        if (r < 0)
+                return r;
+
+        if (fchmod(fileno(f), mode) < 0)
+                return -errno;
+
+        if (fwrite(h, header_size, 1, f) != 1)
+                return -EIO;
+
+        offset = header_size;
+        for (i = 0; i < n_sections; i++) {
+                r = write_padding(f, &offset, SECTION_FILE_ALIGN);
+                if (r < 0)
+                        return r;
+
+                if (sections[i].iov_len > 0 &&
+                    fwrite(sections[i].iov_base, sections[i].iov_len, 1, f) != 1)
+                        return -EIO;
+
+                offset += sections[i].iov_len;
+        }
+
+        r = fflush_and_check(f);
+        if (r < 0)
+                return r;
+
+        if (rename(temp_path, path) < 0)
+                return -errno;
+
+        temp_path = mfree(temp_path);
+        return 0;
+}
+
+int section_file_map(
+                const char *path,
+                const char signature[static SECTION_FILE_SIGNATURE_SIZE],
+                uint64_t version,
+                SectionFile *ret) {
+
+        _cleanup_close_ int fd = -1;
+        const struct section_file_header *h;
+        SectionFile f = {};
+        struct stat st;
+        uint64_t n_sections, header_size;
+        size_t i;
+        int r;
+
+        assert(path);
+        assert(signature);
+        assert(ret);
+
+        fd = open(path, O_RDONLY|O_CLOEXEC|O_NOCTTY);
+        if (fd < 0)
+                return -errno;
+
+        if (fstat(fd, &st) < 0)
+                return -errno;
+
+        if (!S_ISREG(st.st_mode))
+                return -EBADMSG;
+        if ((uint64_t) st.st_size < sizeof(struct section_file_header) || (uint64_t) st.st_size > SIZE_MAX)
+                return -EBADMSG;
+
+        f.size = st.st_size;
+        f.map = mmap(NULL, f.size, PROT_READ, MAP_SHARED, fd, 0);
+        if (f.map == MAP_FAILED)
+                return -errno;
+
+        h = f.map;
+        n_sections = le64toh(h->n_sections);
+        header_size = le64toh(h->header_size);
+
+        r = -EBADMSG;
+        if (memcmp(h->signature, signature, SECTION_FILE_SIGNATURE_SIZE) != 0 ||
+            n_sections > SECTION_FILE_SECTIONS_MAX ||
+            header_size < offsetof(struct section_file_header, sections) + n_sections * sizeof(struct section_file_entry) ||
+            header_size > f.size ||
+            le64toh(h->file_size) != f.size)
+                goto fail;
+
+        /* Report files written in a different format separately, callers will usually just rebuild them */
+        if (le64toh(h->version) != version) {
+                r = -EPROTONOSUPPORT;
+                goto fail;
+        }
+
+        for (i = 0; i < n_sections; i++) {
+                uint64_t offset, size;
+
+                offset = le64toh(h->sections[i].offset);
+                size = le64toh(h->sections[i].size);
+
+                if (offset < header_size || offset % SECTION_FILE_ALIGN != 0 ||
+                    offset > f.size || size > f.size - offset)
+                        goto fail;
+
+                f.sections[i] = IOVEC_MAKE((uint8_t*) f.map + offset, size);
+        }
+
+        f.n_sections = n_sections;
+        f.stamp = le64toh(h->stamp);
+
+        *ret = f;
+        return 0;
+
+fail:
+        (void) munmap(f.map, f.size);
+        return r;
+}
+
+void section_file_unmap(SectionFile *f) {
+        assert(f);
+
+        if (f->map)
+                (void) munmap(f->map, f->size);
+
+        *f = (SectionFile) {};
+}
@@ -0,0 +1,58 @@
+/* SPDX-License-Identifier: LGPL-2.1+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+
+#include "macro.h"
+#include "sparse-endian.h"
+
+/* A simple immutable container for precompiled tables: a header, followed by a number of sections, each of which
+ * starts on a page boundary. Readers map the file and use the sections in place, without parsing or copying them,
+ * so that all processes using the same file share its pages. */
+
+#define SECTION_FILE_SIGNATURE_SIZE 8
+#define SECTION_FILE_ALIGN 4096U
+#define SECTION_FILE_SECTIONS_MAX 16U
+
+struct section_file_entry {
+        le64_t offset;
+        le64_t size;
+} _packed_;
+
+struct section_file_header {
+        uint8_t signature[SECTION_FILE_SIGNATURE_SIZE];
+        le64_t version;       /* format version of the payload, as defined by the user */
+        le64_t stamp;         /* validity stamp, as defined by the user */
+        le64_t header_size;
+        le64_t file_size;
+        le64_t n_sections;
+        struct section_file_entry sections[];
+} _packed_;
+
+typedef struct SectionFile {
+        void *map;
+        size_t size;
+        uint64_t stamp;
+        size_t n_sections;
+        struct iovec sections[SECTION_FILE_SECTIONS_MAX];
+} SectionFile;
+
+int section_file_write(
+                const char *path,
+                const char signature[static SECTION_FILE_SIGNATURE_SIZE],
+                uint64_t version,
+                uint64_t stamp,
+                const struct iovec *sections,
+                size_t n_sections,
+                mode_t mode);
+
+int section_file_map(
+                const char *path,
+                const char signature[static SECTION_FILE_SIGNATURE_SIZE],
+                uint64_t version,
+                SectionFile *ret);
+
+void section_file_unmap(SectionFile *f);
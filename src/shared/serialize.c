@@ -0,0 +1,327 @@
+/* SPDX-License-Identifier: LGPL-2.1+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "alloc-util.h"
+#include "fileio.h"
+#include "serialize.h"
+#include "string-table.h"
+#include "string-util.h"
+#include "unaligned.h"
+
+typedef struct BinaryWriter {
+        FILE *f;
+
+        /* The beginning of a line that didn't fit into the last write */
+        char *pending;
+        size_t n_pending, n_allocated;
+} BinaryWriter;
+
+static bool is_blank(char c) {
+        return IN_SET(c, ' ', '\t', '\n', '\r');
+}
+
+static int binary_writer_emit(BinaryWriter *w, const char *line, size_t n) {
+        struct serialization_record rec;
+
+        /* Strip the line the same way text readers do, so that both formats yield the same lines */
+        while (n > 0 && is_blank(line[0])) {
+                line++;
+                n--;
+        }
+        while (n > 0 && is_blank(line[n-1]))
+                n--;
+
+        if (n >= UINT32_MAX)
+                return -E2BIG;
+
+        rec = (struct serialization_record) {
+                .type = htole32(SERIALIZATION_RECORD_LINE),
+                .size = htole32(n),
+        };
+
+        /* The underlying stream is ours alone while the writer is open, no need to lock it for each record */
+        if (fwrite_unlocked(&rec, sizeof(rec), 1, w->f) != 1)
+                return -EIO;
+        if (n > 0 && fwrite_unlocked(line, n, 1, w->f) != 1)
+                return -EIO;
+        if (fputc_unlocked(0, w->f) == EOF)
+                return -EIO;
+
+        return 0;
+}
+
+static ssize_t binary_writer_write(void *cookie, const char *buf, size_t size) {
+        BinaryWriter *w = cookie;
+        const char *p = buf, *e = buf + size;
+        int r;
+
+        for (;;) {
+                const char *nl;
+
+                nl = memchr(p, '\n', e - p);
+                if (!nl)
+                        break;
+
+                if (w->n_pending > 0) {
+                        if (!GREEDY_REALLOC(w->pending, w->n_allocated, w->n_pending + (nl - p))) {
+                                r = -ENOMEM;
+                                goto fail;
+                        }
+
+                        memcpy(w->pending + w->n_pending, p, nl - p);
+                        r = binary_writer_emit(w, w->pending, w->n_pending + (nl - p));
+                        w->n_pending = 0;
+                } else
+                        r = binary_writer_emit(w, p, nl - p);
+                if (r < 0)
+                        goto fail;
+
+                p = nl + 1;
+        }
+
+        if (p < e) {
+                if (!GREEDY_REALLOC(w->pending, w->n_allocated, w->n_pending + (e - p))) {
+                        r = -ENOMEM;
+                        goto fail;
+                }
+
+                memcpy(w->pending + w->n_pending, p, e - p);
+                w->n_pending += e - p;
+        }
+
+        return size;
+
+fail:
+        errno = -r;
+        return -1;
+}
+
+static int binary_writer_close(void *cookie) {
+        BinaryWriter *w = cookie;
+        int r = 0;
+
+        /* An unterminated last line is a line nonetheless */
+        if (w->n_pending > 0)
+                r = binary_writer_emit(w, w->pending, w->n_pending);
+
+        free(w->pending);
+        free(w);
+
+        if (r < 0) {
+                errno = -r;
+                return -1;
+        }
+
+        return 0;
+}
+
+int serialization_binary_writer_open(FILE *f, FILE **ret) {
+        static const cookie_io_functions_t functions = {
+                .write = binary_writer_write,
+                .close = binary_writer_close,
+        };
+        struct serialization_header h = {
+                .signature = SERIALIZATION_SIGNATURE,
+                .version = htole32(SERIALIZATION_VERSION),
+        };
+        BinaryWriter *w;
+        FILE *b;
+
+        assert(f);
+        assert(ret);
+
+        /* Returns a stream that takes lines the same way as the text format and writes them as binary records to
+         * the specified stream. The returned stream needs to be closed before the records may be read, the
+         * specified one is left open. */
+
+        if (fwrite(&h, sizeof(h), 1, f) != 1)
+                return -EIO;
+
+        w = new0(BinaryWriter, 1);
+        if (!w)
+                return -ENOMEM;
+
+        w->f = f;
+
+        b = fopencookie(w, "w", functions);
+        if (!b) {
+                free(w);
+                return -ENOMEM;
+        }
+
+        *ret = b;
+        return 0;
+}
+
+struct SerializationReader {
+        SerializationFormat format;
+
+        /* The remaining serialization, either mapped (copy-on-write, since lines are terminated in place) or read
+         * into memory */
+        char *data;
+        size_t size;
+        bool mapped;
+
+        size_t offset;
+
+        /* Copy of an unterminated last line in the text format */
+        char *last_line;
+};
+
+int serialization_reader_open(FILE *f, SerializationReader **ret) {
+        _cleanup_(serialization_reader_freep) SerializationReader *r = NULL;
+        struct stat st;
+        off_t pos;
+        int fd, k;
+
+        assert(f);
+        assert(ret);
+
+        /* Takes over everything from the current position of the stream to its end. Memory file descriptors and
+         * regular files are mapped, anything else is read. */
+
+        r = new0(SerializationReader, 1);
+        if (!r)
+                return -ENOMEM;
+
+        fd = fileno(f);
+        pos = ftello(f);
+
+        if (fd >= 0 && pos >= 0 && fstat(fd, &st) >= 0 && S_ISREG(st.st_mode) && st.st_size > pos &&
+            (uint64_t) st.st_size <= SIZE_MAX) {
+                void *p;
+
+                p = mmap(NULL, st.st_size, PROT_READ|PROT_WRITE, MAP_PRIVATE, fd, 0);
+                if (p == MAP_FAILED)
+                        return -errno;
+
+                r->data = p;
+                r->size = st.st_size;
+                r->mapped = true;
+                r->offset = pos;
+
+                if (fseeko(f, 0, SEEK_END) < 0)
+                        return -errno;
+        } else {
+                k = read_full_stream(f, &r->data, &r->size);
+                if (k < 0)
+                        return k;
+        }
+
+        if (r->size - r->offset >= sizeof(struct serialization_header) &&
+            memcmp(r->data + r->offset, SERIALIZATION_SIGNATURE, SERIALIZATION_SIGNATURE_SIZE) == 0) {
+                const struct serialization_header *h = (const struct serialization_header*) (r->data + r->offset);
+
+                if (le32toh(h->version) != SERIALIZATION_VERSION)
+                        return -EPROTONOSUPPORT;
+
+                r->format = SERIALIZATION_BINARY;
+                r->offset += sizeof(struct serialization_header);
+        } else
+                r->format = SERIALIZATION_TEXT;
+
+        *ret = TAKE_PTR(r);
+        return 0;
+}
+
+SerializationReader* serialization_reader_free(SerializationReader *r) {
+        if (!r)
+                return NULL;
+
+        if (r->mapped)
+                (void) munmap(r->data, r->size);
+        else
+                free(r->data);
+
+        free(r->last_line);
+        return mfree(r);
+}
+
+SerializationFormat serialization_reader_format(SerializationReader *r) {
+        assert(r);
+
+        return r->format;
+}
+
+static int read_line_binary(SerializationReader *r, char **ret) {
+        for (;;) {
+                uint32_t type, size;
+                char *payload;
+
+                if (r->offset >= r->size)
+                        return 0;
+
+                if (r->size - r->offset < sizeof(struct serialization_record))
+                        return -EBADMSG;
+
+                type = unaligned_read_le32(r->data + r->offset + offsetof(struct serialization_record, type));
+                size = unaligned_read_le32(r->data + r->offset + offsetof(struct serialization_record, size));
+
+                payload = r->data + r->offset + sizeof(struct serialization_record);
+                if (size >= r->size - r->offset - sizeof(struct serialization_record) || payload[size] != 0)
+                        return -EBADMSG;
+
+                r->offset += sizeof(struct serialization_record) + size + 1;
+
+                /* Skip over records we don't know, newer versions may add some */
+                if (type != SERIALIZATION_RECORD_LINE)
+                        continue;
+
+                *ret = payload;
+                return 1;
+        }
+}
+
+static int read_line_text(SerializationReader *r, char **ret) {
+        char *p, *nl;
+        size_t n;
+
+        if (r->offset >= r->size)
+                return 0;
+
+        p = r->data + r->offset;
+        n = r->size - r->offset;
+
+        nl = memchr(p, '\n', n);
+        if (nl) {
+                *nl = 0;
+                r->offset += nl - p + 1;
+        } else {
+                /* There's no room to terminate the last line in place */
+                free(r->last_line);
+                r->last_line = strndup(p, n);
+                if (!r->last_line)
+                        return -ENOMEM;
+
+                p = r->last_line;
+                r->offset = r->size;
+        }
+
+        *ret = strstrip(p);
+        return 1;
+}
+
+int serialization_read_line(SerializationReader *r, char **ret) {
+        assert(r);
+        assert(ret);
+
+        /* Returns the next line with whitespace stripped, or 0 at the end of the serialization. The line points into
+         * the reader's buffer, and may be modified by the caller, but it must not be freed. */
+
+        if (r->format == SERIALIZATION_BINARY)
+                return read_line_binary(r, ret);
+
+        return read_line_text(r, ret);
+}
+
+static const char* const serialization_format_table[_SERIALIZATION_FORMAT_MAX] = {
+        [SERIALIZATION_TEXT] = "text",
+        [SERIALIZATION_BINARY] = "binary",
+};
+
+DEFINE_STRING_TABLE_LOOKUP(serialization_format, SerializationFormat);
@@ -0,0 +1,53 @@
+/* SPDX-License-Identifier: LGPL-2.1+ */
+#pragma once
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include "macro.h"
+#include "sparse-endian.h"
+
+/* The manager state is serialized as "key=value" lines, with an empty line terminating each section. Next to the
+ * plain text format there's a binary one, which carries the same lines as length-prefixed records, so that they
+ * can be picked out of the serialization without scanning for line breaks, stripping whitespace or copying them.
+ * Readers accept both, and tell them apart by the signature at the beginning of the binary format. */
+
+#define SERIALIZATION_SIGNATURE "SDSERIAL"
+#define SERIALIZATION_SIGNATURE_SIZE 8
+#define SERIALIZATION_VERSION 1U
+
+typedef enum SerializationFormat {
+        SERIALIZATION_TEXT,
+        SERIALIZATION_BINARY,
+        _SERIALIZATION_FORMAT_MAX,
+        _SERIALIZATION_FORMAT_INVALID = -1,
+} SerializationFormat;
+
+enum {
+        SERIALIZATION_RECORD_LINE = 1,    /* a single line, whitespace stripped, terminated by NUL */
+};
+
+struct serialization_header {
+        uint8_t signature[SERIALIZATION_SIGNATURE_SIZE];
+        le32_t version;
+        le32_t reserved;
+} _packed_;
+
+struct serialization_record {
+        le32_t type;
+        le32_t size;          /* size of the payload, excluding the NUL terminator following it */
+} _packed_;
+
+typedef struct SerializationReader SerializationReader;
+
+int serialization_binary_writer_open(FILE *f, FILE **ret);
+
+int serialization_reader_open(FILE *f, SerializationReader **ret);
+SerializationReader* serialization_reader_free(SerializationReader *r);
+DEFINE_TRIVIAL_CLEANUP_FUNC(SerializationReader*, serialization_reader_free);
+
+SerializationFormat serialization_reader_format(SerializationReader *r);
+int serialization_read_line(SerializationReader *r, char **ret);
+
+const char* serialization_format_to_string(SerializationFormat f) _const_;
+SerializationFormat serialization_format_from_string(const char *s) _pure_;
@@ -572,25 +572,71 @@ static int output_units_list(const UnitInfo *unit_infos, unsigned c) {
         return 0;
 }
 
-static int get_unit_list(
+/* The fields of UnitInfo that output_show_unit() looks at, and the ones needed on top to list units or to look up
+ * their properties. These are requested from ListUnitsPaged(), all others are left unset. */
+#define UNIT_INFO_FIELDS_FILTER "Id", "ActiveState", "Following", "JobId"
+#define UNIT_INFO_FIELDS_LIST UNIT_INFO_FIELDS_FILTER, "Description", "LoadState", "SubState", "JobType"
+#define UNIT_INFO_FIELDS_PATH UNIT_INFO_FIELDS_FILTER, "UnitPath"
+
+static int parse_unit_info_fields(sd_bus_message *message, char **fields, UnitInfo *u) {
+        char **f;
+        int r;
+
+        assert(message);
+        assert(u);
+
+        /* Parses one row of the ListUnitsPaged() reply, in the order the fields were requested */
+
+        r = sd_bus_message_enter_container(message, SD_BUS_TYPE_ARRAY, "v");
+        if (r <= 0)
+                return r;
+
+        *u = (UnitInfo) {};
+
+        STRV_FOREACH(f, fields) {
+                if (streq(*f, "Id"))
+                        r = sd_bus_message_read(message, "v", "s", &u->id);
+                else if (streq(*f, "Description"))
+                        r = sd_bus_message_read(message, "v", "s", &u->description);
+                else if (streq(*f, "LoadState"))
+                        r = sd_bus_message_read(message, "v", "s", &u->load_state);
+                else if (streq(*f, "ActiveState"))
+                        r = sd_bus_message_read(message, "v", "s", &u->active_state);
+                else if (streq(*f, "SubState"))
+                        r = sd_bus_message_read(message, "v", "s", &u->sub_state);
+                else if (streq(*f, "Following"))
+                        r = sd_bus_message_read(message, "v", "s", &u->following);
+                else if (streq(*f, "UnitPath"))
+                        r = sd_bus_message_read(message, "v", "o", &u->unit_path);
+                else if (streq(*f, "JobId"))
+                        r = sd_bus_message_read(message, "v", "u", &u->job_id);
+                else if (streq(*f, "JobType"))
+                        r = sd_bus_message_read(message, "v", "s", &u->job_type);
+                else if (streq(*f, "JobPath"))
+                        r = sd_bus_message_read(message, "v", "o", &u->job_path);
+                else
+                        assert_not_reached("Unknown unit info field");
+                if (r < 0)
+                        return r;
+        }
+
+        r = sd_bus_message_exit_container(message);
+        if (r < 0)
+                return r;
+
+        return 1;
+}
+
+static int call_list_units(
                 sd_bus *bus,
-                const char *machine,
+                const char *method,
                 char **patterns,
-                UnitInfo **unit_infos,
-                int c,
-                sd_bus_message **_reply) {
+                char **fields,
+                sd_bus_error *error,
+                sd_bus_message **reply) {
 
         _cleanup_(sd_bus_message_unrefp) sd_bus_message *m = NULL;
-        _cleanup_(sd_bus_error_free) sd_bus_error error = SD_BUS_ERROR_NULL;
-        _cleanup_(sd_bus_message_unrefp) sd_bus_message *reply = NULL;
-        size_t size = c;
         int r;
-        UnitInfo u;
-        bool fallback = false;
-
-        assert(bus);
-        assert(unit_infos);
-        assert(_reply);
 
         r = sd_bus_message_new_method_call(
                         bus,
@@ -598,7 +644,7 @@ static int get_unit_list(
                         "org.freedesktop.systemd1",
                         "/org/freedesktop/systemd1",
                         "org.freedesktop.systemd1.Manager",
-                        "ListUnitsByPatterns");
+                        method);
         if (r < 0)
                 return bus_log_create_error(r);
 
@@ -606,46 +652,88 @@ static int get_unit_list(
         if (r < 0)
                 return bus_log_create_error(r);
 
-        r = sd_bus_message_append_strv(m, patterns);
-        if (r < 0)
-                return bus_log_create_error(r);
-
-        r = sd_bus_call(bus, m, 0, &error, &reply);
-        if (r < 0 && (sd_bus_error_has_name(&error, SD_BUS_ERROR_UNKNOWN_METHOD) ||
-                      sd_bus_error_has_name(&error, SD_BUS_ERROR_ACCESS_DENIED))) {
-                /* Fallback to legacy ListUnitsFiltered method */
-                fallback = true;
-                log_debug_errno(r, "Failed to list units: %s Falling back to ListUnitsFiltered method.", bus_error_message(&error, r));
-                m = sd_bus_message_unref(m);
-                sd_bus_error_free(&error);
+        if (streq(method, "ListUnitsPaged")) {
+                /* Let the manager do the filtering by type too. Everything is fetched in one go, since the strings
+                 * point into the reply, and since the manager has to look at all units for every page anyway. */
+                r = sd_bus_message_append_strv(m, arg_types);
+                if (r < 0)
+                        return bus_log_create_error(r);
 
-                r = sd_bus_message_new_method_call(
-                                bus,
-                                &m,
-                                "org.freedesktop.systemd1",
-                                "/org/freedesktop/systemd1",
-                                "org.freedesktop.systemd1.Manager",
-                                "ListUnitsFiltered");
+                r = sd_bus_message_append_strv(m, patterns);
                 if (r < 0)
                         return bus_log_create_error(r);
 
-                r = sd_bus_message_append_strv(m, arg_states);
+                r = sd_bus_message_append_strv(m, fields);
                 if (r < 0)
                         return bus_log_create_error(r);
 
-                r = sd_bus_call(bus, m, 0, &error, &reply);
+                r = sd_bus_message_append(m, "su", "", 0);
+        } else if (streq(method, "ListUnitsByPatterns"))
+                r = sd_bus_message_append_strv(m, patterns);
+        if (r < 0)
+                return bus_log_create_error(r);
+
+        return sd_bus_call(bus, m, 0, error, reply);
+}
+
+static int get_unit_list(
+                sd_bus *bus,
+                const char *machine,
+                char **patterns,
+                char **fields,
+                UnitInfo **unit_infos,
+                int c,
+                sd_bus_message **_reply) {
+
+        static const char *const methods[] = {
+                "ListUnitsPaged",
+                "ListUnitsByPatterns",
+                "ListUnitsFiltered", /* legacy */
+        };
+
+        _cleanup_(sd_bus_error_free) sd_bus_error error = SD_BUS_ERROR_NULL;
+        _cleanup_(sd_bus_message_unrefp) sd_bus_message *reply = NULL;
+        size_t size = c, k;
+        int r;
+        UnitInfo u;
+
+        assert(bus);
+        assert(unit_infos);
+        assert(_reply);
+
+        for (k = 0; k < ELEMENTSOF(methods); k++) {
+                sd_bus_error_free(&error);
+
+                r = call_list_units(bus, methods[k], patterns, fields, &error, &reply);
+                if (r >= 0 ||
+                    k + 1 >= ELEMENTSOF(methods) ||
+                    !(sd_bus_error_has_name(&error, SD_BUS_ERROR_UNKNOWN_METHOD) ||
+                      sd_bus_error_has_name(&error, SD_BUS_ERROR_ACCESS_DENIED) ||
+                      /* A unit type or field this manager doesn't know yet, filter locally then */
+                      (k == 0 && sd_bus_error_has_name(&error, SD_BUS_ERROR_INVALID_ARGS))))
+                        break;
+
+                /* Fall back to an older method */
+                log_debug_errno(r, "Failed to list units: %s Falling back to %s method.", bus_error_message(&error, r), methods[k + 1]);
         }
         if (r < 0)
                 return log_error_errno(r, "Failed to list units: %s", bus_error_message(&error, r));
 
-        r = sd_bus_message_enter_container(reply, SD_BUS_TYPE_ARRAY, "(ssssssouso)");
-        if (r < 0)
-                return bus_log_parse_error(r);
+        if (k == 0) {
+                r = sd_bus_message_enter_container(reply, SD_BUS_TYPE_ARRAY, "av");
+                if (r < 0)
+                        return bus_log_parse_error(r);
+        } else {
+                r = sd_bus_message_enter_container(reply, SD_BUS_TYPE_ARRAY, "(ssssssouso)");
+                if (r < 0)
+                        return bus_log_parse_error(r);
+        }
 
-        while ((r = bus_parse_unit_info(reply, &u)) > 0) {
+        while ((r = k == 0 ? parse_unit_info_fields(reply, fields, &u) : bus_parse_unit_info(reply, &u)) > 0) {
                 u.machine = machine;
 
-                if (!output_show_unit(&u, fallback ? patterns : NULL))
+                /* ListUnitsFiltered doesn't know about patterns */
+                if (!output_show_unit(&u, k == 2 ? patterns : NULL))
                         continue;
 
                 if (!GREEDY_REALLOC(*unit_infos, size, c+1))
@@ -672,6 +760,7 @@ static void message_set_freep(Set **set) {
 static int get_unit_list_recursive(
                 sd_bus *bus,
                 char **patterns,
+                char **fields,
                 UnitInfo **_unit_infos,
                 Set **_replies,
                 char ***_machines) {
@@ -690,7 +779,7 @@ static int get_unit_list_recursive(
         if (!replies)
                 return log_oom();
 
-        c = get_unit_list(bus, NULL, patterns, &unit_infos, 0, &reply);
+        c = get_unit_list(bus, NULL, patterns, fields, &unit_infos, 0, &reply);
         if (c < 0)
                 return c;
 
@@ -718,7 +807,7 @@ static int get_unit_list_recursive(
                                 continue;
                         }
 
-                        k = get_unit_list(container, *i, patterns, &unit_infos, c, &reply);
+                        k = get_unit_list(container, *i, patterns, fields, &unit_infos, c, &reply);
                         if (k < 0)
                                 return k;
 
@@ -754,7 +843,7 @@ static int list_units(int argc, char *argv[], void *userdata) {
 
         (void) pager_open(arg_no_pager, false);
 
-        r = get_unit_list_recursive(bus, strv_skip(argv, 1), &unit_infos, &replies, &machines);
+        r = get_unit_list_recursive(bus, strv_skip(argv, 1), STRV_MAKE(UNIT_INFO_FIELDS_LIST), &unit_infos, &replies, &machines);
         if (r < 0)
                 return r;
 
@@ -966,7 +1055,7 @@ static int list_sockets(int argc, char *argv[], void *userdata) {
 
         (void) pager_open(arg_no_pager, false);
 
-        n = get_unit_list_recursive(bus, strv_skip(argv, 1), &unit_infos, &replies, &machines);
+        n = get_unit_list_recursive(bus, strv_skip(argv, 1), STRV_MAKE(UNIT_INFO_FIELDS_PATH), &unit_infos, &replies, &machines);
         if (n < 0)
                 return n;
 
@@ -1273,7 +1362,7 @@ static int list_timers(int argc, char *argv[], void *userdata) {
 
         (void) pager_open(arg_no_pager, false);
 
-        n = get_unit_list_recursive(bus, strv_skip(argv, 1), &unit_infos, &replies, &machines);
+        n = get_unit_list_recursive(bus, strv_skip(argv, 1), STRV_MAKE(UNIT_INFO_FIELDS_PATH), &unit_infos, &replies, &machines);
         if (n < 0)
                 return n;
 
@@ -3004,7 +3093,7 @@ static int expand_names(sd_bus *bus, char **names, const char* suffix, char ***r
                 _cleanup_free_ UnitInfo *unit_infos = NULL;
                 size_t allocated, n;
 
-                r = get_unit_list(bus, NULL, globs, &unit_infos, 0, &reply);
+                r = get_unit_list(bus, NULL, globs, STRV_MAKE(UNIT_INFO_FIELDS_FILTER), &unit_infos, 0, &reply);
                 if (r < 0)
                         return r;
 
@@ -5348,7 +5437,7 @@ static int show_all(
         unsigned c;
         int r, ret = 0;
 
-        r = get_unit_list(bus, NULL, NULL, &unit_infos, 0, &reply);
+        r = get_unit_list(bus, NULL, NULL, STRV_MAKE(UNIT_INFO_FIELDS_FILTER), &unit_infos, 0, &reply);
         if (r < 0)
                 return r;
 
@@ -5695,8 +5784,12 @@ static int daemon_reload(int argc, char *argv[], void *userdata) {
                 break;
 
         case ACTION_SYSTEMCTL:
-                method = streq(argv[0], "daemon-reexec") ? "Reexecute" :
-                                     /* "daemon-reload" */ "Reload";
+                if (streq(argv[0], "daemon-reexec"))
+                        method = "Reexecute";
+                else if (arg_force > 0 && streq(argv[0], "daemon-reload"))
+                        method = "ReloadFull";
+                else
+                        method = "Reload";
                 break;
 
         default:
@@ -7288,6 +7381,7 @@ static void systemctl_help(void) {
                "                      reboot\n"
                "  -f --force          When enabling unit files, override existing symlinks\n"
                "                      When shutting down, execute action immediately\n"
+               "                      When reloading the daemon, load all units anew\n"
                "     --preset-mode=   Apply only enable, only disable, or all presets\n"
                "     --root=PATH      Enable/disable/mask unit files in the specified root\n"
                "                      directory\n"
@@ -44,6 +44,9 @@ enum {
         SD_BUS_VTABLE_PROPERTY_EMITS_CHANGE        = 1ULL << 5,
         SD_BUS_VTABLE_PROPERTY_EMITS_INVALIDATION  = 1ULL << 6,
         SD_BUS_VTABLE_PROPERTY_EXPLICIT            = 1ULL << 7,
+        /* Downstream addition, hence taken from the top of the flags below the capability mask, so that it never
+         * collides with the bits upstream allocates from the bottom */
+        SD_BUS_VTABLE_CACHE_PROPERTIES             = 1ULL << 39,
         _SD_BUS_VTABLE_CAPABILITY_MASK             = 0xFFFFULL << 40
 };
 
@@ -741,6 +741,8 @@ static int enumerate_sysv(const LookupPaths *lp, Hashmap *all_services) {
                 _cleanup_closedir_ DIR *d = NULL;
                 struct dirent *de;
 
+                (void) generator_add_input(*path);
+
                 d = opendir(*path);
                 if (!d) {
                         if (errno != ENOENT)
@@ -784,6 +786,8 @@ static int enumerate_sysv(const LookupPaths *lp, Hashmap *all_services) {
                         if (!fpath)
                                 return log_oom();
 
+                        (void) generator_add_input(fpath);
+
                         service = new0(SysvStub, 1);
                         if (!service)
                                 return log_oom();
@@ -831,6 +835,8 @@ static int set_dependencies_from_rcnd(const LookupPaths *lp, Hashmap *all_servic
                                 goto finish;
                         }
 
+                        (void) generator_add_input(path);
+
                         d = opendir(path);
                         if (!d) {
                                 if (errno != ENOENT)
@@ -918,6 +924,7 @@ int main(int argc, char *argv[]) {
         _cleanup_(lookup_paths_free) LookupPaths lp = {};
         SysvStub *service;
         Iterator j;
+        char **p;
         int r;
 
         if (argc > 1 && argc != 4) {
@@ -941,6 +948,11 @@ int main(int argc, char *argv[]) {
                 goto finish;
         }
 
+        /* Scripts are skipped if there's a native unit, hence the unit directories are inputs, too. Together with
+         * the init script and runlevel directories, and the scripts themselves, see generator_add_input(). */
+        STRV_FOREACH(p, lp.search_path)
+                (void) generator_add_input(*p);
+
         all_services = hashmap_new(&string_hash_ops);
         if (!all_services) {
                 r = log_oom();
@@ -6,6 +6,8 @@
 #include "fs-util.h"
 #include "log.h"
 #include "macro.h"
+#include "rm-rf.h"
+#include "stdio-util.h"
 #include "string-util.h"
 #include "strv.h"
 #include "util.h"
@@ -380,6 +382,95 @@ static void test_config_parse(unsigned i, const char *s) {
         }
 }
 
+static void test_config_source_read_many(void) {
+        _cleanup_(rm_rf_physical_and_freep) char *dir = NULL;
+        _cleanup_strv_free_ char **paths = NULL;
+        ConfigSource *sources[64] = {}, *old[64];
+        unsigned i;
+
+        const ConfigTableItem items[] = {
+                { "Section", "setting1",  config_parse_string,   0, NULL },
+                {}
+        };
+
+        log_info("== %s ==", __func__);
+
+        assert_se(mkdtemp_malloc("/tmp/test-conf-parser.XXXXXX", &dir) >= 0);
+
+        for (i = 0; i < ELEMENTSOF(sources); i++) {
+                char *p, contents[LINE_MAX];
+
+                assert_se(asprintf(&p, "%s/%u.conf", dir, i) >= 0);
+                assert_se(strv_consume(&paths, p) >= 0);
+
+                xsprintf(contents, "[Section]\nsetting1=%u \\\nfoo\n", i);
+                assert_se(write_string_file(p, contents, WRITE_STRING_FILE_CREATE) >= 0);
+        }
+
+        assert_se(config_source_read_many(paths, 0, sources) >= 0);
+
+        for (i = 0; i < ELEMENTSOF(sources); i++) {
+                _cleanup_free_ char *expected = NULL;
+                unsigned k;
+
+                assert_se(sources[i]);
+                assert_se(sources[i]->n_lines == 2);
+                assert_se(asprintf(&expected, "%u  foo", i) >= 0);
+
+                /* Sources may be parsed more than once */
+                for (k = 0; k < 2; k++) {
+                        _cleanup_free_ char *setting1 = NULL;
+                        ConfigTableItem t[ELEMENTSOF(items)];
+
+                        memcpy(t, items, sizeof(items));
+                        t[0].data = &setting1;
+
+                        assert_se(config_parse_source(NULL, sources[i], "Section\0", config_item_table_lookup, t, 0, NULL) >= 0);
+                        assert_se(streq(setting1, expected));
+                }
+        }
+
+        /* Unchanged files are not read again */
+        assert_se(write_string_file(paths[1], "[Section]\nsetting1=changed\n", 0) >= 0);
+        assert_se(unlink(paths[2]) >= 0);
+
+        memcpy(old, sources, sizeof(sources));
+        assert_se(config_source_read_many(paths, 0, sources) >= 0);
+
+        assert_se(sources[0] == old[0]);
+        assert_se(sources[1] && sources[1] != old[1]);
+        assert_se(streq(sources[1]->lines[1], "setting1=changed"));
+        assert_se(!sources[2]);
+        assert_se(sources[3] == old[3]);
+
+        for (i = 0; i < ELEMENTSOF(sources); i++) {
+                if (old[i] != sources[i])
+                        config_source_free(old[i]);
+                config_source_free(sources[i]);
+        }
+}
+
+static void test_config_parse_memstream(void) {
+        _cleanup_free_ char *setting1 = NULL;
+        _cleanup_fclose_ FILE *f = NULL;
+        const char contents[] = "[Section]\nsetting1=1 \\\n2\n";
+
+        const ConfigTableItem items[] = {
+                { "Section", "setting1",  config_parse_string,   0, &setting1 },
+                {}
+        };
+
+        log_info("== %s ==", __func__);
+
+        /* Streams without a file descriptor can be parsed too, they just can't be cached */
+        assert_se(f = fmemopen((void*) contents, sizeof(contents) - 1, "r"));
+        assert_se(fileno(f) < 0);
+
+        assert_se(config_parse(NULL, "/dev/memstream", f, "Section\0", config_item_table_lookup, items,
+                               CONFIG_PARSE_WARN, NULL) == 0);
+        assert_se(streq(setting1, "1  2"));
+}
+
 int main(int argc, char **argv) {
         unsigned i;
 
@@ -403,5 +494,8 @@ int main(int argc, char **argv) {
         for (i = 0; i < ELEMENTSOF(config_file); i++)
                 test_config_parse(i, config_file[i]);
 
+        test_config_source_read_many();
+        test_config_parse_memstream();
+
         return 0;
 }
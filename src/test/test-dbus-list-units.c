@@ -0,0 +1,239 @@
+/* SPDX-License-Identifier: LGPL-2.1+ */
+
+#include <stdio.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "sd-bus.h"
+
+#include "alloc-util.h"
+#include "bus-error.h"
+#include "manager.h"
+#include "process-util.h"
+#include "rm-rf.h"
+#include "string-util.h"
+#include "strv.h"
+#include "test-helper.h"
+#include "tests.h"
+#include "unit-name.h"
+
+static int list_units_paged(
+                sd_bus *bus,
+                char **types,
+                char **fields,
+                const char *after,
+                uint32_t max,
+                sd_bus_error *error,
+                sd_bus_message **reply) {
+
+        _cleanup_(sd_bus_message_unrefp) sd_bus_message *m = NULL;
+
+        assert_se(sd_bus_message_new_method_call(bus, &m, NULL, "/org/freedesktop/systemd1",
+                                                 "org.freedesktop.systemd1.Manager", "ListUnitsPaged") >= 0);
+        assert_se(sd_bus_message_append_strv(m, NULL) >= 0);
+        assert_se(sd_bus_message_append_strv(m, types) >= 0);
+        assert_se(sd_bus_message_append_strv(m, NULL) >= 0);
+        assert_se(sd_bus_message_append_strv(m, fields) >= 0);
+        assert_se(sd_bus_message_append(m, "su", after, max) >= 0);
+
+        return sd_bus_call(bus, m, 0, error, reply);
+}
+
+/* Returns the names of the units, requesting only the "Id" field */
+static void list_unit_ids(sd_bus *bus, char **types, const char *after, uint32_t max, char ***ret, char **ret_next) {
+        _cleanup_(sd_bus_message_unrefp) sd_bus_message *reply = NULL;
+        _cleanup_strv_free_ char **ids = NULL;
+        const char *id, *next;
+
+        assert_se(list_units_paged(bus, types, STRV_MAKE("Id"), after, max, NULL, &reply) >= 0);
+
+        assert_se(sd_bus_message_enter_container(reply, 'a', "av") > 0);
+        while (sd_bus_message_enter_container(reply, 'a', "v") > 0) {
+                assert_se(sd_bus_message_read(reply, "v", "s", &id) > 0);
+                assert_se(sd_bus_message_exit_container(reply) > 0);
+                assert_se(strv_extend(&ids, id) >= 0);
+        }
+        assert_se(sd_bus_message_exit_container(reply) > 0);
+
+        assert_se(sd_bus_message_read(reply, "s", &next) > 0);
+        assert_se(*ret_next = strdup(next));
+        *ret = TAKE_PTR(ids);
+}
+
+static void test_projection(sd_bus *bus) {
+        _cleanup_(sd_bus_error_free) sd_bus_error error = SD_BUS_ERROR_NULL;
+        _cleanup_(sd_bus_message_unrefp) sd_bus_message *reply = NULL;
+        const char *path, *id, *state;
+        unsigned n = 0;
+
+        log_info("%s", __func__);
+
+        /* The fields come in the order requested, each with its own type */
+        assert_se(list_units_paged(bus, NULL, STRV_MAKE("UnitPath", "Id", "LoadState"), "", 0, NULL, &reply) >= 0);
+
+        assert_se(sd_bus_message_enter_container(reply, 'a', "av") > 0);
+        while (sd_bus_message_enter_container(reply, 'a', "v") > 0) {
+                _cleanup_free_ char *p = NULL;
+
+                assert_se(sd_bus_message_read(reply, "vvv", "o", &path, "s", &id, "s", &state) > 0);
+                assert_se(sd_bus_message_at_end(reply, false) > 0);
+                assert_se(sd_bus_message_exit_container(reply) > 0);
+
+                assert_se(p = unit_dbus_path_from_name(id));
+                assert_se(streq(path, p));
+                assert_se(!isempty(state));
+                n++;
+        }
+        assert_se(sd_bus_message_exit_container(reply) > 0);
+        assert_se(n > 0);
+
+        assert_se(list_units_paged(bus, NULL, STRV_MAKE("Id", "Foo"), "", 0, &error, NULL) < 0);
+        assert_se(sd_bus_error_has_name(&error, SD_BUS_ERROR_INVALID_ARGS));
+        sd_bus_error_free(&error);
+
+        assert_se(list_units_paged(bus, NULL, NULL, "", 0, &error, NULL) < 0);
+        assert_se(sd_bus_error_has_name(&error, SD_BUS_ERROR_INVALID_ARGS));
+}
+
+static void test_types(sd_bus *bus) {
+        _cleanup_(sd_bus_error_free) sd_bus_error error = SD_BUS_ERROR_NULL;
+        _cleanup_strv_free_ char **all = NULL, **services = NULL;
+        _cleanup_free_ char *next = NULL;
+        char **i;
+
+        log_info("%s", __func__);
+
+        list_unit_ids(bus, NULL, "", 0, &all, &next);
+        assert_se(isempty(next));
+        next = mfree(next);
+
+        list_unit_ids(bus, STRV_MAKE("service"), "", 0, &services, &next);
+        assert_se(isempty(next));
+
+        assert_se(strv_contains(services, "a.service"));
+        assert_se(strv_contains(services, "b.service"));
+        assert_se(strv_contains(services, "c.service"));
+        STRV_FOREACH(i, services)
+                assert_se(endswith(*i, ".service"));
+
+        STRV_FOREACH(i, all)
+                assert_se(strv_contains(services, *i) == !!endswith(*i, ".service"));
+
+        assert_se(list_units_paged(bus, STRV_MAKE("foo"), STRV_MAKE("Id"), "", 0, &error, NULL) < 0);
+        assert_se(sd_bus_error_has_name(&error, SD_BUS_ERROR_INVALID_ARGS));
+}
+
+static void test_pages(sd_bus *bus, uint32_t max) {
+        _cleanup_strv_free_ char **all = NULL, **collected = NULL;
+        _cleanup_free_ char *after = NULL;
+        char **i;
+
+        log_info("%s(%" PRIu32 ")", __func__, max);
+
+        list_unit_ids(bus, NULL, "", 0, &all, &after);
+        assert_se(isempty(after));
+        assert_se(strv_length(all) > max);
+
+        /* Without a limit, everything comes in one go and sorted by name */
+        STRV_FOREACH(i, all)
+                assert_se(i == all || strcmp(i[-1], *i) < 0);
+
+        /* Following the token yields the same list page by page, and the token is the last name returned */
+        for (;;) {
+                _cleanup_strv_free_ char **page = NULL;
+                _cleanup_free_ char *next = NULL;
+
+                list_unit_ids(bus, NULL, strempty(after), max, &page, &next);
+                assert_se(strv_length(page) <= max);
+
+                if (isempty(next)) {
+                        assert_se(strv_extend_strv(&collected, page, false) >= 0);
+                        break;
+                }
+
+                assert_se(strv_length(page) == max);
+                assert_se(streq(next, page[max - 1]));
+                assert_se(strv_extend_strv(&collected, page, false) >= 0);
+
+                free_and_replace(after, next);
+        }
+
+        assert_se(strv_equal(all, collected));
+}
+
+static int run_client(const char *address) {
+        _cleanup_(sd_bus_flush_close_unrefp) sd_bus *bus = NULL;
+
+        assert_se(sd_bus_new(&bus) >= 0);
+        assert_se(sd_bus_set_address(bus, address) >= 0);
+        assert_se(sd_bus_start(bus) >= 0);
+
+        test_projection(bus);
+        test_types(bus);
+        test_pages(bus, 1);
+        test_pages(bus, 2);
+        test_pages(bus, 5);
+
+        return EXIT_SUCCESS;
+}
+
+int main(int argc, char *argv[]) {
+        _cleanup_(rm_rf_physical_and_freep) char *runtime_dir = NULL;
+        _cleanup_(manager_freep) Manager *m = NULL;
+        _cleanup_free_ char *address = NULL;
+        bool connected = false;
+        siginfo_t si;
+        pid_t pid;
+        Unit *u;
+        int r;
+
+        log_set_max_level(LOG_DEBUG);
+        log_parse_environment();
+        log_open();
+
+        r = enter_cgroup_subroot();
+        if (r == -ENOMEDIUM) {
+                log_notice_errno(r, "Skipping test: cgroupfs not available");
+                return EXIT_TEST_SKIP;
+        }
+
+        assert_se(set_unit_path(get_testdata_dir()) >= 0);
+        assert_se(runtime_dir = setup_fake_runtime_dir());
+        r = manager_new(UNIT_FILE_USER, MANAGER_TEST_RUN_BASIC, &m);
+        if (MANAGER_SKIP_TEST(r)) {
+                log_notice_errno(r, "Skipping test: manager_new: %m");
+                return EXIT_TEST_SKIP;
+        }
+        assert_se(r >= 0);
+        assert_se(manager_startup(m, NULL, NULL) >= 0);
+
+        if (m->private_listen_fd < 0) {
+                log_notice("Skipping test: private bus not available");
+                return EXIT_TEST_SKIP;
+        }
+
+        assert_se(manager_load_startable_unit_or_warn(m, "a.service", NULL, &u) >= 0);
+        assert_se(manager_load_startable_unit_or_warn(m, "b.service", NULL, &u) >= 0);
+        assert_se(manager_load_startable_unit_or_warn(m, "c.service", NULL, &u) >= 0);
+
+        assert_se(address = strjoin("unix:path=", runtime_dir, "/systemd/private"));
+
+        r = safe_fork("(bus-client)", FORK_DEATHSIG|FORK_LOG, &pid);
+        assert_se(r >= 0);
+        if (r == 0)
+                _exit(run_client(address));
+
+        /* Serve the client until it hangs up. The manager loop isn't run, so that the units loaded above are not
+         * garbage collected, and signals are ignored, so that the client isn't reaped behind our back. */
+        assert_se(sd_event_source_set_enabled(m->signal_event_source, SD_EVENT_OFF) >= 0);
+        while (!connected || !set_isempty(m->private_buses)) {
+                assert_se(sd_event_run(m->event, (uint64_t) -1) >= 0);
+                connected = connected || !set_isempty(m->private_buses);
+        }
+
+        assert_se(wait_for_terminate(pid, &si) >= 0);
+        assert_se(si.si_code == CLD_EXITED);
+        assert_se(si.si_status == EXIT_SUCCESS);
+
+        return 0;
+}
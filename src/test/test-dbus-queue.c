@@ -0,0 +1,153 @@
+/* SPDX-License-Identifier: LGPL-2.1+ */
+
+#include <stdio.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "sd-bus.h"
+
+#include "alloc-util.h"
+#include "dbus.h"
+#include "manager.h"
+#include "process-util.h"
+#include "rm-rf.h"
+#include "special.h"
+#include "string-util.h"
+#include "test-helper.h"
+#include "tests.h"
+
+/* Counts the PropertiesChanged signals for the generic unit interface of the unit at "path", until the manager
+ * drops the connection */
+static int run_client(const char *address, const char *path) {
+        _cleanup_(sd_bus_flush_close_unrefp) sd_bus *bus = NULL;
+        unsigned n = 0;
+        int r;
+
+        assert_se(sd_bus_new(&bus) >= 0);
+        assert_se(sd_bus_set_address(bus, address) >= 0);
+        assert_se(sd_bus_start(bus) >= 0);
+
+        /* Like any other client, talk to the manager first, so that it knows we are ready */
+        assert_se(sd_bus_call_method(bus, NULL, "/org/freedesktop/systemd1", "org.freedesktop.DBus.Peer", "Ping", NULL, NULL, NULL) >= 0);
+
+        for (;;) {
+                _cleanup_(sd_bus_message_unrefp) sd_bus_message *msg = NULL;
+                const char *interface;
+
+                r = sd_bus_process(bus, &msg);
+                if (r < 0)
+                        break;
+                if (r == 0) {
+                        if (sd_bus_wait(bus, (uint64_t) -1) < 0)
+                                break;
+                        continue;
+                }
+                if (!msg)
+                        continue;
+
+                if (!sd_bus_message_is_signal(msg, "org.freedesktop.DBus.Properties", "PropertiesChanged") ||
+                    !streq_ptr(sd_bus_message_get_path(msg), path))
+                        continue;
+
+                assert_se(sd_bus_message_read(msg, "s", &interface) >= 0);
+                if (streq(interface, "org.freedesktop.systemd1.Unit"))
+                        n++;
+        }
+
+        return n;
+}
+
+static int on_change(sd_event_source *s, void *userdata) {
+        Unit *u = userdata;
+
+        /* Like a state change of the unit, triggered by an event of its own */
+        unit_add_to_dbus_queue(u);
+        return 0;
+}
+
+static int on_done(sd_event_source *s, uint64_t usec, void *userdata) {
+        Manager *m = userdata;
+
+        m->exit_code = MANAGER_EXIT;
+        return 0;
+}
+
+static int on_poll(sd_event_source *s, uint64_t usec, void *userdata) {
+        Unit *u = userdata;
+        Manager *m = u->manager;
+        sd_bus *bus;
+        unsigned k;
+
+        /* Wait for the client to connect, nothing is sent to it before it is ready */
+        bus = set_first(m->private_buses);
+        if (!bus || sd_bus_is_ready(bus) <= 0) {
+                assert_se(sd_event_source_set_time(s, now(CLOCK_MONOTONIC) + 10 * USEC_PER_MSEC) >= 0);
+                return sd_event_source_set_enabled(s, SD_EVENT_ONESHOT);
+        }
+
+        /* Three changes pending at the same time, they should be covered by a single signal */
+        for (k = 0; k < 3; k++)
+                assert_se(sd_event_add_defer(m->event, NULL, on_change, u) >= 0);
+
+        return sd_event_add_time(m->event, NULL, CLOCK_MONOTONIC, now(CLOCK_MONOTONIC) + USEC_PER_SEC / 5, 0, on_done, m);
+}
+
+int main(int argc, char *argv[]) {
+        _cleanup_(rm_rf_physical_and_freep) char *runtime_dir = NULL;
+        _cleanup_(manager_freep) Manager *m = NULL;
+        _cleanup_free_ char *address = NULL, *path = NULL;
+        siginfo_t si;
+        Iterator i;
+        sd_bus *bus;
+        pid_t pid;
+        Unit *u;
+        int r;
+
+        log_set_max_level(LOG_DEBUG);
+        log_parse_environment();
+        log_open();
+
+        r = enter_cgroup_subroot();
+        if (r == -ENOMEDIUM) {
+                log_notice_errno(r, "Skipping test: cgroupfs not available");
+                return EXIT_TEST_SKIP;
+        }
+
+        assert_se(set_unit_path(get_testdata_dir()) >= 0);
+        assert_se(runtime_dir = setup_fake_runtime_dir());
+        r = manager_new(UNIT_FILE_USER, MANAGER_TEST_RUN_BASIC, &m);
+        if (MANAGER_SKIP_TEST(r)) {
+                log_notice_errno(r, "Skipping test: manager_new: %m");
+                return EXIT_TEST_SKIP;
+        }
+        assert_se(r >= 0);
+        assert_se(manager_startup(m, NULL, NULL) >= 0);
+
+        if (m->private_listen_fd < 0) {
+                log_notice("Skipping test: private bus not available");
+                return EXIT_TEST_SKIP;
+        }
+
+        /* A perpetual unit, so that it isn't garbage collected while we look at it */
+        assert_se(u = manager_get_unit(m, SPECIAL_ROOT_SLICE));
+        assert_se(path = unit_dbus_path(u));
+        assert_se(address = strjoin("unix:path=", runtime_dir, "/systemd/private"));
+
+        r = safe_fork("(bus-client)", FORK_DEATHSIG|FORK_LOG, &pid);
+        assert_se(r >= 0);
+        if (r == 0)
+                _exit(run_client(address, path));
+
+        assert_se(sd_event_add_time(m->event, NULL, CLOCK_MONOTONIC, now(CLOCK_MONOTONIC), 0, on_poll, u) >= 0);
+        assert_se(manager_loop(m) == MANAGER_EXIT);
+
+        SET_FOREACH(bus, m->private_buses, i)
+                assert_se(sd_bus_flush(bus) >= 0);
+        bus_done_private(m);
+
+        assert_se(wait_for_terminate(pid, &si) >= 0);
+        assert_se(si.si_code == CLD_EXITED);
+        assert_se(si.si_status == 1);
+
+        return 0;
+}
@@ -14,7 +14,8 @@ int main(int argc, char *argv[]) {
         _cleanup_(rm_rf_physical_and_freep) char *runtime_dir = NULL;
         _cleanup_(sd_bus_error_free) sd_bus_error err = SD_BUS_ERROR_NULL;
         _cleanup_(manager_freep) Manager *m = NULL;
-        Unit *a = NULL, *b = NULL, *c = NULL, *d = NULL, *e = NULL, *g = NULL, *h = NULL, *unit_with_multiple_dashes = NULL;
+        Unit *a = NULL, *b = NULL, *c = NULL, *d = NULL, *e = NULL, *g = NULL, *h = NULL, *i = NULL, *unit_with_multiple_dashes = NULL;
+        Unit *f, *unit_j, *unit_k, *unit_l, *unit_m;
         Job *j;
         int r;
 
@@ -100,32 +101,84 @@ int main(int argc, char *argv[]) {
         assert_se(manager_add_job(m, JOB_START, h, JOB_FAIL, NULL, NULL, &j) == 0);
         manager_dump_jobs(m, stdout, "\t");
 
-        assert_se(!hashmap_get(a->dependencies[UNIT_PROPAGATES_RELOAD_TO], b));
-        assert_se(!hashmap_get(b->dependencies[UNIT_RELOAD_PROPAGATED_FROM], a));
-        assert_se(!hashmap_get(a->dependencies[UNIT_PROPAGATES_RELOAD_TO], c));
-        assert_se(!hashmap_get(c->dependencies[UNIT_RELOAD_PROPAGATED_FROM], a));
+        printf("Test11: (Redundant job dropped)\n");
+        manager_clear_jobs(m);
+        assert_se(manager_add_job(m, JOB_START, g, JOB_REPLACE, NULL, NULL, &j) == 0);
+        manager_dump_jobs(m, stdout, "\t");
+        assert_se(g->job && g->job->type == JOB_START);
+        /* Stopping the inactive e.service is a noop */
+        assert_se(!e->job);
+
+        printf("Test12: (Conflicting stop job dropped to minimize impact)\n");
+        assert_se(manager_add_job(m, JOB_START, e, JOB_FAIL, NULL, NULL, &j) == 0);
+        manager_dump_jobs(m, stdout, "\t");
+        assert_se(e->job && e->job->type == JOB_START);
+        /* Stopping g.service would reverse its start job, which doesn't matter for starting e.service */
+        assert_se(g->job && g->job->type == JOB_START);
+
+        printf("Test13: (Conflicting stop job that matters, fail)\n");
+        manager_clear_jobs(m);
+        assert_se(manager_add_job(m, JOB_START, e, JOB_REPLACE, NULL, NULL, &j) == 0);
+        assert_se(manager_add_job(m, JOB_START, g, JOB_FAIL, NULL, NULL, &j) == -EDEADLK);
+        assert_se(e->job && e->job->type == JOB_START);
+        assert_se(!g->job);
+
+        printf("Load5:\n");
+        manager_clear_jobs(m);
+        assert_se(manager_load_startable_unit_or_warn(m, "i.service", NULL, &i) >= 0);
+        manager_dump_units(m, stdout, "\t");
+
+        printf("Test14: (Cyclic Order, Fixable, Garbage Collector of jobs unreferenced in turn)\n");
+        assert_se(manager_add_job(m, JOB_START, i, JOB_REPLACE, NULL, NULL, &j) == 0);
+        manager_dump_jobs(m, stdout, "\t");
+        assert_se(i->job && i->job->type == JOB_START);
+        assert_se(unit_j = manager_get_unit(m, "j.service"));
+        assert_se(unit_k = manager_get_unit(m, "k.service"));
+        assert_se(unit_l = manager_get_unit(m, "l.service"));
+        assert_se(unit_m = manager_get_unit(m, "m.service"));
+        /* Breaking the cycle drops j.service or k.service, and with it the other one, leaving l.service
+         * unreferenced, and then m.service */
+        assert_se(!unit_j->job);
+        assert_se(!unit_k->job);
+        assert_se(!unit_l->job);
+        assert_se(!unit_m->job);
+
+        printf("Test15: (Cyclic Order, Fixable, Garbage Collector of wanted job)\n");
+        manager_clear_jobs(m);
+        assert_se(f = manager_get_unit(m, "f.service"));
+        assert_se(manager_add_job(m, JOB_START, e, JOB_REPLACE, NULL, NULL, &j) == 0);
+        manager_dump_jobs(m, stdout, "\t");
+        assert_se(e->job && e->job->type == JOB_START);
+        assert_se(!a->job);
+        assert_se(!b->job);
+        assert_se(!f->job);
+
+        assert_se(!unit_dependency_list_get(a->dependencies[UNIT_PROPAGATES_RELOAD_TO], b));
+        assert_se(!unit_dependency_list_get(b->dependencies[UNIT_RELOAD_PROPAGATED_FROM], a));
+        assert_se(!unit_dependency_list_get(a->dependencies[UNIT_PROPAGATES_RELOAD_TO], c));
+        assert_se(!unit_dependency_list_get(c->dependencies[UNIT_RELOAD_PROPAGATED_FROM], a));
 
         assert_se(unit_add_dependency(a, UNIT_PROPAGATES_RELOAD_TO, b, true, UNIT_DEPENDENCY_UDEV) == 0);
         assert_se(unit_add_dependency(a, UNIT_PROPAGATES_RELOAD_TO, c, true, UNIT_DEPENDENCY_PROC_SWAP) == 0);
 
-        assert_se(hashmap_get(a->dependencies[UNIT_PROPAGATES_RELOAD_TO], b));
-        assert_se(hashmap_get(b->dependencies[UNIT_RELOAD_PROPAGATED_FROM], a));
-        assert_se(hashmap_get(a->dependencies[UNIT_PROPAGATES_RELOAD_TO], c));
-        assert_se(hashmap_get(c->dependencies[UNIT_RELOAD_PROPAGATED_FROM], a));
+        assert_se(unit_dependency_list_get(a->dependencies[UNIT_PROPAGATES_RELOAD_TO], b));
+        assert_se(unit_dependency_list_get(b->dependencies[UNIT_RELOAD_PROPAGATED_FROM], a));
+        assert_se(unit_dependency_list_get(a->dependencies[UNIT_PROPAGATES_RELOAD_TO], c));
+        assert_se(unit_dependency_list_get(c->dependencies[UNIT_RELOAD_PROPAGATED_FROM], a));
 
         unit_remove_dependencies(a, UNIT_DEPENDENCY_UDEV);
 
-        assert_se(!hashmap_get(a->dependencies[UNIT_PROPAGATES_RELOAD_TO], b));
-        assert_se(!hashmap_get(b->dependencies[UNIT_RELOAD_PROPAGATED_FROM], a));
-        assert_se(hashmap_get(a->dependencies[UNIT_PROPAGATES_RELOAD_TO], c));
-        assert_se(hashmap_get(c->dependencies[UNIT_RELOAD_PROPAGATED_FROM], a));
+        assert_se(!unit_dependency_list_get(a->dependencies[UNIT_PROPAGATES_RELOAD_TO], b));
+        assert_se(!unit_dependency_list_get(b->dependencies[UNIT_RELOAD_PROPAGATED_FROM], a));
+        assert_se(unit_dependency_list_get(a->dependencies[UNIT_PROPAGATES_RELOAD_TO], c));
+        assert_se(unit_dependency_list_get(c->dependencies[UNIT_RELOAD_PROPAGATED_FROM], a));
 
         unit_remove_dependencies(a, UNIT_DEPENDENCY_PROC_SWAP);
 
-        assert_se(!hashmap_get(a->dependencies[UNIT_PROPAGATES_RELOAD_TO], b));
-        assert_se(!hashmap_get(b->dependencies[UNIT_RELOAD_PROPAGATED_FROM], a));
-        assert_se(!hashmap_get(a->dependencies[UNIT_PROPAGATES_RELOAD_TO], c));
-        assert_se(!hashmap_get(c->dependencies[UNIT_RELOAD_PROPAGATED_FROM], a));
+        assert_se(!unit_dependency_list_get(a->dependencies[UNIT_PROPAGATES_RELOAD_TO], b));
+        assert_se(!unit_dependency_list_get(b->dependencies[UNIT_RELOAD_PROPAGATED_FROM], a));
+        assert_se(!unit_dependency_list_get(a->dependencies[UNIT_PROPAGATES_RELOAD_TO], c));
+        assert_se(!unit_dependency_list_get(c->dependencies[UNIT_RELOAD_PROPAGATED_FROM], a));
 
         assert_se(manager_load_unit(m, "unit-with-multiple-dashes.service", NULL, NULL, &unit_with_multiple_dashes) >= 0);
 
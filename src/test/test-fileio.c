@@ -709,6 +709,41 @@ static void test_read_line3(void) {
         assert_se(read_line(f, LINE_MAX, NULL) == 0);
 }
 
+static void test_read_virtual_file(void) {
+        _cleanup_(unlink_tempfilep) char fn[] = "/tmp/test-fileio-virtual-XXXXXX";
+        _cleanup_close_ int fd = -1;
+        _cleanup_free_ char *full = NULL, *field = NULL;
+        char buf[LINE_MAX];
+        size_t size;
+
+        fd = mkostemp_safe(fn);
+        assert_se(fd >= 0);
+        assert_se(write(fd, "Name:\tfoo\nState:\tR (running)\n", 29) == 29);
+
+        /* The same fd may be used for repeated reads */
+        assert_se(read_virtual_file_fd(fd, buf, sizeof(buf), &size) >= 0);
+        assert_se(size == 29);
+        assert_se(read_virtual_file_fd(fd, buf, sizeof(buf), NULL) >= 0);
+        assert_se(streq(buf, "Name:\tfoo\nState:\tR (running)\n"));
+
+        assert_se(parse_proc_field(buf, "State", NEWLINE, &field) >= 0);
+        assert_se(streq(field, "R (running)"));
+        field = mfree(field);
+        assert_se(parse_proc_field(buf, "foo", NEWLINE, &field) == -ENOENT);
+
+        /* The trailing NUL byte has to fit too */
+        assert_se(read_virtual_file_fd(fd, buf, 29, NULL) == -E2BIG);
+        assert_se(read_virtual_file_fd(fd, buf, 30, NULL) >= 0);
+
+        assert_se(read_virtual_file_at(AT_FDCWD, fn, buf, sizeof(buf), NULL) >= 0);
+        assert_se(streq(buf, "Name:\tfoo\nState:\tR (running)\n"));
+
+        assert_se(read_virtual_file_at(AT_FDCWD, "/proc/self/status", buf, sizeof(buf) / 2, &size) == -E2BIG ||
+                  size < sizeof(buf) / 2);
+        assert_se(read_full_virtual_file("/proc/self/status", &full, NULL) >= 0);
+        assert_se(startswith(full, "Name:"));
+}
+
 int main(int argc, char *argv[]) {
         log_set_max_level(LOG_DEBUG);
         log_parse_environment();
@@ -733,6 +768,7 @@ int main(int argc, char *argv[]) {
         test_read_line();
         test_read_line2();
         test_read_line3();
+        test_read_virtual_file();
 
         return 0;
 }
@@ -3,7 +3,13 @@
   Copyright © 2013 Daniel Buch
 ***/
 
+#include "alloc-util.h"
+#include "env-util.h"
 #include "hashmap.h"
+#include "log.h"
+#include "string-util.h"
+#include "strv.h"
+#include "time-util.h"
 #include "util.h"
 
 void test_hashmap_funcs(void);
@@ -150,6 +156,73 @@ static void test_path_hashmap(void) {
         assert_se(!hashmap_get(h, "/foo////bar////quux/////"));
 }
 
+/* Same as trivial_hash_ops, but hashed with the full SipHash-2-4, for comparison */
+static const struct hash_ops untrusted_trivial_hash_ops = {
+        .hash = trivial_hash_func,
+        .compare = trivial_compare_func,
+};
+
+/* Same as string_hash_ops, but hashed with SipHash-1-3 */
+static const struct hash_ops trusted_string_hash_ops = {
+        .hash = (hash_func_t) string_hash_func,
+        .compare = (compare_func_t) string_compare_func,
+        .trusted_keys = true,
+};
+
+static void benchmark_one(const char *name, const struct hash_ops *ops, void **keys, unsigned n_keys, unsigned n_rounds) {
+        _cleanup_hashmap_free_ Hashmap *h = NULL;
+        usec_t ts_put, ts_get, ts_end;
+        unsigned i, r;
+
+        assert_se(h = hashmap_new(ops));
+
+        ts_put = now(CLOCK_MONOTONIC);
+        for (i = 0; i < n_keys; i++)
+                assert_se(hashmap_put(h, keys[i], UINT_TO_PTR(i + 1)) == 1);
+
+        ts_get = now(CLOCK_MONOTONIC);
+        for (r = 0; r < n_rounds; r++)
+                for (i = 0; i < n_keys; i++)
+                        assert_se(hashmap_get(h, keys[i]) == UINT_TO_PTR(i + 1));
+        ts_end = now(CLOCK_MONOTONIC);
+
+        log_info("%-24s %7u entries: put %6.1f ns/op, get %6.1f ns/op",
+                 name, n_keys,
+                 (double) (ts_get - ts_put) * NSEC_PER_USEC / n_keys,
+                 (double) (ts_end - ts_get) * NSEC_PER_USEC / ((uint64_t) n_keys * n_rounds));
+}
+
+static void test_hashmap_benchmark(void) {
+        _cleanup_free_ void **pointers = NULL;
+        char **strings = NULL;
+        unsigned i, n_keys, n_rounds;
+        bool slow;
+        int r;
+
+        r = getenv_bool("SYSTEMD_SLOW_TESTS");
+        slow = r >= 0 ? r : SYSTEMD_SLOW_TESTS_DEFAULT;
+
+        n_keys = slow ? 1 << 20 : 1 << 12;
+        n_rounds = slow ? 10 : 4;
+
+        log_info("%s (%s)", __func__, slow ? "slow" : "fast");
+
+        assert_se(pointers = new(void*, n_keys));
+        assert_se(strings = new0(char*, n_keys + 1));
+
+        for (i = 0; i < n_keys; i++) {
+                pointers[i] = UINT_TO_PTR((i + 1) * 16);
+                assert_se(asprintf(&strings[i], "unit-%u.service", i) >= 0);
+        }
+
+        benchmark_one("pointer, siphash24", &untrusted_trivial_hash_ops, pointers, n_keys, n_rounds);
+        benchmark_one("pointer, siphash13", &trivial_hash_ops, pointers, n_keys, n_rounds);
+        benchmark_one("string, siphash24", &string_hash_ops, (void**) strings, n_keys, n_rounds);
+        benchmark_one("string, siphash13", &trusted_string_hash_ops, (void**) strings, n_keys, n_rounds);
+
+        strv_free(strings);
+}
+
 int main(int argc, const char *argv[]) {
         test_hashmap_funcs();
         test_ordered_hashmap_funcs();
@@ -161,6 +234,7 @@ int main(int argc, const char *argv[]) {
         test_string_compare_func();
         test_iterated_cache();
         test_path_hashmap();
+        test_hashmap_benchmark();
 
         return 0;
 }
@@ -0,0 +1,211 @@
+/* SPDX-License-Identifier: LGPL-2.1+ */
+
+#include <pthread.h>
+
+#include "hashmap.h"
+#include "mempool.h"
+#include "util.h"
+
+struct tile {
+        uint64_t data[4];
+};
+
+DEFINE_MEMPOOL(test_pool, struct tile, 16);
+
+static void test_alloc_free(void) {
+        struct mempool_stats stats;
+        struct tile *a, *b;
+
+        assert_se(a = mempool_alloc0_tile(&test_pool));
+        assert_se(a->data[0] == 0 && a->data[3] == 0);
+        assert_se(b = mempool_alloc_tile(&test_pool));
+        assert_se(a != b);
+
+        mempool_free_tile(&test_pool, a);
+        assert_se(mempool_alloc_tile(&test_pool) == a);
+
+        mempool_free_tile(&test_pool, a);
+        mempool_free_tile(&test_pool, b);
+
+        mempool_get_stats(&test_pool, &stats);
+        assert_se(stats.n_pools == 1);
+        assert_se(stats.n_tiles == 2);
+        assert_se(stats.n_free == 2);
+
+        assert_se(mempool_trim(&test_pool) > 0);
+
+        mempool_get_stats(&test_pool, &stats);
+        assert_se(stats.n_pools == 0);
+        assert_se(stats.n_tiles == 0);
+        assert_se(stats.n_free == 0);
+}
+
+static void test_trim_partial(void) {
+        struct mempool_stats stats;
+        struct tile *t[512];
+        unsigned i;
+
+        /* This needs more than one pool */
+        for (i = 0; i < ELEMENTSOF(t); i++)
+                assert_se(t[i] = mempool_alloc_tile(&test_pool));
+
+        mempool_get_stats(&test_pool, &stats);
+        assert_se(stats.n_pools > 1);
+
+        /* Keep a tile of the oldest pool in use, hence only the newer ones can be released */
+        for (i = 1; i < ELEMENTSOF(t); i++)
+                mempool_free_tile(&test_pool, t[i]);
+        assert_se(mempool_trim(&test_pool) > 0);
+
+        mempool_get_stats(&test_pool, &stats);
+        assert_se(stats.n_pools == 1);
+        assert_se(stats.n_tiles >= 1);
+
+        mempool_free_tile(&test_pool, t[0]);
+        assert_se(mempool_trim(&test_pool) > 0);
+
+        mempool_get_stats(&test_pool, &stats);
+        assert_se(stats.n_pools == 0);
+}
+
+static void *alloc_thread(void *p) {
+        struct tile **t = p;
+        struct tile *unused;
+
+        assert_se(*t = mempool_alloc_tile(&test_pool));
+
+        /* Leave a free tile behind, it should be handed to the depot when we exit */
+        assert_se(unused = mempool_alloc_tile(&test_pool));
+        mempool_free_tile(&test_pool, unused);
+
+        return NULL;
+}
+
+static void test_threads(void) {
+        struct mempool_stats stats;
+        struct tile *t = NULL, *u;
+        pthread_t thread;
+
+        mempool_get_stats(&test_pool, &stats);
+        assert_se(stats.n_pools == 0);
+
+        assert_se(pthread_create(&thread, NULL, alloc_thread, &t) == 0);
+        assert_se(pthread_join(thread, NULL) == 0);
+        assert_se(t);
+
+        /* The pool of the thread that exited is adopted */
+        assert_se(u = mempool_alloc_tile(&test_pool));
+        mempool_get_stats(&test_pool, &stats);
+        assert_se(stats.n_pools == 1);
+        assert_se(stats.n_free == stats.n_tiles - 2);
+
+        /* Free a tile allocated by another thread */
+        mempool_free_tile(&test_pool, t);
+        mempool_free_tile(&test_pool, u);
+
+        assert_se(mempool_trim(&test_pool) > 0);
+        mempool_get_stats(&test_pool, &stats);
+        assert_se(stats.n_pools == 0);
+}
+
+static void *free_thread(void *p) {
+        struct mempool_stats stats;
+
+        assert_se(!mempool_enabled());
+
+        mempool_free_tile(&test_pool, p);
+
+        /* Without thread pools the tile goes back to the depot right away */
+        mempool_get_stats(&test_pool, &stats);
+        assert_se(stats.n_free == 0);
+
+        return NULL;
+}
+
+static void *hashmap_malloc_thread(void *p) {
+        struct mempool_stats stats;
+        Hashmap **h = p;
+
+        assert_se(*h = hashmap_new(NULL));
+
+        hashmap_get_pool_stats(&stats);
+        assert_se(stats.n_pools == 0);
+
+        return NULL;
+}
+
+static void test_main_thread_only(void) {
+        struct mempool_stats stats;
+        struct tile *t, *u[512];
+        Hashmap *h = NULL;
+        pthread_t thread;
+        unsigned i, n;
+
+        assert_se(mempool_enabled());
+
+        assert_se(t = mempool_alloc_tile(&test_pool));
+        assert_se(pthread_create(&thread, NULL, free_thread, t) == 0);
+        assert_se(pthread_join(thread, NULL) == 0);
+
+        mempool_get_stats(&test_pool, &stats);
+        assert_se(stats.n_free == 0);
+
+        /* Once our pool is used up, the tile freed by the thread is picked up from the depot again */
+        for (n = 0; n < ELEMENTSOF(u); n++) {
+                assert_se(u[n] = mempool_alloc_tile(&test_pool));
+                if (u[n] == t)
+                        break;
+        }
+        assert_se(n < ELEMENTSOF(u));
+
+        for (i = 0; i <= n; i++)
+                mempool_free_tile(&test_pool, u[i]);
+        assert_se(mempool_trim(&test_pool) > 0);
+
+        mempool_get_stats(&test_pool, &stats);
+        assert_se(stats.n_pools == 0);
+
+        /* Other threads don't use the pools at all */
+        assert_se(pthread_create(&thread, NULL, hashmap_malloc_thread, &h) == 0);
+        assert_se(pthread_join(thread, NULL) == 0);
+        assert_se(h);
+        hashmap_free(h);
+}
+
+static void *hashmap_thread(void *p) {
+        struct mempool_stats stats;
+        Hashmap **h = p;
+
+        assert_se(*h = hashmap_new(NULL));
+
+        hashmap_get_pool_stats(&stats);
+        assert_se(stats.n_pools == 1);
+        assert_se(stats.n_tiles == 1);
+
+        return NULL;
+}
+
+static void test_hashmap_threads(void) {
+        Hashmap *h = NULL;
+        pthread_t thread;
+
+        assert_se(pthread_create(&thread, NULL, hashmap_thread, &h) == 0);
+        assert_se(pthread_join(thread, NULL) == 0);
+        assert_se(h);
+
+        assert_se(hashmap_put(h, INT_TO_PTR(1), INT_TO_PTR(2)) == 1);
+        hashmap_free(h);
+}
+
+int main(int argc, char *argv[]) {
+        test_main_thread_only();
+
+        mempool_enable_thread_pools();
+
+        test_alloc_free();
+        test_trim_partial();
+        test_threads();
+        test_hashmap_threads();
+
+        return 0;
+}
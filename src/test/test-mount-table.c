@@ -0,0 +1,234 @@
+/* SPDX-License-Identifier: LGPL-2.1+ */
+
+#include <sched.h>
+#include <stdlib.h>
+#include <sys/mount.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "alloc-util.h"
+#include "log.h"
+#include "mount-table.h"
+#include "process-util.h"
+#include "set.h"
+#include "stdio-util.h"
+#include "string-util.h"
+#include "util.h"
+
+#define ROOT "1 0 8:1 / / rw,relatime shared:1 - ext4 /dev/sda1 rw\n"
+#define PROC "2 1 0:4 / /proc rw,nosuid shared:2 - proc proc rw\n"
+#define HOME "3 1 8:2 / /home rw,relatime shared:3 - ext4 /dev/sda2 rw\n"
+#define HOME_RO "3 1 8:2 / /home ro,relatime shared:3 - ext4 /dev/sda2 ro\n"
+#define HOME_TMPFS "4 3 0:40 / /home rw shared:4 - tmpfs tmpfs rw\n"
+#define SPACE "5 1 8:3 / /mnt/with\\040space rw shared:5 - xfs /dev/sda3 rw\n"
+
+static void update(MountTable *t, const char *mountinfo, const char *utab, int expected, MountTableChanges *changes) {
+        mount_table_changes_done(changes);
+        assert_se(mount_table_update_from_string(t, mountinfo, utab, changes) == expected);
+}
+
+static void test_basic(void) {
+        _cleanup_(mount_table_changes_done) MountTableChanges changes = {};
+        _cleanup_(mount_table_freep) MountTable *t = NULL;
+        MountTableEntry *e;
+
+        log_info("%s", __func__);
+
+        assert_se(mount_table_new(&t) >= 0);
+
+        /* The first update has nothing to compare with */
+        update(t, ROOT PROC HOME, NULL, 0, &changes);
+        assert_se(mount_table_size(t) == 3);
+        assert_se(set_size(changes.wheres) == 3);
+        assert_se(set_contains(changes.found, "/dev/sda2"));
+        assert_se(set_isempty(changes.lost));
+
+        assert_se(e = mount_table_get(t, "/home"));
+        assert_se(e->id == 3);
+        assert_se(streq(e->what, "/dev/sda2"));
+        assert_se(streq(e->fstype, "ext4"));
+        assert_se(mount_table_has_what(t, "proc"));
+
+        /* Nothing changed */
+        update(t, ROOT PROC HOME, NULL, 1, &changes);
+        assert_se(set_isempty(changes.wheres));
+        assert_se(set_isempty(changes.found));
+        assert_se(set_isempty(changes.lost));
+
+        /* A remount is reported as the source being lost and found again */
+        update(t, ROOT PROC HOME_RO, NULL, 1, &changes);
+        assert_se(set_size(changes.wheres) == 1);
+        assert_se(set_contains(changes.wheres, "/home"));
+        assert_se(set_contains(changes.found, "/dev/sda2"));
+        assert_se(set_contains(changes.lost, "/dev/sda2"));
+        assert_se(e = mount_table_get(t, "/home"));
+        assert_se(strstr(e->options, "ro"));
+
+        /* Stacked mounts, the later one is on top */
+        update(t, ROOT PROC HOME_RO HOME_TMPFS, NULL, 1, &changes);
+        assert_se(set_size(changes.wheres) == 1);
+        assert_se(e = mount_table_get(t, "/home"));
+        assert_se(streq(e->fstype, "tmpfs"));
+        assert_se(mount_table_has_what(t, "/dev/sda2"));
+
+        update(t, ROOT PROC HOME_RO, NULL, 1, &changes);
+        assert_se(set_contains(changes.wheres, "/home"));
+        assert_se(set_contains(changes.lost, "tmpfs"));
+        assert_se(!mount_table_has_what(t, "tmpfs"));
+        assert_se(e = mount_table_get(t, "/home"));
+        assert_se(streq(e->fstype, "ext4"));
+
+        /* Removal, and an escaped mount point */
+        update(t, ROOT SPACE, NULL, 1, &changes);
+        assert_se(set_size(changes.wheres) == 3);
+        assert_se(set_contains(changes.wheres, "/proc"));
+        assert_se(set_contains(changes.wheres, "/mnt/with space"));
+        assert_se(set_contains(changes.lost, "/dev/sda2"));
+        assert_se(!mount_table_get(t, "/home"));
+        assert_se(mount_table_get(t, "/mnt/with space"));
+        assert_se(mount_table_size(t) == 2);
+
+        /* After a reset everything is new again */
+        mount_table_reset(t);
+        update(t, ROOT SPACE, NULL, 0, &changes);
+        assert_se(set_size(changes.wheres) == 2);
+}
+
+static void test_utab(void) {
+        _cleanup_(mount_table_changes_done) MountTableChanges changes = {};
+        _cleanup_(mount_table_freep) MountTable *t = NULL;
+        MountTableEntry *e;
+
+        log_info("%s", __func__);
+
+        assert_se(mount_table_new(&t) >= 0);
+
+        update(t, ROOT HOME, NULL, 0, &changes);
+        assert_se(e = mount_table_get(t, "/home"));
+        assert_se(!strstr(e->options, "x-foo"));
+
+        /* The userspace options are picked up even though the kernel's table didn't change */
+        update(t, ROOT HOME, "ID=3 SRC=/dev/sda2 TARGET=/home ROOT=/ OPTS=x-foo\n", 1, &changes);
+        assert_se(set_contains(changes.wheres, "/home"));
+        assert_se(e = mount_table_get(t, "/home"));
+        assert_se(strstr(e->options, "x-foo"));
+
+        update(t, ROOT HOME, NULL, 1, &changes);
+        assert_se(e = mount_table_get(t, "/home"));
+        assert_se(!strstr(e->options, "x-foo"));
+}
+
+static char* make_mountinfo(unsigned n, unsigned changed) {
+        _cleanup_free_ char *s = NULL;
+        size_t size = 0, allocated = 0;
+        unsigned i;
+
+        for (i = 0; i < n; i++) {
+                char line[256];
+
+                xsprintf(line, "%u 1 0:%u / /srv/bind%u %s shared:%u - tmpfs tmpfs rw\n",
+                         i + 2, i + 100, i, i == changed ? "ro" : "rw", i + 2);
+
+                assert_se(GREEDY_REALLOC(s, allocated, size + strlen(line) + 1));
+                strcpy(s + size, line);
+                size += strlen(line);
+        }
+
+        return TAKE_PTR(s);
+}
+
+static void test_many(unsigned n) {
+        _cleanup_(mount_table_changes_done) MountTableChanges changes = {};
+        _cleanup_(mount_table_freep) MountTable *t = NULL;
+        _cleanup_free_ char *a = NULL, *b = NULL;
+        unsigned i;
+
+        log_info("%s(%u)", __func__, n);
+
+        assert_se(mount_table_new(&t) >= 0);
+        assert_se(a = make_mountinfo(n, UINT_MAX));
+        assert_se(b = make_mountinfo(n, n / 2));
+
+        update(t, a, NULL, 0, &changes);
+        assert_se(mount_table_size(t) == n);
+        assert_se(set_size(changes.wheres) == n);
+
+        for (i = 0; i < 4; i++) {
+                update(t, i % 2 ? a : b, NULL, 1, &changes);
+                assert_se(mount_table_size(t) == n);
+                assert_se(set_size(changes.wheres) == 1);
+        }
+}
+
+static void test_bind_mounts(unsigned n) {
+        _cleanup_(mount_table_changes_done) MountTableChanges changes = {};
+        _cleanup_(mount_table_freep) MountTable *t = NULL;
+        char tmp[] = "/tmp/test-mount-table-XXXXXX";
+        char path[STRLEN("/tmp/test-mount-table-XXXXXX/") + DECIMAL_STR_MAX(unsigned)];
+        unsigned i, base;
+        pid_t pid;
+        int r;
+
+        log_info("%s(%u)", __func__, n);
+
+        if (geteuid() != 0) {
+                log_info("not running as root, skipping");
+                return;
+        }
+
+        /* Do the mounting in a private mount namespace, so that nothing leaks if we fail half way */
+        r = safe_fork("(test-mount-table)", FORK_DEATHSIG|FORK_LOG|FORK_WAIT, &pid);
+        assert_se(r >= 0);
+        if (r > 0)
+                return;
+
+        if (unshare(CLONE_NEWNS) < 0) {
+                log_notice_errno(errno, "Can't create mount namespace, skipping: %m");
+                _exit(EXIT_SUCCESS);
+        }
+
+        assert_se(mount(NULL, "/", NULL, MS_PRIVATE|MS_REC, NULL) >= 0);
+        assert_se(mkdtemp(tmp));
+        assert_se(mount("tmpfs", tmp, "tmpfs", 0, NULL) >= 0);
+
+        assert_se(mount_table_new(&t) >= 0);
+        assert_se(mount_table_update(t, &changes) == 0);
+        base = mount_table_size(t);
+
+        for (i = 0; i < n; i++) {
+                xsprintf(path, "%s/%u", tmp, i);
+                assert_se(mkdir(path, 0755) >= 0);
+                assert_se(mount(tmp, path, NULL, MS_BIND, NULL) >= 0);
+        }
+
+        mount_table_changes_done(&changes);
+        assert_se(mount_table_update(t, &changes) == 1);
+        assert_se(mount_table_size(t) == base + n);
+        assert_se(set_size(changes.wheres) == n);
+
+        xsprintf(path, "%s/%u", tmp, n / 2);
+        assert_se(umount(path) >= 0);
+
+        mount_table_changes_done(&changes);
+        assert_se(mount_table_update(t, &changes) == 1);
+        assert_se(set_size(changes.wheres) == 1);
+        assert_se(set_contains(changes.wheres, path));
+        assert_se(!mount_table_get(t, path));
+
+        assert_se(umount2(tmp, MNT_DETACH) >= 0);
+        (void) rmdir(tmp);
+
+        _exit(EXIT_SUCCESS);
+}
+
+int main(int argc, char *argv[]) {
+        log_parse_environment();
+        log_open();
+
+        test_basic();
+        test_utab();
+        test_many(1000);
+        test_bind_mounts(100);
+
+        return 0;
+}
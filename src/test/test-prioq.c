@@ -3,9 +3,11 @@
 #include <stdlib.h>
 
 #include "alloc-util.h"
+#include "log.h"
 #include "prioq.h"
 #include "set.h"
 #include "siphash24.h"
+#include "time-util.h"
 #include "util.h"
 
 #define SET_SIZE 1024*4
@@ -156,10 +158,147 @@ static void test_struct(void) {
         set_free(s);
 }
 
+static void test_keyed(void) {
+        struct test *t, items[SET_SIZE];
+        unsigned previous = 0, i;
+        Prioq *q;
+
+        srand(0);
+
+        assert_se(q = prioq_new(NULL));
+
+        for (i = 0; i < ELEMENTSOF(items); i++) {
+                items[i].value = (unsigned) rand();
+                assert_se(prioq_put_with_key(q, items + i, &items[i].idx, items[i].value) >= 0);
+        }
+
+        /* Move some items to the front and some to the back */
+        for (i = 0; i < ELEMENTSOF(items); i += 7) {
+                items[i].value = i % 2 ? items[i].value / 2 : items[i].value + items[i].value / 2;
+                assert_se(prioq_set_key(q, items + i, &items[i].idx, items[i].value) > 0);
+        }
+
+        for (i = 0; i < ELEMENTSOF(items); i++) {
+                assert_se(t = prioq_pop(q));
+                assert_se(previous <= t->value);
+                previous = t->value;
+        }
+
+        assert_se(prioq_isempty(q));
+        prioq_free(q);
+}
+
+static void test_put_many(void) {
+        struct test items[SET_SIZE], *t;
+        void *data[ELEMENTSOF(items)];
+        unsigned *idx[ELEMENTSOF(items)];
+        unsigned previous = 0, i;
+        Prioq *q;
+
+        srand(0);
+
+        assert_se(q = prioq_new(test_compare));
+
+        for (i = 0; i < ELEMENTSOF(items); i++) {
+                items[i].value = (unsigned) rand();
+                data[i] = items + i;
+                idx[i] = &items[i].idx;
+        }
+
+        /* A large batch into an empty queue, then a small one into a large queue */
+        assert_se(prioq_put_many(q, data, idx, NULL, ELEMENTSOF(items) - 10) >= 0);
+        assert_se(prioq_put_many(q, data + ELEMENTSOF(items) - 10, idx + ELEMENTSOF(items) - 10, NULL, 10) >= 0);
+        assert_se(prioq_size(q) == ELEMENTSOF(items));
+
+        for (i = 0; i < ELEMENTSOF(items); i++)
+                assert_se(prioq_peek_by_index(q, items[i].idx) == items + i);
+
+        /* Change all priorities at once */
+        for (i = 0; i < ELEMENTSOF(items); i++)
+                items[i].value = UINT_MAX - items[i].value;
+        prioq_reshuffle_all(q);
+
+        for (i = 0; i < ELEMENTSOF(items); i++) {
+                assert_se(t = prioq_pop(q));
+                assert_se(previous <= t->value);
+                previous = t->value;
+        }
+
+        prioq_free(q);
+}
+
+#define BENCHMARK_SIZE (1024U*1024U)
+
+static void test_benchmark(void) {
+        _cleanup_free_ struct test *items = NULL;
+        _cleanup_free_ void **data = NULL;
+        _cleanup_free_ uint64_t *keys = NULL;
+        usec_t ts[4];
+        unsigned i, mode;
+        Prioq *q;
+
+        static const char *const mode_names[] = {
+                "compare func",
+                "inline key",
+                "compare func, heapify",
+        };
+
+        assert_se(items = new(struct test, BENCHMARK_SIZE));
+        assert_se(data = new(void*, BENCHMARK_SIZE));
+        assert_se(keys = new(uint64_t, BENCHMARK_SIZE));
+
+        for (mode = 0; mode < ELEMENTSOF(mode_names); mode++) {
+                srand(0);
+
+                for (i = 0; i < BENCHMARK_SIZE; i++) {
+                        items[i].value = (unsigned) rand();
+                        data[i] = items + i;
+                        keys[i] = items[i].value;
+                }
+
+                assert_se(q = prioq_new(mode == 1 ? NULL : test_compare));
+
+                ts[0] = now(CLOCK_MONOTONIC);
+
+                if (mode == 2)
+                        assert_se(prioq_put_many(q, data, NULL, NULL, BENCHMARK_SIZE) >= 0);
+                else
+                        for (i = 0; i < BENCHMARK_SIZE; i++)
+                                assert_se(prioq_put_with_key(q, items + i, &items[i].idx, keys[i]) >= 0);
+
+                ts[1] = now(CLOCK_MONOTONIC);
+
+                /* Push every 16th item towards the back, as timer updates would do */
+                if (mode != 2)
+                        for (i = 0; i < BENCHMARK_SIZE; i += 16) {
+                                items[i].value += 1U << 20;
+                                assert_se(prioq_set_key(q, items + i, &items[i].idx, items[i].value) > 0);
+                        }
+
+                ts[2] = now(CLOCK_MONOTONIC);
+
+                for (i = 0; i < BENCHMARK_SIZE; i++)
+                        assert_se(prioq_pop(q));
+
+                ts[3] = now(CLOCK_MONOTONIC);
+
+                log_info("%-22s %u items: put %4.0f ms, update %4.0f ms, pop %4.0f ms",
+                         mode_names[mode], BENCHMARK_SIZE,
+                         (double) (ts[1] - ts[0]) / USEC_PER_MSEC,
+                         (double) (ts[2] - ts[1]) / USEC_PER_MSEC,
+                         (double) (ts[3] - ts[2]) / USEC_PER_MSEC);
+
+                prioq_free(q);
+        }
+}
+
 int main(int argc, char* argv[]) {
 
         test_unsigned();
         test_struct();
+        test_keyed();
+        test_put_many();
+        test_benchmark();
 
         return 0;
 }
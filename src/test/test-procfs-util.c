@@ -2,13 +2,94 @@
 
 #include <errno.h>
 
+#include "alloc-util.h"
+#include "audit-util.h"
+#include "cgroup-util.h"
+#include "env-util.h"
+#include "fd-util.h"
+#include "fileio.h"
 #include "log.h"
 #include "parse-util.h"
 #include "procfs-util.h"
 #include "process-util.h"
+#include "string-util.h"
 #include "util.h"
 #include "tests.h"
 
+static void test_procfs_pid_open(void) {
+        _cleanup_close_ int fd = -1;
+        _cleanup_free_ char *comm = NULL, *a = NULL, *b = NULL;
+        uint32_t session;
+
+        fd = procfs_pid_open(0);
+        assert_se(fd >= 0);
+
+        assert_se(get_process_comm_at(fd, &comm) >= 0);
+        assert_se(streq(comm, "test-procfs-uti"));
+
+        assert_se(get_process_exe_at(fd, &a) >= 0);
+        assert_se(get_process_exe(0, &b) >= 0);
+        assert_se(streq(a, b));
+        a = mfree(a);
+        b = mfree(b);
+
+        assert_se(cg_pid_get_path_at(NULL, fd, &a) == cg_pid_get_path(NULL, 0, &b));
+        assert_se(streq_ptr(a, b));
+
+        assert_se(IN_SET(audit_session_from_proc_fd(fd, &session), 0, -ENOENT, -ENODATA));
+
+        assert_se(procfs_pid_open(INT32_MAX) == -ESRCH);
+}
+
+static void test_procfs_benchmark(void) {
+        _cleanup_close_ int fd = -1;
+        char buf[4096], *t;
+        usec_t ts_path, ts_fd, ts_end;
+        const char *status, *comm;
+        unsigned i, n;
+        bool slow;
+        int r;
+
+        r = getenv_bool("SYSTEMD_SLOW_TESTS");
+        slow = r >= 0 ? r : SYSTEMD_SLOW_TESTS_DEFAULT;
+
+        n = slow ? 100000 : 1000;
+
+        log_info("%s (%s)", __func__, slow ? "slow" : "fast");
+
+        /* Read the same fields as journald does for each client, once by path, the way it used to be done, and
+         * once through an fd to the /proc directory of the process */
+
+        status = procfs_file_alloca(getpid_cached(), "status");
+        comm = procfs_file_alloca(getpid_cached(), "comm");
+
+        ts_path = now(CLOCK_MONOTONIC);
+        for (i = 0; i < n; i++) {
+                assert_se(read_one_line_file(comm, &t) >= 0);
+                free(t);
+                assert_se(get_proc_field(status, "Uid", WHITESPACE, &t) >= 0);
+                free(t);
+                assert_se(get_proc_field(status, "CapEff", WHITESPACE, &t) >= 0);
+                free(t);
+        }
+
+        ts_fd = now(CLOCK_MONOTONIC);
+        assert_se((fd = procfs_pid_open(getpid_cached())) >= 0);
+        for (i = 0; i < n; i++) {
+                assert_se(read_virtual_file_at(fd, "comm", buf, sizeof(buf), NULL) >= 0);
+                assert_se(read_virtual_file_at(fd, "status", buf, sizeof(buf), NULL) >= 0);
+                assert_se(parse_proc_field(buf, "Uid", WHITESPACE, &t) >= 0);
+                free(t);
+                assert_se(parse_proc_field(buf, "CapEff", WHITESPACE, &t) >= 0);
+                free(t);
+        }
+        ts_end = now(CLOCK_MONOTONIC);
+
+        log_info("by path: %6.2f us/iteration, by fd: %6.2f us/iteration",
+                 (double) (ts_fd - ts_path) / n,
+                 (double) (ts_end - ts_fd) / n);
+}
+
 int main(int argc, char *argv[]) {
         char buf[CONST_MAX(FORMAT_TIMESPAN_MAX, FORMAT_BYTES_MAX)];
         nsec_t nsec;
@@ -18,6 +99,9 @@ int main(int argc, char *argv[]) {
         log_parse_environment();
         log_open();
 
+        test_procfs_pid_open();
+        test_procfs_benchmark();
+
         assert_se(procfs_cpu_get_usage(&nsec) >= 0);
         log_info("Current system CPU time: %s", format_timespan(buf, sizeof(buf), nsec/NSEC_PER_USEC, 1));
 
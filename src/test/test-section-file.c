@@ -0,0 +1,66 @@
+/* SPDX-License-Identifier: LGPL-2.1+ */
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "alloc-util.h"
+#include "fd-util.h"
+#include "fileio.h"
+#include "fs-util.h"
+#include "io-util.h"
+#include "section-file.h"
+#include "string-util.h"
+#include "util.h"
+
+#define SIGNATURE "TESTSECT"
+
+static void test_section_file(void) {
+        _cleanup_(unlink_tempfilep) char p[] = "/tmp/test-section-file.XXXXXX";
+        _cleanup_close_ int fd = -1;
+        const uint64_t numbers[] = { 1, 2, 3, 0xdeadbeef };
+        const char strings[] = "foo\0bar\0baz";
+        const struct iovec sections[] = {
+                IOVEC_INIT((void*) numbers, sizeof(numbers)),
+                IOVEC_INIT(NULL, 0),
+                IOVEC_INIT((void*) strings, sizeof(strings)),
+        };
+        SectionFile f;
+        size_t i;
+
+        fd = mkostemp_safe(p);
+        assert_se(fd >= 0);
+
+        assert_se(section_file_write(p, SIGNATURE, 7, 0x1234, sections, ELEMENTSOF(sections), 0644) >= 0);
+
+        assert_se(section_file_map(p, SIGNATURE, 7, &f) >= 0);
+        assert_se(f.stamp == 0x1234);
+        assert_se(f.n_sections == ELEMENTSOF(sections));
+
+        for (i = 0; i < f.n_sections; i++) {
+                assert_se(f.sections[i].iov_len == sections[i].iov_len);
+                assert_se(((uint8_t*) f.sections[i].iov_base - (uint8_t*) f.map) % SECTION_FILE_ALIGN == 0);
+                assert_se(memcmp(f.sections[i].iov_base, sections[i].iov_base, sections[i].iov_len) == 0);
+        }
+
+        assert_se(((const uint64_t*) f.sections[0].iov_base)[3] == 0xdeadbeef);
+        assert_se(streq((const char*) f.sections[2].iov_base + 4, "bar"));
+
+        section_file_unmap(&f);
+        assert_se(!f.map);
+
+        assert_se(section_file_map(p, SIGNATURE, 8, &f) == -EPROTONOSUPPORT);
+        assert_se(section_file_map(p, "OTHERSIG", 7, &f) == -EBADMSG);
+
+        /* Truncated files are refused */
+        assert_se(truncate(p, SECTION_FILE_ALIGN) >= 0);
+        assert_se(section_file_map(p, SIGNATURE, 7, &f) == -EBADMSG);
+
+        assert_se(unlink(p) >= 0);
+        assert_se(section_file_map(p, SIGNATURE, 7, &f) == -ENOENT);
+}
+
+int main(int argc, char *argv[]) {
+        test_section_file();
+
+        return 0;
+}
@@ -0,0 +1,217 @@
+/* SPDX-License-Identifier: LGPL-2.1+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "alloc-util.h"
+#include "fd-util.h"
+#include "fileio.h"
+#include "log.h"
+#include "serialize.h"
+#include "string-util.h"
+#include "util.h"
+
+static FILE* open_serialization(void) {
+        FILE *f;
+        int fd;
+
+        fd = open_serialization_fd("test-serialize");
+        assert_se(fd >= 0);
+
+        assert_se(f = fdopen(fd, "w+"));
+        return f;
+}
+
+static void test_roundtrip(SerializationFormat format) {
+        _cleanup_(serialization_reader_freep) SerializationReader *reader = NULL;
+        _cleanup_fclose_ FILE *f = NULL, *b = NULL;
+        _cleanup_free_ char *long_value = NULL;
+        char *l;
+        FILE *w;
+
+        log_info("%s(%s)", __func__, serialization_format_to_string(format));
+
+        /* Longer than the stdio buffer, so that it's split across writes */
+        assert_se(long_value = malloc(3 * BUFSIZ + 1));
+        memset(long_value, 'x', 3 * BUFSIZ);
+        long_value[3 * BUFSIZ] = 0;
+
+        f = open_serialization();
+
+        if (format == SERIALIZATION_BINARY) {
+                assert_se(serialization_binary_writer_open(f, &b) >= 0);
+                w = b;
+        } else
+                w = f;
+
+        fputs("foo=bar\n", w);
+        fputs("  spaces=around  \n", w);
+        fputc('\n', w);
+        fputs("unit.service\n", w);
+        fprintf(w, "long=%s\n", long_value);
+        fputs("last=unterminated", w);
+
+        if (b) {
+                assert_se(fclose(b) == 0);
+                b = NULL;
+        }
+
+        assert_se(fflush_and_check(f) >= 0);
+        assert_se(fseeko(f, 0, SEEK_SET) >= 0);
+
+        assert_se(serialization_reader_open(f, &reader) >= 0);
+        assert_se(serialization_reader_format(reader) == format);
+
+        assert_se(serialization_read_line(reader, &l) > 0);
+        assert_se(streq(l, "foo=bar"));
+        assert_se(serialization_read_line(reader, &l) > 0);
+        assert_se(streq(l, "spaces=around"));
+        assert_se(serialization_read_line(reader, &l) > 0);
+        assert_se(isempty(l));
+        assert_se(serialization_read_line(reader, &l) > 0);
+        assert_se(streq(l, "unit.service"));
+        assert_se(serialization_read_line(reader, &l) > 0);
+        assert_se(startswith(l, "long="));
+        assert_se(streq(l + 5, long_value));
+        assert_se(serialization_read_line(reader, &l) > 0);
+        assert_se(streq(l, "last=unterminated"));
+        assert_se(serialization_read_line(reader, &l) == 0);
+        assert_se(serialization_read_line(reader, &l) == 0);
+}
+
+static void test_binary_records(void) {
+        _cleanup_(serialization_reader_freep) SerializationReader *reader = NULL;
+        _cleanup_fclose_ FILE *f = NULL;
+        struct serialization_header h = {
+                .signature = SERIALIZATION_SIGNATURE,
+                .version = htole32(SERIALIZATION_VERSION),
+        };
+        struct serialization_record rec;
+        char *l;
+
+        log_info("%s", __func__);
+
+        f = open_serialization();
+        assert_se(fwrite(&h, sizeof(h), 1, f) == 1);
+
+        /* Records of unknown types are skipped */
+        rec = (struct serialization_record) { .type = htole32(4711), .size = htole32(3) };
+        assert_se(fwrite(&rec, sizeof(rec), 1, f) == 1);
+        assert_se(fwrite("abc", 4, 1, f) == 1);
+
+        rec = (struct serialization_record) { .type = htole32(SERIALIZATION_RECORD_LINE), .size = htole32(5) };
+        assert_se(fwrite(&rec, sizeof(rec), 1, f) == 1);
+        assert_se(fwrite("a=b=c", 6, 1, f) == 1);
+
+        /* A truncated one */
+        rec = (struct serialization_record) { .type = htole32(SERIALIZATION_RECORD_LINE), .size = htole32(100) };
+        assert_se(fwrite(&rec, sizeof(rec), 1, f) == 1);
+        assert_se(fwrite("xyz", 4, 1, f) == 1);
+
+        assert_se(fflush_and_check(f) >= 0);
+        assert_se(fseeko(f, 0, SEEK_SET) >= 0);
+
+        assert_se(serialization_reader_open(f, &reader) >= 0);
+        assert_se(serialization_reader_format(reader) == SERIALIZATION_BINARY);
+        assert_se(serialization_read_line(reader, &l) > 0);
+        assert_se(streq(l, "a=b=c"));
+        assert_se(serialization_read_line(reader, &l) == -EBADMSG);
+        reader = serialization_reader_free(reader);
+
+        /* Versions we don't know are refused */
+        h.version = htole32(SERIALIZATION_VERSION + 1);
+        assert_se(fseeko(f, 0, SEEK_SET) >= 0);
+        assert_se(fwrite(&h, sizeof(h), 1, f) == 1);
+        assert_se(fflush_and_check(f) >= 0);
+        assert_se(fseeko(f, 0, SEEK_SET) >= 0);
+        assert_se(serialization_reader_open(f, &reader) == -EPROTONOSUPPORT);
+}
+
+static void serialize_units(FILE *f, unsigned n_units) {
+        unsigned i, j;
+
+        /* Roughly what a service unit serializes, without jobs */
+        fputs("current-job-id=4711\nn-installed-jobs=815\ntaint-usr=no\n\n", f);
+
+        for (i = 0; i < n_units; i++) {
+                fprintf(f, "unit-%u.service\n", i);
+                fputs("state=running\nresult=success\nreload-result=success\n", f);
+                fprintf(f, "main-pid="PID_FMT"\nmain-pid-known=yes\nbus-name-good=no\n", (pid_t) (1000 + i));
+                fputs("status-text=Processing requests\\x2e\\x2e\\x2e\n", f);
+                for (j = 0; j < 9; j++)
+                        fprintf(f, "timestamp-%u=%" PRIu64 " %" PRIu64 "\n", j, (uint64_t) 1539000000000000 + i, (uint64_t) 5000000 + i);
+                fprintf(f, "cgroup=/system.slice/unit-%u.service\ncgroup-realized=yes\n", i);
+                fputs("cgroup-realized-mask=cpu io memory pids\ncgroup-enabled-mask=memory pids\n", f);
+                fprintf(f, "invocation-id=%032x\n", i);
+                fputs("transient=no\nexported-invocation-id=yes\ncpu-usage-base=0\n", f);
+                for (j = 0; j < 4; j++)
+                        fprintf(f, "ip-accounting-metric-%u=%u\n", j, i * j);
+                fputc('\n', f);
+        }
+}
+
+static unsigned deserialize_units(SerializationReader *reader) {
+        unsigned n_units = 0, n_items = 0;
+        char *l;
+
+        /* Mimics the manager: the header, then the units, each item split into key and value */
+        while (serialization_read_line(reader, &l) > 0 && !isempty(l))
+                n_items++;
+
+        while (serialization_read_line(reader, &l) > 0) {
+                n_units++;
+
+                while (serialization_read_line(reader, &l) > 0 && !isempty(l)) {
+                        size_t k;
+
+                        k = strcspn(l, "=");
+                        if (l[k] == '=')
+                                l[k] = 0;
+
+                        n_items++;
+                }
+        }
+
+        assert_se(n_items > n_units);
+        return n_units;
+}
+
+static void test_many_units(void) {
+        SerializationFormat format;
+
+        for (format = 0; format < _SERIALIZATION_FORMAT_MAX; format++) {
+                _cleanup_(serialization_reader_freep) SerializationReader *reader = NULL;
+                _cleanup_fclose_ FILE *f = NULL;
+
+                log_info("%s(%s)", __func__, serialization_format_to_string(format));
+
+                f = open_serialization();
+
+                if (format == SERIALIZATION_BINARY) {
+                        FILE *b;
+
+                        assert_se(serialization_binary_writer_open(f, &b) >= 0);
+                        serialize_units(b, 1000);
+                        assert_se(fclose(b) == 0);
+                } else
+                        serialize_units(f, 1000);
+
+                assert_se(fflush_and_check(f) >= 0);
+                assert_se(fseeko(f, 0, SEEK_SET) >= 0);
+
+                assert_se(serialization_reader_open(f, &reader) >= 0);
+                assert_se(deserialize_units(reader) == 1000);
+        }
+}
+
+int main(int argc, char *argv[]) {
+        log_parse_environment();
+        log_open();
+
+        test_roundtrip(SERIALIZATION_TEXT);
+        test_roundtrip(SERIALIZATION_BINARY);
+        test_binary_records();
+        test_many_units();
+
+        return 0;
+}
@@ -85,6 +85,21 @@ static void test_short_hashes(void) {
         }
 }
 
+static void test_siphash13(const uint8_t *in, size_t len, const uint8_t *key) {
+        struct siphash state = {};
+        unsigned i;
+
+        assert_se(siphash13(in, 0, key) == 0xabac0158050fc4dc);
+        assert_se(siphash13(in, len, key) == 0xd320d86d2a519956);
+
+        for (i = 0; i < len; i++) {
+                siphash13_init(&state, key);
+                siphash24_compress(in, i, &state);
+                siphash24_compress(&in[i], len - i, &state);
+                assert_se(siphash24_finalize(&state) == 0xd320d86d2a519956);
+        }
+}
+
 /* see https://131002.net/siphash/siphash.pdf, Appendix A */
 int main(int argc, char *argv[]) {
         const uint8_t in[15]  = { 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07,
@@ -104,4 +119,5 @@ int main(int argc, char *argv[]) {
         do_test(in_buf + 4, sizeof(in), key);
 
         test_short_hashes();
+        test_siphash13(in, sizeof(in), key);
 }
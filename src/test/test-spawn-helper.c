@@ -0,0 +1,98 @@
+/* SPDX-License-Identifier: LGPL-2.1+ */
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "fd-util.h"
+#include "log.h"
+#include "process-util.h"
+#include "spawn-helper.h"
+#include "stdio-util.h"
+#include "string-util.h"
+#include "util.h"
+
+static int child_write(void *data, size_t size, int *fds, size_t n_fds) {
+        /* Writes the request back into the passed pipe, and tells by the exit status whether we are a child of the
+         * process whose PID is in the request, and whether our PID is cached correctly */
+        if (n_fds != 1)
+                return EXIT_FAILURE;
+
+        if (write(fds[0], data, size) != (ssize_t) size)
+                return EXIT_FAILURE;
+
+        if (getpid_cached() != getpid())
+                return EXIT_FAILURE;
+
+        return getppid() == (pid_t) strtoul(data, NULL, 10) ? 42 : EXIT_FAILURE;
+}
+
+static int child_exec(void *data, size_t size, int *fds, size_t n_fds) {
+        execl(data, data, NULL);
+        return EXIT_FAILURE;
+}
+
+static void wait_for(pid_t pid, int status) {
+        siginfo_t si;
+
+        assert_se(waitid(P_PID, pid, &si, WEXITED) >= 0);
+        assert_se(si.si_code == CLD_EXITED);
+        assert_se(si.si_status == status);
+}
+
+static void test_spawn(void) {
+        _cleanup_(spawn_helper_freep) SpawnHelper *h = NULL;
+        _cleanup_close_pair_ int pair[2] = { -1, -1 };
+        char buf[DECIMAL_STR_MAX(pid_t)], received[sizeof(buf)] = {};
+        pid_t pid;
+
+        log_info("%s", __func__);
+
+        assert_se(spawn_helper_new("(test-spawn)", child_write, &h) >= 0);
+        assert_se(spawn_helper_is_connected(h));
+        assert_se(pipe2(pair, O_CLOEXEC) >= 0);
+
+        /* The cloned process is ours, not the helper's */
+        xsprintf(buf, PID_FMT, getpid_cached());
+        assert_se(spawn_helper_spawn(h, buf, strlen(buf) + 1, &pair[1], 1, &pid) >= 0);
+        wait_for(pid, 42);
+
+        assert_se(read(pair[0], received, sizeof(received)) == (ssize_t) strlen(buf) + 1);
+        assert_se(streq(received, buf));
+
+        /* Refused requests leave the helper usable */
+        assert_se(spawn_helper_spawn(h, buf, SPAWN_HELPER_REQUEST_MAX + 1, NULL, 0, &pid) == -EMSGSIZE);
+        assert_se(spawn_helper_spawn(h, buf, strlen(buf) + 1, NULL, 0, &pid) >= 0);
+        wait_for(pid, EXIT_FAILURE);
+        assert_se(spawn_helper_is_connected(h));
+}
+
+static void test_exec(void) {
+        _cleanup_(spawn_helper_freep) SpawnHelper *h = NULL;
+        pid_t pid;
+        unsigned i;
+
+        log_info("%s", __func__);
+
+        assert_se(spawn_helper_new("(test-spawn)", child_exec, &h) >= 0);
+
+        for (i = 0; i < 3; i++) {
+                assert_se(spawn_helper_spawn(h, "/bin/true", STRLEN("/bin/true") + 1, NULL, 0, &pid) >= 0);
+                wait_for(pid, EXIT_SUCCESS);
+        }
+
+        assert_se(spawn_helper_spawn(h, "/bin/false", STRLEN("/bin/false") + 1, NULL, 0, &pid) >= 0);
+        wait_for(pid, EXIT_FAILURE);
+}
+
+int main(int argc, char *argv[]) {
+        log_parse_environment();
+        log_open();
+
+        test_spawn();
+        test_exec();
+
+        return 0;
+}
@@ -0,0 +1,149 @@
+/* SPDX-License-Identifier: LGPL-2.1+ */
+
+#include <stdlib.h>
+
+#include "alloc-util.h"
+#include "hashmap.h"
+#include "log.h"
+#include "unit-dependency-list.h"
+#include "util.h"
+
+/* The lists never look at the units, hence any distinct addresses will do */
+static uint8_t fake_units[1000];
+#define FAKE_UNIT(i) ((Unit*) (fake_units + (i)))
+#define FAKE_DATA(i) UINT_TO_PTR((i) + 1)
+
+static void test_basic(unsigned n) {
+        UnitDependencyList *l = NULL, *m = NULL;
+        Iterator i;
+        unsigned k, seen = 0;
+        Unit *u;
+        void *v;
+
+        log_info("%s(%u)", __func__, n);
+
+        assert_se(unit_dependency_list_isempty(l));
+        assert_se(!unit_dependency_list_first(l));
+        assert_se(!unit_dependency_list_get(l, FAKE_UNIT(0)));
+        assert_se(!unit_dependency_list_remove(l, FAKE_UNIT(0)));
+
+        for (k = 0; k < n; k++)
+                assert_se(unit_dependency_list_replace(&l, FAKE_UNIT(k), FAKE_DATA(k)) == 1);
+        assert_se(unit_dependency_list_replace(&l, FAKE_UNIT(0), FAKE_DATA(42)) == 0);
+        assert_se(unit_dependency_list_size(l) == n);
+        assert_se(unit_dependency_list_get(l, FAKE_UNIT(0)) == FAKE_DATA(42));
+        assert_se(unit_dependency_list_get(l, FAKE_UNIT(n - 1)) == FAKE_DATA(n - 1));
+        assert_se(!unit_dependency_list_contains(l, FAKE_UNIT(n)));
+
+        /* Dropping the current entry while iterating neither skips nor repeats any */
+        UNIT_DEPENDENCY_FOREACH(v, u, l, i) {
+                seen++;
+                if ((uint8_t*) u - fake_units < n / 2)
+                        assert_se(unit_dependency_list_remove(l, u) == v);
+        }
+        assert_se(seen == n);
+        assert_se(unit_dependency_list_size(l) == n - n / 2);
+
+        for (k = 0; k < n; k++)
+                assert_se(unit_dependency_list_contains(l, FAKE_UNIT(k)) == (k >= n / 2));
+
+        /* Replacing by a unit that is not in the list yet reuses the entry, otherwise the two are merged */
+        assert_se(unit_dependency_list_remove_and_replace(l, FAKE_UNIT(0), FAKE_UNIT(n), NULL) == -ENOENT);
+        assert_se(unit_dependency_list_remove_and_replace(l, FAKE_UNIT(n - 1), FAKE_UNIT(n), FAKE_DATA(7)) >= 0);
+        assert_se(unit_dependency_list_size(l) == n - n / 2);
+        assert_se(unit_dependency_list_get(l, FAKE_UNIT(n)) == FAKE_DATA(7));
+        assert_se(unit_dependency_list_remove_and_replace(l, FAKE_UNIT(n), FAKE_UNIT(n / 2), FAKE_DATA(8)) >= 0);
+        assert_se(unit_dependency_list_size(l) == n - n / 2 - 1);
+        assert_se(unit_dependency_list_get(l, FAKE_UNIT(n / 2)) == FAKE_DATA(8));
+        assert_se(!unit_dependency_list_contains(l, FAKE_UNIT(n)));
+
+        /* Moving keeps the entries already there */
+        for (k = 0; k < n; k++)
+                assert_se(unit_dependency_list_replace(&m, FAKE_UNIT(k), FAKE_DATA(1000)) >= 0);
+        assert_se(unit_dependency_list_reserve(&l, n) >= 0);
+        assert_se(unit_dependency_list_move(&l, &m) == 0);
+        assert_se(!m);
+        assert_se(unit_dependency_list_size(l) == n);
+        assert_se(unit_dependency_list_get(l, FAKE_UNIT(n / 2)) == FAKE_DATA(8));
+        assert_se(unit_dependency_list_get(l, FAKE_UNIT(0)) == FAKE_DATA(1000));
+
+        unit_dependency_list_free(l);
+}
+
+/* A graph roughly like the one of a large system: every unit wants and is ordered after a few others, and one
+ * target pulls in everything */
+#define N_EDGES 4U
+
+enum {
+        DEP_WANTS,
+        DEP_WANTED_BY,
+        DEP_AFTER,
+        DEP_BEFORE,
+        _DEP_MAX,
+};
+
+static unsigned edge(unsigned u, unsigned k, unsigned n) {
+        return (u * 7919U + k * 104729U + 1) % n;
+}
+
+/* Builds the same graph as lists and as hashmaps and checks both agree */
+static void test_graph(unsigned n) {
+        _cleanup_free_ UnitDependencyList **l = NULL;
+        _cleanup_free_ Hashmap **h = NULL;
+        unsigned u, k, d, count = 0;
+
+        log_info("%s(%u)", __func__, n);
+
+        assert_se(n > N_EDGES && n <= ELEMENTSOF(fake_units));
+        assert_se(l = new0(UnitDependencyList*, n * _DEP_MAX));
+        assert_se(h = new0(Hashmap*, n * _DEP_MAX));
+
+        for (u = 0; u < n; u++)
+                for (k = 0; k < N_EDGES; k++) {
+                        unsigned o = u == 0 ? k + 1 : edge(u, k, n);
+                        d = k % 2 ? DEP_WANTS : DEP_AFTER;
+
+                        assert_se(unit_dependency_list_replace(&l[u * _DEP_MAX + d], FAKE_UNIT(o), FAKE_DATA(u)) >= 0);
+                        assert_se(unit_dependency_list_replace(&l[o * _DEP_MAX + d + 1], FAKE_UNIT(u), FAKE_DATA(u)) >= 0);
+
+                        assert_se(hashmap_ensure_allocated(&h[u * _DEP_MAX + d], NULL) >= 0);
+                        assert_se(hashmap_replace(h[u * _DEP_MAX + d], FAKE_UNIT(o), FAKE_DATA(u)) >= 0);
+                        assert_se(hashmap_ensure_allocated(&h[o * _DEP_MAX + d + 1], NULL) >= 0);
+                        assert_se(hashmap_replace(h[o * _DEP_MAX + d + 1], FAKE_UNIT(u), FAKE_DATA(u)) >= 0);
+                }
+        for (u = 1; u < n; u++) {
+                assert_se(unit_dependency_list_replace(&l[DEP_WANTS], FAKE_UNIT(u), FAKE_DATA(u)) >= 0);
+                assert_se(hashmap_replace(h[DEP_WANTS], FAKE_UNIT(u), FAKE_DATA(u)) >= 0);
+        }
+
+        assert_se(unit_dependency_list_size(l[DEP_WANTS]) == n - 1);
+
+        for (u = 0; u < n * _DEP_MAX; u++) {
+                Iterator i;
+                Unit *other;
+                void *v;
+
+                assert_se(unit_dependency_list_size(l[u]) == hashmap_size(h[u]));
+
+                UNIT_DEPENDENCY_FOREACH(v, other, l[u], i) {
+                        assert_se(hashmap_get(h[u], other) == v);
+                        count++;
+                }
+
+                unit_dependency_list_free(l[u]);
+                hashmap_free(h[u]);
+        }
+
+        assert_se(count > n);
+}
+
+int main(int argc, char *argv[]) {
+        log_parse_environment();
+        log_open();
+
+        test_basic(5);
+        test_basic(100);
+        test_graph(1000);
+
+        return 0;
+}
@@ -8,6 +8,7 @@
 #include <fcntl.h>
 #include <fnmatch.h>
 #include <limits.h>
+#include <link.h>
 #include <stdbool.h>
 #include <stddef.h>
 #include <stdio.h>
@@ -24,8 +25,11 @@
 #include "fd-util.h"
 #include "fs-util.h"
 #include "glob-util.h"
+#include "io-util.h"
 #include "path-util.h"
 #include "proc-cmdline.h"
+#include "section-file.h"
+#include "siphash24.h"
 #include "stat-util.h"
 #include "stdio-util.h"
 #include "strbuf.h"
@@ -54,6 +58,17 @@ static const char* const rules_dirs[] = {
         NULL
 };
 
+/* The parsed rules are saved here, and used by the next process that would parse the very same rules files. Tokens
+ * store enum values whose meaning depends on the build, hence the numbers of token types and builtins are part of the
+ * version, and the build ID is part of the stamp. */
+#define RULES_CACHE_DIR "/run/udev"
+#define RULES_CACHE_SIGNATURE "UDEVRUL1"
+#define RULES_CACHE_VERSION                                             \
+        ((UINT64_C(2) << 48) |                                          \
+         ((uint64_t) TK_END << 32) |                                    \
+         ((uint64_t) UDEV_BUILTIN_MAX << 24) |                          \
+         sizeof(struct token))
+
 struct udev_rules {
         struct udev *udev;
         usec_t dirs_ts_usec;
@@ -67,6 +82,10 @@ struct udev_rules {
         /* all key strings are copied and de-duplicated in a single continuous string buffer */
         struct strbuf *strbuf;
 
+        /* if the rules were loaded from the cache, tokens and strings point into its mapping instead */
+        SectionFile cache;
+        const char *strings;
+
         /* during rule parsing, uid/gid lookup results are cached */
         struct uid_gid *uids;
         unsigned int uids_cur;
@@ -77,7 +96,7 @@ struct udev_rules {
 };
 
 static char *rules_str(struct udev_rules *rules, unsigned int off) {
-        return rules->strbuf->buf + off;
+        return (char*) (rules->strbuf ? rules->strbuf->buf : rules->strings) + off;
 }
 
 static unsigned int rules_add_string(struct udev_rules *rules, const char *s) {
@@ -323,7 +342,7 @@ static void dump_token(struct udev_rules *rules, struct token *token) {
         enum operation_type op = token->key.op;
         enum string_glob_type glob = token->key.glob;
         const char *value = rules_str(rules, token->key.value_off);
-        const char *attr = &rules->strbuf->buf[token->key.attr_off];
+        const char *attr = rules_str(rules, token->key.attr_off);
 
         switch (type) {
         case TK_RULE:
@@ -333,9 +352,9 @@ static void dump_token(struct udev_rules *rules, struct token *token) {
                         unsigned int idx = (tk_ptr - tks_ptr) / sizeof(struct token);
 
                         log_debug("* RULE %s:%u, token: %u, count: %u, label: '%s'",
-                                  &rules->strbuf->buf[token->rule.filename_off], token->rule.filename_line,
+                                  rules_str(rules, token->rule.filename_off), token->rule.filename_line,
                                   idx, token->rule.token_count,
-                                  &rules->strbuf->buf[token->rule.label_off]);
+                                  rules_str(rules, token->rule.label_off));
                         break;
                 }
         case TK_M_ACTION:
@@ -1573,11 +1592,178 @@ static int parse_file(struct udev_rules *rules, const char *filename) {
         return 0;
 }
 
+static const char *rules_cache_path(int resolve_names) {
+        /* udevd and "udevadm test" may resolve names differently, give each setting its own cache so that they
+         * don't keep replacing each other's */
+        if (resolve_names > 0)
+                return RULES_CACHE_DIR "/rules-early.bin";
+        if (resolve_names == 0)
+                return RULES_CACHE_DIR "/rules-late.bin";
+        return RULES_CACHE_DIR "/rules-never.bin";
+}
+
+struct build_id_search {
+        const void *addr;
+        struct siphash *state;
+        bool found;
+};
+
+static int build_id_search_callback(struct dl_phdr_info *info, size_t size, void *userdata) {
+        struct build_id_search *search = userdata;
+        bool ours = false;
+        size_t i;
+
+        for (i = 0; i < info->dlpi_phnum; i++) {
+                const ElfW(Phdr) *ph = info->dlpi_phdr + i;
+                uintptr_t start = info->dlpi_addr + ph->p_vaddr;
+
+                if (ph->p_type == PT_LOAD &&
+                    (uintptr_t) search->addr >= start && (uintptr_t) search->addr < start + ph->p_memsz) {
+                        ours = true;
+                        break;
+                }
+        }
+        if (!ours)
+                return 0;
+
+        for (i = 0; i < info->dlpi_phnum; i++) {
+                const ElfW(Phdr) *ph = info->dlpi_phdr + i;
+                const uint8_t *p, *e;
+
+                if (ph->p_type != PT_NOTE)
+                        continue;
+
+                p = (const uint8_t*) (info->dlpi_addr + ph->p_vaddr);
+                e = p + ph->p_memsz;
+
+                while ((size_t) (e - p) >= sizeof(ElfW(Nhdr))) {
+                        const ElfW(Nhdr) *n = (const ElfW(Nhdr)*) p;
+                        const uint8_t *name = p + sizeof(ElfW(Nhdr)), *desc = name + ALIGN4(n->n_namesz);
+
+                        if (desc > e || (size_t) (e - desc) < ALIGN4(n->n_descsz))
+                                break;
+
+                        if (n->n_type == NT_GNU_BUILD_ID &&
+                            n->n_namesz == sizeof("GNU") && memcmp(name, "GNU", sizeof("GNU")) == 0) {
+                                siphash24_compress(desc, n->n_descsz, search->state);
+                                search->found = true;
+                                return 1;
+                        }
+
+                        p = desc + ALIGN4(n->n_descsz);
+                }
+        }
+
+        return 1;
+}
+
+static int rules_cache_stamp(char **files, int resolve_names, uint64_t *ret) {
+        static const uint8_t key[16] = {
+                0x5c, 0x1e, 0x0b, 0x8d, 0x3a, 0x4f, 0x47, 0x27,
+                0x9e, 0x61, 0x6a, 0x2d, 0xc0, 0x7b, 0x93, 0x12,
+        };
+        struct build_id_search search;
+        struct siphash state;
+        const char *p;
+        char **f;
+
+        assert(ret);
+
+        /* Covers everything the parsed rules depend on: the udev build, the list of rules files and their
+         * modification times, and, if names are resolved while parsing, the user and group databases. */
+
+        siphash24_init(&state, key);
+        siphash24_compress(PACKAGE_VERSION, STRLEN(PACKAGE_VERSION), &state);
+        siphash24_compress(&resolve_names, sizeof(resolve_names), &state);
+
+        /* The version stays the same across rebuilds with backported changes, hence identify the build by the
+         * build ID of the shared library udevd and udevadm have in common, so that both can use the same cache */
+        search = (struct build_id_search) {
+                .addr = (const void*) section_file_map,
+                .state = &state,
+        };
+        (void) dl_iterate_phdr(build_id_search_callback, &search);
+        if (!search.found)
+                return -ENODATA;
+
+        STRV_FOREACH(f, files) {
+                struct stat st;
+
+                if (stat(*f, &st) < 0)
+                        return -errno;
+
+                siphash24_compress(*f, strlen(*f) + 1, &state);
+                siphash24_compress(&st.st_dev, sizeof(st.st_dev), &state);
+                siphash24_compress(&st.st_ino, sizeof(st.st_ino), &state);
+                siphash24_compress(&st.st_size, sizeof(st.st_size), &state);
+                siphash24_compress(&st.st_mtim, sizeof(st.st_mtim), &state);
+        }
+
+        if (resolve_names > 0)
+                FOREACH_STRING(p, "/etc/passwd", "/etc/group") {
+                        struct stat st = {};
+
+                        (void) stat(p, &st);
+                        siphash24_compress(&st.st_ino, sizeof(st.st_ino), &state);
+                        siphash24_compress(&st.st_mtim, sizeof(st.st_mtim), &state);
+                }
+
+        *ret = siphash24_finalize(&state);
+        return 0;
+}
+
+static int rules_load_cache(struct udev_rules *rules, uint64_t stamp) {
+        SectionFile f;
+        const struct iovec *tokens, *strings;
+        int r;
+
+        r = section_file_map(rules_cache_path(rules->resolve_names), RULES_CACHE_SIGNATURE, RULES_CACHE_VERSION, &f);
+        if (r < 0)
+                return r;
+
+        if (f.stamp != stamp || f.n_sections != 2)
+                goto stale;
+
+        tokens = f.sections + 0;
+        strings = f.sections + 1;
+
+        if (tokens->iov_len == 0 || tokens->iov_len % sizeof(struct token) != 0 ||
+            tokens->iov_len / sizeof(struct token) > UINT_MAX ||
+            ((const struct token*) tokens->iov_base)[tokens->iov_len / sizeof(struct token) - 1].type != TK_END ||
+            strings->iov_len == 0 || ((const char*) strings->iov_base)[strings->iov_len - 1] != 0)
+                goto stale;
+
+        rules->cache = f;
+        rules->tokens = tokens->iov_base;
+        rules->token_cur = rules->token_max = tokens->iov_len / sizeof(struct token);
+        rules->strings = strings->iov_base;
+
+        log_debug("Loaded %u tokens, %zu bytes strings from %s", rules->token_cur, strings->iov_len,
+                  rules_cache_path(rules->resolve_names));
+        return 0;
+
+stale:
+        section_file_unmap(&f);
+        return -ESTALE;
+}
+
+static int rules_save_cache(struct udev_rules *rules, uint64_t stamp) {
+        const struct iovec sections[] = {
+                IOVEC_INIT(rules->tokens, rules->token_cur * sizeof(struct token)),
+                IOVEC_INIT(rules->strbuf->buf, rules->strbuf->len),
+        };
+
+        return section_file_write(rules_cache_path(rules->resolve_names), RULES_CACHE_SIGNATURE, RULES_CACHE_VERSION,
+                                  stamp, sections, ELEMENTSOF(sections), 0644);
+}
+
 struct udev_rules *udev_rules_new(struct udev *udev, int resolve_names) {
         struct udev_rules *rules;
         struct udev_list file_list;
         struct token end_token;
         char **files, **f;
+        uint64_t stamp;
+        bool have_stamp;
         int r;
 
         rules = new0(struct udev_rules, 1);
@@ -1587,21 +1773,36 @@ struct udev_rules *udev_rules_new(struct udev *udev, int resolve_names) {
         rules->resolve_names = resolve_names;
         udev_list_init(udev, &file_list, true);
 
+        udev_rules_check_timestamp(rules);
+
+        r = conf_files_list_strv(&files, ".rules", NULL, 0, rules_dirs);
+        if (r < 0) {
+                log_error_errno(r, "failed to enumerate rules files: %m");
+                return udev_rules_unref(rules);
+        }
+
+        have_stamp = rules_cache_stamp(files, resolve_names, &stamp) >= 0;
+        if (have_stamp) {
+                r = rules_load_cache(rules, stamp);
+                if (r >= 0) {
+                        strv_free(files);
+                        return rules;
+                }
+                if (r != -ENOENT)
+                        log_debug_errno(r, "Not using %s, parsing rules: %m", rules_cache_path(resolve_names));
+        }
+
         /* init token array and string buffer */
         rules->tokens = malloc_multiply(PREALLOC_TOKEN, sizeof(struct token));
-        if (rules->tokens == NULL)
+        if (rules->tokens == NULL) {
+                strv_free(files);
                 return udev_rules_unref(rules);
+        }
         rules->token_max = PREALLOC_TOKEN;
 
         rules->strbuf = strbuf_new();
-        if (!rules->strbuf)
-                return udev_rules_unref(rules);
-
-        udev_rules_check_timestamp(rules);
-
-        r = conf_files_list_strv(&files, ".rules", NULL, 0, rules_dirs);
-        if (r < 0) {
-                log_error_errno(r, "failed to enumerate rules files: %m");
+        if (!rules->strbuf) {
+                strv_free(files);
                 return udev_rules_unref(rules);
         }
 
@@ -1637,6 +1838,12 @@ struct udev_rules *udev_rules_new(struct udev *udev, int resolve_names) {
         rules->gids_cur = 0;
         rules->gids_max = 0;
 
+        if (have_stamp) {
+                r = rules_save_cache(rules, stamp);
+                if (r < 0)
+                        log_debug_errno(r, "Failed to write %s, ignoring: %m", rules_cache_path(resolve_names));
+        }
+
         dump_rules(rules);
         return rules;
 }
@@ -1644,7 +1851,10 @@ struct udev_rules *udev_rules_new(struct udev *udev, int resolve_names) {
 struct udev_rules *udev_rules_unref(struct udev_rules *rules) {
         if (rules == NULL)
                 return NULL;
-        free(rules->tokens);
+        if (rules->cache.map)
+                section_file_unmap(&rules->cache);
+        else
+                free(rules->tokens);
         strbuf_cleanup(rules->strbuf);
         free(rules->uids);
         free(rules->gids);